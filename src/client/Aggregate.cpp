@@ -0,0 +1,161 @@
+/**
+ * @file Aggregate.cpp
+ *
+ * @copyright Copyright (C) 2014-2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <Aggregate.hpp>
+#include <cstring>
+
+Aggregate::Aggregate(const std::string& mode, const boost::optional<std::string>& group_by, int max_threads)
+    : mode(mode), group_by(group_by), partials(max_threads > 0 ? max_threads : 1) {}
+
+bool Aggregate::isMode(const std::string& mode) {
+
+    return mode == "sum" || mode == "count" || mode == "min" || mode == "max";
+}
+
+bool Aggregate::isGroup(const std::string& group_by) {
+
+    return group_by == "language" || group_by == "filename" || group_by == "directory" || group_by == "version";
+}
+
+void Aggregate::Partial::add(double value) {
+
+    if (count == 0 || value < min)
+        min = value;
+    if (count == 0 || value > max)
+        max = value;
+    sum += value;
+    ++count;
+}
+
+void Aggregate::Partial::merge(const Partial& other) {
+
+    if (other.count == 0)
+        return;
+
+    if (count == 0 || other.min < min)
+        min = other.min;
+    if (count == 0 || other.max > max)
+        max = other.max;
+    sum += other.sum;
+    count += other.count;
+}
+
+/* group of the unit, empty when not grouping */
+std::string Aggregate::group(const srcml_unit* unit) const {
+
+    if (!group_by || !unit)
+        return "";
+
+    const char* value = nullptr;
+    if (*group_by == "language")
+        value = srcml_unit_get_language(unit);
+    else if (*group_by == "version")
+        value = srcml_unit_get_version(unit);
+    else
+        value = srcml_unit_get_filename(unit);
+
+    if (!value)
+        return "";
+
+    if (*group_by != "directory")
+        return value;
+
+    // directory prefix of the filename
+    const char* slash = strrchr(value, '/');
+    return slash ? std::string(value, slash) : ".";
+}
+
+/* only accessed by the worker thread thread_id, so no lock is needed */
+void Aggregate::add(int thread_id, const srcml_unit* unit, srcml_transform_result* result) {
+
+    double value = 0;
+    switch (srcml_transform_get_type(result)) {
+    case SRCML_RESULT_NUMBER:
+        value = srcml_transform_get_number(result);
+        break;
+
+    case SRCML_RESULT_BOOLEAN:
+        value = srcml_transform_get_bool(result) ? 1 : 0;
+        break;
+
+    case SRCML_RESULT_UNITS:
+        value = srcml_transform_get_unit_size(result);
+        break;
+
+    case SRCML_RESULT_STRING:
+        // strings have no value to aggregate
+        return;
+
+    default:
+        break;
+    };
+
+    add(thread_id, unit, value);
+}
+
+/* only accessed by the worker thread thread_id, so no lock is needed */
+void Aggregate::add(int thread_id, const srcml_unit* unit, double value) {
+
+    partials[thread_id][group(unit)].add(value);
+}
+
+void Aggregate::write(srcml_archive* archive) const {
+
+    // reduce the partial aggregates of the worker threads
+    std::map<std::string, Partial> total;
+    for (const auto& partial : partials) {
+        for (const auto& entry : partial)
+            total[entry.first].merge(entry.second);
+    }
+
+    // sum and count are always defined, even with no units
+    if (!group_by && (mode == "sum" || mode == "count"))
+        total[""];
+
+    for (const auto& entry : total) {
+
+        const Partial& partial = entry.second;
+        if (partial.count == 0 && (mode == "min" || mode == "max"))
+            continue;
+
+        double value = partial.sum;
+        if (mode == "count")
+            value = (double) partial.count;
+        else if (mode == "min")
+            value = partial.min;
+        else if (mode == "max")
+            value = partial.max;
+
+        std::string s;
+        if (group_by) {
+            s += entry.first;
+            s += '\t';
+        }
+        if (value != (long long) value)
+            s += std::to_string(value);
+        else
+            s += std::to_string((long long) value);
+        s += '\n';
+
+        srcml_archive_write_string(archive, s.c_str(), (int) s.size());
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file Aggregate.hpp
+ *
+ * @copyright Copyright (C) 2014-2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include <srcml.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/optional.hpp>
+
+/*
+  Aggregate of the per-unit results of a query over the entire input.
+
+  Each unit contributes a single value: the number for a numeric result, 1 or 0
+  for a boolean result, and the number of units for a unit result. Each worker
+  thread of the parse queue accumulates into its own partial result, so no locking
+  is needed, and the partials are reduced once when all units are processed.
+*/
+class Aggregate {
+
+public:
+    Aggregate(const std::string& mode, const boost::optional<std::string>& group_by, int max_threads);
+
+    // valid aggregate modes, and unit attributes to group by
+    static bool isMode(const std::string& mode);
+    static bool isGroup(const std::string& group_by);
+
+    // add the result of a unit to the partial aggregate of the worker thread
+    void add(int thread_id, const srcml_unit* unit, srcml_transform_result* result);
+
+    // add the value of a unit to the partial aggregate of the worker thread
+    void add(int thread_id, const srcml_unit* unit, double value);
+
+    // reduce the partial aggregates, and write the result
+    void write(srcml_archive* archive) const;
+
+private:
+    struct Partial {
+        double sum = 0;
+        long count = 0;
+        double min = 0;
+        double max = 0;
+
+        void add(double value);
+        void merge(const Partial& other);
+    };
+
+    // group of the unit
+    std::string group(const srcml_unit* unit) const;
+
+    std::string mode;
+    boost::optional<std::string> group_by;
+
+    // partial aggregates by group, one for each worker thread
+    std::vector<std::map<std::string, Partial>> partials;
+};
+
+#endif
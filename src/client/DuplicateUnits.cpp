@@ -0,0 +1,53 @@
+/**
+ * @file DuplicateUnits.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <DuplicateUnits.hpp>
+#include <source_hash.hpp>
+
+bool DuplicateUnits::check(ParseRequest& request) {
+
+    if (!request.needsparsing || request.language.empty())
+        return false;
+
+    // the source is either read into the request, or still in the file
+    std::string hash;
+    if (request.disk_filename) {
+        if (!source_file_hash(*request.disk_filename, hash))
+            return false;
+    } else {
+        hash = source_hash(request.buffer);
+    }
+
+    std::string key = hash;
+    key += '\0';
+    key += request.language;
+
+    if (sources.insert(key).second)
+        return false;
+
+    request.duplicate = hash;
+
+    // the source is not needed
+    std::vector<char>().swap(request.buffer);
+
+    return true;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file DuplicateUnits.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef DUPLICATEUNITS_HPP
+#define DUPLICATEUNITS_HPP
+
+#include <ParseRequest.hpp>
+#include <string>
+#include <unordered_set>
+
+/*
+  Units with the same source as an earlier unit in a dedup archive.
+
+  The source of each request is hashed before it is parsed, in the order the
+  requests are scheduled, which is the order the units are written. A request
+  with the same hash and language as an earlier request is not parsed, and its
+  unit is written as a reference to the unit of the earlier request.
+*/
+class DuplicateUnits {
+
+public:
+    // in the order the requests are scheduled, decide if the request is a duplicate
+    bool check(ParseRequest& request);
+
+private:
+    // hash and language of the source of each request
+    std::unordered_set<std::string> sources;
+};
+
+#endif
@@ -26,19 +26,38 @@
 #include <ParseRequest.hpp>
 #include <WriteQueue.hpp>
 #include <ctpl_stl.h>
+#include <ParseScheduler.hpp>
 #include <mutex>
 #include <srcml_consume.hpp>
 #include <memory>
 #include <srcml_utilities.hpp>
+#include <UpdateArchive.hpp>
+#include <DuplicateUnits.hpp>
 
 class ParseQueue {
 public:
 
-    ParseQueue(int max_threads, WriteQueue* write_queue)
-        : pool(max_threads), wqueue(write_queue) {}
+    ParseQueue(int max_threads, WriteQueue* write_queue, const std::vector<srcml_archive*>* query_archives = nullptr, Aggregate* aggregate = nullptr,
+               UpdateArchive* update = nullptr, DuplicateUnits* duplicates = nullptr, bool schedule_by_size = false)
+        : wqueue(write_queue), query_archives(query_archives), aggregate(aggregate), update(update), duplicates(duplicates) {
+
+        // the size-aware scheduler is only used on request, until it is measured against the thread pool
+        if (schedule_by_size)
+            scheduler.reset(new ParseScheduler(max_threads, 16 * max_threads, write_queue));
+        else
+            pool.reset(new ctpl::thread_pool(max_threads));
+    }
 
     inline void schedule(std::shared_ptr<ParseRequest> pvalue) {
 
+        // size of the source, unless known from the input before it is read
+        if (!pvalue->size)
+            pvalue->size = pvalue->buffer.size();
+
+        // block the producer until the write queue has room, before taking a position,
+        // so that every position handed out can be written
+        wqueue->reserve(*pvalue);
+
         int next;
         {
             std::unique_lock<std::mutex> l(e);
@@ -46,6 +65,8 @@ public:
             next = ++counter;
         }
         pvalue->position = next;
+        pvalue->query_archs = query_archives;
+        pvalue->aggregate = aggregate;
 
         // error passthrough to output for proper output in trace
         if (pvalue->status) {
@@ -54,17 +75,38 @@ public:
             return;
         }
 
-        pool.push(srcml_consume, pvalue, wqueue);
+        // duplicate of an earlier unit is marked instead of parsed
+        if (duplicates)
+            duplicates->check(*pvalue);
+
+        // unchanged unit of the previous archive is copied by the write queue, without parsing
+        if (!pvalue->duplicate && update && update->reuse(*pvalue)) {
+            wqueue->schedule(pvalue);
+            return;
+        }
+
+        if (scheduler)
+            scheduler->push(pvalue);
+        else
+            pool->push(srcml_consume, pvalue, wqueue);
     }
 
     inline void wait() {
 
-        pool.stop(true);
+        if (scheduler)
+            scheduler->stop();
+        else
+            pool->stop(true);
     }
 
 private:
-    ctpl::thread_pool pool;
+    std::unique_ptr<ctpl::thread_pool> pool;
+    std::unique_ptr<ParseScheduler> scheduler;
     WriteQueue* wqueue;
+    const std::vector<srcml_archive*>* query_archives;
+    Aggregate* aggregate;
+    UpdateArchive* update;
+    DuplicateUnits* duplicates;
     int counter = 0;
     std::mutex e;
 };
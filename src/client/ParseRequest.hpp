@@ -29,6 +29,9 @@
 #include <srcml_utilities.hpp>
 #include <memory>
 #include <boost/optional.hpp>
+#include <Aggregate.hpp>
+
+class UpdateArchive;
 
 struct ParseRequest {
     ParseRequest(int size = 0) : buffer(size) {}
@@ -45,12 +48,19 @@ struct ParseRequest {
     boost::optional<std::string> disk_dir;
     std::string parsertest_filename;
     int position = 0;
+    size_t size = 0;
     int status = 0;
     double runtime = 0;
     boost::optional<std::string> time_stamp;
     boost::optional<std::string> errormsg;
     bool needsparsing = true;
     srcml_transform_result* results = nullptr;
+    const std::vector<srcml_archive*>* query_archs = nullptr;
+    std::vector<srcml_transform_result*> query_results;
+    Aggregate* aggregate = nullptr;
+    UpdateArchive* update = nullptr;
+    boost::optional<int> previous;
+    boost::optional<std::string> duplicate;
     std::shared_ptr<srcml_archive> input_archive;
 };
 
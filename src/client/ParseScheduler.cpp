@@ -0,0 +1,181 @@
+/**
+ * @file ParseScheduler.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <ParseScheduler.hpp>
+#include <srcml_consume.hpp>
+
+namespace {
+
+    // requests dispatched to a worker ahead of the one it is parsing
+    const size_t WORKER_DEPTH = 2;
+}
+
+ParseScheduler::ParseScheduler(int max_threads, size_t lookahead, WriteQueue* write_queue)
+    : lookahead(lookahead), wqueue(write_queue), pending(&ParseScheduler::smaller) {
+
+    if (max_threads < 1)
+        max_threads = 1;
+
+    for (int i = 0; i < max_threads; ++i)
+        workers.emplace_back(new Worker);
+
+    for (int i = 0; i < max_threads; ++i)
+        threads.emplace_back(&ParseScheduler::process, this, i);
+}
+
+// order of the lookahead, largest source first, then in input order
+bool ParseScheduler::smaller(const std::shared_ptr<ParseRequest>& r1, const std::shared_ptr<ParseRequest>& r2) {
+
+    if (r1->size != r2->size)
+        return r1->size < r2->size;
+
+    return r1->position > r2->position;
+}
+
+void ParseScheduler::push(std::shared_ptr<ParseRequest> request) {
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    pending.push(request);
+
+    dispatch();
+
+    cv.notify_all();
+
+    while (pending.size() > lookahead)
+        room.wait(lock);
+}
+
+// called with the lock of the scheduler held, so all pushes to a worker deque are seen by a waiting worker
+void ParseScheduler::dispatch() {
+
+    while (!pending.empty()) {
+
+        // worker with room and the fewest bytes queued
+        Worker* least = nullptr;
+        size_t leastbytes = 0;
+        for (auto& worker : workers) {
+
+            std::lock_guard<std::mutex> lock(worker->mutex);
+
+            if (worker->requests.size() >= WORKER_DEPTH)
+                continue;
+
+            if (!least || worker->bytes < leastbytes) {
+                least = worker.get();
+                leastbytes = worker->bytes;
+            }
+        }
+        if (!least)
+            return;
+
+        auto request = pending.top();
+        pending.pop();
+
+        std::lock_guard<std::mutex> lock(least->mutex);
+
+        least->requests.push_back(request);
+        least->bytes += request->size;
+    }
+}
+
+std::shared_ptr<ParseRequest> ParseScheduler::next(int id) {
+
+    while (true) {
+
+        // own deque first, then steal from the back of the others, where the smaller requests are
+        std::shared_ptr<ParseRequest> request;
+        for (size_t i = 0; i < workers.size() && !request; ++i) {
+
+            Worker& worker = *workers[(id + i) % workers.size()];
+
+            std::lock_guard<std::mutex> lock(worker.mutex);
+
+            if (worker.requests.empty())
+                continue;
+
+            if (i == 0) {
+                request = worker.requests.front();
+                worker.requests.pop_front();
+            } else {
+                request = worker.requests.back();
+                worker.requests.pop_back();
+            }
+            worker.bytes -= request->size;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // an idle worker does not wait for the lookahead to be dispatched
+        if (!request && !pending.empty()) {
+            request = pending.top();
+            pending.pop();
+        }
+
+        if (request) {
+
+            // refill the deque that was taken from, and make room for the producer
+            dispatch();
+            room.notify_all();
+
+            return request;
+        }
+
+        // requests may have been dispatched since the deques were checked
+        bool queued = false;
+        for (auto& worker : workers) {
+            std::lock_guard<std::mutex> wlock(worker->mutex);
+            if (!worker->requests.empty()) {
+                queued = true;
+                break;
+            }
+        }
+        if (queued)
+            continue;
+
+        if (stopped)
+            return nullptr;
+
+        cv.wait(lock);
+    }
+}
+
+void ParseScheduler::process(int id) {
+
+    while (auto request = next(id))
+        srcml_consume(id, request, wqueue);
+}
+
+void ParseScheduler::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        stopped = true;
+    }
+
+    cv.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+}
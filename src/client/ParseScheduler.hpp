@@ -0,0 +1,90 @@
+/**
+ * @file ParseScheduler.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef PARSESCHEDULER_HPP
+#define PARSESCHEDULER_HPP
+
+#include <ParseRequest.hpp>
+#include <WriteQueue.hpp>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+  Parse scheduler for the worker threads, by the size of the source.
+
+  Scheduled requests wait in a lookahead of a bounded number of requests, and the
+  largest is dispatched first, so a large file does not become a long tail after
+  the smaller files that sort before it. The producer waits while the lookahead is
+  full. Each worker has a short deque of dispatched requests, refilled from the
+  lookahead as the worker takes from the front. An idle worker steals from the back
+  of the deque of another worker, where the smaller requests are, and then takes
+  from the lookahead directly, so no request waits while a worker is idle. The order
+  of the output is kept by the write queue. Used with --schedule-by-size, instead of
+  the thread pool that parses in input order.
+*/
+class ParseScheduler {
+
+public:
+    ParseScheduler(int max_threads, size_t lookahead, WriteQueue* write_queue);
+
+    // schedule a request for parsing, waiting while the lookahead is full
+    void push(std::shared_ptr<ParseRequest> request);
+
+    // parse all scheduled requests, and stop the worker threads
+    void stop();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<ParseRequest>> requests;
+        size_t bytes = 0;
+    };
+
+    // move the largest requests of the lookahead to the worker deques with room
+    void dispatch();
+
+    // next request for the worker, or null when stopped
+    std::shared_ptr<ParseRequest> next(int id);
+
+    // actual process of each worker thread
+    void process(int id);
+
+    static bool smaller(const std::shared_ptr<ParseRequest>& r1, const std::shared_ptr<ParseRequest>& r2);
+
+    size_t lookahead;
+    WriteQueue* wqueue;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::priority_queue<std::shared_ptr<ParseRequest>, std::vector<std::shared_ptr<ParseRequest>>,
+                        bool (*)(const std::shared_ptr<ParseRequest>&, const std::shared_ptr<ParseRequest>&)> pending;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable room;
+    bool stopped = false;
+};
+
+#endif
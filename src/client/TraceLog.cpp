@@ -27,6 +27,10 @@
 #include <iostream>
 
 size_t TraceLog::loc = 0;
+size_t TraceLog::hits = 0;
+size_t TraceLog::misses = 0;
+bool TraceLog::updated = false;
+size_t TraceLog::reused = 0;
 
 TraceLog::TraceLog()
     : enabled(option(SRCML_COMMAND_VERBOSE)) {
@@ -43,6 +43,32 @@ public:
         return loc;
     }
 
+    inline void cache(size_t fhits, size_t fmisses) {
+        hits += fhits;
+        misses += fmisses;
+    }
+
+    inline static size_t cacheHits() {
+        return hits;
+    }
+
+    inline static size_t cacheMisses() {
+        return misses;
+    }
+
+    inline void update(size_t freused) {
+        updated = true;
+        reused += freused;
+    }
+
+    inline static bool updateRan() {
+        return updated;
+    }
+
+    inline static size_t updateReused() {
+        return reused;
+    }
+
     inline void skip() {
         ++num_skipped;
     }
@@ -55,6 +81,10 @@ private:
     int num_skipped = 0;
     int num_error = 0;
     static size_t loc;
+    static size_t hits;
+    static size_t misses;
+    static bool updated;
+    static size_t reused;
 };
 
 #endif
@@ -0,0 +1,112 @@
+/**
+ * @file UnitChannel.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <UnitChannel.hpp>
+
+UnitChannel::~UnitChannel() {
+
+    for (auto unit : units)
+        srcml_unit_free(unit);
+}
+
+int UnitChannel::write_unit(void* context, srcml_unit* unit) {
+
+    auto channel = static_cast<UnitChannel*>(context);
+
+    {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+
+        while (channel->units.size() >= channel->capacity && !channel->read_closed)
+            channel->cv.wait(lock);
+
+        // nothing is reading the units
+        if (channel->read_closed) {
+            lock.unlock();
+            srcml_unit_free(unit);
+            return -1;
+        }
+
+        channel->units.push_back(unit);
+    }
+
+    channel->cv.notify_all();
+
+    return 0;
+}
+
+int UnitChannel::close_write(void* context) {
+
+    auto channel = static_cast<UnitChannel*>(context);
+
+    {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+
+        channel->write_closed = true;
+    }
+
+    channel->cv.notify_all();
+
+    return 0;
+}
+
+srcml_unit* UnitChannel::read_unit(void* context) {
+
+    auto channel = static_cast<UnitChannel*>(context);
+
+    srcml_unit* unit = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+
+        while (channel->units.empty() && !channel->write_closed)
+            channel->cv.wait(lock);
+
+        if (channel->units.empty())
+            return nullptr;
+
+        unit = channel->units.front();
+        channel->units.pop_front();
+    }
+
+    channel->cv.notify_all();
+
+    return unit;
+}
+
+int UnitChannel::close_read(void* context) {
+
+    auto channel = static_cast<UnitChannel*>(context);
+
+    std::deque<srcml_unit*> unread;
+    {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+
+        channel->read_closed = true;
+        unread.swap(channel->units);
+    }
+
+    channel->cv.notify_all();
+
+    for (auto unit : unread)
+        srcml_unit_free(unit);
+
+    return 0;
+}
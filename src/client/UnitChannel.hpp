@@ -0,0 +1,63 @@
+/**
+ * @file UnitChannel.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef UNIT_CHANNEL_HPP
+#define UNIT_CHANNEL_HPP
+
+#include <srcml.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/*
+  Bounded channel of srcML units between two steps of the pipeline in the same process.
+
+  The earlier step writes to an archive opened with srcml_archive_write_open_units(),
+  and the later step reads from an archive opened with srcml_archive_read_open_units(),
+  so the units are not serialized to srcML and parsed again as they would be on a pipe.
+  The writer waits while the channel is full. Once the reader closes, any units written
+  are discarded, as when the read end of a pipe is closed.
+*/
+class UnitChannel {
+
+public:
+    UnitChannel(size_t capacity = 64) : capacity(capacity) {}
+    ~UnitChannel();
+
+    // callbacks for srcml_archive_write_open_units()
+    static int write_unit(void* context, srcml_unit* unit);
+    static int close_write(void* context);
+
+    // callbacks for srcml_archive_read_open_units()
+    static srcml_unit* read_unit(void* context);
+    static int close_read(void* context);
+
+private:
+    size_t capacity;
+    std::deque<srcml_unit*> units;
+    bool write_closed = false;
+    bool read_closed = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file UnparseQueue.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <UnparseQueue.hpp>
+
+UnparseQueue::UnparseQueue(int max_threads, std::function<void(UnparseRequest&)> unparse,
+                           std::function<void(UnparseRequest&)> write)
+    : unparse(unparse), write(write) {
+
+    // without threads, each unit is unparsed and written when it is scheduled
+    if (max_threads < 1)
+        return;
+
+    // units unparsed ahead of the writer, so the workers are not idle while it writes
+    window = 4 * max_threads;
+
+    for (int i = 0; i < max_threads; ++i)
+        workers.emplace_back(&UnparseQueue::unparse_process, this);
+
+    if (write)
+        write_thread = std::thread(&UnparseQueue::write_process, this);
+}
+
+void UnparseQueue::schedule(std::shared_ptr<UnparseRequest> request) {
+
+    if (workers.empty()) {
+
+        unparse(*request);
+        if (write)
+            write(*request);
+
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (inflight >= window)
+            cv.wait(lock);
+
+        ++inflight;
+        pending.push_back(request);
+        if (write)
+            ordered.push_back(request);
+    }
+
+    cv.notify_all();
+}
+
+void UnparseQueue::unparse_process() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+
+        while (pending.empty() && !completed)
+            cv.wait(lock);
+        if (pending.empty())
+            return;
+
+        auto request = pending.front();
+        pending.pop_front();
+        lock.unlock();
+
+        unparse(*request);
+
+        // without a writer, the unit is complete
+        if (!write)
+            request.reset();
+
+        lock.lock();
+        if (request)
+            request->done = true;
+        else
+            --inflight;
+        cv.notify_all();
+    }
+}
+
+void UnparseQueue::write_process() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+
+        while ((ordered.empty() && !completed) || (!ordered.empty() && !ordered.front()->done))
+            cv.wait(lock);
+        if (ordered.empty())
+            return;
+
+        auto request = ordered.front();
+        ordered.pop_front();
+        lock.unlock();
+
+        write(*request);
+        request.reset();
+
+        lock.lock();
+        --inflight;
+        cv.notify_all();
+    }
+}
+
+void UnparseQueue::wait() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (inflight)
+        cv.wait(lock);
+}
+
+void UnparseQueue::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        completed = true;
+    }
+
+    cv.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+
+    if (write_thread.joinable())
+        write_thread.join();
+}
@@ -0,0 +1,91 @@
+/**
+ * @file UnparseQueue.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef UNPARSE_QUEUE_HPP
+#define UNPARSE_QUEUE_HPP
+
+#include <srcml.h>
+#include <srcml_utilities.hpp>
+#include <string>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+struct UnparseRequest {
+    ~UnparseRequest() { if (buffer) srcml_memory_free(buffer); }
+
+    std::unique_ptr<srcml_unit> unit;
+    std::string filename;
+    char* buffer = nullptr;
+    size_t size = 0;
+    int status = SRCML_STATUS_OK;
+    bool done = false;
+};
+
+/*
+  Conversion of srcML units back to source on a pool of worker threads.
+
+  The reader schedules the units in the order they are read, and waits while the
+  window of units not yet written is full. Each unit is unparsed by a worker,
+  and, when there is a write, the units are written by a single writer thread
+  in the order they were scheduled, e.g., for entries of a source archive, or the
+  separators between units on standard output. Without a write, the unparse is the
+  output, e.g., a file of its own, and units complete in any order. With no threads,
+  each unit is unparsed and written by the reader as it is scheduled.
+*/
+class UnparseQueue {
+
+public:
+    UnparseQueue(int max_threads, std::function<void(UnparseRequest&)> unparse,
+                 std::function<void(UnparseRequest&)> write = nullptr);
+
+    // schedule a unit for unparsing, waiting while the window is full
+    void schedule(std::shared_ptr<UnparseRequest> request);
+
+    // wait until all scheduled units are written
+    void wait();
+
+    // finish all scheduled units, and stop the threads
+    void stop();
+
+private:
+    void unparse_process();
+    void write_process();
+
+    std::function<void(UnparseRequest&)> unparse;
+    std::function<void(UnparseRequest&)> write;
+    size_t window = 0;
+    std::deque<std::shared_ptr<UnparseRequest>> pending;
+    std::deque<std::shared_ptr<UnparseRequest>> ordered;
+    size_t inflight = 0;
+    bool completed = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::thread> workers;
+    std::thread write_thread;
+};
+
+#endif
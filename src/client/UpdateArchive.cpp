@@ -0,0 +1,212 @@
+/**
+ * @file UpdateArchive.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <UpdateArchive.hpp>
+#include <source_hash.hpp>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+    // optional string from a possibly null string
+    boost::optional<std::string> optional_string(const char* s) {
+
+        return s ? boost::optional<std::string>(s) : boost::none;
+    }
+
+    // equal, possibly null strings
+    bool equal_string(const char* s1, const char* s2) {
+
+        return (!s1 && !s2) || (s1 && s2 && strcmp(s1, s2) == 0);
+    }
+}
+
+UpdateArchive::UpdateArchive(const std::string& archive_filename) : filename(archive_filename), output_filename(archive_filename + ".update") {
+
+    OpenFileLimiter::open();
+    std::unique_ptr<srcml_archive> headers(srcml_archive_create());
+    if (!headers || srcml_archive_read_open_filename(headers.get(), filename.c_str()) != SRCML_STATUS_OK)
+        return;
+
+    // units of a single file have no hash
+    if (srcml_archive_is_solitary_unit(headers.get()))
+        return;
+
+    // only the headers of the units are parsed
+    int position = 0;
+    while (std::unique_ptr<srcml_unit> unit{ srcml_archive_read_unit_header(headers.get()) }) {
+
+        const char* hash = srcml_unit_get_hash(unit.get());
+        const char* unit_filename = srcml_unit_get_filename(unit.get());
+        const char* language = srcml_unit_get_language(unit.get());
+        if (hash && unit_filename && language) {
+            units.emplace(unit_filename, Entry{ position, hash, language,
+                optional_string(srcml_unit_get_version(unit.get())), optional_string(srcml_unit_get_timestamp(unit.get())) });
+        }
+
+        ++position;
+    }
+
+    OpenFileLimiter::open();
+    reader.reset(srcml_archive_create());
+    if (!reader)
+        return;
+    srcml_archive_set_read_content(reader.get(), SRCML_READ_CONTENT_SRCML);
+    srcml_archive_set_dedup_expand(reader.get(), DEDUP_EXPAND_SIZE);
+    if (srcml_archive_read_open_filename(reader.get(), filename.c_str()) != SRCML_STATUS_OK)
+        return;
+
+    // the options of the previous archive to compare with the output archive
+    usable = true;
+    headers.swap(previous);
+}
+
+UpdateArchive::~UpdateArchive() {
+
+    previous.reset();
+    reader.reset();
+
+    // an incomplete output archive leaves the previous archive as it was
+    if (!replaced)
+        std::remove(output_filename.c_str());
+}
+
+/* called after the output archive is closed without errors */
+bool UpdateArchive::replace() {
+
+    previous.reset();
+    reader.reset();
+
+    if (std::rename(output_filename.c_str(), filename.c_str()) != 0)
+        return false;
+
+    replaced = true;
+
+    return true;
+}
+
+/*
+  The srcML of a unit depends on the markup options, tabstop, namespace prefixes, and
+  revision of the archive. Any difference from the previous archive and no unit is reused.
+*/
+void UpdateArchive::check(srcml_archive* output_archive) {
+
+    if (!usable)
+        return;
+
+    usable = false;
+
+    const unsigned long long markup = SRCML_OPTION_POSITION | SRCML_OPTION_CPP_TEXT_ELSE | SRCML_OPTION_CPP_MARKUP_IF0;
+    if ((srcml_archive_get_options(previous.get()) & markup) != (srcml_archive_get_options(output_archive) & markup))
+        return;
+
+    if ((srcml_archive_get_options(output_archive) & SRCML_OPTION_POSITION)
+        && srcml_archive_get_tabstop(previous.get()) != srcml_archive_get_tabstop(output_archive))
+        return;
+
+    if (!equal_string(srcml_archive_get_revision(previous.get()), srcml_archive_get_revision(output_archive)))
+        return;
+
+    if (!equal_string(srcml_archive_get_src_encoding(previous.get()), srcml_archive_get_src_encoding(output_archive)))
+        return;
+
+    // name filters are on all units of an archive, or none
+    if (srcml_archive_has_name_filter(previous.get()) != srcml_archive_has_name_filter(output_archive) || !srcml_archive_has_hash(output_archive))
+        return;
+
+    // same prefix for each namespace
+    size_t size = srcml_archive_get_namespace_size(previous.get());
+    if (size != srcml_archive_get_namespace_size(output_archive))
+        return;
+
+    for (size_t i = 0; i < size; ++i) {
+        const char* uri = srcml_archive_get_namespace_uri(previous.get(), i);
+        if (!equal_string(srcml_archive_get_namespace_prefix(previous.get(), i), srcml_archive_get_prefix_from_uri(output_archive, uri)))
+            return;
+    }
+
+    store_loc = (srcml_archive_get_options(output_archive) & SRCML_OPTION_STORE_LOC) != 0;
+
+    usable = true;
+}
+
+/* called by the single thread that schedules requests, so no lock is needed */
+bool UpdateArchive::reuse(ParseRequest& request) {
+
+    if (!usable || request.status || !request.needsparsing || !request.filename)
+        return false;
+
+    // filename as in the unit
+    std::string unit_filename = *request.filename;
+    while (unit_filename.size() > 2 && unit_filename[0] == '.' && unit_filename[1] == '/')
+        unit_filename.erase(0, 2);
+
+    auto it = units.find(unit_filename);
+    if (it == units.end())
+        return false;
+
+    // previous units are read in order, so a unit before an already reused unit is parsed
+    const Entry& entry = it->second;
+    if (entry.position < next)
+        return false;
+
+    if (entry.language != request.language || entry.version != request.version || entry.timestamp != request.time_stamp)
+        return false;
+
+    // the source is either read into the request, or still in the file
+    std::string hash;
+    if (request.disk_filename) {
+        if (!source_file_hash(*request.disk_filename, hash))
+            return false;
+    } else {
+        hash = source_hash(request.buffer);
+    }
+
+    if (entry.hash != hash)
+        return false;
+
+    request.previous = entry.position;
+    request.update = this;
+    next = entry.position + 1;
+    ++reused;
+
+    // the source is not needed
+    std::vector<char>().swap(request.buffer);
+
+    return true;
+}
+
+/* called by the single thread that writes units, in the order they were scheduled */
+std::unique_ptr<srcml_unit> UpdateArchive::unit(int position) {
+
+    for (; read < position; ++read)
+        srcml_archive_skip_unit(reader.get());
+
+    std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(reader.get()));
+    ++read;
+
+    // the loc is stored on the output unit, even if the previous unit did not have it
+    if (unit && store_loc)
+        srcml_unit_get_loc(unit.get());
+
+    return unit;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file UpdateArchive.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef UPDATEARCHIVE_HPP
+#define UPDATEARCHIVE_HPP
+
+#include <srcml.h>
+#include <ParseRequest.hpp>
+#include <srcml_utilities.hpp>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <boost/optional.hpp>
+
+/*
+  Previous srcML archive of an update of the output archive.
+
+  A unit of the previous archive is reused when its source is unchanged, i.e.,
+  the same filename, language, version, and timestamp, and a hash of the source
+  equal to the hash attribute of the unit. The output archive is written to a
+  temporary file, and replaces the previous archive only when it is complete, so an
+  error keeps the previous archive. The units of the previous archive are read in
+  order as they are written, so a reused unit is copied from the previous archive
+  instead of parsing the source again. The previous archive is only used when it was created
+  with the same options as the output archive, so the output is identical to
+  creating the archive from scratch.
+*/
+class UpdateArchive {
+
+public:
+    UpdateArchive(const std::string& filename);
+    ~UpdateArchive();
+
+    // check that the previous archive was created with the options of the output archive
+    void check(srcml_archive* output_archive);
+
+    // in the order the requests are scheduled, decide if the previous unit is reused
+    bool reuse(ParseRequest& request);
+
+    // reused unit of the previous archive, in the order the requests are written
+    std::unique_ptr<srcml_unit> unit(int position);
+
+    // number of units reused
+    int numReused() const { return reused; }
+
+    // temporary file the output archive is written to
+    const std::string& outputFilename() const { return output_filename; }
+
+    // replace the previous archive with the closed output archive
+    bool replace();
+
+private:
+    struct Entry {
+        int position;
+        std::string hash;
+        std::string language;
+        boost::optional<std::string> version;
+        boost::optional<std::string> timestamp;
+    };
+
+    // previous archive, with the options it was created with
+    std::string filename;
+    std::unique_ptr<srcml_archive> previous;
+
+    // temporary output archive, removed unless it replaced the previous archive
+    std::string output_filename;
+    bool replaced = false;
+    bool usable = false;
+
+    // units of the previous archive by filename
+    std::unordered_map<std::string, Entry> units;
+
+    // the output archive stores the loc on its units
+    bool store_loc = false;
+
+    // previous archive for reading the reused units
+    std::unique_ptr<srcml_archive> reader;
+    int read = 0;
+
+    // next position of the previous archive that can be reused
+    int next = 0;
+    int reused = 0;
+};
+
+#endif
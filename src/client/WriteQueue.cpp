@@ -23,15 +23,31 @@
 #include <WriteQueue.hpp>
 #include <srcml_write.hpp>
 
-WriteQueue::WriteQueue(TraceLog& log, const srcml_output_dest& destination, bool ordered)
+WriteQueue::WriteQueue(TraceLog& log, const srcml_output_dest& destination, bool ordered,
+                       int window_units, size_t window_bytes)
        : log(log), destination(destination), ordered(ordered), maxposition(0), q(
             [](std::shared_ptr<ParseRequest> r1, std::shared_ptr<ParseRequest> r2) {
                 return r1->position > r2->position;
-            }) {
+            }), window_units(window_units), window_bytes(window_bytes) {
 
     write_thread = std::thread(&WriteQueue::process, this);
 }
 
+/* wait for room in the reorder window for a request */
+void WriteQueue::reserve(ParseRequest& request) {
+
+    std::unique_lock<std::mutex> lock(wmutex);
+
+    // a request is always allowed into an empty window, no matter how large
+    while (inflight_units > 0 &&
+           ((window_units && inflight_units >= window_units) ||
+            (window_bytes && inflight_bytes + request.size > window_bytes)))
+        wcv.wait(lock);
+
+    ++inflight_units;
+    inflight_bytes += request.size;
+}
+
 /* writes out the current srcml */
 void WriteQueue::schedule(std::shared_ptr<ParseRequest> pvalue) {
 
@@ -91,5 +107,14 @@ void WriteQueue::process() {
 
         // finally write it out
         srcml_write_request(pvalue, log, destination);
+
+        // make room in the window for waiting producers
+        {
+            std::lock_guard<std::mutex> lock(wmutex);
+
+            --inflight_units;
+            inflight_bytes -= pvalue->size;
+        }
+        wcv.notify_all();
     }
 }
@@ -36,7 +36,11 @@
 class WriteQueue {
 
 public:
-    WriteQueue(TraceLog& log, const srcml_output_dest& destination, bool ordered = true);
+    WriteQueue(TraceLog& log, const srcml_output_dest& destination, bool ordered = true,
+               int window_units = 0, size_t window_bytes = 0);
+
+    // wait for room in the window for a request, before it is given a position
+    void reserve(ParseRequest& request);
 
     // writes out the current srcml
     void schedule(std::shared_ptr<ParseRequest> pvalue);
@@ -61,6 +65,14 @@ public:
     std::condition_variable cv;
     int total = 0;
     bool completed = false;
+
+    // reorder window of requests scheduled but not yet written, 0 is unlimited
+    int window_units;
+    size_t window_bytes;
+    int inflight_units = 0;
+    size_t inflight_bytes = 0;
+    std::mutex wmutex;
+    std::condition_variable wcv;
 };
 
 #endif
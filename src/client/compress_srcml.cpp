@@ -26,12 +26,229 @@
 #include <SRCMLStatus.hpp>
 #include <libarchive_utilities.hpp>
 #include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <fcntl.h>
+#ifdef _MSC_BUILD
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+#ifdef WITH_ZLIB
+    #include <zlib.h>
+#endif
 
 #if ARCHIVE_VERSION_NUMBER >= 3002000
-void compress_srcml(const srcml_request_t& /* srcml_request */,
+
+namespace {
+
+    // size of the reads of the input, and of the blocks compressed in parallel
+    const size_t COMPRESS_BLOCK_SIZE = 1024 * 1024;
+
+    // read a full block, unless at the end of the input
+    size_t read_block(int fd, std::vector<char>& buffer) {
+
+        size_t total = 0;
+        while (total < buffer.size()) {
+            ssize_t s = read(fd, buffer.data() + total, (unsigned int) (buffer.size() - total));
+            if (s == -1 && errno == EINTR)
+                continue;
+            if (s == -1) {
+                SRCMLstatus(ERROR_MSG, "srcml: Unable to read output to compress");
+                exit(1);
+            }
+            if (s == 0)
+                break;
+            total += s;
+        }
+
+        return total;
+    }
+
+#ifdef WITH_ZLIB
+    struct GzipBlock {
+        std::vector<char> data;
+        std::vector<char> compressed;
+        bool done = false;
+    };
+
+    // compress the block as a complete gzip member
+    bool gzip_member(const std::vector<char>& data, std::vector<char>& compressed) {
+
+        z_stream zs = z_stream();
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+
+        compressed.resize(deflateBound(&zs, (uLong) data.size()));
+
+        zs.next_in = (Bytef*) data.data();
+        zs.avail_in = (uInt) data.size();
+        zs.next_out = (Bytef*) compressed.data();
+        zs.avail_out = (uInt) compressed.size();
+
+        int status = deflate(&zs, Z_FINISH);
+        compressed.resize(zs.total_out);
+
+        deflateEnd(&zs);
+
+        return status == Z_STREAM_END;
+    }
+
+    /*
+      Compress the input as a multi-member gzip, with the blocks of the input compressed
+      by a pool of threads, and written in order. Each member is a standard gzip stream,
+      and decompressors, including gzip and libarchive, read the members as one stream.
+    */
+    void compress_gzip(int threads, int infd, int outfd) {
+
+        if (threads < 1)
+            threads = 1;
+
+        // blocks read and not yet written, in order, and blocks not yet compressed
+        std::deque<std::shared_ptr<GzipBlock>> ordered;
+        std::deque<std::shared_ptr<GzipBlock>> pending;
+        const size_t max_blocks = 2 * threads;
+        bool eof = false;
+        bool failed = false;
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        auto compressor = [&]() {
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+
+                while (pending.empty() && !eof)
+                    cv.wait(lock);
+                if (pending.empty())
+                    return;
+
+                auto block = pending.front();
+                pending.pop_front();
+                lock.unlock();
+
+                bool status = gzip_member(block->data, block->compressed);
+                std::vector<char>().swap(block->data);
+
+                lock.lock();
+                if (!status)
+                    failed = true;
+                block->done = true;
+                cv.notify_all();
+            }
+        };
+
+        auto writer = [&]() {
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+
+                while (!(eof && ordered.empty()) && (ordered.empty() || !ordered.front()->done))
+                    cv.wait(lock);
+                if (ordered.empty())
+                    return;
+
+                auto block = ordered.front();
+                ordered.pop_front();
+                cv.notify_all();
+                lock.unlock();
+
+                for (size_t total = 0; total < block->compressed.size();) {
+                    ssize_t s = write(outfd, block->compressed.data() + total, (unsigned int) (block->compressed.size() - total));
+                    if (s <= 0) {
+                        SRCMLstatus(ERROR_MSG, "srcml: Unable to write compressed output");
+                        exit(1);
+                    }
+                    total += s;
+                }
+
+                lock.lock();
+            }
+        };
+
+        std::vector<std::thread> compressors;
+        for (int i = 0; i < threads; ++i)
+            compressors.emplace_back(compressor);
+        std::thread write_thread(writer);
+
+        // an empty input is still a single, empty, gzip member
+        bool first = true;
+        while (true) {
+
+            std::shared_ptr<GzipBlock> block(new GzipBlock);
+            block->data.resize(COMPRESS_BLOCK_SIZE);
+            block->data.resize(read_block(infd, block->data));
+            if (block->data.empty() && !first)
+                break;
+            first = false;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (ordered.size() >= max_blocks)
+                cv.wait(lock);
+
+            ordered.push_back(block);
+            pending.push_back(block);
+            cv.notify_all();
+
+            if (block->data.size() < COMPRESS_BLOCK_SIZE)
+                break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            eof = true;
+        }
+        cv.notify_all();
+
+        for (auto& thread : compressors)
+            thread.join();
+        write_thread.join();
+
+        if (failed) {
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to compress output");
+            exit(1);
+        }
+    }
+#endif
+}
+
+void compress_srcml(const srcml_request_t& srcml_request,
                     const srcml_input_t& input_sources,
                     const srcml_output_dest& destination) {
 
+#ifdef WITH_ZLIB
+    // gzip alone is compressed in parallel blocks
+    if (destination.compressions.size() == 1 && destination.compressions.front() == ".gz") {
+
+        int outfd = -1;
+        if (contains<int>(destination)) {
+            outfd = destination;
+        } else {
+#ifdef _MSC_BUILD
+            outfd = _open(destination.resource.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+            outfd = open(destination.resource.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif
+        }
+        if (outfd == -1) {
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to open output file " + destination.resource);
+            exit(1);
+        }
+
+        compress_gzip(srcml_request.max_threads, *input_sources[0].fd, outfd);
+
+        if (!contains<int>(destination))
+            close(outfd);
+
+        return;
+    }
+#endif
+
     // create a new archive for output that will handle all
     // types, including source-code files
     std::unique_ptr<archive> ar(archive_write_new());
@@ -45,6 +262,10 @@ void compress_srcml(const srcml_request_t& /* srcml_request */,
     for (const auto& ext : destination.compressions)
         archive_write_set_compression_by_extension(ar.get(), ext.c_str());
 
+    // compressions that support threads, e.g., xz and zstd, use them
+    // other compressions ignore the option
+    archive_write_set_filter_option(ar.get(), nullptr, "threads", std::to_string(srcml_request.max_threads).c_str());
+
     // open the new archive based on input source
     int status = ARCHIVE_OK;
     if (contains<int>(destination)) {
@@ -74,10 +295,16 @@ void compress_srcml(const srcml_request_t& /* srcml_request */,
     }
 
     // write the data into the archive
-    std::vector<char> buffer(4092);
+    std::vector<char> buffer(COMPRESS_BLOCK_SIZE);
     while (true) {
         ssize_t s = read(*input_sources[0].fd, buffer.data(), (size_t) buffer.size());
-        if (s <= 0)
+        if (s == -1 && errno == EINTR)
+            continue;
+        if (s == -1) {
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to read output to compress");
+            exit(1);
+        }
+        if (s == 0)
             break;
 
         ssize_t status = archive_write_data(ar.get(), buffer.data(), s);
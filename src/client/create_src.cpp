@@ -31,15 +31,44 @@
 #include <SRCMLStatus.hpp>
 #include <libarchive_utilities.hpp>
 #include <srcml_utilities.hpp>
+#include <UnparseQueue.hpp>
+#include <UnitChannel.hpp>
+#include <algorithm>
+#ifdef _MSC_BUILD
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+// write all of the buffer, continuing after partial writes
+static bool write_all(int fd, const char* buffer, size_t size) {
+
+    while (size) {
+        auto written = write(fd, buffer, size);
+        if (written <= 0)
+            return false;
+
+        buffer += written;
+        size -= written;
+    }
+
+    return true;
+}
 
-static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input_src& input_source, const boost::optional<size_t>& revision) {
+static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input_src& input_source, const boost::optional<size_t>& revision, const boost::optional<std::string>& filter_unit) {
 
     OpenFileLimiter::open();
     std::unique_ptr<srcml_archive> arch(srcml_archive_create());
     if (!arch)
         return 0;
 
-    int status = SRCML_STATUS_OK;
+    // only the source is output, so no need to collect the srcML
+    int status = srcml_archive_set_read_content(arch.get(), SRCML_READ_CONTENT_SRC);
+    if (status != SRCML_STATUS_OK)
+        return 0;
+
+    // the source of a reference of a dedup archive is that of the unit it refers to
+    srcml_archive_set_dedup_expand(arch.get(), DEDUP_EXPAND_SIZE);
 
     if (revision) {
         status = srcml_archive_set_srcdiff_revision(arch.get(), *revision);
@@ -47,6 +76,15 @@ static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input
             return 0;
     }
 
+    // units whose attributes do not match are skipped by the reader
+    if (filter_unit) {
+        status = srcml_archive_set_unit_filter(arch.get(), filter_unit->c_str());
+        if (status != SRCML_STATUS_OK) {
+            SRCMLstatus(ERROR_MSG, "srcml: invalid unit filter \"" + *filter_unit + "\"");
+            exit(1);
+        }
+    }
+
     // may need to modify input source based on url and compressions
     srcml_input_src curinput = input_source;
 
@@ -72,7 +110,9 @@ static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input
     }
 
     // open input source
-    if (curinput.fd) {
+    if (input_source.units) {
+        status = srcml_archive_read_open_units(arch.get(), input_source.units.get(), UnitChannel::read_unit, UnitChannel::close_read);
+    } else if (curinput.fd) {
         status = srcml_archive_read_open_fd(arch.get(), *curinput.fd);
     } else {
         status = srcml_archive_read_open(arch.get(), input_source);
@@ -90,6 +130,9 @@ void create_src(const srcml_request_t& srcml_request,
                 const srcml_input_t& input_sources,
                 const srcml_output_dest& destination) {
 
+    // units are only unparsed on threads on request, until measured against the serial unparse
+    int unparse_threads = srcml_request.parallel_unparse ? std::max(srcml_request.max_threads, 1) : 0;
+
     if (option(SRCML_COMMAND_TO_DIRECTORY)) {
 
         // srcml->src extract all archives to the filesystem
@@ -97,9 +140,9 @@ void create_src(const srcml_request_t& srcml_request,
         TraceLog log;
 
         for (const auto& input_source : input_sources) {
-            auto arch(srcml_read_open_internal(input_source, srcml_request.revision));
+            auto arch(srcml_read_open_internal(input_source, srcml_request.revision, srcml_request.filter_unit));
 
-            src_output_filesystem(arch.get(), destination, log);
+            src_output_filesystem(arch.get(), destination, log, unparse_threads);
         }
 
     } else if (input_sources.size() == 1 && contains<int>(destination) &&
@@ -107,7 +150,7 @@ void create_src(const srcml_request_t& srcml_request,
 
         // srcml->src extract to stdout
 
-        auto arch(srcml_read_open_internal(input_sources[0], srcml_request.revision));
+        auto arch(srcml_read_open_internal(input_sources[0], srcml_request.revision, srcml_request.filter_unit));
 
         // move to the correct unit
         for (int i = 1; i < srcml_request.unit; ++i) {
@@ -117,7 +160,42 @@ void create_src(const srcml_request_t& srcml_request,
             }
         }
 
+        // set encoding for source output
+        // NOTE: How this is done may change in the future
+        if (srcml_request.src_encoding)
+            srcml_archive_set_src_encoding(arch.get(), srcml_request.src_encoding->c_str());
+
+        // units are unparsed into memory in parallel, and written in order
         int count = 0;
+        bool failed = false;
+        int fd = destination;
+        UnparseQueue queue(unparse_threads, [](UnparseRequest& request) {
+
+            request.status = srcml_unit_unparse_memory(request.unit.get(), &request.buffer, &request.size);
+
+        }, [&](UnparseRequest& request) {
+
+            if (failed)
+                return;
+
+            // null separator before every unit (except the first)
+            if (count++ && !write_all(fd, "", 1)) {
+                SRCMLstatus(ERROR_MSG, "Unable to write to stdout");
+                failed = true;
+                return;
+            }
+
+            if (request.status != SRCML_STATUS_OK) {
+                SRCMLstatus(ERROR_MSG, "srcml: Unable to convert unit %d to source", count);
+                return;
+            }
+
+            if (!write_all(fd, request.buffer, request.size)) {
+                SRCMLstatus(ERROR_MSG, "Unable to write to stdout");
+                failed = true;
+            }
+        });
+
         while (1) {
             std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(arch.get()));
             if (srcml_request.unit && !unit) {
@@ -127,36 +205,24 @@ void create_src(const srcml_request_t& srcml_request,
             if (!unit)
                 break;
 
-            // set encoding for source output
-            // NOTE: How this is done may change in the future
-            if (srcml_request.src_encoding)
-                srcml_archive_set_src_encoding(arch.get(), srcml_request.src_encoding->c_str());
-
             // if requested eol, then use that
             if (srcml_request.eol)
                 srcml_unit_set_eol(unit.get(), *srcml_request.eol);
 
-            // null separator before every unit (except the first)
-            if (count) {
-                if (write(1, "", 1) == -1) {
-                    SRCMLstatus(ERROR_MSG, "Unable to write to stdout");
-                    break;
-                }
-            }
-
-            // unparse directly to the destintation
-            srcml_unit_unparse_fd(unit.get(), destination);
+            std::shared_ptr<UnparseRequest> request(new UnparseRequest);
+            request->unit = std::move(unit);
+            queue.schedule(request);
 
             // get out if only one unit
             if (srcml_request.unit)
                 break;
-
-            ++count;
         }
 
+        queue.stop();
+
     } else if (input_sources.size() == 1 && destination.compressions.empty() && destination.archives.empty()) {
 
-        auto arch(srcml_read_open_internal(input_sources[0], srcml_request.revision));
+        auto arch(srcml_read_open_internal(input_sources[0], srcml_request.revision, srcml_request.filter_unit));
 
         // move to the correct unit
         for (int i = 1; i < srcml_request.unit; ++i) {
@@ -219,10 +285,10 @@ void create_src(const srcml_request_t& srcml_request,
         // extract all the srcml archives to this libarchive
         for (const auto& input_source : input_sources) {
 
-            auto arch(srcml_read_open_internal(input_source, srcml_request.revision));
+            auto arch(srcml_read_open_internal(input_source, srcml_request.revision, srcml_request.filter_unit));
 
             // extract this srcml archive to the source archive
-            src_output_libarchive(arch.get(), ar.get());
+            src_output_libarchive(arch.get(), ar.get(), unparse_threads);
         }
     }
 }
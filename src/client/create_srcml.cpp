@@ -24,6 +24,9 @@
 #include <srcml.h>
 #include <srcml_options.hpp>
 #include <ParseQueue.hpp>
+#include <Aggregate.hpp>
+#include <UpdateArchive.hpp>
+#include <DuplicateUnits.hpp>
 #include <WriteQueue.hpp>
 #include <src_input_libarchive.hpp>
 #include <src_input_file.hpp>
@@ -33,6 +36,7 @@
 #include <src_prefix.hpp>
 #include <srcml_input_srcml.hpp>
 #include <transform_srcml.hpp>
+#include <index_srcml.hpp>
 #include <TraceLog.hpp>
 #include <input_file.hpp>
 #include <input_curl.hpp>
@@ -42,6 +46,15 @@
 #include <ParserTest.hpp>
 #include <cstring>
 #include <libarchive_utilities.hpp>
+#include <srcml_pipe.hpp>
+#include <decompress_srcml.hpp>
+#include <UnitChannel.hpp>
+#include <vector>
+#ifdef _MSC_BUILD
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
 
 int srcml_handler_dispatch(ParseQueue& queue,
                           srcml_archive* srcml_arch,
@@ -96,7 +109,23 @@ int srcml_handler_dispatch(ParseQueue& queue,
         return -1;
     }
 
-    return src_input_libarchive(queue, srcml_arch, srcml_request, uninput);
+    // decompression of a local file on a thread of its own, so that it overlaps
+    // with reading the entries and parsing
+    bool decompressed = uninput.protocol == "file" && uninput.exists && !uninput.compressions.empty();
+    if (decompressed)
+        srcml_pipe(uninput, decompress_stream);
+
+    int count = src_input_libarchive(queue, srcml_arch, srcml_request, uninput);
+
+    // drain any input not read, so that the decompression finishes
+    if (decompressed) {
+        std::vector<char> buffer(65536);
+        while (read(*uninput.fd, buffer.data(), (unsigned int) buffer.size()) > 0)
+            ;
+        close(*uninput.fd);
+    }
+
+    return count;
 }
 
 // create srcml from the current request
@@ -111,16 +140,25 @@ void create_srcml(const srcml_request_t& srcml_request,
         exit(SRCML_STATUS_INVALID_ARGUMENT);
     }
 
+    // previous archive of an update, replaced by the output only when it is complete
+    std::unique_ptr<UpdateArchive> update;
+    if (option(SRCML_COMMAND_UPDATE) && !option(SRCML_COMMAND_NOARCHIVE) && !contains<int>(destination) && srcml_request.transformations.empty())
+        update.reset(new UpdateArchive(destination.resource));
+
     // open the output
     int nstatus = SRCML_STATUS_OK;
     if (!option(SRCML_COMMAND_NOARCHIVE)) {
-        if (contains<int>(destination)) {
+        if (destination.units) {
+
+            nstatus = srcml_archive_write_open_units(srcml_arch.get(), destination.units.get(), UnitChannel::write_unit, UnitChannel::close_write);
+
+        } else if (contains<int>(destination)) {
 
             nstatus = srcml_archive_write_open_fd(srcml_arch.get(), *destination.fd);
 
         } else {
 
-            nstatus = srcml_archive_write_open_filename(srcml_arch.get(), destination.c_str());
+            nstatus = srcml_archive_write_open_filename(srcml_arch.get(), update ? update->outputFilename().c_str() : destination.c_str());
         }
         if (nstatus != SRCML_STATUS_OK)
             return;
@@ -183,6 +221,34 @@ void create_srcml(const srcml_request_t& srcml_request,
             srcml_archive_enable_option(srcml_arch.get(), SRCML_OPTION_NO_XML_DECL);
         if (*srcml_request.markup_options & SRCML_HASH)
             srcml_archive_enable_hash(srcml_arch.get());
+        if (*srcml_request.markup_options & SRCML_OPTION_STORE_LOC)
+            srcml_archive_enable_option(srcml_arch.get(), SRCML_OPTION_STORE_LOC);
+    }
+
+    if (srcml_request.name_filter)
+        srcml_archive_enable_name_filter(srcml_arch.get());
+
+    if (srcml_request.binary || destination.extension == ".srcmlb")
+        srcml_archive_enable_binary(srcml_arch.get());
+
+    if (srcml_request.dedup)
+        srcml_archive_enable_dedup(srcml_arch.get());
+
+    // the index is next to the output file
+    if (srcml_request.index) {
+        if (contains<int>(destination)) {
+            SRCMLstatus(ERROR_MSG, "srcml: --index requires an output file");
+            exit(SRCML_STATUS_INVALID_ARGUMENT);
+        }
+
+        std::string index_filename = destination.resource + ".idx";
+        srcml_archive_set_index_filename(srcml_arch.get(), index_filename.c_str());
+    }
+
+    // cache of parsed units, shared by runs
+    if (srcml_request.cache && srcml_archive_set_cache(srcml_arch.get(), srcml_request.cache->c_str(), (size_t) srcml_request.cache_size * 1024 * 1024) != SRCML_STATUS_OK) {
+        SRCMLstatus(ERROR_MSG, "srcml: invalid cache directory '%s'", *srcml_request.cache);
+        exit(SRCML_STATUS_INVALID_ARGUMENT);
     }
 
     // language
@@ -259,6 +325,9 @@ void create_srcml(const srcml_request_t& srcml_request,
         }
     }
 
+    // independent xpath queries, each with its own output archive
+    std::vector<srcml_archive*> query_archives;
+
     // iterate through all transformations added during cli parsing
     int xpath_index = -1;
     for (const auto& trans : srcml_request.transformations) {
@@ -267,8 +336,24 @@ void create_srcml(const srcml_request_t& srcml_request,
         std::string resource;
         std::tie(protocol, resource) = src_prefix_split_uri(trans);
 
-        if (protocol == "xpath") {
-            if (apply_xpath(srcml_arch.get(), srcml_arch.get(), resource, srcml_request.xpath_query_support[++xpath_index], srcml_request.xmlns_namespaces) != SRCML_STATUS_OK) {
+        if (protocol == "xpath" && srcml_request.xpath_outputs[++xpath_index]) {
+
+            srcml_archive* query_arch = srcml_archive_clone(srcml_arch.get());
+            if (!query_arch || srcml_archive_write_open_filename(query_arch, srcml_request.xpath_outputs[xpath_index]->c_str()) != SRCML_STATUS_OK) {
+                SRCMLstatus(ERROR_MSG, "srcml: unable to open xpath output '%s'", *srcml_request.xpath_outputs[xpath_index]);
+                exit(1);
+            }
+            query_archives.push_back(query_arch);
+
+            // the clone includes the transformations of the main output so far
+            srcml_clear_transforms(query_arch);
+
+            if (apply_xpath(query_arch, query_arch, resource, srcml_request.xpath_query_support[xpath_index], srcml_request.xmlns_namespaces) != SRCML_STATUS_OK) {
+                exit(1);
+            }
+
+        } else if (protocol == "xpath") {
+            if (apply_xpath(srcml_arch.get(), srcml_arch.get(), resource, srcml_request.xpath_query_support[xpath_index], srcml_request.xmlns_namespaces) != SRCML_STATUS_OK) {
                 exit(1);
             }
 
@@ -301,6 +386,28 @@ void create_srcml(const srcml_request_t& srcml_request,
         }
     }
 
+    // units of the previous archive are only reused when they are the same as parsing
+    if (update)
+        update->check(srcml_arch.get());
+
+    // duplicate sources are not parsed when each unit is written to the archive
+    std::unique_ptr<DuplicateUnits> duplicates;
+    if (srcml_request.dedup && !srcml_archive_is_solitary_unit(srcml_arch.get()) && srcml_archive_has_hash(srcml_arch.get()) &&
+        srcml_request.transformations.empty() &&
+        !option(SRCML_COMMAND_XML_FRAGMENT | SRCML_COMMAND_XML_RAW | SRCML_COMMAND_CAT_XML | SRCML_COMMAND_NOARCHIVE | SRCML_COMMAND_PARSER_TEST))
+        duplicates.reset(new DuplicateUnits);
+
+    // query answered from the index of the input, without reading the srcML
+    if (index_query_srcml(srcml_request, input_sources, srcml_arch.get())) {
+
+        srcml_archive_close(srcml_arch.get());
+
+        if (destination.fd)
+            close(*destination.fd);
+
+        return;
+    }
+
     // start tracing
     TraceLog log;
 
@@ -316,10 +423,16 @@ void create_srcml(const srcml_request_t& srcml_request,
     log.output("\n");
 
     // write queue for output of parsing
-    WriteQueue write_queue(log, destination);
+    WriteQueue write_queue(log, destination, true, srcml_request.window_units, (size_t) srcml_request.window_size * 1024 * 1024);
+
+    // aggregate of the query results over all units
+    std::unique_ptr<Aggregate> aggregate;
+    if (srcml_request.aggregate)
+        aggregate.reset(new Aggregate(*srcml_request.aggregate, srcml_request.group_by, srcml_request.max_threads));
 
     // parsing queue
-    ParseQueue parse_queue(srcml_request.max_threads, &write_queue);
+    ParseQueue parse_queue(srcml_request.max_threads, &write_queue, &query_archives, aggregate.get(), update.get(), duplicates.get(),
+                           srcml_request.schedule_by_size);
 
     // convert input sources to srcml
     int status = 0;
@@ -344,6 +457,10 @@ void create_srcml(const srcml_request_t& srcml_request,
     // wait for the writing queue to finish
     write_queue.stop();
 
+    // reduce the partial aggregates of the parsing threads
+    if (aggregate)
+        aggregate->write(srcml_arch.get());
+
     if (SRCMLStatus::errors())
         status = -1;
 
@@ -356,10 +473,26 @@ void create_srcml(const srcml_request_t& srcml_request,
         ParserTest::report(srcml_arch.get());
     }
 
+    log.cache(srcml_archive_get_cache_hits(srcml_arch.get()), srcml_archive_get_cache_misses(srcml_arch.get()));
+    if (update)
+        log.update(update->numReused());
+
     if (status != -1 || always_archive) {
         srcml_archive_close(srcml_arch.get());
     }
 
+    // on any error, the previous archive is kept
+    if (update && status != -1 && !update->replace())
+        SRCMLstatus(ERROR_MSG, "srcml: unable to replace '%s' with the updated srcml archive", destination.c_str());
+
+    for (auto query_arch : query_archives) {
+        srcml_archive_close(query_arch);
+        srcml_archive_free(query_arch);
+    }
+
     if (destination.fd)
         close(*destination.fd);
+
+    if (destination.units)
+        UnitChannel::close_write(destination.units.get());
 }
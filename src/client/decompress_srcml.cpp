@@ -27,6 +27,7 @@
 #include <SRCMLStatus.hpp>
 #include <memory>
 #include <libarchive_utilities.hpp>
+#include <input_readahead.hpp>
 
 namespace {
 
@@ -84,7 +85,7 @@ void decompress_srcml(const srcml_request_t& /* srcml_request */,
 
     } else {
 
-        status = archive_read_open_filename(libarchive_srcml.get(), input_sources[0].resource.c_str(), buffer_size);
+        status = archive_read_open_readahead(libarchive_srcml.get(), input_sources[0].resource.c_str());
     }
     if (status != ARCHIVE_OK) {
         SRCMLstatus(ERROR_MSG, std::to_string(status));
@@ -101,3 +102,37 @@ void decompress_srcml(const srcml_request_t& /* srcml_request */,
     // important to close, since this is how the file descriptor reader get an EOF
     close(*destination.fd);
 }
+
+void decompress_stream(const srcml_request_t& /* srcml_request */,
+    const srcml_input_t& input_sources,
+    const srcml_output_dest& destination) {
+
+    std::unique_ptr<archive> libarchive_stream(archive_read_new());
+
+    // any archive format is left for the next stage in the pipeline
+    archive_read_support_format_raw(libarchive_stream.get());
+    archive_read_support_format_empty(libarchive_stream.get());
+
+    // Compressions
+    archive_read_support_filter_all(libarchive_stream.get());
+
+    if (archive_read_open_readahead(libarchive_stream.get(), input_sources[0].resource.c_str()) != ARCHIVE_OK) {
+        SRCMLstatus(WARNING_MSG, "srcml: Unable to open file " + src_prefix_resource(input_sources[0].filename));
+        close(*destination.fd);
+        return;
+    }
+
+    // an error in the compressed data fails the run, instead of passing on part of the source
+    archive_entry *entry;
+    int status = archive_read_next_header(libarchive_stream.get(), &entry);
+    if (status == ARCHIVE_OK)
+        status = archive_read_data_into_fd(libarchive_stream.get(), *destination.fd);
+    if (status != ARCHIVE_OK && status != ARCHIVE_EOF) {
+        const char* error = archive_error_string(libarchive_stream.get());
+        SRCMLstatus(ERROR_MSG, "srcml: Unable to decompress file " + src_prefix_resource(input_sources[0].filename)
+            + (error ? std::string(": ") + error : std::string()));
+    }
+
+    // important to close, since this is how the file descriptor reader get an EOF
+    close(*destination.fd);
+}
@@ -31,5 +31,10 @@ void decompress_srcml(const srcml_request_t& srcml_request,
                 const srcml_input_t& input_sources,
                 const srcml_output_dest& output);
 
+// decompress a local file, leaving any archive format for the next stage
+void decompress_stream(const srcml_request_t& srcml_request,
+                const srcml_input_t& input_sources,
+                const srcml_output_dest& output);
+
 #endif
 
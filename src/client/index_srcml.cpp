@@ -0,0 +1,123 @@
+/**
+ * @file index_srcml.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <index_srcml.hpp>
+#include <srcml.h>
+#include <srcml_options.hpp>
+#include <srcml_utilities.hpp>
+#include <src_prefix.hpp>
+#include <Aggregate.hpp>
+#include <SRCMLStatus.hpp>
+#include <regex>
+#include <memory>
+
+/*
+  Build the index of each srcML input file next to the file, as FILE.idx
+*/
+void index_srcml(const srcml_request_t& /* srcml_request */, const srcml_input_t& input_sources, const srcml_output_dest& /* destination */) {
+
+    for (const auto& input : input_sources) {
+
+        if (input.state != SRCML || input.protocol != "file" || !input.compressions.empty()) {
+            SRCMLstatus(ERROR_MSG, "srcml: index requires uncompressed srcML files, not %s", src_prefix_resource(input.filename));
+            continue;
+        }
+
+        std::string index_filename = input.resource + ".idx";
+        if (srcml_index_build(input.resource.c_str(), index_filename.c_str()) != SRCML_STATUS_OK)
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to index srcml file %s", input.resource);
+    }
+}
+
+/*
+  Queries of the form count(//prefix:name) and boolean(//prefix:name) are answered per unit,
+  and aggregated, from the index of the srcML input. The index is used when the input has
+  the same size and modification time as when it was indexed. Anything else, e.g., predicates, other axes, or options that change
+  the units queried, needs the srcML, and falls back to the query on each unit.
+*/
+bool index_query_srcml(const srcml_request_t& srcml_request, const srcml_input_t& input_sources, srcml_archive* output_archive) {
+
+    if (srcml_request.transformations.size() != 1 || input_sources.size() != 1)
+        return false;
+
+    std::string protocol;
+    std::string expression;
+    std::tie(protocol, expression) = src_prefix_split_uri(srcml_request.transformations[0]);
+    if (protocol != "xpath" || srcml_request.xpath_outputs[0]
+        || srcml_request.xpath_query_support[0].first || srcml_request.xpath_query_support[0].second)
+        return false;
+
+    // options that change the units queried, or the namespace prefixes
+    if (srcml_request.filter_unit || srcml_request.unit != 0 || srcml_request.revision || !srcml_request.xmlns_namespaces.empty()
+        || option(SRCML_COMMAND_NOARCHIVE) || option(SRCML_COMMAND_PARSER_TEST) || option(SRCML_COMMAND_CAT_XML))
+        return false;
+
+    const auto& input = input_sources[0];
+    if (input.state != SRCML || input.protocol != "file" || !input.compressions.empty() || !input.archives.empty() || input.unit != 0)
+        return false;
+
+    static const std::regex query(R"(\s*(count|boolean)\(\s*//([A-Za-z_][-\w.]*):([A-Za-z_][-\w.]*)\s*\)\s*)");
+    std::smatch match;
+    if (!std::regex_match(expression, match, query))
+        return false;
+
+    // the unit element itself is not in the index
+    std::string function = match[1];
+    std::string element = match[2].str() + ":" + match[3].str();
+    if (match[3] == "unit")
+        return false;
+
+    std::string index_filename = input.resource + ".idx";
+    std::unique_ptr<srcml_index, decltype(&srcml_index_free)> index(srcml_index_read_filename(index_filename.c_str()), srcml_index_free);
+    if (!index || !srcml_index_is_current(index.get(), input.resource.c_str()))
+        return false;
+
+    // the aggregate groups by the unit attributes, so each unit has its attributes from the index
+    std::unique_ptr<Aggregate> aggregate;
+    if (srcml_request.aggregate)
+        aggregate.reset(new Aggregate(*srcml_request.aggregate, srcml_request.group_by, 1));
+
+    std::unique_ptr<srcml_unit> unit(srcml_unit_create(output_archive));
+    for (size_t pos = 0; pos < srcml_index_get_unit_size(index.get()); ++pos) {
+
+        size_t count = srcml_index_get_element_count(index.get(), pos, element.c_str());
+        double value = function == "count" ? (double) count : (count > 0 ? 1 : 0);
+
+        if (aggregate) {
+            srcml_unit_set_filename(unit.get(), srcml_index_get_unit_filename(index.get(), pos));
+            srcml_unit_set_language(unit.get(), srcml_index_get_unit_language(index.get(), pos));
+            srcml_unit_set_version(unit.get(), srcml_index_get_unit_version(index.get(), pos));
+
+            aggregate->add(0, unit.get(), value);
+            continue;
+        }
+
+        // same output as the scalar results of the query on each unit
+        std::string result = function == "count" ? std::to_string(count) + "\n" : (count > 0 ? "true\n" : "false\n");
+        srcml_archive_write_string(output_archive, result.c_str(), (int) result.size());
+    }
+
+    if (aggregate)
+        aggregate->write(output_archive);
+
+    return true;
+}
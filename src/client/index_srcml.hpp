@@ -0,0 +1,35 @@
+/**
+ * @file index_srcml.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef INDEX_SRCML_HPP
+#define INDEX_SRCML_HPP
+
+#include <srcml_cli.hpp>
+#include <srcml_input_src.hpp>
+
+// build the element index of each srcML input file
+void index_srcml(const srcml_request_t& srcml_request, const srcml_input_t& input_sources, const srcml_output_dest& destination);
+
+// answer a query from the element index of the srcML input, returning false if the query needs the srcML
+bool index_query_srcml(const srcml_request_t& srcml_request, const srcml_input_t& input_sources, srcml_archive* output_archive);
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * @file input_readahead.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <input_readahead.hpp>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <fcntl.h>
+#ifdef _MSC_BUILD
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace {
+
+    // size of each read of the file, and the number of reads ahead of libarchive
+    const size_t READAHEAD_BLOCK_SIZE = 1024 * 1024;
+    const size_t READAHEAD_BLOCKS = 8;
+
+    /*
+      Reads of a file on a thread of its own, into a bounded queue of large blocks, so that the
+      reads overlap with the decompression and the reading of the entries by libarchive.
+    */
+    class ReadAhead {
+
+    public:
+        ReadAhead(int fd) : fd(fd), reader(&ReadAhead::process, this) {}
+
+        ~ReadAhead() {
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopped = true;
+            }
+            cv.notify_all();
+
+            reader.join();
+
+#ifdef _MSC_BUILD
+            _close(fd);
+#else
+            close(fd);
+#endif
+        }
+
+        // next block of the file, empty at the end of the file, or null on error
+        std::shared_ptr<std::vector<char>> next() {
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (blocks.empty() && !eof)
+                cv.wait(lock);
+
+            if (blocks.empty())
+                return error ? nullptr : std::make_shared<std::vector<char>>();
+
+            auto block = blocks.front();
+            blocks.pop_front();
+            cv.notify_all();
+
+            return block;
+        }
+
+        // block returned to libarchive, which must stay valid until the next read
+        std::shared_ptr<std::vector<char>> current;
+
+        int error = 0;
+
+    private:
+        void process() {
+
+            while (true) {
+
+                std::shared_ptr<std::vector<char>> block = std::make_shared<std::vector<char>>(READAHEAD_BLOCK_SIZE);
+
+                size_t total = 0;
+                int status = 0;
+                while (total < block->size()) {
+#ifdef _MSC_BUILD
+                    int count = _read(fd, block->data() + total, (unsigned int) (block->size() - total));
+#else
+                    ssize_t count = read(fd, block->data() + total, block->size() - total);
+#endif
+                    if (count < 0 && errno == EINTR)
+                        continue;
+                    if (count < 0)
+                        status = errno;
+                    if (count <= 0)
+                        break;
+
+                    total += count;
+                }
+                block->resize(total);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                while (blocks.size() >= READAHEAD_BLOCKS && !stopped)
+                    cv.wait(lock);
+                if (stopped)
+                    return;
+
+                if (!block->empty())
+                    blocks.push_back(block);
+
+                if (status || total < READAHEAD_BLOCK_SIZE) {
+                    error = status;
+                    eof = true;
+                    cv.notify_all();
+                    return;
+                }
+                cv.notify_all();
+            }
+        }
+
+        int fd;
+        std::deque<std::shared_ptr<std::vector<char>>> blocks;
+        bool eof = false;
+        bool stopped = false;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::thread reader;
+    };
+
+    la_ssize_t readahead_read(archive* ar, void* client_data, const void** buffer) {
+
+        auto readahead = static_cast<ReadAhead*>(client_data);
+
+        readahead->current = readahead->next();
+        if (!readahead->current) {
+            archive_set_error(ar, readahead->error, "Unable to read file");
+            return -1;
+        }
+
+        *buffer = readahead->current->data();
+
+        return (la_ssize_t) readahead->current->size();
+    }
+
+    int readahead_close(archive* /* ar */, void* client_data) {
+
+        delete static_cast<ReadAhead*>(client_data);
+
+        return ARCHIVE_OK;
+    }
+}
+
+/**
+ * archive_read_open_readahead
+ * @param ar a libarchive for reading
+ * @param filename the name of a local file
+ *
+ * Open the libarchive, as archive_read_open_filename(), with the file read on a thread of its own.
+ *
+ * @returns the status of archive_read_open()
+ */
+int archive_read_open_readahead(archive* ar, const char* filename) {
+
+#ifdef _MSC_BUILD
+    int fd = _open(filename, _O_RDONLY | _O_BINARY);
+#else
+    int fd = open(filename, O_RDONLY);
+#endif
+    if (fd == -1) {
+        archive_set_error(ar, errno, "Failed to open '%s'", filename);
+        return ARCHIVE_FATAL;
+    }
+
+    return archive_read_open(ar, new ReadAhead(fd), nullptr, readahead_read, readahead_close);
+}
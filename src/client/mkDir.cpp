@@ -32,12 +32,13 @@ mkDir::mkDir() {
 
 void mkDir::mkdir(const std::string& path) {
 
-    if (last != path) {
-        archive_entry_set_pathname(entry, path.c_str());
-        archive_write_header(arch, entry);
-        archive_write_finish_entry(arch);
-    }
-    last = path;
+    // each directory is only created once
+    if (!created.insert(path).second)
+        return;
+
+    archive_entry_set_pathname(entry, path.c_str());
+    archive_write_header(arch, entry);
+    archive_write_finish_entry(arch);
 }
 
 mkDir::~mkDir() {
@@ -26,6 +26,7 @@
 #include <archive.h>
 #include <archive_entry.h>
 #include <string>
+#include <unordered_set>
 
 class mkDir {
 public:
@@ -37,7 +38,7 @@ public:
 private:
     archive* arch;
     archive_entry* entry;
-    std::string last;
+    std::unordered_set<std::string> created;
 };
 
 #endif
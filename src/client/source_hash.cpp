@@ -0,0 +1,51 @@
+/**
+ * @file source_hash.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <source_hash.hpp>
+#include <sha1utilities.hpp>
+#include <fstream>
+
+// hash of the source, as in the hash attribute of a unit
+std::string source_hash(const std::vector<char>& buffer) {
+
+    return sha1_hex(buffer.data(), buffer.size());
+}
+
+// hash of the source file, as in the hash attribute of a unit, read in blocks
+bool source_file_hash(const std::string& filename, std::string& hash) {
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        return false;
+
+    sha1_hash sha1;
+    char block[64 * 1024];
+    while (file.read(block, sizeof(block)) || file.gcount() > 0)
+        sha1.update(block, (size_t) file.gcount());
+
+    if (file.bad())
+        return false;
+
+    hash = sha1.hex();
+
+    return true;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file source_hash.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SOURCE_HASH_HPP
+#define SOURCE_HASH_HPP
+
+#include <string>
+#include <vector>
+
+// hash of the source, as in the hash attribute of a unit
+std::string source_hash(const std::vector<char>& buffer);
+
+// hash of the source file, as in the hash attribute of a unit, or false if it cannot be read
+bool source_file_hash(const std::string& filename, std::string& hash);
+
+#endif
@@ -64,6 +64,9 @@ namespace {
         { ".xar",  archive_write_add_filter_xz },
         { ".xz"  , archive_write_add_filter_xz },
         { ".z"   , archive_write_add_filter_compress },
+#if ARCHIVE_VERSION_NUMBER >= 3003003
+        { ".zst" , archive_write_add_filter_zstd },
+#endif
     };
 
     // map from language to file extension
@@ -23,6 +23,16 @@
 #include <src_input_file.hpp>
 #include <srcml_options.hpp>
 #include <src_input_libarchive.hpp>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#ifdef _MSC_BUILD
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
 
 // Convert input to a ParseRequest and assign request to the processing queue
 int src_input_file(ParseQueue& queue,
@@ -57,8 +67,117 @@ int src_input_file(ParseQueue& queue,
 
     prequest->disk_filename = input.resource;
 
+    // size of the file for scheduling, since it is not read before parsing
+    struct stat st;
+    if (stat(input.resource.c_str(), &st) == 0)
+        prequest->size = (size_t) st.st_size;
+
     // Hand request off to the processing queue
     queue.schedule(prequest);
 
     return 1;
 }
+
+/*
+  Read a regular, uncompressed, non-archive source file directly into a ParseRequest,
+  with the size from the directory walk for a single allocation, instead of through
+  a libarchive reader with format and filter probing.
+
+  @returns false if the file cannot be read this way, and is left for libarchive
+*/
+bool src_input_file_direct(ParseRequests& requests,
+                           srcml_archive* srcml_arch,
+                           const srcml_request_t& srcml_request,
+                           const srcml_input_src& input,
+                           size_t size) {
+
+    if (input.skip || !input.compressions.empty() || !input.archives.empty())
+        return false;
+
+    auto filename = input.resource;
+    auto it = filename.begin();
+    while (*it == '.' && std::next(it) != filename.end() && *std::next(it) == '/') {
+        filename.erase(it, std::next(std::next(it)));
+        it = filename.begin();
+    }
+
+    if (srcml_request.att_filename && srcml_archive_is_solitary_unit(srcml_arch))
+        filename = *srcml_request.att_filename;
+
+    // files without a source-code extension are left for libarchive, which reports them
+    const char* l = srcml_archive_check_extension(srcml_arch, filename.c_str());
+    if (!l)
+        return false;
+
+#ifdef _MSC_BUILD
+    int fd = _open(input.resource.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = open(input.resource.c_str(), O_RDONLY);
+#endif
+    if (fd == -1)
+        return false;
+
+    // form the parsing request
+    std::shared_ptr<ParseRequest> prequest(new ParseRequest);
+
+    if (option(SRCML_COMMAND_NOARCHIVE))
+        prequest->disk_dir = srcml_request.output_filename;
+
+    prequest->filename = filename;
+    prequest->url = srcml_request.att_url;
+    prequest->version = srcml_request.att_version;
+    prequest->srcml_arch = srcml_arch;
+    prequest->language = srcml_request.att_language ? *srcml_request.att_language : l;
+
+    if (option(SRCML_COMMAND_TIMESTAMP)) {
+
+        struct stat st;
+        fstat(fd, &st);
+        time_t mod_time(st.st_mtime);
+
+        prequest->time_stamp = timestamp_string(mod_time);
+    }
+
+    // one more byte than the size, so the end of the file is found without growing the buffer
+    prequest->buffer.resize(size + 1);
+    size_t total = 0;
+    while (true) {
+
+        if (total == prequest->buffer.size())
+            prequest->buffer.resize(2 * prequest->buffer.size());
+
+#ifdef _MSC_BUILD
+        int count = _read(fd, prequest->buffer.data() + total, (unsigned int) (prequest->buffer.size() - total));
+#else
+        ssize_t count = pread(fd, prequest->buffer.data() + total, prequest->buffer.size() - total, (off_t) total);
+#endif
+        if (count == 0)
+            break;
+
+        // an interrupted read is retried, and any other error leaves the file for libarchive
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+
+#ifdef _MSC_BUILD
+            _close(fd);
+#else
+            close(fd);
+#endif
+            return false;
+        }
+
+        total += count;
+    }
+    prequest->buffer.resize(total);
+
+#ifdef _MSC_BUILD
+    _close(fd);
+#else
+    close(fd);
+#endif
+
+    requests.schedule(prequest);
+
+    return true;
+}
@@ -27,10 +27,17 @@
 #include <srcml_cli.hpp>
 #include <string>
 #include <ParseQueue.hpp>
+#include <src_input_libarchive.hpp>
 
 int src_input_file(ParseQueue& queue,
                     srcml_archive* srcml_arch,
                     const srcml_request_t& srcml_request,
                     const srcml_input_src& input);
 
+bool src_input_file_direct(ParseRequests& requests,
+                           srcml_archive* srcml_arch,
+                           const srcml_request_t& srcml_request,
+                           const srcml_input_src& input,
+                           size_t size);
+
 #endif
@@ -26,12 +26,17 @@
 
 #include <src_input_libarchive.hpp>
 #include <src_input_filesystem.hpp>
+#include <src_input_file.hpp>
 #include <srcml_input_srcml.hpp>
 
 #include <list>
 #include <deque>
 #include <vector>
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <archive.h>
 #include <archive_entry.h>
 
@@ -42,6 +47,143 @@
     #include <unistd.h>
 #endif
 
+namespace {
+
+    // source bytes of the files read ahead, but not yet scheduled
+    const size_t PREFETCH_BYTES = 64 * 1024 * 1024;
+
+    struct FilesystemFile {
+        std::string filename;
+        size_t size;
+
+        bool operator<(const FilesystemFile& other) const { return filename < other.filename; }
+    };
+
+    bool is_dot_file(const std::string& filename) {
+
+        return filename[filename.find_last_of("/") + 1] == '.';
+    }
+
+    // list the entries of a single directory, without descending into the subdirectories
+    void filesystem_list(const std::string& directory, bool root, const srcml_request_t& srcml_request,
+                         std::vector<std::string>& subdirectories, std::vector<FilesystemFile>& files) {
+
+        auto darchive = archive_read_disk_new();
+#if ARCHIVE_VERSION_NUMBER >= 3002003
+        archive_read_disk_set_behavior(darchive, ARCHIVE_READDISK_NO_ACL | ARCHIVE_READDISK_NO_XATTR | ARCHIVE_READDISK_NO_FFLAGS);
+#elif ARCHIVE_VERSION_NUMBER >= 3002000
+        archive_read_disk_set_behavior(darchive, ARCHIVE_READDISK_NO_XATTR);
+#endif
+        archive_read_disk_open(darchive, directory.c_str());
+
+        /* Null entry with archive_read_next_header() causes a segfault on ARCHIVE_VERSION_NUMBER < 300200
+           Creating an entry and using archive_read_next_header2() works */
+        archive_entry* entry = archive_entry_new();
+        bool first = true;
+        while (archive_read_next_header2(darchive, entry) == ARCHIVE_OK) {
+
+            std::string filename = archive_entry_pathname(entry);
+
+            // the directory itself, where only the root of the tree may be a . directory
+            if (first) {
+                first = false;
+                if (root && is_dot_file(filename))
+                    break;
+
+                archive_read_disk_descend(darchive);
+                continue;
+            }
+
+            // do not descend into . directories
+            if (is_dot_file(filename))
+                continue;
+
+            if (archive_entry_filetype(entry) == AE_IFDIR) {
+                subdirectories.push_back(filename);
+                continue;
+            }
+
+            if (archive_entry_filetype(entry) != AE_IFREG)
+                continue;
+
+            if (srcml_request.command & SRCML_COMMAND_PARSER_TEST) {
+                if (filename.substr(filename.find_last_of(".") + 1) != "xml")
+                    continue;
+            }
+
+            files.push_back({ filename, archive_entry_size_is_set(entry) ? (size_t) archive_entry_size(entry) : 0 });
+        }
+        archive_entry_free(entry);
+        archive_read_free(darchive);
+    }
+
+    // list all files of the tree, with the directories listed in parallel
+    std::vector<FilesystemFile> filesystem_walk(const std::string& input, const srcml_request_t& srcml_request) {
+
+        std::vector<FilesystemFile> files;
+        std::vector<std::string> directories;
+        filesystem_list(input, true, srcml_request, directories, files);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        int active = 0;
+
+        auto walker = [&]() {
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+
+                // the walk is complete only when no walker can find another directory
+                while (directories.empty() && active)
+                    cv.wait(lock);
+                if (directories.empty())
+                    break;
+
+                std::string directory = directories.back();
+                directories.pop_back();
+                ++active;
+                lock.unlock();
+
+                std::vector<std::string> subdirectories;
+                std::vector<FilesystemFile> subfiles;
+                filesystem_list(directory, false, srcml_request, subdirectories, subfiles);
+
+                lock.lock();
+                --active;
+                directories.insert(directories.end(), subdirectories.begin(), subdirectories.end());
+                files.insert(files.end(), subfiles.begin(), subfiles.end());
+                cv.notify_all();
+            }
+            cv.notify_all();
+        };
+
+        std::vector<std::thread> walkers;
+        for (int i = 1; i < srcml_request.max_threads; ++i)
+            walkers.emplace_back(walker);
+        walker();
+        for (auto& thread : walkers)
+            thread.join();
+
+        std::sort(files.begin(), files.end());
+
+        return files;
+    }
+
+    srcml_input_src filesystem_input(const std::string& filename, const srcml_request_t& srcml_request) {
+
+        srcml_input_src input_file(filename);
+
+        // If a directory contains archives skip them
+        if (!(srcml_request.command & SRCML_COMMAND_PARSER_TEST) && !(input_file.archives.empty())) {
+            input_file.skip = true;
+        }
+
+        input_file.prefix = filename.substr(0, filename.find_last_of('/'));
+
+        return input_file;
+    }
+}
+
 int src_input_filesystem(ParseQueue& queue,
                           srcml_archive* srcml_arch,
                           const srcml_request_t& srcml_request,
@@ -56,68 +198,82 @@ int src_input_filesystem(ParseQueue& queue,
     }
 
     // get a list of files (including directories) from the current directory
-    std::vector<std::string> files;
-
-    // start at the root of the tree
-    auto darchive = archive_read_disk_new();
-#if ARCHIVE_VERSION_NUMBER >= 3002003
-    archive_read_disk_set_behavior(darchive, ARCHIVE_READDISK_NO_ACL | ARCHIVE_READDISK_NO_XATTR | ARCHIVE_READDISK_NO_FFLAGS);
-#elif ARCHIVE_VERSION_NUMBER >= 3002000
-    archive_read_disk_set_behavior(darchive, ARCHIVE_READDISK_NO_XATTR);
-#endif
-    archive_read_disk_open(darchive, input.c_str());
+    auto files = filesystem_walk(input, srcml_request);
 
-    /* Null entry with archive_read_next_header() causes a segfault on ARCHIVE_VERSION_NUMBER < 300200
-       Creating an entry and using archive_read_next_header2() works */
-    archive_entry* entry = archive_entry_new();
-    bool first = true;
-    int status = ARCHIVE_OK;
-    while ((status = archive_read_next_header2(darchive, entry)) == ARCHIVE_OK) {
+    if (srcml_request.command & SRCML_COMMAND_PARSER_TEST) {
 
-        std::string filename = archive_entry_pathname(entry);
+        for (auto& file : files) {
 
-        // do not descend into . directories
-        if (filename[filename.find_last_of("/") + 1] == '.') {
-            continue;
+            srcml_input_src input_file(file.filename);
+            srcml_input_srcml(queue, srcml_arch, srcml_request, input_file, srcml_request.revision);
         }
 
-        archive_read_disk_descend(darchive);
-        if (first) {
-            first = false;
-            continue;
-        }
+        return 1;
+    }
 
-        if (archive_entry_filetype(entry) != AE_IFREG)
-            continue;
+    // a directory is a srcML archive, set before the readers start, so that the readers only
+    // read the archive options, and an archive file in the directory does not change them
+    srcml_archive_disable_solitary_unit(srcml_arch);
+    srcml_archive_enable_hash(srcml_arch);
 
-        if (srcml_request.command & SRCML_COMMAND_PARSER_TEST) {
-            if (filename.substr(filename.find_last_of(".") + 1) != "xml")
-                continue;
-        }
+    // files are read ahead by a pool of readers, and scheduled in sorted order
+    std::vector<ParseRequests> prefetched(files.size());
+    std::vector<bool> ready(files.size(), false);
+    size_t nextread = 0;
+    size_t nextschedule = 0;
+    size_t inflight = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
 
-        files.push_back(archive_entry_pathname(entry));
-    }
-    archive_entry_free(entry);
-    archive_read_free(darchive);
+    auto reader = [&]() {
 
-    std::sort(files.begin(), files.end());
+        std::unique_lock<std::mutex> lock(mutex);
+        while (nextread < files.size()) {
 
-    for (auto& filename : files) {
+            size_t i = nextread++;
 
-        srcml_input_src input_file(filename);
+            // the file to be scheduled next is always read, so the bytes in flight are bounded without stalling
+            while (i != nextschedule && inflight && inflight + files[i].size > PREFETCH_BYTES)
+                cv.wait(lock);
+            inflight += files[i].size;
+            lock.unlock();
 
-        // If a directory contains archives skip them
-        if (!(srcml_request.command & SRCML_COMMAND_PARSER_TEST) && !(input_file.archives.empty())) {
-            input_file.skip = true;
+            ParseRequests requests;
+            auto input_file = filesystem_input(files[i].filename, srcml_request);
+            if (!src_input_file_direct(requests, srcml_arch, srcml_request, input_file, files[i].size))
+                src_input_libarchive(requests, srcml_arch, srcml_request, input_file);
+
+            lock.lock();
+            prefetched[i] = std::move(requests);
+            ready[i] = true;
+            cv.notify_all();
         }
+    };
 
-        if (srcml_request.command & SRCML_COMMAND_PARSER_TEST) {
-            srcml_input_srcml(queue, srcml_arch, srcml_request, input_file, srcml_request.revision);
-        } else {
-            input_file.prefix = filename.substr(0, filename.find_last_of('/'));
-            src_input_libarchive(queue, srcml_arch, srcml_request, input_file);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < std::max(srcml_request.max_threads, 1); ++i)
+        readers.emplace_back(reader);
+
+    for (size_t i = 0; i < files.size(); ++i) {
+
+        ParseRequests requests;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!ready[i])
+                cv.wait(lock);
+
+            requests = std::move(prefetched[i]);
+            inflight -= files[i].size;
+            nextschedule = i + 1;
         }
+        cv.notify_all();
+
+        for (auto& request : requests.requests)
+            queue.schedule(request);
     }
 
+    for (auto& thread : readers)
+        thread.join();
+
     return 1;
 }
@@ -36,6 +36,35 @@ typedef SSIZE_T ssize_t;
 #include <SRCMLStatus.hpp>
 #include <cstring>
 #include <libarchive_utilities.hpp>
+#include <input_readahead.hpp>
+#include <mutex>
+#include <sys/stat.h>
+
+namespace {
+
+    // size of an uncompressed file above which it is read ahead on a thread of its own
+    const off_t READAHEAD_MIN_SIZE = 1024 * 1024;
+}
+
+/*
+  ctime() returns a static buffer shared by all threads, so the time is formatted
+  in a local buffer instead
+*/
+std::string timestamp_string(time_t mod_time) {
+
+    struct tm local_time;
+#ifdef _MSC_BUILD
+    localtime_s(&local_time, &mod_time);
+#else
+    localtime_r(&mod_time, &local_time);
+#endif
+
+    char c_time[64];
+    if (strftime(c_time, sizeof(c_time), "%a %b %e %H:%M:%S %Y", &local_time) == 0)
+        return "";
+
+    return c_time;
+}
 
 archive* libarchive_input_file(const srcml_input_src& input_file) {
 
@@ -82,7 +111,14 @@ archive* libarchive_input_file(const srcml_input_src& input_file) {
 
     } else {
 
-        status = archive_read_open_filename(arch.get(), input_file.c_str(), buffer_size);
+        // a thread reading ahead only pays for itself when the reads overlap with decompression,
+        // or when there is more than one block to read
+        struct stat st;
+        bool large = stat(input_file.c_str(), &st) == 0 && st.st_size > READAHEAD_MIN_SIZE;
+        if (!input_file.compressions.empty() || large)
+            status = archive_read_open_readahead(arch.get(), input_file.c_str());
+        else
+            status = archive_read_open_filename(arch.get(), input_file.c_str(), buffer_size);
     }
 
     if (status != ARCHIVE_OK) {
@@ -93,11 +129,19 @@ archive* libarchive_input_file(const srcml_input_src& input_file) {
     return arch.release();
 }
 
-// Convert input to a ParseRequest and assign request to the processing queue
-int src_input_libarchive(ParseQueue& queue,
-                          srcml_archive* srcml_arch,
-                          const srcml_request_t& srcml_request,
-                          const srcml_input_src& input_file) {
+namespace {
+
+    // archive options set from the format of the input, which may be read on more than one thread,
+    // so they are only changed when not already set, e.g., by the filesystem input before its readers start
+    std::mutex archive_format_mutex;
+}
+
+// Convert input to a ParseRequest and assign request to the queue, in the order of the entries
+template <typename Queue>
+static int src_input_libarchive_entries(Queue& queue,
+                                        srcml_archive* srcml_arch,
+                                        const srcml_request_t& srcml_request,
+                                        const srcml_input_src& input_file) {
 
     // don't process if non-archive, non-compressed, and we don't handle the extension
     // this is to prevent trying to open, with srcml_archive_open_filename(), a non-srcml file,
@@ -152,8 +196,11 @@ int src_input_libarchive(ParseQueue& queue,
         // after the first archive_read_next_header() the archive knows the archive format
         // use this archive format to force a srcML archive output with archive source
         if (count == 0 && archive_format(arch.get()) != ARCHIVE_FORMAT_RAW && archive_format(arch.get()) != ARCHIVE_FORMAT_EMPTY) {
-            srcml_archive_disable_solitary_unit(srcml_arch);
-            srcml_archive_enable_hash(srcml_arch);
+            std::lock_guard<std::mutex> lock(archive_format_mutex);
+            if (srcml_archive_is_solitary_unit(srcml_arch) || !srcml_archive_has_hash(srcml_arch)) {
+                srcml_archive_disable_solitary_unit(srcml_arch);
+                srcml_archive_enable_hash(srcml_arch);
+            }
         }
 
         // skip any directories
@@ -244,11 +291,7 @@ int src_input_libarchive(ParseQueue& queue,
             //Long time provided by libarchive needs to be time_t
             time_t mod_time(archive_entry_mtime(entry));
 
-            //Standard ctime output and prune '/n' from string
-            char* c_time = ctime(&mod_time);
-            c_time[strlen(c_time) - 1] = 0;
-
-            prequest->time_stamp = c_time;
+            prequest->time_stamp = timestamp_string(mod_time);
         }
 
         // fill up the parse request buffer
@@ -277,3 +320,21 @@ int src_input_libarchive(ParseQueue& queue,
 
     return count;
 }
+
+// Convert input to a ParseRequest and assign request to the processing queue
+int src_input_libarchive(ParseQueue& queue,
+                          srcml_archive* srcml_arch,
+                          const srcml_request_t& srcml_request,
+                          const srcml_input_src& input_file) {
+
+    return src_input_libarchive_entries(queue, srcml_arch, srcml_request, input_file);
+}
+
+// Convert input to a ParseRequest and collect the requests, to be scheduled later
+int src_input_libarchive(ParseRequests& requests,
+                          srcml_archive* srcml_arch,
+                          const srcml_request_t& srcml_request,
+                          const srcml_input_src& input_file) {
+
+    return src_input_libarchive_entries(requests, srcml_arch, srcml_request, input_file);
+}
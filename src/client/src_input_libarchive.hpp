@@ -31,12 +31,31 @@
 #include <ParseQueue.hpp>
 #include <srcml_input_src.hpp>
 #include <src_archive.hpp>
+#include <vector>
+#include <memory>
+#include <ctime>
 
 archive* libarchive_input_file(const srcml_input_src& input_file);
 
+// modification time in the format of ctime(), without the newline, for the timestamp attribute
+std::string timestamp_string(time_t mod_time);
+
+// parse requests of an input, in the order of the entries, to be scheduled later
+struct ParseRequests {
+
+    void schedule(std::shared_ptr<ParseRequest> request) { requests.push_back(request); }
+
+    std::vector<std::shared_ptr<ParseRequest>> requests;
+};
+
 int src_input_libarchive(ParseQueue& queue,
                           srcml_archive* srcml_arch,
                           const srcml_request_t& srcml_request,
                           const srcml_input_src& input);
 
+int src_input_libarchive(ParseRequests& requests,
+                          srcml_archive* srcml_arch,
+                          const srcml_request_t& srcml_request,
+                          const srcml_input_src& input);
+
 #endif
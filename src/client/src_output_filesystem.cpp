@@ -25,19 +25,34 @@
 #include <iostream>
 #include <srcml_utilities.hpp>
 #include <mkDir.hpp>
+#include <UnparseQueue.hpp>
+#include <SRCMLStatus.hpp>
+#include <unordered_set>
+#include <mutex>
 
-void src_output_filesystem(srcml_archive* srcml_arch, const std::string& output_dir, TraceLog& log) {
+void src_output_filesystem(srcml_archive* srcml_arch, const std::string& output_dir, TraceLog& log, int max_threads) {
 
     // construct the relative directory
     std::string prefix;
     if (output_dir != "." && output_dir != "./")
         prefix = output_dir;
 
-    // create output directory structure as needed
+    // create output directory structure as needed, with each directory created once
     mkDir dir;
 
+    // each unit is unparsed directly to its own file, in any order
+    std::mutex error_mutex;
+    UnparseQueue queue(max_threads, [&error_mutex](UnparseRequest& request) {
+
+        request.status = srcml_unit_unparse_filename(request.unit.get(), request.filename.c_str());
+        if (request.status != SRCML_STATUS_OK) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to write source file " + request.filename);
+        }
+    });
+
     int count = 0;
-    std::string last;
+    std::unordered_set<std::string> filenames;
     while (std::unique_ptr<srcml_unit> unit{srcml_archive_read_unit(srcml_arch)}) {
 
         const char* cfilename = srcml_unit_get_filename(unit.get());
@@ -59,9 +74,18 @@ void src_output_filesystem(srcml_archive* srcml_arch, const std::string& output_
         // use libarchive to create the file path
         dir.mkdir(path);
 
+        // a later unit with the same filename replaces the file, so the earlier one must be finished
+        if (!filenames.insert(fullfilename).second)
+            queue.wait();
+
         // unparse directory to filename
         log << ++count << fullfilename;
 
-        srcml_unit_unparse_filename(unit.get(), fullfilename.c_str());
+        std::shared_ptr<UnparseRequest> request(new UnparseRequest);
+        request->unit = std::move(unit);
+        request->filename = fullfilename;
+        queue.schedule(request);
     }
+
+    queue.stop();
 }
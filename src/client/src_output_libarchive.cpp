@@ -31,39 +31,40 @@
 #include <memory>
 #include <libarchive_utilities.hpp>
 #include <srcml_utilities.hpp>
+#include <UnparseQueue.hpp>
+#include <atomic>
 
-void src_output_libarchive(srcml_archive* srcml_arch, archive* src_archive) {
+void src_output_libarchive(srcml_archive* srcml_arch, archive* src_archive, int max_threads) {
 
-    ssize_t arch_status = ARCHIVE_OK;
-    int unitcounter = 0;
-    while (std::unique_ptr<srcml_unit> unit{srcml_archive_read_unit(srcml_arch)}) {
+    // any failure of the source archive stops the output
+    std::atomic<bool> failed(false);
 
-        ++unitcounter;
+    // units are unparsed into memory, and written as entries in the order of the srcML archive
+    UnparseQueue queue(max_threads, [](UnparseRequest& request) {
 
-        // have to make sure we have a valid filename
-        std::string newfilename = srcml_unit_get_filename(unit.get()) ? srcml_unit_get_filename(unit.get()) : "";
-        if (newfilename.empty()) {
-            newfilename = "srcml_unit_";
-            newfilename += std::to_string(unitcounter);
-            if (language_to_std_extension(srcml_unit_get_language(unit.get())) != "")
-                newfilename += language_to_std_extension(srcml_unit_get_language(unit.get()));
-            SRCMLstatus(WARNING_MSG, "A srcML unit without a filename saved as " + newfilename);
+        // Convert from srcML back to source in a buffer
+        request.status = srcml_unit_unparse_memory(request.unit.get(), &request.buffer, &request.size);
+
+    }, [&](UnparseRequest& request) {
+
+        if (failed)
+            return;
+
+        if (request.status != SRCML_STATUS_OK) {
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to convert " + request.filename + " to source");
+            return;
         }
 
         // setup the entry header
         std::unique_ptr<archive_entry> entry(archive_entry_new());
-        if (!entry)
-            break;
-
-        // Convert from srcML back to source in a buffer
-        char* buffer;
-        size_t buffer_size;
-        srcml_unit_unparse_memory(unit.get(), &buffer, &buffer_size);
-        std::unique_ptr<char> pbuffer(buffer);
+        if (!entry) {
+            failed = true;
+            return;
+        }
 
         // setup the entry
-        archive_entry_set_pathname(entry.get(), newfilename.c_str());
-        archive_entry_set_size(entry.get(), buffer_size);
+        archive_entry_set_pathname(entry.get(), request.filename.c_str());
+        archive_entry_set_size(entry.get(), request.size);
         archive_entry_set_filetype(entry.get(), AE_IFREG);
         archive_entry_set_perm(entry.get(), 0644);
 
@@ -72,14 +73,42 @@ void src_output_libarchive(srcml_archive* srcml_arch, archive* src_archive) {
         archive_entry_set_ctime(entry.get(), now, 0);
         archive_entry_set_mtime(entry.get(), now, 0);
 
-        if ((arch_status = archive_write_header(src_archive, entry.get())) != ARCHIVE_OK)
-            break;
+        if (archive_write_header(src_archive, entry.get()) != ARCHIVE_OK) {
+            failed = true;
+            return;
+        }
 
         // write the data into the archive
-        arch_status = archive_write_data(src_archive, pbuffer.get(), (size_t) buffer_size);
-        if (arch_status == -1) {
-            SRCMLstatus(WARNING_MSG, "Unable to save " + newfilename + " to source archive");
+        if (archive_write_data(src_archive, request.buffer, request.size) == -1) {
+            SRCMLstatus(WARNING_MSG, "Unable to save " + request.filename + " to source archive");
+            failed = true;
+        }
+    });
+
+    int unitcounter = 0;
+    while (!failed) {
+
+        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+        if (!unit)
             break;
+
+        ++unitcounter;
+
+        // have to make sure we have a valid filename
+        std::string newfilename = srcml_unit_get_filename(unit.get()) ? srcml_unit_get_filename(unit.get()) : "";
+        if (newfilename.empty()) {
+            newfilename = "srcml_unit_";
+            newfilename += std::to_string(unitcounter);
+            if (language_to_std_extension(srcml_unit_get_language(unit.get())) != "")
+                newfilename += language_to_std_extension(srcml_unit_get_language(unit.get()));
+            SRCMLstatus(WARNING_MSG, "A srcML unit without a filename saved as " + newfilename);
         }
+
+        std::shared_ptr<UnparseRequest> request(new UnparseRequest);
+        request->unit = std::move(unit);
+        request->filename = newfilename;
+        queue.schedule(request);
     }
+
+    queue.stop();
 }
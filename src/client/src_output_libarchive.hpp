@@ -26,6 +26,6 @@
 #include <archive.h>
 #include <srcml.h>
 
-void src_output_libarchive(srcml_archive* srcml_arch, archive* ar);
+void src_output_libarchive(srcml_archive* srcml_arch, archive* ar, int max_threads = 0);
 
 #endif
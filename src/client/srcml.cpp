@@ -26,6 +26,7 @@
 #include <create_srcml.hpp>
 #include <compress_srcml.hpp>
 #include <create_src.hpp>
+#include <index_srcml.hpp>
 #include <srcml_display_metadata.hpp>
 #include <srcml_execute.hpp>
 #include <Timer.hpp>
@@ -48,6 +49,7 @@ namespace {
     bool request_display_metadata  (const srcml_request_t&);
     bool request_output_compression(const srcml_request_t&);
     bool request_create_src        (const srcml_request_t&);
+    bool request_index_srcml       (const srcml_request_t&);
 }
 
 int main(int argc, char * argv[]) {
@@ -123,22 +125,30 @@ See `srcml --help` for more information.
     // steps in the internal pipeline
     processing_steps_t pipeline;
 
-    // step src->srcml
-    if (request_create_srcml(srcml_request)) {
+    // step srcml->index
+    if (request_index_srcml(srcml_request)) {
 
-        pipeline.push_back(create_srcml);
-    }
+        pipeline.push_back(index_srcml);
 
-    // step srcml->metadata
-    if (request_display_metadata(srcml_request)) {
+    } else {
 
-        pipeline.push_back(srcml_display_metadata);
-    }
+        // step src->srcml
+        if (request_create_srcml(srcml_request)) {
+
+            pipeline.push_back(create_srcml);
+        }
 
-    // step srcml->src
-    if (request_create_src(srcml_request)) {
+        // step srcml->metadata
+        if (request_display_metadata(srcml_request)) {
 
-        pipeline.push_back(create_src);
+            pipeline.push_back(srcml_display_metadata);
+        }
+
+        // step srcml->src
+        if (request_create_src(srcml_request)) {
+
+            pipeline.push_back(create_src);
+        }
     }
 
     // step (srcml|src)->compressed
@@ -170,6 +180,13 @@ See `srcml --help` for more information.
             SRCMLstatus(DEBUG_MSG) << "LOC: " << TraceLog::totalLOC() << '\n'
                                    << "KLOC/s: " << (realtime > 0 ? std::round(TraceLog::totalLOC() / realtime) : 0) << '\n';
         }
+        if (TraceLog::cacheHits() + TraceLog::cacheMisses() > 0) {
+            SRCMLstatus(DEBUG_MSG) << "Cache hits: " << TraceLog::cacheHits() << '\n'
+                                   << "Cache misses: " << TraceLog::cacheMisses() << '\n';
+        }
+        if (TraceLog::updateRan()) {
+            SRCMLstatus(DEBUG_MSG) << "Reused units: " << TraceLog::updateReused() << '\n';
+        }
 
         SRCMLstatus(DEBUG_MSG) << "Status: " << (SRCMLStatus::errors() ? 1 : 0) << '\n';
     }
@@ -231,4 +248,15 @@ namespace {
             !request_create_srcml(request) &&
             !request_display_metadata(request)));
     }
+
+    /*
+        Index srcML
+        * Index requested
+        * All input sources are srcML, with no transformation and no output file
+    */
+    bool request_index_srcml(const srcml_request_t& request) {
+
+        return request.index && request.transformations.empty() && contains<int>(request.output_filename) &&
+            std::all_of(request.input_sources.begin(), request.input_sources.end(), [](const srcml_input_src& input) { return input.state == SRCML; });
+    }
 }
@@ -24,6 +24,7 @@
 #include <src_prefix.hpp>
 #include <stdlib.h>
 #include <SRCMLStatus.hpp>
+#include <Aggregate.hpp>
 #include <algorithm>
 
 // tell cli11 to use boost optional
@@ -195,6 +196,28 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         ->type_name("NUM")
         ->group("GENERAL OPTIONS");
 
+    app.add_flag("--schedule-by-size", srcml_request.schedule_by_size,
+        "Parse the largest source files first, with idle threads taking work from the others")
+        ->group("GENERAL OPTIONS");
+
+    app.add_flag("--parallel-unparse", srcml_request.parallel_unparse,
+        "Convert srcML back to source on up to NUM threads of --jobs")
+        ->group("GENERAL OPTIONS");
+
+    srcml_request.window_units = 1024;
+    app.add_option("--window", srcml_request.window_units,
+        "Allow up to NUM units parsed but not yet written, 0 for no limit")
+        ->type_name("NUM")
+        ->check(CLI::Range(0, 1 << 24))
+        ->group("GENERAL OPTIONS");
+
+    srcml_request.window_size = 256;
+    app.add_option("--window-size", srcml_request.window_size,
+        "Allow up to NUM MB of source parsed but not yet written, 0 for no limit")
+        ->type_name("NUM")
+        ->check(CLI::Range(0, 1 << 20))
+        ->group("GENERAL OPTIONS");
+
     // src2srcml_options "CREATING SRCML"
     auto text =
     app.add_option("--text,-t",
@@ -271,6 +294,41 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         "Output contents of XML unit")
         ->group("CREATING SRCML");
 
+    app.add_flag_callback("--output-binary",   [&]() {
+        srcml_request.binary = true;
+        srcml_request.command |= SRCML_COMMAND_XML;
+    },
+        "Output binary srcML, a compact encoding of srcML, default for the extension .srcmlb")
+        ->group("CREATING SRCML");
+
+    app.add_flag_callback("--update",       [&]() { srcml_request.command |= SRCML_COMMAND_UPDATE; },
+        "Update the existing srcML output file, reusing the units of unchanged source files")
+        ->group("CREATING SRCML");
+
+    auto index =
+    app.add_flag("--index", srcml_request.index,
+        "Write an element index of the srcML output file to FILE.idx, or of each srcML input file when there is no output file")
+        ->group("CREATING SRCML");
+
+    app.add_flag("--dedup", srcml_request.dedup,
+        "Write a unit with the same source as an earlier unit as a reference to it, without parsing it")
+        ->group("CREATING SRCML")
+        ->excludes(index);
+
+    auto cache =
+    app.add_option("--cache", srcml_request.cache,
+        "Copy the units of source files parsed before from the cache in directory DIR, shared by runs, instead of parsing them")
+        ->type_name("DIR")
+        ->group("CREATING SRCML");
+
+    srcml_request.cache_size = 1024;
+    app.add_option("--cache-size", srcml_request.cache_size,
+        "Limit the cache to NUM MB, removing the least recently used units, default of 1024")
+        ->type_name("NUM")
+        ->group("CREATING SRCML")
+        ->needs(cache)
+        ->check(CLI::Range(0, 1 << 20));
+
     // markup options
     app.add_flag_callback("--position",        [&]() { *srcml_request.markup_options |= SRCML_OPTION_POSITION; },
         "Include start and end attributes with line/column of each element")
@@ -402,6 +460,14 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         "Include generated hash attribute")
         ->group("METADATA OPTIONS");
 
+    app.add_flag_callback("--loc",       [&]() { *srcml_request.markup_options |= SRCML_OPTION_STORE_LOC; },
+        "Include lines of code attribute")
+        ->group("METADATA OPTIONS");
+
+    app.add_flag("--name-filter", srcml_request.name_filter,
+        "Include name-filter attribute so that queries on a name skip other units")
+        ->group("METADATA OPTIONS");
+
     app.add_flag_callback("--timestamp", [&]() { srcml_request.command |= SRCML_COMMAND_TIMESTAMP; },
         "Include generated timestamp attribute")
         ->group("METADATA OPTIONS");
@@ -460,8 +526,50 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         ->each([&](std::string value) {
             srcml_request.transformations.push_back(src_prefix_add_uri("xpath", value));
             srcml_request.xpath_query_support.push_back(std::make_pair(boost::none,boost::none));
+            srcml_request.xpath_outputs.push_back(boost::none);
         });
 
+    auto xpath_output =
+    app.add_option("--xpath-output",
+        "Output the results of the preceding XPath query to FILE, independent of the other transformations")
+        ->type_name("FILE")
+        ->group("QUERY & TRANSFORMATION")
+        ->needs(xpath);
+
+    auto aggregate =
+    app.add_option("--aggregate", srcml_request.aggregate,
+        "Aggregate the results of the XPath query over all units using MODE: sum, count, min, or max")
+        ->type_name("MODE")
+        ->group("QUERY & TRANSFORMATION")
+        ->needs(xpath)
+        ->check([&](const std::string &value) {
+
+            if (!Aggregate::isMode(value)) {
+                return std::string("invalid aggregate mode \"") + value + "\"";
+            }
+
+            return std::string("");
+        });
+
+    app.add_option("--group-by", srcml_request.group_by,
+        "Group the aggregate by the unit ATTRIBUTE: language, filename, directory, or version")
+        ->type_name("ATTRIBUTE")
+        ->group("QUERY & TRANSFORMATION")
+        ->needs(aggregate)
+        ->check([&](const std::string &value) {
+
+            if (!Aggregate::isGroup(value)) {
+                return std::string("invalid group-by attribute \"") + value + "\"";
+            }
+
+            return std::string("");
+        });
+
+    app.add_option("--filter-unit", srcml_request.filter_unit,
+        "Only process the units of srcML input whose attributes match PREDICATE, e.g., \"@language='C++'\"")
+        ->type_name("PREDICATE")
+        ->group("QUERY & TRANSFORMATION");
+
     app.add_option("--attribute",
         "Insert attribute PRE:NAME=\"VALUE\" into element results of XPath query in original unit")
         ->type_name("PRE:NAME=\"VALUE\"")
@@ -587,9 +695,6 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         "Extract the given revision (0 = original, 1 = modified)")
         ->group("");
 
-    app.add_flag_callback("--update",       [&]() { srcml_request.command |= SRCML_COMMAND_UPDATE; },
-        "Output and update existing srcml")
-        ->group("");
 
     app.add_flag("--xml-processing", srcml_request.xml_processing,
         "Add XML processing instruction")
@@ -636,6 +741,26 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         exit(CLI_STATUS_ERROR);
     }
 
+    // each --xpath-output is for the --xpath it follows
+    if (!xpath_output->empty()) {
+
+        int xpath_index = -1;
+        size_t output_index = 0;
+        for (const auto option : app.parse_order()) {
+
+            if (option == xpath) {
+                ++xpath_index;
+            } else if (option == xpath_output) {
+                if (xpath_index == -1) {
+                    SRCMLstatus(ERROR_MSG, "srcml: xpath-output option must follow an --xpath option");
+                    exit(SRCML_STATUS_INVALID_ARGUMENT);
+                }
+
+                srcml_request.xpath_outputs[xpath_index] = xpath_output->results()[output_index++];
+            }
+        }
+    }
+
     // make sure --text has an indication of language
     if (!text->empty() && language->empty() && filename->empty()) {
         SRCMLstatus(ERROR_MSG, "srcml: --text requires --language or --filename to determine source language");
@@ -120,6 +120,22 @@ struct srcml_request_t {
     int command = 0;
     boost::optional<int> markup_options;
 
+    // Bloom filter of the names on each unit
+    bool name_filter = false;
+
+    // output binary srcML
+    bool binary = false;
+
+    // element index of the srcML, next to the srcML file
+    bool index = false;
+
+    // units with the same source as an earlier unit are a reference to it
+    bool dedup = false;
+
+    // cache of parsed units, with its maximum size in MB
+    boost::optional<std::string> cache;
+    int cache_size;
+
     // unit attributes
     boost::optional<std::string> att_language;
     boost::optional<std::string> att_filename;
@@ -155,9 +171,29 @@ struct srcml_request_t {
     std::vector<std::string> transformations;
     std::vector< std::pair< boost::optional<element>, boost::optional<attribute> > > xpath_query_support;
 
+    // output of independent xpath queries
+    std::vector<boost::optional<std::string>> xpath_outputs;
+
+    // aggregate of the xpath results over all units
+    boost::optional<std::string> aggregate;
+    boost::optional<std::string> group_by;
+
+    // predicate on the unit attributes of srcML input
+    boost::optional<std::string> filter_unit;
+
     int unit = 0;
     int max_threads;
 
+    // parse the largest sources first, with work stealing between the threads
+    bool schedule_by_size = false;
+
+    // convert srcML back to source on the threads
+    bool parallel_unparse = false;
+
+    // reorder window of units parsed but not yet written, in units and MB of source
+    int window_units;
+    int window_size;
+
     boost::optional<std::string> pretty_format;
 
     boost::optional<size_t> revision;
@@ -30,11 +30,12 @@
 #include <srcml_options.hpp>
 #include <srcml_cli.hpp>
 #include <string>
+#include <vector>
 #include <SRCMLStatus.hpp>
 #include <Timer.hpp>
 
 // creates initial unit, parses, and then sends unit to write queue
-void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> request, WriteQueue* write_queue) {
+void srcml_consume(int thread_pool_id, std::shared_ptr<ParseRequest> request, WriteQueue* write_queue) {
 
     // error passthrough to output for proper output in trace
     if (request->status) {
@@ -99,13 +100,18 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
     // parse the buffer/file, timing as we go
     Timer parsetime;
 
-    if (request->disk_filename) {
+    if (request->duplicate) {
+        request->status = srcml_unit_set_duplicate(request->unit.get(), request->duplicate->c_str());
+    }
+    else if (request->disk_filename) {
         request->status = srcml_unit_parse_filename(request->unit.get(), request->disk_filename->c_str());
     }
     else if (request->needsparsing) {
 
         request->status = srcml_unit_parse_memory(request->unit.get(), request->buffer.data(), request->buffer.size());
 
+        // source is not needed after parsing, so release it while the unit waits to be written
+        std::vector<char>().swap(request->buffer);
     }
     if (request->status == SRCML_STATUS_INVALID_ARGUMENT) {
         request->status = SRCML_STATUS_IO_ERROR;
@@ -124,7 +130,29 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
     request->runtime = parsetime.cpu_time_elapsed();
 
     // perform any transformations and add them to the request
-    srcml_unit_apply_transforms(request->srcml_arch, request->unit.get(), &(request->results));
+    if (request->query_archs && !request->query_archs->empty()) {
+
+        // independent queries share a single parse of the unit with the output transformations
+        std::vector<srcml_archive*> archives(1, request->srcml_arch);
+        archives.insert(archives.end(), request->query_archs->begin(), request->query_archs->end());
+        std::vector<srcml_transform_result*> results(archives.size(), nullptr);
+
+        srcml_unit_apply_transforms_each((int) archives.size(), archives.data(), request->unit.get(), results.data());
+
+        request->results = results.front();
+        request->query_results.assign(std::next(results.begin()), results.end());
+    } else {
+        srcml_unit_apply_transforms(request->srcml_arch, request->unit.get(), &(request->results));
+    }
+
+    // aggregate the result in the partial of this thread, so there is nothing to output
+    if (request->aggregate && request->results) {
+        request->aggregate->add(thread_pool_id, request->unit.get(), request->results);
+        srcml_transform_free(request->results);
+        request->results = nullptr;
+        request->unit.reset();
+    }
+
     if (request->results && srcml_transform_get_type(request->results) == SRCML_RESULT_NONE) {
         request->unit.reset();
     }
@@ -47,7 +47,8 @@ namespace {
         int numUnits = 0;
         long LOC = 0;
         while (true) {
-            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+            // body is only read when the loc attribute is not stored
+            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(srcml_arch));
             if (!unit)
                 break;
 
@@ -87,7 +88,7 @@ namespace {
         if (xml_encoding)
             std::cout << "encoding=" << "\"" << xml_encoding << "\"\n";
 
-        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(srcml_arch));
         int unit_count = 0;
 
         if (!isarchive && unit) {
@@ -125,7 +126,7 @@ namespace {
         int numUnits = 0;
         while (true) {
 
-            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(srcml_arch));
             if (!unit)
                 break;
 
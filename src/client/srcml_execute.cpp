@@ -31,25 +31,51 @@
 #include <thread>
 #include <list>
 #include <srcml_pipe.hpp>
+#include <UnitChannel.hpp>
+#include <create_srcml.hpp>
+#include <create_src.hpp>
+#include <srcml_options.hpp>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+
+// units can be passed directly from creating srcML to creating source, unless the
+// srcML output is more than the units, or the units are changed as they are written
+static bool srcml_execute_units(const srcml_request_t& srcml_request, process_srcml from, process_srcml to) {
+
+    return from == create_srcml && to == create_src &&
+           !srcml_request.revision && !srcml_request.dedup && !srcml_request.aggregate && !srcml_request.index &&
+           !option(SRCML_COMMAND_UPDATE | SRCML_COMMAND_XML_FRAGMENT | SRCML_COMMAND_XML_RAW | SRCML_COMMAND_CAT_XML |
+                   SRCML_COMMAND_NOARCHIVE | SRCML_COMMAND_PARSER_TEST);
+}
 
 void srcml_execute(const srcml_request_t& srcml_request,
                    processing_steps_t& pipeline,
                    const srcml_input_t& input_sources,
                    const srcml_output_dest& destination) {
 
-    // create a thread for each step, creating pipes between adjoining steps
+    // create a thread for each step, creating pipes or unit channels between adjoining steps
     std::list<std::thread> pipethreads;
     int fds[2] = { -1, -1 };
-    for (const auto& command : pipeline) {
+    std::shared_ptr<UnitChannel> units;
+    for (auto it = pipeline.begin(); it != pipeline.end(); ++it) {
+
+        auto command = *it;
 
         // special handling for first and last steps
-        bool first = command == pipeline.front();
-        bool last  = command == pipeline.back();
+        bool first = it == pipeline.begin();
+        bool last  = std::next(it) == pipeline.end();
 
-        // pipe between each step
+        // pipe or unit channel between each step
         int prevoutfd = fds[0];
+        auto prevunits = units;
         fds[0] = fds[1] = -1;
-        if (pipeline.size() > 1 && !last) {
+        units.reset();
+        if (pipeline.size() > 1 && !last && srcml_execute_units(srcml_request, command, *std::next(it))) {
+
+            units = std::make_shared<UnitChannel>();
+
+        } else if (pipeline.size() > 1 && !last) {
 #if !defined(_MSC_BUILD) && !defined(__MINGW32__)
             if (pipe(fds) == -1) {
                 perror("srcml");
@@ -65,14 +91,26 @@ void srcml_execute(const srcml_request_t& srcml_request,
 #endif
         }
 
+        // input from the previous step, and output to the next step
+        srcml_input_src input("stdin://-", prevoutfd);
+        srcml_output_dest output("-", fds[1]);
+        if (prevunits) {
+            input.fd = boost::none;
+            input.units = prevunits;
+        }
+        if (units) {
+            output.fd = boost::none;
+            output.units = units;
+        }
+
         /* run this step in the sequence */
         pipethreads.push_back(std::thread(
             command,
             srcml_request,
-            /* first process_srcml uses input_source, rest input from previous output pipe */
-            first ? input_sources : srcml_input_t(1, srcml_input_src("stdin://-", prevoutfd)),
-            /* last process_srcml uses destination, rest output to pipe */
-            last  ? destination   : srcml_output_dest("-", fds[1])
+            /* first process_srcml uses input_source, rest input from previous output */
+            first ? input_sources : srcml_input_t(1, input),
+            /* last process_srcml uses destination, rest output to the next step */
+            last  ? destination   : output
         ));
     }
 
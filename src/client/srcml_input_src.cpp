@@ -95,7 +95,7 @@ srcml_input_src::srcml_input_src(const std::string& other) : arch(0), state(INDE
     }
 
     if (resource != "-" && protocol != "text")
-        state = (extension == ".xml" || extension == ".srcml") ? SRCML : SRC;
+        state = (extension == ".xml" || extension == ".srcml" || extension == ".srcmlb") ? SRCML : SRC;
 
     if (protocol == "text")
         state = SRC;
@@ -30,6 +30,7 @@
 #include <srcmlns.hpp>
 #include <SRCMLStatus.hpp>
 #include <OpenFileLimiter.hpp>
+#include <algorithm>
 
 int srcml_input_srcml(ParseQueue& queue,
                        srcml_archive* srcml_output_archive,
@@ -45,6 +46,13 @@ int srcml_input_srcml(ParseQueue& queue,
         return -1;
     }
 
+    // srcML output and transformations only need the srcML, the source is extracted on request
+    if (!option(SRCML_COMMAND_PARSER_TEST))
+        srcml_archive_set_read_content(srcml_input_archive.get(), SRCML_READ_CONTENT_SRCML);
+
+    // references of a dedup archive are output with the contents they refer to
+    srcml_archive_set_dedup_expand(srcml_input_archive.get(), DEDUP_EXPAND_SIZE);
+
     int open_status = SRCML_STATUS_OK;
     if (revision)
         open_status = srcml_archive_set_srcdiff_revision(srcml_input_archive.get(), *revision);
@@ -59,6 +67,22 @@ int srcml_input_srcml(ParseQueue& queue,
         return -1;
     }
 
+    // units whose attributes do not match are skipped by the reader, without parsing their body
+    // when the xpath query results are the output, units that the query cannot match are skipped as well
+    std::string filter;
+    if (srcml_request.filter_unit)
+        filter = *srcml_request.filter_unit;
+    const char* query_filter = srcml_archive_get_unit_filter(srcml_output_archive);
+    if (query_filter && option(SRCML_COMMAND_XML) && !option(SRCML_COMMAND_PARSER_TEST) && srcml_input.unit == 0
+        && !srcml_request.aggregate
+        && std::none_of(srcml_request.xpath_outputs.begin(), srcml_request.xpath_outputs.end(), [](const boost::optional<std::string>& output) { return output; })) {
+        filter = filter.empty() ? query_filter : "(" + filter + ") and (" + query_filter + ")";
+    }
+    if (!filter.empty() && srcml_archive_set_unit_filter(srcml_input_archive.get(), filter.c_str()) != SRCML_STATUS_OK) {
+        SRCMLstatus(ERROR_MSG, "srcml: invalid unit filter \"%s\"", filter);
+        exit(1);
+    }
+
     // output is in srcML
     if (option(SRCML_COMMAND_XML)) {
 
@@ -130,7 +154,8 @@ int srcml_input_srcml(ParseQueue& queue,
             break;
     }
 
-    if (!unitFound) {
+    // a filter may match none of the units
+    if (!unitFound && (filter.empty() || srcml_input.unit)) {
         SRCMLstatus(ERROR_MSG, "Requested unit %d out of range.", srcml_input.unit);
         exit(1);
     }
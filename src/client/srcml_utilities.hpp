@@ -27,6 +27,9 @@
 #include <memory>
 #include <OpenFileLimiter.hpp>
 
+// maximum size of the contents of units kept to expand the references read from a dedup srcML archive
+const size_t DEDUP_EXPAND_SIZE = 256 * 1024 * 1024;
+
 // std::shared_ptr deleter for srcml archive
 // some compilers will not use the default_delete<srcml_archive> for std::shared_ptr
 inline void srcml_archive_deleter(srcml_archive* arch) {
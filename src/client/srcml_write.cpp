@@ -32,11 +32,53 @@
 #include <stdio.h>
 #include <cstring>
 #include <ParserTest.hpp>
+#include <UpdateArchive.hpp>
 #include <OpenFileLimiter.hpp>
 #include <srcml_utilities.hpp>
 #include <mkDir.hpp>
 #include <cmath>
 
+// output a scalar result, returning false if the result is not a scalar
+static bool srcml_write_scalar(srcml_archive* output_archive, srcml_transform_result* results) {
+
+    switch (srcml_transform_get_type(results)) {
+    case SRCML_RESULT_BOOLEAN:
+        {
+            // output as true/false with newline after every results
+            const char* boolresult = srcml_transform_get_bool(results) ? "true\n" : "false\n";
+            srcml_archive_write_string(output_archive, boolresult, (int) strlen(boolresult));
+        }
+        return true;
+
+    case SRCML_RESULT_NUMBER:
+        {
+            std::string s;
+            if (srcml_transform_get_number(results) != (int) srcml_transform_get_number(results))
+                s = std::to_string(srcml_transform_get_number(results));
+            else
+                s = std::to_string((int) srcml_transform_get_number(results));
+
+            srcml_archive_write_string(output_archive, s.c_str(), (int) s.size());
+
+            // output a newline after every result
+            srcml_archive_write_string(output_archive, "\n", 1);
+        }
+        return true;
+
+    case SRCML_RESULT_STRING:
+        const char* s = (const char*) srcml_transform_get_string(results);
+        srcml_archive_write_string(output_archive, s, (int) strlen(s));
+
+        // if the string is non-empty and does not end in a newline, output one
+        if (s[0] != '\0' && s[strlen(s) - 1] != '\n')
+            srcml_archive_write_string(output_archive, "\n", 1);
+
+        return true;
+    };
+
+    return false;
+}
+
 // Public consumption thread function
 void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, const srcml_output_dest& /* destination */) {
 
@@ -67,6 +109,33 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
         return;
     }
 
+    // unchanged unit of the previous archive of an update
+    if (request->previous && request->update) {
+        request->unit = request->update->unit(*request->previous);
+        if (!request->unit) {
+            request->status = SRCML_STATUS_ERROR;
+            request->errormsg = "srcml: Unable to read unit from previous archive for " + (request->filename ? *request->filename : "");
+        }
+    }
+
+    // output the results of independent queries, each to its own archive
+    for (size_t i = 0; i < request->query_results.size(); ++i) {
+
+        srcml_archive* query_archive = (*request->query_archs)[i];
+        auto results = request->query_results[i];
+        if (!results)
+            continue;
+
+        if (!srcml_write_scalar(query_archive, results)) {
+            for (int j = 0; j < srcml_transform_get_unit_size(results); ++j) {
+                srcml_archive_write_unit(query_archive, srcml_transform_get_unit(results, j));
+            }
+        }
+
+        srcml_transform_free(results);
+    }
+    request->query_results.clear();
+
     srcml_archive* output_archive = request->srcml_arch;
 
     // created for per-unit archive, close() and free() automatic
@@ -103,51 +172,14 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
     }
 
     // output scalar results
-    if (request->results) {
-        switch (srcml_transform_get_type(request->results)) {
-        case SRCML_RESULT_BOOLEAN:
-            {
-                // output as true/false with newline after every results
-                const char* boolresult = srcml_transform_get_bool(request->results) ? "true\n" : "false\n";
-                srcml_archive_write_string(output_archive, boolresult, (int) strlen(boolresult));
-            }
-            srcml_transform_free(request->results);
-            return;
-
-        case SRCML_RESULT_NUMBER:
-            {
-                std::string s;
-                if (srcml_transform_get_number(request->results) != (int) srcml_transform_get_number(request->results))
-                    s = std::to_string(srcml_transform_get_number(request->results));
-                else
-                    s = std::to_string((int) srcml_transform_get_number(request->results));
-
-                srcml_archive_write_string(output_archive, s.c_str(), (int) s.size());
-
-                // output a newline after every result
-                srcml_archive_write_string(output_archive, "\n", 1);
-            }
-            srcml_transform_free(request->results);
-            return;
-
-        case SRCML_RESULT_STRING:
-            const char* s = (const char*) srcml_transform_get_string(request->results);
-            srcml_archive_write_string(output_archive, s, (int) strlen(s));
-
-            // if the string does not end in a newline, output one
-            if (s[strlen(s) - 1] != '\n')
-                srcml_archive_write_string(output_archive, "\n", 1);
-
-            srcml_transform_free(request->results);
-            return;
-        };
+    if (request->results && srcml_write_scalar(output_archive, request->results)) {
+        srcml_transform_free(request->results);
+        return;
     }
 
     // write the unit
     if (request->status == SRCML_STATUS_OK) {
 
-        log.totalLOC(srcml_unit_get_loc(request->unit.get()));
-
         // chance that a solo unit archive was the input, but transformation was
         // done, so output has to be a full archive
         if (request->results && srcml_transform_get_unit_size(request->results) > 1) {
@@ -164,16 +196,17 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
         if ((!request->results || srcml_transform_get_unit_size(request->results) == 0) && request->unit) {
             int status = SRCML_STATUS_OK;
             if (option(SRCML_COMMAND_XML_FRAGMENT)) {
+                // a reference that was not expanded has no srcML
                 const char* s = srcml_unit_get_srcml_outer(request->unit.get());
-                status = srcml_archive_write_string(output_archive, s, (int) strlen(s));
-                if (s[strlen(s) - 1] != '\n') {
+                status = s ? srcml_archive_write_string(output_archive, s, (int) strlen(s)) : SRCML_STATUS_INVALID_INPUT;
+                if (s && s[strlen(s) - 1] != '\n') {
                     srcml_archive_write_string(output_archive, "\n", 1);
                 }
             } else if (option(SRCML_COMMAND_XML_RAW)) {
                 const char* s = srcml_unit_get_srcml_inner(request->unit.get());
-                status = srcml_archive_write_string(output_archive, s, (int) strlen(s));
+                status = s ? srcml_archive_write_string(output_archive, s, (int) strlen(s)) : SRCML_STATUS_INVALID_INPUT;
                 // when non-blank and does not end in newline, add one in
-                if (s[0] != '\0' && s[strlen(s) - 1] != '\n') {
+                if (s && s[0] != '\0' && s[strlen(s) - 1] != '\n') {
                     srcml_archive_write_string(output_archive, "\n", 1);
                 }
             } else if (option(SRCML_COMMAND_CAT_XML)) {
@@ -182,6 +215,7 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
                     auto sarchive = srcml_archive_clone(output_archive);
                     srcml_archive_enable_solitary_unit(sarchive);
                     srcml_archive_disable_hash(sarchive);
+                    srcml_archive_disable_binary(sarchive);
                     char* buffer = 0;
                     size_t size = 0;
                     srcml_archive_write_open_memory(sarchive, &buffer, &size);
@@ -195,9 +229,9 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
                     first = false;
                 }
                 const char* s = srcml_unit_get_srcml_inner(request->unit.get());
-                status = srcml_archive_write_string(output_archive, s, (int) strlen(s));
+                status = s ? srcml_archive_write_string(output_archive, s, (int) strlen(s)) : SRCML_STATUS_INVALID_INPUT;
                 // when non-blank and does not end in newline, add one in
-                if (s[0] != '\0' && s[strlen(s) - 1] != '\n') {
+                if (s && s[0] != '\0' && s[strlen(s) - 1] != '\n') {
                     srcml_archive_write_string(output_archive, "\n", 1);
                 }
             } else {
@@ -208,6 +242,11 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
             }
         }
 
+        // loc of units read without source is extracted, so only when reported,
+        // and is only known for a duplicate unit once it is written
+        if (option(SRCML_DEBUG_MODE) || option(SRCML_TIMING_MODE))
+            log.totalLOC(srcml_unit_get_loc(request->unit.get()));
+
         if (request->results)
             srcml_transform_free(request->results);
 
@@ -27,6 +27,7 @@
 #include <SRCMLStatus.hpp>
 #include <cstring>
 #include <libarchive_utilities.hpp>
+#include <input_readahead.hpp>
 #include <memory>
 
 void unarchive_srcml(const srcml_request_t& /* srcml_request */,
@@ -64,7 +65,7 @@ void unarchive_srcml(const srcml_request_t& /* srcml_request */,
 
         status = archive_read_open_fd(libarchive_srcml.get(), input_sources[0], buffer_size);
     } else {
-        status = archive_read_open_filename(libarchive_srcml.get(), input_sources[0].resource.c_str(), buffer_size);
+        status = archive_read_open_readahead(libarchive_srcml.get(), input_sources[0].resource.c_str());
     }
     if (status != ARCHIVE_OK) {
         SRCMLstatus(ERROR_MSG, std::to_string(status));
@@ -31,6 +31,8 @@
 #include <memory>
 #include <boost/optional.hpp>
 #include <srcml.h>
+#include <srcmlns.hpp>
+#include <unit_filter.hpp>
 
 struct TransformationResult {
     TransformationResult(xmlNodeSetPtr nodeset = nullptr, bool wrapped = false)
@@ -61,6 +63,49 @@ public :
      */
     virtual TransformationResult apply(xmlDocPtr doc, int position) const = 0;
 
+    /**
+     * modifies_document
+     *
+     * Whether applying the transformation changes the doc it is applied to.
+     *
+     * @returns true if the doc is changed, false otherwise.
+     */
+    virtual bool modifies_document() const { return false; }
+
+    /**
+     * streamable
+     *
+     * Whether the transformation can be applied to the srcML of a unit
+     * while it is parsed, without building a doc.
+     *
+     * @returns true if apply_stream() can be used, false otherwise.
+     */
+    virtual bool streamable() const { return false; }
+
+    /**
+     * apply_stream
+     * @param srcml the srcML of the unit
+     * @param namespaces the namespaces of the unit
+     * @param results the begin and end offsets of each result in the srcML
+     *
+     * Apply transformation directly to the srcML of a unit.
+     *
+     * @returns true on success, false on failure.
+     */
+    virtual bool apply_stream(const std::string& /* srcml */, const Namespaces& /* namespaces */,
+                              std::vector<std::pair<int, int>>& /* results */) const { return false; }
+
+    /**
+     * filter
+     *
+     * Predicates on the unit attributes that a unit must satisfy for the
+     * transformation to have any result, e.g., so that units can be skipped
+     * based on their header alone.
+     *
+     * @returns the unit filter, or nullptr if there is none.
+     */
+    virtual const unit_filter* filter() const { return nullptr; }
+
     virtual ~Transformation() {}
 
       /** XSLT parameters */
@@ -26,6 +26,8 @@
 #include <srcml_types.hpp>
 #include <srcml_macros.hpp>
 #include <srcml_sax2_utilities.hpp>
+#include <srcml_binary.hpp>
+#include <libxml2_utilities.hpp>
 
 #include <Language.hpp>
 #include <language_extension_registry.hpp>
@@ -252,6 +254,119 @@ int srcml(const char* input_filename, const char* output_filename) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_copy_buffer
+ * @param input an input buffer
+ * @param output an output buffer
+ *
+ * Copy all of the input to the output, a buffer at a time.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
+ */
+static int srcml_copy_buffer(xmlParserInputBuffer* input, xmlOutputBuffer* output) {
+
+    int status = 0;
+    do {
+
+        if (xmlOutputBufferWrite(output, (int) xmlBufUse(input->buffer), (const char*) xmlBufContent(input->buffer)) < 0)
+            return SRCML_STATUS_IO_ERROR;
+
+        xmlBufShrink(input->buffer, xmlBufUse(input->buffer));
+
+    } while ((status = xmlParserInputBufferGrow(input, 4096)) > 0);
+
+    return status == 0 ? SRCML_STATUS_OK : SRCML_STATUS_IO_ERROR;
+}
+
+/**
+ * srcml_convert_to_binary
+ * @param srcml_filename input srcML file
+ * @param binary_filename output binary srcML file
+ *
+ * Convert srcML to binary srcML. The srcML is not parsed, so the conversion
+ * streams, and srcml_convert_from_binary() reproduces the srcML byte for byte.
+ *
+ * @returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_convert_to_binary(const char* srcml_filename, const char* binary_filename) {
+
+    if (!srcml_filename || !binary_filename) {
+
+        global_archive.error_string = "No input file provided";
+        return SRCML_STATUS_INVALID_ARGUMENT;
+    }
+
+    std::unique_ptr<xmlParserInputBuffer> input(xmlParserInputBufferCreateFilename(srcml_filename, XML_CHAR_ENCODING_NONE));
+    if (!input) {
+        global_archive.error_string = "Unable to open srcML file";
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    if (srcml_binary_detect(input.get())) {
+        global_archive.error_string = "Input is already binary srcML";
+        return SRCML_STATUS_INVALID_INPUT;
+    }
+
+    std::unique_ptr<xmlOutputBuffer> output(srcml_binary_output_create(xmlOutputBufferCreateFilename(binary_filename, 0, 0)));
+    if (!output) {
+        global_archive.error_string = "Unable to open binary srcML file";
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    int status = srcml_copy_buffer(input.get(), output.get());
+
+    if (xmlOutputBufferClose(output.release()) < 0)
+        status = SRCML_STATUS_IO_ERROR;
+
+    return status;
+}
+
+/**
+ * srcml_convert_from_binary
+ * @param binary_filename input binary srcML file
+ * @param srcml_filename output srcML file
+ *
+ * Convert binary srcML to the srcML it was encoded from.
+ *
+ * @returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_convert_from_binary(const char* binary_filename, const char* srcml_filename) {
+
+    if (!binary_filename || !srcml_filename) {
+
+        global_archive.error_string = "No input file provided";
+        return SRCML_STATUS_INVALID_ARGUMENT;
+    }
+
+    std::unique_ptr<xmlParserInputBuffer> input(xmlParserInputBufferCreateFilename(binary_filename, XML_CHAR_ENCODING_NONE));
+    if (!input) {
+        global_archive.error_string = "Unable to open binary srcML file";
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    if (!srcml_binary_detect(input.get())) {
+        global_archive.error_string = "Input is not binary srcML";
+        return SRCML_STATUS_INVALID_INPUT;
+    }
+
+    input.reset(srcml_binary_input_create(input.release()));
+    if (!input)
+        return SRCML_STATUS_IO_ERROR;
+
+    std::unique_ptr<xmlOutputBuffer> output(xmlOutputBufferCreateFilename(srcml_filename, 0, 0));
+    if (!output) {
+        global_archive.error_string = "Unable to open srcML file";
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    int status = srcml_copy_buffer(input.get(), output.get());
+
+    if (xmlOutputBufferClose(output.release()) < 0)
+        status = SRCML_STATUS_IO_ERROR;
+
+    return status;
+}
+
 /******************************************************************************
  *                                                                            *
  *                           Global set functions                             *
@@ -0,0 +1,35 @@
+/**
+ * @file name_filter.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef INCLUDED_NAME_FILTER_HPP
+#define INCLUDED_NAME_FILTER_HPP
+
+#include <string>
+#include <cstddef>
+
+// Bloom filter, in hex digits, of the string values of all name elements in the srcML of a unit
+std::string name_filter_create(const char* srcml, size_t size, const std::string& prefix);
+
+// Check if a name element with the string value may be in the unit of the filter
+bool name_filter_may_contain(const std::string& filter, const std::string& name);
+
+#endif
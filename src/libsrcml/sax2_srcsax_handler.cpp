@@ -22,6 +22,7 @@
 
 #include <sax2_srcsax_handler.hpp>
 #include <srcmlns.hpp>
+#include <srcml.h>
 #include <string>
 #include <algorithm>
 #include <cstring>
@@ -53,6 +54,20 @@
 static const xmlChar* UNIT_ENTRY = nullptr;
 static const xmlChar* MACRO_LIST_ENTRY = nullptr;
 static const xmlChar* ESCAPE_ENTRY = nullptr;
+static const xmlChar* INSERT_ENTRY = nullptr;
+static const xmlChar* DELETE_ENTRY = nullptr;
+
+/**
+ * is_diff
+ * @param state the sax2_srcsax_handler state
+ * @param URI the namespace of the element
+ *
+ * @returns if the element is srcDiff markup that is filtered for a revision
+ */
+static inline bool is_diff(const sax2_srcsax_handler* state, const xmlChar* URI) {
+
+    return state->revision && URI && strcmp((const char*) URI, SRCML_DIFF_NS_URI) == 0;
+}
 
 /**
  * factory
@@ -167,6 +182,129 @@ static int reparse_root(void* ctx) {
     return status;
 }
 
+// read more input into the libxml2 buffer, keeping the parser position
+// returns false when no more input is available
+static bool grow_input(xmlParserCtxtPtr ctxt) {
+
+    auto input = ctxt->input;
+    if (input->buf == nullptr || input->buf->readcallback == nullptr)
+        return false;
+
+    auto curoffset = input->cur - input->base;
+
+    if (xmlParserInputBufferGrow(input->buf, 4 * 4096) <= 0)
+        return false;
+
+#ifdef LIBXML2_NEW_BUFFER
+    input->base = xmlBufContent(input->buf->buffer);
+    input->end = xmlBufEnd(input->buf->buffer);
+#else
+    input->base = input->buf->buffer->content;
+    input->end = input->buf->buffer->content + input->buf->buffer->use;
+#endif
+    input->cur = input->base + curoffset;
+
+    return true;
+}
+
+// skip the body of a unit with a raw byte scan for the matching end tag,
+// instead of libxml2 tokenizing the body with no callbacks.
+// The parser is left at the end of the last top-level element of the unit,
+// so only trailing text and the unit end tag are parsed. When a comment, CDATA,
+// or processing instruction is found, it falls back to regular parsing.
+static void skip_unit_body(xmlParserCtxtPtr ctxt, const xmlChar* localname, const xmlChar* prefix) {
+
+    // empty unit
+    if (ctxt->input->cur[0] != '>')
+        return;
+
+    std::string qname;
+    if (prefix) {
+        qname += (const char*) prefix;
+        qname += ':';
+    }
+    qname += (const char*) localname;
+
+    // offsets, since growing the input can move the buffer
+    auto start = ctxt->input->cur - ctxt->input->base;
+    auto pos = start + 1;
+    decltype(pos) last = 0;
+    int depth = 0;
+    while (true) {
+
+        const xmlChar* base = ctxt->input->base;
+        const xmlChar* end = ctxt->input->end;
+
+        // next tag
+        auto p = (const xmlChar*) memchr(base + pos, '<', end - (base + pos));
+        if (p == nullptr) {
+            pos = end - base;
+            if (!grow_input(ctxt))
+                return;
+            continue;
+        }
+
+        // find the end of the tag, respecting quoted attribute values
+        const xmlChar* tagend = nullptr;
+        char quote = 0;
+        for (auto q = p + 1; q < end; ++q) {
+            if (quote) {
+                if (*q == quote)
+                    quote = 0;
+            } else if (*q == '"' || *q == '\'') {
+                quote = *q;
+            } else if (*q == '>') {
+                tagend = q;
+                break;
+            }
+        }
+        if (tagend == nullptr) {
+            pos = p - base;
+            if (!grow_input(ctxt))
+                return;
+            continue;
+        }
+
+        // comments, CDATA, and processing instructions may contain anything
+        if (p[1] == '!' || p[1] == '?')
+            return;
+
+        bool isend = p[1] == '/';
+        const xmlChar* name = p + (isend ? 2 : 1);
+        bool isunit = (size_t) (tagend - name) >= qname.size()
+                      && memcmp(name, qname.c_str(), qname.size()) == 0
+                      && (name[qname.size()] == '>' || name[qname.size()] == '/' || isspace(name[qname.size()]));
+
+        if (isend) {
+
+            // matching end tag of this unit
+            if (depth == 0) {
+                if (!isunit)
+                    return;
+                break;
+            }
+
+            --depth;
+            if (depth == 0)
+                last = tagend - base;
+
+        } else if (tagend[-1] != '/') {
+
+            ++depth;
+
+        } else if (depth == 0) {
+
+            last = tagend - base;
+        }
+
+        pos = tagend - base + 1;
+    }
+
+    // resume parsing at the end of the last top-level element
+    if (last)
+        ctxt->input->cur = ctxt->input->base + last;
+}
+
 /**
  * start_document
  * @param ctx an xmlParserCtxtPtr
@@ -194,6 +332,8 @@ void start_document(void* ctx) {
     UNIT_ENTRY       = xmlDictLookup(ctxt->dict, (const xmlChar*) "unit", (int) strlen("unit"));
     MACRO_LIST_ENTRY = xmlDictLookup(ctxt->dict, (const xmlChar*) "macro-list", (int) strlen("macro-list"));
     ESCAPE_ENTRY     = xmlDictLookup(ctxt->dict, (const xmlChar*) "escape", (int) strlen("escape"));
+    INSERT_ENTRY     = xmlDictLookup(ctxt->dict, (const xmlChar*) "insert", (int) strlen("insert"));
+    DELETE_ENTRY     = xmlDictLookup(ctxt->dict, (const xmlChar*) "delete", (int) strlen("delete"));
 
     // save the encoding from the input
     state->context->encoding = "UTF-8";
@@ -503,8 +643,21 @@ void start_unit(void* ctx, const xmlChar* localname, const xmlChar* prefix, cons
     ctxt->sax->cdataBlock = 0;
     ctxt->sax->processingInstruction = 0;
 
-    if (!state->collect_unit_body)
+    if (!state->collect_unit_body) {
+
+        // units of an archive can skip the body entirely
+        if (state->callupper && state->context->is_archive) {
+
+            skip_unit_body(ctxt, localname, prefix);
+
+            // parser position was moved directly
+            state->base = ctxt->input->cur + 1;
+            state->prevbase = ctxt->input->base;
+            state->prevconsumed = ctxt->input->consumed;
+        }
+
         return;
+    }
 
     // next start tag will be for a non-unit element
     ctxt->sax->startElementNs = &start_element;
@@ -515,6 +668,8 @@ void start_unit(void* ctx, const xmlChar* localname, const xmlChar* prefix, cons
 
     // start to collect source
     state->unitsrc.clear();
+    state->diff_stack.clear();
+    state->diff_dropped = 0;
 
     SRCSAX_DEBUG_END(localname);
 }
@@ -603,7 +758,7 @@ void end_root(void* ctx, const xmlChar* localname, const xmlChar* prefix, const
  * SAX handler function for start of an element.
  * Immediately calls supplied handlers function.
  */
-void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix */, const xmlChar* /* URI */,
+void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix */, const xmlChar* URI,
                     int /* nb_namespaces */, const xmlChar** /* namespaces */,
                     int /* nb_attributes */, int /* nb_defaulted */, const xmlChar** attributes) {
 
@@ -618,7 +773,20 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
 
     SRCSAX_DEBUG_START(localname);
 
-    if (state->collect_unit_body) {
+    // srcDiff elements are dropped, along with content not in the revision
+    bool output = state->diff_dropped == 0;
+    bool isdiff = is_diff(state, URI);
+    if (isdiff) {
+
+        bool dropped = (*state->revision == SRCDIFF_REVISION_ORIGINAL && localname == INSERT_ENTRY)
+                    || (*state->revision == SRCDIFF_REVISION_MODIFIED && localname == DELETE_ENTRY);
+
+        state->diff_stack.push_back(dropped);
+        if (dropped)
+            ++state->diff_dropped;
+    }
+
+    if (state->collect_unit_body && state->collect_srcml) {
 
         // end previous start element
         if (state->base[0] == '>') {
@@ -633,9 +801,13 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
 
         SRCML_DEBUG("BASE", (const char*) state->base, srcmllen);
 
-        state->unitsrcml.append((const char*) state->base, srcmllen);
+        if (output && !isdiff)
+            state->unitsrcml.append((const char*) state->base, srcmllen);
 
         SRCML_DEBUG("UNIT", state->unitsrcml.c_str(), state->unitsrcml.size());
+    }
+
+    if (state->collect_unit_body && state->collect_src && output) {
 
         // Special element <escape char="0x0c"/> used to embed non-XML characters
         // extract the value of the char attribute and add to the src (text)
@@ -650,6 +822,10 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
     }
     state->base = ctxt->input->cur;
 
+    // skip the end of a dropped start tag, so it is not ended later
+    if ((!output || isdiff) && state->base[0] == '>')
+        state->base += 1;
+
     SRCSAX_DEBUG_END(localname);
 }
 
@@ -677,8 +853,18 @@ void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, con
 
     SRCSAX_DEBUG_START(localname);
 
+    // srcDiff elements are dropped, along with content not in the revision
+    bool isdiff = is_diff(state, URI);
+    bool output = state->diff_dropped == 0 && !isdiff;
+    if (isdiff && !state->diff_stack.empty()) {
+
+        if (state->diff_stack.back())
+            --state->diff_dropped;
+        state->diff_stack.pop_back();
+    }
+
     // collect end element tag
-    if (state->collect_unit_body) {
+    if (state->collect_unit_body && state->collect_srcml) {
 
         auto srcmllen = ctxt->input->cur - state->base;
         if (srcmllen < 0) {
@@ -686,8 +872,10 @@ void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, con
             return;
         }
 
-        state->content_end = (int) state->unitsrcml.size() + 1;
-        state->unitsrcml.append((const char*) state->base, srcmllen);
+        if (output) {
+            state->content_end = (int) state->unitsrcml.size() + 1;
+            state->unitsrcml.append((const char*) state->base, srcmllen);
+        }
 
         SRCML_DEBUG("UNIT", state->unitsrcml.c_str(), state->unitsrcml.size());
     }
@@ -776,9 +964,18 @@ void characters_unit(void* ctx, const xmlChar* ch, int len) {
     if (!state->collect_unit_body)
         return;
 
-    state->unitsrc.append((const char*) ch, len);
+    // text not in the srcDiff revision
+    bool output = state->diff_dropped == 0;
+
+    if (state->collect_src && output) {
+
+        state->unitsrc.append((const char*) ch, len);
+
+        state->loc += (int) std::count((const char*) ch, (const char*) ch + len, '\n');
+    }
 
-    state->loc += (int) std::count((const char*) ch, (const char*) ch + len, '\n');
+    if (!state->collect_srcml)
+        return;
 
     update_ctx(ctx);
 
@@ -793,7 +990,8 @@ void characters_unit(void* ctx, const xmlChar* ch, int len) {
     if (state->base == ctxt->input->cur) {
 
         // plain old strings
-        state->unitsrcml.append((const char*) ch, len);
+        if (output)
+            state->unitsrcml.append((const char*) ch, len);
 
         // libxml2 passes ctxt->input->cur as ch, so then must increment to len
         state->base = ctxt->input->cur + len;
@@ -801,7 +999,8 @@ void characters_unit(void* ctx, const xmlChar* ch, int len) {
     } else {
 
         // whitespace and escaped characters
-        state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
+        if (output)
+            state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
         state->base = ctxt->input->cur;
     }
 
@@ -833,7 +1032,7 @@ void comment(void* ctx, const xmlChar* value) {
 
     SRCSAX_DEBUG_START("");
 
-    if (state->collect_unit_body) {
+    if (state->collect_unit_body && state->collect_srcml && state->diff_dropped == 0) {
 
         // take the value but note it could be part of inter-unit
         state->unitsrcml.append("<!--");
@@ -872,10 +1071,12 @@ void cdata_block(void* ctx, const xmlChar* value, int len) {
     if (state->collect_unit_body) {
 
         // xml can get raw
-        state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
+        if (state->collect_srcml && state->diff_dropped == 0)
+            state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
 
         // CDATA is character data
-        state->unitsrc.append((const char*) value, len);
+        if (state->collect_src && state->diff_dropped == 0)
+            state->unitsrc.append((const char*) value, len);
 
         state->base = ctxt->input->cur;
     }
@@ -905,9 +1106,10 @@ void processing_instruction(void* ctx, const xmlChar* /* target */, const xmlCha
 
     SRCSAX_DEBUG_START("");
 
-    if (state->collect_unit_body) {
+    if (state->collect_unit_body && state->collect_srcml) {
 
-        state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
+        if (state->diff_dropped == 0)
+            state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
 
         state->base = ctxt->input->cur;
     }
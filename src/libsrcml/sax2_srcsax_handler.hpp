@@ -78,7 +78,8 @@ struct sax2_srcsax_handler {
 
     const xmlChar* prevbase = nullptr;
 
-    bool collect_src = false;
+    bool collect_src = true;
+    bool collect_srcml = true;
     bool collect_unit_body = true;
 
     bool callupper = true;
@@ -93,6 +94,15 @@ struct sax2_srcsax_handler {
 
     int loc = 0;
 
+    /** srcDiff revision to collect, when filtering */
+    boost::optional<int> revision;
+
+    /** open srcDiff elements, and if the content of each is not in the revision */
+    std::vector<bool> diff_stack;
+
+    /** number of open srcDiff elements whose content is not in the revision */
+    int diff_dropped = 0;
+
     boost::optional<std::string> cpp_prefix;
 
     bool rootcalled = false;
@@ -30,12 +30,13 @@
 /**
  * srcSAXController
  * @param input a parser input buffer
+ * @param binary the input is binary srcML to parse directly
  *
  * Constructor
  */
-srcSAXController::srcSAXController(std::unique_ptr<xmlParserInputBuffer> input) {
+srcSAXController::srcSAXController(std::unique_ptr<xmlParserInputBuffer> input, bool binary) {
 
-    context = srcsax_create_context_parser_input_buffer(std::move(input));
+    context = srcsax_create_context_parser_input_buffer(std::move(input), binary);
     if (context == NULL)
         throw std::string("File does not exist");
 }
@@ -61,10 +61,11 @@ public :
     /**
      * srcSAXController
      * @param input a parser input buffer
+     * @param binary the input is binary srcML to parse directly
      *
      * Constructor
      */
-    srcSAXController(std::unique_ptr<xmlParserInputBuffer> input);
+    srcSAXController(std::unique_ptr<xmlParserInputBuffer> input, bool binary = false);
 
     /**
      * getCtxt
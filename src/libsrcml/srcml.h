@@ -115,6 +115,8 @@ const unsigned int SRCML_OPTION_CPP_TEXT_ELSE     = 1<<4;
 const unsigned int SRCML_OPTION_CPP_MARKUP_IF0    = 1<<5;
 /** Encode the original source encoding as an attribute */
 const unsigned int SRCML_OPTION_STORE_ENCODING    = 1<<6;
+/** Store the lines of code of the source as a unit attribute */
+const unsigned int SRCML_OPTION_STORE_LOC         = 1<<7;
 /**@}*/
 
 /**@{ @name Source Output EOL Options */
@@ -129,6 +131,15 @@ const unsigned int SRCML_OPTION_STORE_ENCODING    = 1<<6;
 /** Source-code end of line is carriage return and new line */
 #define SOURCE_OUTPUT_EOL_CRLF      3
 /**@}*/
+
+/**@{ @name Read Content Options */
+/** Collect both the srcML and the source of each unit read (default) */
+#define SRCML_READ_CONTENT_ALL      0
+/** Collect only the srcML of each unit read, the source is extracted on request */
+#define SRCML_READ_CONTENT_SRCML    1
+/** Collect only the source of each unit read, the srcML is not available */
+#define SRCML_READ_CONTENT_SRC      2
+/**@}*/
 /**@}*/
 /**@}*/
 
@@ -146,6 +157,13 @@ struct srcml_archive;
  */
 struct srcml_unit;
 
+/**
+ * @struct srcml_index
+ *
+ * Posting lists of the elements in the units of a srcML archive
+ */
+struct srcml_index;
+
 /** @defgroup utility Utility functions
     @{
  */
@@ -288,6 +306,24 @@ LIBSRCML_DECL void srcml_memory_free(char * buffer);
  */
 LIBSRCML_DECL int srcml(const char* input_filename, const char* output_filename);
 
+/**
+ * Convert srcML to binary srcML, a compact encoding of the same srcML
+ * @param [in] srcml_filename The name of the input srcML file
+ * @param [in] binary_filename The name of the output binary srcML file
+ * @return SRCML_STATUS_OK on success
+ * @return Status error on failure
+ */
+LIBSRCML_DECL int srcml_convert_to_binary(const char* srcml_filename, const char* binary_filename);
+
+/**
+ * Convert binary srcML to the srcML it was encoded from, byte for byte
+ * @param [in] binary_filename The name of the input binary srcML file
+ * @param [in] srcml_filename The name of the output srcML file
+ * @return SRCML_STATUS_OK on success
+ * @return Status error on failure
+ */
+LIBSRCML_DECL int srcml_convert_from_binary(const char* binary_filename, const char* srcml_filename);
+
 /**@{ @name Global settings
       @brief To be used with the convenience function srcml()
 */
@@ -675,6 +711,18 @@ LIBSRCML_DECL int srcml_archive_write_open_fd(struct srcml_archive* archive, int
  * @return Status error code on failure
  */
 LIBSRCML_DECL int srcml_archive_write_open_io(struct srcml_archive* archive, void * context, int (*write_callback)(void * context, const char* buffer, int len), int (*close_callback)(void * context));
+
+/**
+ * Open up a srcml_archive for writing units directly to a unit context, without serializing the archive.
+ * Each unit written is copied and passed to the write callback, which takes ownership of it
+ * @param archive A srcml_archive
+ * @param context A unit context
+ * @param write_callback A unit write callback function, returning -1 on failure
+ * @param close_callback A close callback function
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_open_units(struct srcml_archive* archive, void * context, int (*write_callback)(void * context, struct srcml_unit* unit), int (*close_callback)(void * context));
 /**@}*/
 
 /**@{ @name Open for Read
@@ -726,6 +774,18 @@ LIBSRCML_DECL int srcml_archive_read_open_fd(struct srcml_archive* archive, int
  * @retval SRCML_STATUS_IO_ERROR
  */
 LIBSRCML_DECL int srcml_archive_read_open_io(struct srcml_archive* archive, void * context, int (*read_callback)(void * context, char* buffer, int len), int (*close_callback)(void * context));
+
+/**
+ * Open a srcML archive for reading units directly from a unit context, e.g., one written to by srcml_archive_write_open_units().
+ * The read callback returns the next unit, or NULL when done, and the archive takes ownership of it
+ * @param archive A srcml_archive
+ * @param context A unit context
+ * @param read_callback A unit read callback function
+ * @param close_callback A close callback function
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_read_open_units(struct srcml_archive* archive, void * context, struct srcml_unit* (*read_callback)(void * context), int (*close_callback)(void * context));
 /**@}*/
 
 /**@{ @name Archive Options */
@@ -780,6 +840,102 @@ LIBSRCML_DECL int srcml_archive_enable_hash(struct srcml_archive* archive);
  */
 LIBSRCML_DECL int srcml_archive_disable_hash(struct srcml_archive* archive);
 
+/**
+ * Whether the units have the name-filter attribute, a Bloom filter of the names in the unit (in the case of a read),
+ * or would have it added (in case of a write)
+ * @param archive A srcml archive opened for reading or writing
+ * @retval 1 Includes the name-filter attribute
+ * @retval 0 Does not include the name-filter attribute
+ */
+LIBSRCML_DECL int srcml_archive_has_name_filter(const struct srcml_archive* archive);
+
+/**
+ * Enable the name-filter attribute, so that XPath queries with equality tests on names,
+ * e.g., //src:call[src:name='foo'], skip units without the name when reading
+ * @param archive A srcml_archive opened for writing
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_enable_name_filter(struct srcml_archive* archive);
+
+/**
+ * Disable the name-filter attribute. This is the default.
+ * @param archive A srcml_archive opened for writing
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_disable_name_filter(struct srcml_archive* archive);
+
+/**
+ * Whether the archive is binary srcML (in the case of a read), or would be written as binary srcML (in case of a write)
+ * @param archive A srcml archive opened for reading or writing
+ * @retval 1 Binary srcML
+ * @retval 0 srcML
+ */
+LIBSRCML_DECL int srcml_archive_is_binary(const struct srcml_archive* archive);
+
+/**
+ * Enable writing binary srcML, a compact encoding of the srcML. Reading detects binary srcML.
+ * @param archive A srcml_archive opened for writing
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_enable_binary(struct srcml_archive* archive);
+
+/**
+ * Disable writing binary srcML. This is the default.
+ * @param archive A srcml_archive opened for writing
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_disable_binary(struct srcml_archive* archive);
+
+/**
+ * Whether the archive is a dedup archive, where a unit with the same source as an earlier unit is a reference to it
+ * @param archive A srcml archive
+ * @retval 1 Is (or would be written as) a dedup archive
+ * @retval 0 Is not a dedup archive
+ */
+LIBSRCML_DECL int srcml_archive_is_dedup(const struct srcml_archive* archive);
+
+/**
+ * Enable writing a unit with the same hash and language as an earlier unit as a reference to it,
+ * i.e., the same attributes with a ref attribute of the position of the earlier unit, and no contents.
+ * Requires the hash attribute, and is not used when writing an index.
+ * Reading a dedup archive expands the references only with srcml_archive_set_dedup_expand().
+ * @param archive A srcml_archive opened for writing
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_enable_dedup(struct srcml_archive* archive);
+
+/**
+ * Disable writing references to earlier units with the same source. This is the default.
+ * @param archive A srcml_archive opened for writing
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_disable_dedup(struct srcml_archive* archive);
+
+/**
+ * Expand each reference read from a dedup archive to the contents of the earlier unit it refers to.
+ * The contents of up to max_size bytes of the most recent units are kept for the expansion, including
+ * units that are skipped. A reference to a unit whose contents are not kept is read without contents,
+ * with the error SRCML_STATUS_INVALID_INPUT on the unit and the archive. A reference without contents has
+ * no srcML or source, and can only be written to a dedup archive. The default of 0 does not expand references.
+ * @param archive A srcml_archive opened for reading
+ * @param max_size Maximum size in bytes of the contents kept
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_dedup_expand(struct srcml_archive* archive, size_t max_size);
+
+/**
+ * @param archive A srcml_archive
+ * @return The maximum size in bytes of the contents kept to expand references, with 0 for no expansion
+ */
+LIBSRCML_DECL size_t srcml_archive_get_dedup_expand(const struct srcml_archive* archive);
+
 /**
  * Set the XML encoding of the srcML archive
  * @param archive The srcml_archive to set the encoding
@@ -843,6 +999,51 @@ LIBSRCML_DECL int srcml_archive_disable_option(struct srcml_archive* archive, si
  */
 LIBSRCML_DECL int srcml_archive_set_tabstop(struct srcml_archive* archive, size_t tabstop);
 
+/**
+ * Set what content is collected for each unit read from the archive
+ * @param archive A srcml_archive
+ * @param content One of SRCML_READ_CONTENT_ALL, SRCML_READ_CONTENT_SRCML, or SRCML_READ_CONTENT_SRC
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_read_content(struct srcml_archive* archive, size_t content);
+
+/**
+ * Only read units whose attributes satisfy the predicate, skipping the body of other units without parsing.
+ * The predicate is a conjunction of @ATTR, @ATTR='VALUE', @ATTR!='VALUE', starts-with(@ATTR, 'VALUE'),
+ * and contains(@ATTR, 'VALUE'), e.g., "@language='C++' and starts-with(@filename, 'src/')".
+ * The test .//src:name='VALUE' uses the name-filter attribute, so it skips the units that do not contain
+ * the name, but may read some that do not. Units without the name-filter attribute are always read.
+ * @param archive A srcml_archive
+ * @param predicate The predicate on the unit attributes, or NULL to read all units
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_unit_filter(struct srcml_archive* archive, const char* predicate);
+
+/**
+ * Set the file to write the element index of the archive to when the archive is closed.
+ * The index is built from the units written to the archive.
+ * @param archive A srcml_archive opened for writing
+ * @param index_filename Name of the index file, or NULL for no index
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_index_filename(struct srcml_archive* archive, const char* index_filename);
+
+/**
+ * Set the directory of a cache of parsed units, which can be shared by runs and processes.
+ * A source parsed before with the same language and options is not parsed again, but copied
+ * from the cache. Clones of the archive share the cache.
+ * @param archive A srcml_archive
+ * @param dirname Name of the cache directory, created if it does not exist, or NULL for no cache
+ * @param max_size Maximum total size in bytes of the cache, or 0 for no maximum. The least recently
+ * used units are removed when the archive is closed
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_cache(struct srcml_archive* archive, const char* dirname, size_t max_size);
+
 /**
  * Set an extension to be associated with a given source-code language
  * @param archive A srcml_archive that associates the given extension with a language
@@ -946,6 +1147,38 @@ LIBSRCML_DECL int srcml_archive_get_options(const struct srcml_archive* archive)
  */
 LIBSRCML_DECL size_t srcml_archive_get_tabstop(const struct srcml_archive* archive);
 
+/**
+ * @param archive A srcml_archive
+ * @return The content collected for each unit read
+ */
+LIBSRCML_DECL size_t srcml_archive_get_read_content(const struct srcml_archive* archive);
+
+/**
+ * The unit filter set for reading, or if none, the predicate on the unit attributes
+ * that the first transformation requires, e.g., from the XPath /src:unit[@language='C++']//src:function
+ * @param archive A srcml_archive
+ * @return The predicate on the unit attributes, or NULL if there is none
+ */
+LIBSRCML_DECL const char* srcml_archive_get_unit_filter(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The directory of the cache of parsed units, or NULL if there is none
+ */
+LIBSRCML_DECL const char* srcml_archive_get_cache_directory(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The number of units parsed with the archive that were found in the cache
+ */
+LIBSRCML_DECL size_t srcml_archive_get_cache_hits(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The number of units parsed with the archive that were not found in the cache
+ */
+LIBSRCML_DECL size_t srcml_archive_get_cache_misses(const struct srcml_archive* archive);
+
 /**
  * @param archive A srcml_archive
  * @return The number of currently defined namespaces or 0 if archive is NULL
@@ -1005,6 +1238,8 @@ LIBSRCML_DECL const char* srcml_archive_check_extension(const struct srcml_archi
 */
 /**
  * Read the next unit header from the archive
+ * The unit body is not parsed. It is read on first access, e.g., srcml_unit_get_srcml(),
+ * and only until the next unit is read from the archive.
  * @param archive A srcml_archive open for reading
  * @return The read srcml_unit, with header information only, on success
  * @return NULL on failure
@@ -1201,6 +1436,18 @@ struct srcml_transform_result;
  */
 LIBSRCML_DECL int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit* unit, struct srcml_transform_result** result);
 
+/**
+ * Apply the appended transformations of each archive to the unit, independently of the transformations
+ * of the other archives. The unit is parsed once for all of the archives, instead of once for each archive.
+ * The results of each archive are placed in the corresponding result.
+ * @param size Number of archives
+ * @param archives Array of archives with the transformations declared
+ * @param unit Unit to perform the transformations on
+ * @param results Array of size results, one for each archive
+ * @returns Returns SRCML_STATUS_OK on success and a status error codes on failure.
+ */
+LIBSRCML_DECL int srcml_unit_apply_transforms_each(int size, struct srcml_archive** archives, struct srcml_unit* unit, struct srcml_transform_result** results);
+
 /**
  * @param result A srcml transformation result
  * @return The type of the transformation result
@@ -1342,6 +1589,16 @@ LIBSRCML_DECL int srcml_unit_set_version(struct srcml_unit* unit, const char* ve
  */
 LIBSRCML_DECL int srcml_unit_set_timestamp(struct srcml_unit* unit, const char* timestamp);
 
+/**
+ * Mark the unit, instead of parsing it, as a duplicate of a unit with the same source
+ * already written to a dedup archive, so that it is written as a reference to that unit
+ * @param unit A srcml_unit
+ * @param hash The hash of the source, as in the hash attribute
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_unit_set_duplicate(struct srcml_unit* unit, const char* hash);
+
 /**
  * Set the type of end of line to be used for unparse
  * @param unit A srcml_unit
@@ -1394,6 +1651,7 @@ LIBSRCML_DECL const char* srcml_unit_get_timestamp(const struct srcml_unit* unit
 LIBSRCML_DECL const char* srcml_unit_get_hash(const struct srcml_unit* unit);
 
 /**
+ * If the loc attribute was not stored, the unit body is read to count it
  * @param unit A srcml_unit
  * @return The loc of the source code in the unit, or -1 on failure
  */
@@ -1617,6 +1875,113 @@ LIBSRCML_DECL int srcml_write_string(struct srcml_unit* unit, const char* conten
 /**@}*/
 /**@}*/
 
+/** @defgroup index Element index
+
+    The index of a srcML archive has, for each element, the units that contain it,
+    the count in each unit, and the position of each start tag in the unit contents.
+    Counts of elements can be answered from the index without parsing the archive.
+    Elements are qualified names, e.g., src:function or cpp:define, where a name
+    without a prefix is in the srcML namespace. Units are by their position in the archive.
+    @{
+*/
+
+/**
+ * Build the index of an existing srcML archive
+ * @param srcml_filename Name of a srcML file
+ * @param index_filename Name of the index file
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_index_build(const char* srcml_filename, const char* index_filename);
+
+/**
+ * Read an index
+ * @param index_filename Name of an index file
+ * @return The index, or NULL if the file is not a valid index. Free with srcml_index_free()
+ */
+LIBSRCML_DECL struct srcml_index* srcml_index_read_filename(const char* index_filename);
+
+/**
+ * Free an index
+ * @param index A srcml_index
+ */
+LIBSRCML_DECL void srcml_index_free(struct srcml_index* index);
+
+/**
+ * @param index A srcml_index
+ * @param srcml_filename Name of the srcML file of the index
+ * @return 1 if the srcML file has the same size and modification time as when indexed, 0 if not
+ */
+LIBSRCML_DECL int srcml_index_is_current(const struct srcml_index* index, const char* srcml_filename);
+
+/**
+ * @param index A srcml_index
+ * @return The number of units in the indexed archive
+ */
+LIBSRCML_DECL size_t srcml_index_get_unit_size(const struct srcml_index* index);
+
+/**
+ * @param index A srcml_index
+ * @param pos Position of the unit in the archive
+ * @return The filename attribute of the unit, or NULL if none
+ */
+LIBSRCML_DECL const char* srcml_index_get_unit_filename(const struct srcml_index* index, size_t pos);
+
+/**
+ * @param index A srcml_index
+ * @param pos Position of the unit in the archive
+ * @return The language attribute of the unit, or NULL if none
+ */
+LIBSRCML_DECL const char* srcml_index_get_unit_language(const struct srcml_index* index, size_t pos);
+
+/**
+ * @param index A srcml_index
+ * @param pos Position of the unit in the archive
+ * @return The version attribute of the unit, or NULL if none
+ */
+LIBSRCML_DECL const char* srcml_index_get_unit_version(const struct srcml_index* index, size_t pos);
+
+/**
+ * @param index A srcml_index
+ * @param element Qualified name of an element
+ * @return The number of occurrences of the element in all units
+ */
+LIBSRCML_DECL size_t srcml_index_get_element_total(const struct srcml_index* index, const char* element);
+
+/**
+ * @param index A srcml_index
+ * @param element Qualified name of an element
+ * @return The number of units that contain the element
+ */
+LIBSRCML_DECL size_t srcml_index_get_element_unit_size(const struct srcml_index* index, const char* element);
+
+/**
+ * @param index A srcml_index
+ * @param element Qualified name of an element
+ * @param pos Position in the units that contain the element
+ * @return The position in the archive of the unit, or -1 if none
+ */
+LIBSRCML_DECL int srcml_index_get_element_unit(const struct srcml_index* index, const char* element, size_t pos);
+
+/**
+ * @param index A srcml_index
+ * @param pos Position of the unit in the archive
+ * @param element Qualified name of an element
+ * @return The number of occurrences of the element in the unit
+ */
+LIBSRCML_DECL size_t srcml_index_get_element_count(const struct srcml_index* index, size_t pos, const char* element);
+
+/**
+ * @param index A srcml_index
+ * @param pos Position of the unit in the archive
+ * @param element Qualified name of an element
+ * @param n Which occurrence of the element in the unit
+ * @return The offset of the start tag of the occurrence in the srcML of the unit contents,
+ * as from srcml_unit_get_srcml_inner(), or -1 if none
+ */
+LIBSRCML_DECL int srcml_index_get_element_position(const struct srcml_index* index, size_t pos, const char* element, size_t n);
+/**@}*/
+
 /** @defgroup srcDiff srcDiff
     @{
 */
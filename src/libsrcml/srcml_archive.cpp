@@ -23,7 +23,19 @@
 #include <srcmlns.hpp>
 #include <srcml_translator.hpp>
 #include <srcml_sax2_reader.hpp>
+#include <srcml_binary.hpp>
+#include <srcml_index.hpp>
+#include <srcml_cache.hpp>
 #include <libxml/encoding.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _MSC_BUILD
+#include <direct.h>
+#define MKDIR(DIR) _mkdir(DIR)
+#else
+#define MKDIR(DIR) mkdir(DIR, 0777)
+#endif
 
 /**
  * srcml_archive_check_extension
@@ -126,6 +138,8 @@ void srcml_archive_free(struct srcml_archive* archive) {
         archive->reader = nullptr;
     }
 
+    delete archive->index;
+
     if (archive == nullptr)
         return;
 
@@ -160,6 +174,17 @@ srcml_archive* srcml_archive_clone(const struct srcml_archive* archive) {
     new_archive->buffer = nullptr;
     new_archive->size = nullptr;
     new_archive->rawwrites = false;
+    new_archive->read_name_filter = false;
+    new_archive->binary_wrapped = false;
+    new_archive->unit_context = nullptr;
+    new_archive->unit_write_callback = nullptr;
+    new_archive->unit_read_callback = nullptr;
+    new_archive->unit_close_callback = nullptr;
+    new_archive->index_filename = boost::none;
+    new_archive->index = nullptr;
+    new_archive->output_filename = boost::none;
+    new_archive->dedup_units.clear();
+    new_archive->dedup_count = 0;
     new_archive->error_string.clear();
     new_archive->error_number = 0;
 
@@ -289,7 +314,7 @@ int srcml_archive_set_options(struct srcml_archive* archive, size_t options) {
         archive->options |= SRCML_OPTION_CPP_DECLARED;
     }
 
-    int modoption = options % (1<<7);
+    int modoption = options % (1<<8);
 
     archive->options = modoption;
 
@@ -363,6 +388,130 @@ int srcml_archive_disable_hash(struct srcml_archive* archive) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_has_name_filter(const struct srcml_archive* archive) {
+
+    return (archive->options & SRCML_OPTION_NAME_FILTER) != 0 || archive->read_name_filter;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_enable_name_filter(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->options |= (unsigned long long)(SRCML_OPTION_NAME_FILTER);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_disable_name_filter(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->options &= ~(unsigned long long)(SRCML_OPTION_NAME_FILTER);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_is_dedup(const struct srcml_archive* archive) {
+
+    return (archive->options & SRCML_OPTION_DEDUP) != 0;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_enable_dedup(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->options |= (unsigned long long)(SRCML_OPTION_DEDUP);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_disable_dedup(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->options &= ~(unsigned long long)(SRCML_OPTION_DEDUP);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * @param archive a srcml_archive
+ * @param max_size maximum size in bytes of the contents kept to expand references
+ */
+int srcml_archive_set_dedup_expand(struct srcml_archive* archive, size_t max_size) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->dedup_expand = max_size;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+size_t srcml_archive_get_dedup_expand(const struct srcml_archive* archive) {
+
+    return archive ? archive->dedup_expand : 0;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_is_binary(const struct srcml_archive* archive) {
+
+    return (archive->options & SRCML_OPTION_BINARY) != 0;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_enable_binary(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->options |= (unsigned long long)(SRCML_OPTION_BINARY);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_disable_binary(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->options &= ~(unsigned long long)(SRCML_OPTION_BINARY);
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_archive_enable_option
  * @param archive a srcml_archive
@@ -383,7 +532,7 @@ int srcml_archive_enable_option(struct srcml_archive* archive, size_t option) {
         archive->options |= SRCML_OPTION_CPP_DECLARED;
     }
 
-    int modoption = option % (1<<7);
+    int modoption = option % (1<<8);
 
     archive->options |= modoption;
 
@@ -405,7 +554,7 @@ int srcml_archive_disable_option(struct srcml_archive* archive, size_t option) {
     if (archive == nullptr)
         return SRCML_STATUS_INVALID_ARGUMENT;
 
-    int modoption = option % (1<<7);
+    int modoption = option % (1<<8);
 
     archive->options &= ~modoption;
 
@@ -431,6 +580,103 @@ int srcml_archive_set_tabstop(struct srcml_archive* archive, size_t tabstop) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_archive_set_read_content
+ * @param archive a srcml_archive
+ * @param content what to collect for each unit read
+ *
+ * Set what content, srcML, source, or both, is collected for each unit read.
+ * Source of a srcML-only unit is extracted from the srcML on request.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on failure.
+ */
+int srcml_archive_set_read_content(struct srcml_archive* archive, size_t content) {
+
+    if (archive == nullptr
+        || (content != SRCML_READ_CONTENT_ALL && content != SRCML_READ_CONTENT_SRCML && content != SRCML_READ_CONTENT_SRC))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->read_content = content;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_unit_filter
+ * @param archive a srcml_archive
+ * @param predicate conjunction of predicates on the unit attributes, or NULL for no filter
+ *
+ * Set the filter on the units read. The header of each unit is checked against
+ * the filter, and the body of a unit that does not satisfy it is skipped without parsing.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on failure.
+ */
+int srcml_archive_set_unit_filter(struct srcml_archive* archive, const char* predicate) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    unit_filter filter;
+    if (predicate && !unit_filter_parse(predicate, filter))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->unitfilter = filter;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_index_filename
+ * @param archive a srcml_archive
+ * @param index_filename name of the index file, or NULL for no index
+ *
+ * Set the file the element index of the units written is written to
+ * when the archive is closed.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on failure.
+ */
+int srcml_archive_set_index_filename(struct srcml_archive* archive, const char* index_filename) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->index_filename = index_filename ? boost::optional<std::string>(index_filename) : boost::none;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_cache
+ * @param archive a srcml_archive
+ * @param dirname name of the cache directory, or NULL for no cache
+ * @param max_size maximum total size in bytes of the cache, or 0 for no maximum
+ *
+ * Set the directory of the cache of parsed units. The directory is created
+ * if it does not exist.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on failure.
+ */
+int srcml_archive_set_cache(struct srcml_archive* archive, const char* dirname, size_t max_size) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    if (dirname == nullptr) {
+        archive->cache.reset();
+        return SRCML_STATUS_OK;
+    }
+
+    // another process may create the directory at the same time
+    MKDIR(dirname);
+    struct stat info;
+    if (stat(dirname, &info) != 0 || (info.st_mode & S_IFMT) != S_IFDIR)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->cache = std::make_shared<srcml_cache>(dirname, max_size);
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_archive_register_file_extension
  * @param archive a srcml_archive
@@ -654,7 +900,7 @@ const char* srcml_archive_get_version(const struct srcml_archive* archive) {
  */
 int srcml_archive_get_options(const struct srcml_archive* archive) {
 
-    return archive ? (archive->options % (1<<7)) : 0;
+    return archive ? (archive->options % (1<<8)) : 0;
 }
 
 /**
@@ -668,6 +914,17 @@ size_t srcml_archive_get_tabstop(const struct srcml_archive* archive) {
     return archive ? archive->tabstop : 0;
 }
 
+/**
+ * srcml_archive_get_read_content
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve the content collected for each unit read.
+ */
+size_t srcml_archive_get_read_content(const struct srcml_archive* archive) {
+
+    return archive ? archive->read_content : SRCML_READ_CONTENT_ALL;
+}
+
 /**
  * srcml_archive_get_namespace_size
  * @param archive a srcml_archive
@@ -851,6 +1108,63 @@ const char* srcml_archive_get_macro_type(const struct srcml_archive* archive, si
     return archive->user_macro_list[pos * 2 + 1].c_str();
 }
 
+/**
+ * srcml_archive_get_unit_filter
+ * @param archive a srcml_archive
+ *
+ * The filter set on the units read, or if none, the predicate on the unit
+ * attributes required by the first transformation, i.e., no other unit
+ * can have a result.
+ *
+ * @returns the predicate expression of the filter, or NULL if there is none.
+ */
+const char* srcml_archive_get_unit_filter(const struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return 0;
+
+    if (!archive->unitfilter.empty())
+        return archive->unitfilter.expression.c_str();
+
+    if (!archive->transformations.empty() && archive->transformations.front()->filter())
+        return archive->transformations.front()->filter()->expression.c_str();
+
+    return 0;
+}
+
+/**
+ * srcml_archive_get_cache_directory
+ * @param archive a srcml_archive
+ *
+ * @returns the directory of the cache of parsed units, or NULL if there is none.
+ */
+const char* srcml_archive_get_cache_directory(const struct srcml_archive* archive) {
+
+    return archive && archive->cache ? archive->cache->directory.c_str() : 0;
+}
+
+/**
+ * srcml_archive_get_cache_hits
+ * @param archive a srcml_archive
+ *
+ * @returns the number of units parsed that were found in the cache.
+ */
+size_t srcml_archive_get_cache_hits(const struct srcml_archive* archive) {
+
+    return archive && archive->cache ? archive->cache->hits.load() : 0;
+}
+
+/**
+ * srcml_archive_get_cache_misses
+ * @param archive a srcml_archive
+ *
+ * @returns the number of units parsed that were not found in the cache.
+ */
+size_t srcml_archive_get_cache_misses(const struct srcml_archive* archive) {
+
+    return archive && archive->cache ? archive->cache->misses.load() : 0;
+}
+
 /**
  * srcml_archive_get_srcdiff_revision
  * @param archive a srcml_archive
@@ -873,8 +1187,32 @@ size_t srcml_archive_get_srcdiff_revision(const struct srcml_archive* archive) {
  *                                                                            *
  ******************************************************************************/
 
+/**
+ * srcml_archive_write_open_binary
+ * @param archive a srcml_archive
+ *
+ * Encode the output as binary srcML, if enabled. Done once, on the first write,
+ * since options may be set after the archive is opened.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
+ */
+static int srcml_archive_write_open_binary(struct srcml_archive* archive) {
+
+    if (!(archive->options & SRCML_OPTION_BINARY) || archive->output_buffer == nullptr || archive->binary_wrapped)
+        return SRCML_STATUS_OK;
+
+    archive->output_buffer = srcml_binary_output_create(archive->output_buffer);
+    archive->binary_wrapped = true;
+
+    return archive->output_buffer ? SRCML_STATUS_OK : SRCML_STATUS_IO_ERROR;
+}
+
 static int srcml_archive_write_create_translator_xml_buffer(struct srcml_archive* archive) {
 
+    int status = srcml_archive_write_open_binary(archive);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
     try {
 
         archive->translator = new srcml_translator(
@@ -919,6 +1257,7 @@ int srcml_archive_write_open_filename(struct srcml_archive* archive, const char*
 
     archive->type = SRCML_ARCHIVE_WRITE;
     archive->output_buffer = xmlOutputBufferCreateFilename(srcml_filename, 0, 0);
+    archive->output_filename = std::string(srcml_filename);
 
     return SRCML_STATUS_OK;
 }
@@ -1020,6 +1359,34 @@ int srcml_archive_write_open_io(struct srcml_archive* archive, void * context, i
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_archive_write_open_units
+ * @param archive a srcml_archive
+ * @param context a unit context
+ * @param write_callback a unit write callback function
+ * @param close_callback a close callback function
+ *
+ * Open up a srcml_archive for writing.  Each unit written is copied
+ * and passed to the write callback, which takes ownership of the copy,
+ * instead of being serialized into the srcML of an archive.  The
+ * context is closed using close callback.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_open_units(struct srcml_archive* archive, void * context, int (*write_callback)(void * context, struct srcml_unit* unit), int (*close_callback)(void * context)) {
+
+    if (archive == nullptr || context == nullptr || write_callback == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->type = SRCML_ARCHIVE_WRITE;
+
+    archive->unit_context = context;
+    archive->unit_write_callback = write_callback;
+    archive->unit_close_callback = close_callback;
+
+    return SRCML_STATUS_OK;
+}
+
 /******************************************************************************
  *                                                                            *
  *                       Archive read open functions                          *
@@ -1039,15 +1406,28 @@ static int srcml_archive_read_open_internal(struct srcml_archive* archive, std::
     if (!input)
         return SRCML_STATUS_IO_ERROR;
 
+    // UTF-8 binary srcML is parsed directly from its records, and any other
+    // binary srcML is decoded into the srcML it was encoded from for libxml2
+    bool binary = srcml_binary_detect(input.get());
+    bool direct = binary && srcml_binary_is_utf8(input.get());
+    if (binary && !direct) {
+        input.reset(srcml_binary_input_create(input.release()));
+        if (!input)
+            return SRCML_STATUS_IO_ERROR;
+    }
+
     try {
 
-        archive->reader = new srcml_sax2_reader(archive, std::move(input));
+        archive->reader = new srcml_sax2_reader(archive, std::move(input), direct);
 
     } catch(...) {
 
         return SRCML_STATUS_IO_ERROR;
     }
 
+    if (binary)
+        archive->options |= SRCML_OPTION_BINARY;
+
     archive->type = SRCML_ARCHIVE_READ;
 
     return SRCML_STATUS_OK;
@@ -1179,12 +1559,50 @@ int srcml_archive_read_open_io(struct srcml_archive* archive, void * context, in
     return srcml_archive_read_open_internal(archive, std::move(input));
 }
 
+/**
+ * srcml_archive_read_open_units
+ * @param archive a srcml_archive
+ * @param context a unit context
+ * @param read_callback a unit read callback function
+ * @param close_callback a close callback function
+ *
+ * Open a srcML archive for reading.  Each unit read is the next unit
+ * from the read callback, e.g., as written to an archive opened with
+ * srcml_archive_write_open_units(), and belongs to this archive.
+ * There is no srcML to parse.  The context is closed using close callback.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_read_open_units(struct srcml_archive* archive, void * context, struct srcml_unit* (*read_callback)(void * context), int (*close_callback)(void * context)) {
+
+    if (archive == nullptr || context == nullptr || read_callback == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->type = SRCML_ARCHIVE_READ;
+
+    archive->unit_context = context;
+    archive->unit_read_callback = read_callback;
+    archive->unit_close_callback = close_callback;
+
+    return SRCML_STATUS_OK;
+}
+
 /******************************************************************************
  *                                                                            *
  *                       Archive read/write unit functions                    *
  *                                                                            *
  ******************************************************************************/
 
+// units with the same hash and language have the same srcML
+static std::string srcml_dedup_key(const srcml_unit* unit) {
+
+    std::string key = *unit->hash;
+    key += '\0';
+    key += unit->language ? *unit->language : Language(unit->derived_language).getLanguageString();
+
+    return key;
+}
+
 /**
  * srcml_archive_write_unit
  * @param archive a srcml archive opened for writing
@@ -1192,7 +1610,9 @@ int srcml_archive_read_open_io(struct srcml_archive* archive, void * context, in
  *
  * Append the srcml_unit unit to the srcml_archive archive.
  * If copying from a read and only the attributes have been read
- * read in the xml and output.
+ * read in the xml and output. In a dedup archive, a unit with the
+ * same hash and language as an earlier unit is written as a reference
+ * to it, without reading the body.
  *
  * Can not mix with by element mode.
  *
@@ -1203,28 +1623,96 @@ int srcml_archive_write_unit(struct srcml_archive* archive, struct srcml_unit* u
     if (archive == nullptr || unit == nullptr)
         return SRCML_STATUS_INVALID_ARGUMENT;
 
-    if (!unit->read_body && !unit->read_header)
+    // in a dedup archive, a unit with the same source as an earlier unit is written as a reference to it,
+    // except when writing an index, which needs the elements of each unit, and for the results of
+    // transformations, which share the hash of the unit they are from
+    bool dedup = (archive->options & SRCML_OPTION_DEDUP) && (archive->options & SRCML_OPTION_ARCHIVE) && !archive->index_filename
+                 && archive->transformations.empty() && unit->hash && !unit->archive->revision_number;
+    const srcml_dedup_unit* original = nullptr;
+    if (dedup) {
+        auto it = archive->dedup_units.find(srcml_dedup_key(unit));
+        if (it != archive->dedup_units.end())
+            original = &it->second;
+    }
+
+    // a duplicate is not parsed, and a reference read without expanding it has no contents,
+    // so either can only be written as a reference
+    if ((unit->duplicate || unit->ref > 0) && !original)
+        return SRCML_STATUS_INVALID_INPUT;
+
+    if (!original && !unit->read_body && !unit->read_header)
         return SRCML_STATUS_UNINITIALIZED_UNIT;
 
     // if we haven't read a unit yet, go ahead and try
-    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
+    if (!original && !unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
         unit->archive->reader->read_body(unit);
-    if (!unit->read_body) {
+    if (!original && (!unit->read_body || unit->read_src_only)) {
         return SRCML_STATUS_UNINITIALIZED_UNIT;
     }
 
+    // srcml of a unit parsed directly into a DOM
+    int status = original ? SRCML_STATUS_OK : srcml_unit_serialize_doc(unit);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
     if (archive->type != SRCML_ARCHIVE_WRITE && archive->type != SRCML_ARCHIVE_RW)
         return SRCML_STATUS_INVALID_IO_OPERATION;
 
+    // pass a copy of the unit, which has its srcml, directly to the reader of the units
+    if (archive->unit_write_callback) {
+
+        std::unique_ptr<srcml_unit> copy(new srcml_unit(*unit));
+        copy->output_buffer = nullptr;
+        copy->unit_translator = nullptr;
+        copy->doc.reset();
+
+        if (archive->unit_write_callback(archive->unit_context, copy.get()) == -1)
+            return SRCML_STATUS_IO_ERROR;
+        copy.release();
+
+        return SRCML_STATUS_OK;
+    }
+
     // if we haven't opened the translator yet, do so now
     if (archive->translator == nullptr) {
-        int status = srcml_archive_write_create_translator_xml_buffer(archive);
+        status = srcml_archive_write_create_translator_xml_buffer(archive);
         if (status != SRCML_STATUS_OK)
             return status;
     }
 
+    ++archive->dedup_count;
+
+    // reference to the earlier unit with the same source
+    if (original) {
+
+        if (unit->loc == -1)
+            unit->loc = original->loc;
+
+        archive->translator->add_unit(unit, original->position, original->namespaces);
+
+        return SRCML_STATUS_OK;
+    }
+
     archive->translator->add_unit(unit);
 
+    if (archive->index_filename) {
+        if (archive->index == nullptr)
+            archive->index = new srcml_index;
+
+        srcml_index_add_unit(archive->index, unit);
+    }
+
+    // later units with the same source are written as a reference to this one
+    if (dedup) {
+
+        srcml_dedup_unit entry;
+        entry.position = archive->dedup_count;
+        entry.loc = unit->loc;
+        entry.namespaces = unit->namespaces;
+
+        archive->dedup_units.emplace(srcml_dedup_key(unit), std::move(entry));
+    }
+
     return SRCML_STATUS_OK;
 }
 
@@ -1246,6 +1734,14 @@ int srcml_archive_write_string(struct srcml_archive* archive, const char* s, int
     if (archive == nullptr || s == nullptr || len < 0)
         return SRCML_STATUS_INVALID_ARGUMENT;
 
+    // only units can be passed directly
+    if (archive->unit_write_callback)
+        return SRCML_STATUS_INVALID_IO_OPERATION;
+
+    int status = srcml_archive_write_open_binary(archive);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
     if (archive->output_buffer)
         xmlOutputBufferWrite(archive->output_buffer, len, s);
 
@@ -1254,6 +1750,75 @@ int srcml_archive_write_string(struct srcml_archive* archive, const char* s, int
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_archive_read_filtered_header
+ * @param archive a srcml archive open for reading
+ * @param unit the unit to read the header into, replaced for each skipped unit
+ *
+ * Read the header of the next unit that satisfies the unit filter of the archive.
+ * The body of a unit that does not is skipped without parsing by reading the next header.
+ *
+ * @returns 1 on success and 0 if done
+ */
+static int srcml_archive_read_filtered_header(srcml_archive* archive, std::unique_ptr<srcml_unit>& unit) {
+
+    // units passed directly already have their body, and belong to this archive once read
+    if (archive->unit_read_callback) {
+
+        do {
+            unit.reset(archive->unit_read_callback(archive->unit_context));
+            if (!unit)
+                return 0;
+
+            unit->archive = archive;
+
+            // as for srcML, the source encoding of this archive is used
+            unit->encoding = boost::none;
+
+        } while (!archive->unitfilter.empty() && !unit_filter_match(unit.get(), archive->unitfilter));
+
+        return 1;
+    }
+
+    int not_done = archive->reader->read_header(unit.get());
+    while (not_done && !archive->unitfilter.empty() && !unit_filter_match(unit.get(), archive->unitfilter)) {
+
+        unit.reset(srcml_unit_create(archive));
+        not_done = archive->reader->read_header(unit.get());
+    }
+
+    return not_done;
+}
+
+/**
+ * srcml_archive_read_unit_header
+ * @param archive a srcml archive open for reading
+ *
+ * Read the header of the next unit from the archive.
+ * The body is not collected, and is read on first access
+ * as long as no other unit has been read from the archive.
+ *
+ * @returns Return the read srcml_unit on success.
+ * On failure returns NULL.
+ */
+struct srcml_unit* srcml_archive_read_unit_header(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return nullptr;
+
+    if (archive->type != SRCML_ARCHIVE_READ && archive->type != SRCML_ARCHIVE_RW)
+        return nullptr;
+
+    std::unique_ptr<srcml_unit> unit(srcml_unit_create(archive));
+
+    int not_done = srcml_archive_read_filtered_header(archive, unit);
+    if (!not_done) {
+        return nullptr;
+    }
+
+    return unit.release();
+}
+
 /**
  * srcml_archive_read_unit
  * @param archive a srcml archive open for reading
@@ -1276,9 +1841,10 @@ struct srcml_unit* srcml_archive_read_unit(struct srcml_archive* archive) {
     std::unique_ptr<srcml_unit> unit(srcml_unit_create(archive));
     int not_done = 0;
     if (!unit->read_header)
-        not_done = archive->reader->read_header(unit.get());
+        not_done = srcml_archive_read_filtered_header(archive, unit);
 
-    archive->reader->read_body(unit.get());
+    if (archive->reader)
+        archive->reader->read_body(unit.get());
 
     if (!not_done || !unit->read_body) {
         return nullptr;
@@ -1291,7 +1857,7 @@ struct srcml_unit* srcml_archive_read_unit(struct srcml_archive* archive) {
  * srcml_archive_skip_unit
  * @param archive a srcml archive open for reading
  *
- * Skip the next unit from the archive.
+ * Skip the next unit from the archive that satisfies the unit filter.
  *
  * @returns 1 on success
  * @returns 0 on failure
@@ -1307,7 +1873,7 @@ int srcml_archive_skip_unit(struct srcml_archive* archive) {
     // read the header only of a temporary unit
     std::unique_ptr<srcml_unit> unit(srcml_unit_create(archive));
 
-    int not_done = archive->reader->read_header(unit.get());
+    int not_done = srcml_archive_read_filtered_header(archive, unit);
     if (!not_done) {
         return 0;
     }
@@ -1334,19 +1900,52 @@ void srcml_archive_close(struct srcml_archive* archive) {
     if (archive == nullptr)
         return;
 
+    // units passed directly have no srcML
+    bool units = archive->unit_write_callback || archive->unit_read_callback;
+
     // if we haven't opened the translator yet, do so now. This will create an empty unit/archive
-    if (archive->type == SRCML_ARCHIVE_WRITE && !archive->rawwrites && archive->translator == nullptr) {
+    if (archive->type == SRCML_ARCHIVE_WRITE && !units && !archive->rawwrites && archive->translator == nullptr) {
         srcml_archive_write_create_translator_xml_buffer(archive);
     }
 
+    // the translator closes the output buffer, including any raw writes to it
     if (archive->translator) {
         archive->translator->close();
+        archive->output_buffer = nullptr;
     }
 
+    // references are only to units of the same output
+    archive->dedup_units.clear();
+    archive->dedup_count = 0;
+
+    // keep the cache within its size after adding to it
+    if (archive->cache && archive->cache->stored > 0)
+        srcml_cache_evict(archive->cache.get());
+
     if (archive->rawwrites && archive->output_buffer) {
         xmlOutputBufferClose(archive->output_buffer);
         archive->output_buffer = nullptr;
     }
+    archive->binary_wrapped = false;
+
+    // an archive with no units has an empty index, and the index is of the complete output file
+    if (archive->type == SRCML_ARCHIVE_WRITE && archive->index_filename) {
+
+        if (archive->index == nullptr)
+            archive->index = new srcml_index;
+
+        srcml_index_set_namespaces(archive->index, archive->namespaces);
+        if (archive->output_filename)
+            srcml_index_set_srcml_filename(archive->index, archive->output_filename->c_str());
+        if (srcml_index_write_filename(archive->index, archive->index_filename->c_str()) != SRCML_STATUS_OK) {
+            archive->error_string = "Unable to write index file " + *archive->index_filename;
+            archive->error_number = SRCML_STATUS_IO_ERROR;
+        }
+
+        delete archive->index;
+        archive->index = nullptr;
+    }
+    archive->output_filename = boost::none;
 
     // Give the user the completed buffer if opened using srcml_archive_write_open_memory()
     if (archive->buffer && archive->size) {
@@ -1356,5 +1955,14 @@ void srcml_archive_close(struct srcml_archive* archive) {
         (*archive->buffer) = (char *) xmlBufferDetach(archive->xbuffer);
     }
 
+    // done with the units passed directly
+    if (units && archive->unit_close_callback)
+        archive->unit_close_callback(archive->unit_context);
+
+    archive->unit_context = nullptr;
+    archive->unit_write_callback = nullptr;
+    archive->unit_read_callback = nullptr;
+    archive->unit_close_callback = nullptr;
+
     archive->type = SRCML_ARCHIVE_INVALID;
 }
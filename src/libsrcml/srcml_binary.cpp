@@ -0,0 +1,1500 @@
+/**
+ * @file srcml_binary.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+  Binary srcML is a stream of operations on the bytes of the srcML, so that decoding
+  reproduces the srcML byte for byte. Element and attribute names are assigned ids
+  from a dictionary built as the stream is written, and attribute values, e.g.,
+  namespace URIs, filenames, and languages, are referred to by index after their first use.
+
+  Operations:
+    00-3f         text, with the length in the low bits
+    40-7f         start tag, with the name id in the low bits, followed by the attributes
+    80-bf         empty element tag, with the name id in the low bits, followed by the attributes
+    c0            end tag of the innermost open element
+    f0 len        text
+    f1 id         start tag, followed by the attributes
+    f2 id         empty element tag, followed by the attributes
+    f3 len        raw markup, e.g., XML declaration, comment, processing instruction, CDATA
+    f4 len len    raw start tag not in the form <q a="v">, with the qualified name and the tag
+    f5 len        raw end tag not of the innermost open element
+
+  A name id equal to the number of names defined so far defines the next name, and is
+  followed by its length and characters. Attributes are a count followed by, for each,
+  the name id and a value index, where 0 is followed by the length and characters of the
+  value. All numbers are unsigned LEB128.
+*/
+
+#include <srcml_binary.hpp>
+#include <sax2_srcsax_handler.hpp>
+#include <libxml/tree.h>
+#include <libxml/parserInternals.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+    // signature at the start of binary srcML, followed by the version of the format
+    const unsigned char SIGNATURE[] = { 0x89, 's', 'r', 'c', 'M', 'L', '\n', 0x01 };
+
+    const unsigned char OP_TEXT       = 0x00;
+    const unsigned char OP_START      = 0x40;
+    const unsigned char OP_EMPTY      = 0x80;
+    const unsigned char OP_END        = 0xc0;
+    const unsigned char OP_TEXT_LONG  = 0xf0;
+    const unsigned char OP_START_LONG = 0xf1;
+    const unsigned char OP_EMPTY_LONG = 0xf2;
+    const unsigned char OP_RAW        = 0xf3;
+    const unsigned char OP_RAW_START  = 0xf4;
+    const unsigned char OP_RAW_END    = 0xf5;
+
+    // limit of lengths and name ids in the low bits of an operation
+    const size_t SHORT_LIMIT = 0x40;
+
+    // limits on the dictionaries, so that memory does not grow with the input
+    const size_t MAX_NAMES = 4096;
+    const size_t MAX_VALUES = 1024;
+    const size_t MAX_VALUE_SIZE = 64;
+
+    // characters that end a name in a tag
+    bool is_name_end(char c) {
+
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>'
+            || c == '=' || c == '"' || c == '\'' || c == '<';
+    }
+
+    void append_number(std::string& out, size_t value) {
+
+        while (value >= 0x80) {
+            out += (char) ((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += (char) value;
+    }
+
+    void append_string(std::string& out, const char* s, size_t size) {
+
+        append_number(out, size);
+        out.append(s, size);
+    }
+
+    // encoding in an XML declaration, or empty if none
+    std::string declared_encoding(const std::string& declaration) {
+
+        auto pos = declaration.find("encoding");
+        if (pos == std::string::npos)
+            return "";
+
+        pos = declaration.find_first_of("\"'", pos);
+        if (pos == std::string::npos)
+            return "";
+
+        auto end = declaration.find(declaration[pos], pos + 1);
+        if (end == std::string::npos)
+            return "";
+
+        return declaration.substr(pos + 1, end - pos - 1);
+    }
+
+    /*
+      Encoder of srcML into binary srcML
+    */
+    struct binary_encoder {
+
+        // output of the binary srcML
+        xmlOutputBuffer* output = nullptr;
+
+        // srcML not yet encoded, an incomplete markup token
+        std::string pending;
+
+        // binary srcML not yet written
+        std::string out;
+
+        // ids of the element and attribute names, and the index of each attribute value by name id
+        std::unordered_map<std::string, size_t> names;
+        std::vector<std::unordered_map<std::string, size_t>> values;
+
+        // names of the open elements
+        std::vector<std::string> stack;
+
+        // append the definition of a name that is new
+        void append_definition(const std::string& name, bool defined) {
+
+            if (!defined)
+                append_string(out, name.c_str(), name.size());
+        }
+
+        // id of a name, defining it if new
+        size_t name_id(const std::string& name, bool& defined) {
+
+            auto it = names.find(name);
+            defined = it != names.end();
+            if (defined)
+                return it->second;
+
+            size_t id = names.size();
+            names[name] = id;
+            values.emplace_back();
+
+            return id;
+        }
+
+        void text(const char* s, size_t size) {
+
+            if (size == 0)
+                return;
+
+            if (size < SHORT_LIMIT) {
+                out += (char) (OP_TEXT | size);
+                out.append(s, size);
+            } else {
+                out += (char) OP_TEXT_LONG;
+                append_string(out, s, size);
+            }
+        }
+
+        void raw(const std::string& token) {
+
+            out += (char) OP_RAW;
+            append_string(out, token.c_str(), token.size());
+        }
+
+        void end_tag(const std::string& token) {
+
+            std::string qname = token.substr(2, token.size() - 3);
+            if (!stack.empty() && stack.back() == qname) {
+                out += (char) OP_END;
+            } else {
+                out += (char) OP_RAW_END;
+                append_string(out, token.c_str(), token.size());
+            }
+
+            if (!stack.empty())
+                stack.pop_back();
+        }
+
+        void start_tag(const std::string& token) {
+
+            // qualified name
+            size_t pos = 1;
+            while (pos < token.size() && !is_name_end(token[pos]))
+                ++pos;
+            std::string qname = token.substr(1, pos - 1);
+
+            // attributes in the form ' a="v"'
+            bool canonical = !qname.empty();
+            std::vector<std::pair<std::string, std::string>> attributes;
+            while (canonical && token[pos] == ' ') {
+
+                size_t name_start = ++pos;
+                while (pos < token.size() && !is_name_end(token[pos]))
+                    ++pos;
+                if (pos == name_start || token.compare(pos, 2, "=\"") != 0) {
+                    canonical = false;
+                    break;
+                }
+
+                size_t value_start = pos + 2;
+                size_t value_end = token.find('"', value_start);
+                if (value_end == std::string::npos) {
+                    canonical = false;
+                    break;
+                }
+
+                attributes.emplace_back(token.substr(name_start, pos - name_start), token.substr(value_start, value_end - value_start));
+                pos = value_end + 1;
+            }
+
+            bool empty = canonical && token[pos] == '/';
+            if (empty)
+                ++pos;
+            canonical = canonical && pos == token.size() - 1;
+
+            // names must fit in the dictionary
+            if (canonical) {
+                size_t newnames = !names.count(qname);
+                for (const auto& attribute : attributes)
+                    newnames += !names.count(attribute.first) && attribute.first != qname;
+                canonical = names.size() + newnames <= MAX_NAMES;
+            }
+
+            if (!canonical) {
+
+                if (token.size() >= 2 && token[token.size() - 2] == '/') {
+                    raw(token);
+                } else {
+                    out += (char) OP_RAW_START;
+                    append_string(out, qname.c_str(), qname.size());
+                    append_string(out, token.c_str(), token.size());
+                    stack.push_back(qname);
+                }
+                return;
+            }
+
+            bool defined = false;
+            size_t id = name_id(qname, defined);
+            if (id < SHORT_LIMIT) {
+                out += (char) ((empty ? OP_EMPTY : OP_START) | id);
+            } else {
+                out += (char) (empty ? OP_EMPTY_LONG : OP_START_LONG);
+                append_number(out, id);
+            }
+            append_definition(qname, defined);
+
+            append_number(out, attributes.size());
+            for (const auto& attribute : attributes) {
+
+                size_t attribute_id = name_id(attribute.first, defined);
+                append_number(out, attribute_id);
+                append_definition(attribute.first, defined);
+
+                auto& dictionary = values[attribute_id];
+                auto it = dictionary.find(attribute.second);
+                if (it != dictionary.end()) {
+                    append_number(out, it->second + 1);
+                    continue;
+                }
+
+                append_number(out, 0);
+                append_string(out, attribute.second.c_str(), attribute.second.size());
+                if (attribute.second.size() <= MAX_VALUE_SIZE && dictionary.size() < MAX_VALUES) {
+                    size_t index = dictionary.size();
+                    dictionary[attribute.second] = index;
+                }
+            }
+
+            if (!empty)
+                stack.push_back(qname);
+        }
+
+        // end of the markup token at pos, or npos if incomplete
+        size_t token_end(size_t pos) const {
+
+            static const std::pair<const char*, const char*> delimiters[] = {
+                { "<!--", "-->" }, { "<![CDATA[", "]]>" }, { "<?", "?>" }
+            };
+
+            for (const auto& delimiter : delimiters) {
+
+                size_t size = strlen(delimiter.first);
+                size_t available = std::min(size, pending.size() - pos);
+                if (pending.compare(pos, available, delimiter.first, available) != 0)
+                    continue;
+
+                // could still be this kind of markup
+                if (available < size)
+                    return std::string::npos;
+
+                size_t end = pending.find(delimiter.second, pos + size);
+                return end == std::string::npos ? end : end + strlen(delimiter.second) - 1;
+            }
+
+            // tags and declarations, respecting quoted values and internal subsets
+            char quote = 0;
+            int depth = 0;
+            for (size_t i = pos + 1; i < pending.size(); ++i) {
+
+                char c = pending[i];
+                if (quote) {
+                    if (c == quote)
+                        quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    quote = c;
+                } else if (c == '[') {
+                    ++depth;
+                } else if (c == ']') {
+                    --depth;
+                } else if (c == '>' && depth <= 0) {
+                    return i;
+                }
+            }
+
+            return std::string::npos;
+        }
+
+        // encode the complete tokens of the pending srcML
+        void encode() {
+
+            size_t pos = 0;
+            while (pos < pending.size()) {
+
+                // text, which can always be split
+                if (pending[pos] != '<') {
+                    size_t next = pending.find('<', pos);
+                    if (next == std::string::npos)
+                        next = pending.size();
+                    text(pending.c_str() + pos, next - pos);
+                    pos = next;
+                    continue;
+                }
+
+                size_t end = token_end(pos);
+                if (end == std::string::npos)
+                    break;
+
+                std::string token = pending.substr(pos, end - pos + 1);
+                if (token[1] == '/')
+                    end_tag(token);
+                else if (token[1] == '!' || token[1] == '?')
+                    raw(token);
+                else
+                    start_tag(token);
+
+                pos = end + 1;
+            }
+
+            pending.erase(0, pos);
+        }
+
+        int flush() {
+
+            if (out.empty())
+                return 0;
+
+            int status = xmlOutputBufferWrite(output, (int) out.size(), out.c_str());
+            out.clear();
+
+            return status < 0 ? -1 : 0;
+        }
+    };
+
+    int binary_write(void* context, const char* buffer, int len) {
+
+        auto encoder = (binary_encoder*) context;
+
+        encoder->pending.append(buffer, len);
+        encoder->encode();
+
+        return encoder->flush() < 0 ? -1 : len;
+    }
+
+    int binary_write_close(void* context) {
+
+        auto encoder = (binary_encoder*) context;
+
+        // incomplete markup at the end is kept as is
+        if (!encoder->pending.empty())
+            encoder->raw(encoder->pending);
+
+        int status = encoder->flush();
+        if (xmlOutputBufferClose(encoder->output) < 0)
+            status = -1;
+
+        delete encoder;
+
+        return status;
+    }
+
+    /*
+      Decoder of binary srcML into srcML
+    */
+    struct binary_decoder {
+
+        // input of the binary srcML, and the size of the input already decoded
+        xmlParserInputBuffer* input = nullptr;
+        size_t consumed = 0;
+
+        // srcML decoded and not yet read
+        std::string out;
+        size_t outpos = 0;
+
+        // names by id, and attribute values by name id
+        std::vector<std::string> names;
+        std::vector<std::vector<std::string>> values;
+
+        // names of the open elements
+        std::vector<std::string> stack;
+
+        // binary srcML is not valid
+        bool error = false;
+
+        // attribute of a tag, with the offsets of the value in the decoded srcML
+        struct attribute {
+            size_t name;
+            size_t begin;
+            size_t end;
+        };
+
+        // the last operation decoded, with the offset of its srcML in the decoded srcML,
+        // and for a tag, the name id and attributes
+        unsigned char last_op = OP_TEXT;
+        size_t last_begin = 0;
+        size_t last_name = 0;
+        std::vector<attribute> last_attributes;
+
+        bool read_number(const unsigned char*& p, const unsigned char* end, size_t& value) {
+
+            value = 0;
+            for (int shift = 0; p < end; shift += 7) {
+
+                if (shift > 56) {
+                    error = true;
+                    return false;
+                }
+
+                unsigned char c = *p++;
+                value |= (size_t) (c & 0x7f) << shift;
+                if (!(c & 0x80))
+                    return true;
+            }
+
+            return false;
+        }
+
+        bool read_string(const unsigned char*& p, const unsigned char* end, const char*& s, size_t& size) {
+
+            if (!read_number(p, end, size) || (size_t) (end - p) < size)
+                return false;
+
+            s = (const char*) p;
+            p += size;
+
+            return true;
+        }
+
+        // name of an id, defining the name if new
+        bool read_name(const unsigned char*& p, const unsigned char* end, size_t id, size_t& count, bool commit, std::string& name) {
+
+            if (id < count) {
+                if (commit)
+                    name = names[id];
+                return true;
+            }
+
+            if (id != count) {
+                error = true;
+                return false;
+            }
+
+            const char* s = nullptr;
+            size_t size = 0;
+            if (!read_string(p, end, s, size))
+                return false;
+
+            ++count;
+            if (commit) {
+                names.emplace_back(s, size);
+                values.emplace_back();
+                name = names.back();
+            }
+
+            return true;
+        }
+
+        /*
+          Decode the operation at the start of the binary srcML. Without commit, only
+          checks that the operation is complete, without changing the dictionaries.
+
+          @returns the size of the operation, or 0 if incomplete or not valid
+        */
+        size_t decode(const unsigned char* begin, const unsigned char* end, bool commit) {
+
+            const unsigned char* p = begin;
+            if (p == end)
+                return 0;
+
+            unsigned char op = *p++;
+            size_t count = names.size();
+            const char* s = nullptr;
+            size_t size = 0;
+
+            if (commit) {
+                last_begin = out.size();
+                last_attributes.clear();
+            }
+
+            if (op < OP_START || op == OP_TEXT_LONG || op == OP_RAW || op == OP_RAW_END) {
+
+                if (op < OP_START) {
+                    size = op;
+                    if ((size_t) (end - p) < size)
+                        return 0;
+                    s = (const char*) p;
+                    p += size;
+                } else if (!read_string(p, end, s, size)) {
+                    return 0;
+                }
+
+                if (commit) {
+                    out.append(s, size);
+                    if (op == OP_RAW_END && !stack.empty())
+                        stack.pop_back();
+                    last_op = op < OP_START || op == OP_TEXT_LONG ? OP_TEXT : op;
+                }
+
+            } else if (op == OP_END) {
+
+                if (commit) {
+                    if (stack.empty()) {
+                        error = true;
+                        return 0;
+                    }
+                    out += "</";
+                    out += stack.back();
+                    out += '>';
+                    stack.pop_back();
+                    last_op = OP_END;
+                }
+
+            } else if (op == OP_RAW_START) {
+
+                const char* qname = nullptr;
+                size_t qname_size = 0;
+                if (!read_string(p, end, qname, qname_size) || !read_string(p, end, s, size))
+                    return 0;
+
+                if (commit) {
+                    out.append(s, size);
+                    stack.emplace_back(qname, qname_size);
+                    last_op = OP_RAW_START;
+                }
+
+            } else if (op < OP_END || op == OP_START_LONG || op == OP_EMPTY_LONG) {
+
+                bool empty = op == OP_EMPTY_LONG || (op >= OP_EMPTY && op < OP_END);
+                size_t id = op & (SHORT_LIMIT - 1);
+                if (op >= OP_TEXT_LONG && !read_number(p, end, id))
+                    return 0;
+
+                std::string qname;
+                if (!read_name(p, end, id, count, commit, qname))
+                    return 0;
+
+                if (commit) {
+                    out += '<';
+                    out += qname;
+                    last_op = empty ? OP_EMPTY : OP_START;
+                    last_name = id;
+                }
+
+                size_t attribute_count = 0;
+                if (!read_number(p, end, attribute_count))
+                    return 0;
+
+                for (size_t i = 0; i < attribute_count; ++i) {
+
+                    size_t attribute_id = 0;
+                    std::string attribute;
+                    size_t index = 0;
+                    if (!read_number(p, end, attribute_id) || !read_name(p, end, attribute_id, count, commit, attribute)
+                        || !read_number(p, end, index))
+                        return 0;
+
+                    if (index == 0 && !read_string(p, end, s, size))
+                        return 0;
+
+                    if (!commit)
+                        continue;
+
+                    auto& dictionary = values[attribute_id];
+                    if (index == 0) {
+                        if (size <= MAX_VALUE_SIZE && dictionary.size() < MAX_VALUES)
+                            dictionary.emplace_back(s, size);
+                    } else if (index > dictionary.size()) {
+                        error = true;
+                        return 0;
+                    }
+
+                    out += ' ';
+                    out += attribute;
+                    out += "=\"";
+                    size_t value_begin = out.size();
+                    if (index == 0)
+                        out.append(s, size);
+                    else
+                        out += dictionary[index - 1];
+                    last_attributes.push_back({ attribute_id, value_begin, out.size() });
+                    out += '"';
+                }
+
+                if (commit) {
+                    if (empty) {
+                        out += "/>";
+                    } else {
+                        out += '>';
+                        stack.push_back(qname);
+                    }
+                }
+
+            } else {
+
+                error = true;
+                return 0;
+            }
+
+            return p - begin;
+        }
+    };
+
+    int binary_read(void* context, char* buffer, int len) {
+
+        auto decoder = (binary_decoder*) context;
+        xmlParserInputBuffer* input = decoder->input;
+
+        while (decoder->out.size() - decoder->outpos < (size_t) len) {
+
+            const unsigned char* begin = xmlBufContent(input->buffer) + decoder->consumed;
+            const unsigned char* end = xmlBufContent(input->buffer) + xmlBufUse(input->buffer);
+
+            // decode only complete operations
+            size_t size = decoder->decode(begin, end, false);
+            if (size) {
+                decoder->decode(begin, end, true);
+                decoder->consumed += size;
+                continue;
+            }
+
+            if (decoder->error)
+                return -1;
+
+            // shrinking moves the rest of the input, so it is only done before growing
+            xmlBufShrink(input->buffer, decoder->consumed);
+            decoder->consumed = 0;
+
+            int status = xmlParserInputBufferGrow(input, 4096);
+            if (status < 0)
+                return -1;
+
+            if (status == 0) {
+
+                // an incomplete operation at the end
+                if (xmlBufUse(input->buffer) != 0)
+                    return -1;
+
+                break;
+            }
+        }
+
+        size_t size = std::min(decoder->out.size() - decoder->outpos, (size_t) len);
+        memcpy(buffer, decoder->out.c_str() + decoder->outpos, size);
+        decoder->outpos += size;
+
+        // decoded srcML that is read is not kept
+        if (decoder->outpos == decoder->out.size()) {
+            decoder->out.clear();
+            decoder->outpos = 0;
+        }
+
+        return (int) size;
+    }
+
+    int binary_read_close(void* context) {
+
+        auto decoder = (binary_decoder*) context;
+
+        xmlFreeParserInputBuffer(decoder->input);
+        delete decoder;
+
+        return 0;
+    }
+
+    /*
+      Parser of binary srcML directly into the SAX2 callbacks of a parser context. The
+      callbacks receive the same arguments, and the parser input is positioned in the
+      decoded srcML the same way, as when libxml2 parses the srcML, so that the
+      srcSAX handler collects the unit srcML from the input as it does for srcML.
+
+      This writes fields of the libxml2 structs that are not part of its API:
+      input->base, input->cur, input->end and input->consumed of xmlParserInput, and
+      nameNr and lastError of xmlParserCtxt. They were checked against the parser.h
+      of libxml2 2.9.14 only, and must be rechecked when other versions are supported.
+    */
+    struct binary_parser {
+
+        // size of the decoded srcML before the parser position that is kept
+        static const size_t KEEP_SIZE = 1 << 16;
+
+        // qualified name, split and in the dictionary of the parser
+        struct qname {
+            const xmlChar* localname = nullptr;
+            const xmlChar* prefix = nullptr;
+        };
+
+        // attribute of a tag, with the offsets of the value in the decoded srcML
+        struct tag_attribute {
+            qname name;
+            size_t begin;
+            size_t end;
+        };
+
+        // open element, with the number of namespace declarations in scope at its start
+        struct element {
+            qname name;
+            const xmlChar* URI;
+            size_t namespaces;
+        };
+
+        xmlParserCtxtPtr ctxt = nullptr;
+        binary_decoder decoder;
+
+        // qualified names by name id of the binary srcML
+        std::vector<qname> qnames;
+
+        // namespace declarations in scope, as prefix and URI
+        std::vector<std::pair<const xmlChar*, const xmlChar*>> namespaces;
+
+        std::vector<element> elements;
+
+        // attributes of the current tag, and the arguments of the callbacks
+        std::vector<tag_attribute> attributes;
+        std::vector<const xmlChar*> namespace_args;
+        std::vector<const xmlChar*> attribute_args;
+        std::vector<std::string> values;
+        std::string text;
+
+        const xmlChar* XMLNS = nullptr;
+        const xmlChar* XML = nullptr;
+        const xmlChar* XML_URI = nullptr;
+
+        // text of consecutive text operations, which can split a reference or line end
+        bool pending_text = false;
+        size_t text_begin = 0;
+
+        bool started = false;
+        bool root = false;
+        int status = 0;
+
+        binary_parser(xmlParserCtxtPtr ctxt) : ctxt(ctxt) {
+
+            XMLNS = intern("xmlns", 5);
+            XML = intern("xml", 3);
+            XML_URI = intern((const char*) XML_XML_NAMESPACE, strlen((const char*) XML_XML_NAMESPACE));
+        }
+
+        const xmlChar* intern(const char* s, size_t size) {
+
+            return xmlDictLookup(ctxt->dict, BAD_CAST s, (int) size);
+        }
+
+        qname split(const char* s, size_t size) {
+
+            qname name;
+            auto colon = (const char*) memchr(s, ':', size);
+            if (colon) {
+                name.prefix = intern(s, colon - s);
+                name.localname = intern(colon + 1, s + size - colon - 1);
+            } else {
+                name.localname = intern(s, size);
+            }
+
+            return name;
+        }
+
+        // qualified name of a name id
+        const qname& name(size_t id) {
+
+            while (qnames.size() <= id) {
+                const std::string& s = decoder.names[qnames.size()];
+                qnames.push_back(split(s.c_str(), s.size()));
+            }
+
+            return qnames[id];
+        }
+
+        // URI of the namespace prefix in scope
+        const xmlChar* uri(const xmlChar* prefix) const {
+
+            for (auto it = namespaces.rbegin(); it != namespaces.rend(); ++it) {
+                if (it->first == prefix)
+                    return it->second;
+            }
+
+            return prefix == XML ? XML_URI : nullptr;
+        }
+
+        const char* srcml() const {
+
+            return decoder.out.c_str();
+        }
+
+        // position the parser input at the offset in the decoded srcML
+        void position(size_t offset) {
+
+            auto input = ctxt->input;
+            input->base = (const xmlChar*) srcml();
+            input->cur = input->base + offset;
+            input->end = input->base + decoder.out.size();
+        }
+
+        // the callbacks stopped the parser
+        bool stopped() const {
+
+            return ctxt->disableSAX || ctxt->instate == XML_PARSER_EOF;
+        }
+
+        bool error(const char* message) {
+
+            ctxt->wellFormed = 0;
+            xmlResetError(&ctxt->lastError);
+            ctxt->lastError.domain = XML_FROM_PARSER;
+            ctxt->lastError.code = XML_ERR_DOCUMENT_END;
+            ctxt->lastError.level = XML_ERR_FATAL;
+            ctxt->lastError.message = (char*) xmlStrdup(BAD_CAST message);
+            ctxt->errNo = XML_ERR_DOCUMENT_END;
+            status = -1;
+
+            return false;
+        }
+
+        /*
+          Decode the references and normalize the line ends of text, as libxml2 does.
+          Attribute values also have whitespace normalized to spaces.
+
+          @returns false if the text is the same after decoding
+        */
+        bool decode(const char* s, size_t size, bool attribute, std::string& value) {
+
+            const char* end = s + size;
+            const char* p = s;
+            while (p < end && *p != '&' && *p != '\r' && !(attribute && (*p == '\n' || *p == '\t')))
+                ++p;
+            if (p == end)
+                return false;
+
+            value.assign(s, p);
+            while (p < end) {
+
+                char c = *p;
+                if (c == '\r') {
+                    value += attribute ? ' ' : '\n';
+                    if (p + 1 < end && p[1] == '\n')
+                        ++p;
+                    ++p;
+                    continue;
+                }
+
+                if (attribute && (c == '\n' || c == '\t')) {
+                    value += ' ';
+                    ++p;
+                    continue;
+                }
+
+                auto semi = c == '&' ? (const char*) memchr(p, ';', end - p) : nullptr;
+                if (!semi) {
+                    value += c;
+                    ++p;
+                    continue;
+                }
+
+                std::string entity(p + 1, semi);
+                long code = 0;
+                if (entity == "lt")
+                    code = '<';
+                else if (entity == "gt")
+                    code = '>';
+                else if (entity == "amp")
+                    code = '&';
+                else if (entity == "quot")
+                    code = '"';
+                else if (entity == "apos")
+                    code = '\'';
+                else if (entity.size() > 1 && entity[0] == '#')
+                    code = strtol(entity.c_str() + 1 + (entity[1] == 'x'), nullptr, entity[1] == 'x' ? 16 : 10);
+
+                xmlChar utf8[5];
+                int length = code > 0 && code <= 0x10FFFF ? xmlCopyCharMultiByte(utf8, (int) code) : 0;
+                if (length > 0) {
+                    value.append((const char*) utf8, length);
+                    p = semi + 1;
+                } else {
+                    value += c;
+                    ++p;
+                }
+            }
+
+            return true;
+        }
+
+        bool start_document(size_t offset) {
+
+            started = true;
+            position(offset);
+            if (ctxt->sax->startDocument && !ctxt->disableSAX)
+                ctxt->sax->startDocument(ctxt->userData);
+
+            return !stopped();
+        }
+
+        bool is_declaration(size_t begin, size_t end) const {
+
+            return end - begin > 6 && decoder.out.compare(begin, 5, "<?xml") == 0 && isspace(srcml()[begin + 5]);
+        }
+
+        // XML declaration, with the encoding of the document
+        bool declaration(size_t begin, size_t end) {
+
+            std::string encoding = declared_encoding(decoder.out.substr(begin, end - begin));
+            if (!encoding.empty() && ctxt->encoding == nullptr)
+                ctxt->encoding = xmlStrdup(BAD_CAST encoding.c_str());
+
+            return start_document(end);
+        }
+
+        // parse a tag not in the form of a binary srcML tag, with the end the offset of the '>'
+        bool parse_tag(size_t begin, size_t end, qname& tagname, bool& empty) {
+
+            const char* s = srcml();
+            size_t pos = begin + 1;
+            while (pos < end && !is_name_end(s[pos]))
+                ++pos;
+            if (pos == begin + 1)
+                return false;
+            tagname = split(s + begin + 1, pos - begin - 1);
+
+            attributes.clear();
+            empty = false;
+            while (true) {
+
+                while (pos < end && isspace(s[pos]))
+                    ++pos;
+
+                if (pos == end)
+                    return true;
+
+                if (s[pos] == '/') {
+                    empty = true;
+                    return pos + 1 == end;
+                }
+
+                size_t name_begin = pos;
+                while (pos < end && !is_name_end(s[pos]))
+                    ++pos;
+                size_t name_end = pos;
+                while (pos < end && isspace(s[pos]))
+                    ++pos;
+                if (name_begin == name_end || pos == end || s[pos] != '=')
+                    return false;
+                ++pos;
+                while (pos < end && isspace(s[pos]))
+                    ++pos;
+                if (pos == end || (s[pos] != '"' && s[pos] != '\''))
+                    return false;
+
+                auto quote = (const char*) memchr(s + pos + 1, s[pos], end - pos - 1);
+                if (!quote)
+                    return false;
+
+                attributes.push_back({ split(s + name_begin, name_end - name_begin), pos + 1, (size_t) (quote - s) });
+                pos = quote - s + 1;
+            }
+        }
+
+        // start tag of the attributes, with the end the offset of the '>'
+        bool start_element(const qname& tagname, size_t end, bool empty) {
+
+            element e;
+            e.name = tagname;
+            e.namespaces = namespaces.size();
+
+            // namespace declarations
+            for (const auto& attribute : attributes) {
+
+                if (attribute.name.prefix != XMLNS && !(attribute.name.prefix == nullptr && attribute.name.localname == XMLNS))
+                    continue;
+
+                const char* value = srcml() + attribute.begin;
+                size_t size = attribute.end - attribute.begin;
+                if (decode(value, size, true, text)) {
+                    value = text.c_str();
+                    size = text.size();
+                }
+
+                namespaces.emplace_back(attribute.name.prefix ? attribute.name.localname : nullptr, intern(value, size));
+            }
+
+            e.URI = uri(e.name.prefix);
+            elements.push_back(e);
+            ctxt->nameNr = (int) elements.size();
+            root = true;
+
+            position(empty ? end - 1 : end);
+            if (ctxt->sax->startElementNs && !ctxt->disableSAX) {
+
+                namespace_args.clear();
+                for (auto i = e.namespaces; i < namespaces.size(); ++i) {
+                    namespace_args.push_back(namespaces[i].first);
+                    namespace_args.push_back(namespaces[i].second);
+                }
+
+                // decoded values are stored first, since their storage moves as it grows
+                values.resize(attributes.size());
+                attribute_args.clear();
+                for (size_t i = 0; i < attributes.size(); ++i) {
+
+                    const auto& attribute = attributes[i];
+                    if (attribute.name.prefix == XMLNS || (attribute.name.prefix == nullptr && attribute.name.localname == XMLNS))
+                        continue;
+
+                    const char* value = srcml() + attribute.begin;
+                    const char* value_end = srcml() + attribute.end;
+                    if (decode(value, attribute.end - attribute.begin, true, values[i])) {
+                        value = values[i].c_str();
+                        value_end = value + values[i].size();
+                    }
+
+                    attribute_args.push_back(attribute.name.localname);
+                    attribute_args.push_back(attribute.name.prefix);
+                    attribute_args.push_back(attribute.name.prefix ? uri(attribute.name.prefix) : nullptr);
+                    attribute_args.push_back((const xmlChar*) value);
+                    attribute_args.push_back((const xmlChar*) value_end);
+                }
+
+                ctxt->sax->startElementNs(ctxt->userData, e.name.localname, e.name.prefix, e.URI,
+                                          (int) (namespaces.size() - e.namespaces), namespace_args.data(),
+                                          (int) (attribute_args.size() / 5), 0, attribute_args.data());
+            }
+
+            if (stopped())
+                return false;
+
+            return !empty || end_element(end + 1);
+        }
+
+        // end tag of the innermost element, with the end the offset past the '>'
+        bool end_element(size_t end) {
+
+            if (elements.empty())
+                return error("Extra end tag in binary srcML\n");
+
+            position(end);
+            const auto& e = elements.back();
+            if (ctxt->sax->endElementNs && !ctxt->disableSAX)
+                ctxt->sax->endElementNs(ctxt->userData, e.name.localname, e.name.prefix, e.URI);
+
+            namespaces.resize(e.namespaces);
+            elements.pop_back();
+            ctxt->nameNr = (int) elements.size();
+
+            return !stopped();
+        }
+
+        bool characters(size_t begin, size_t end) {
+
+            // only whitespace is outside of the root element
+            if (elements.empty())
+                return true;
+
+            position(end);
+            if (!ctxt->sax->characters || ctxt->disableSAX)
+                return true;
+
+            const char* s = srcml() + begin;
+            size_t size = end - begin;
+            if (decode(s, size, false, text)) {
+                s = text.c_str();
+                size = text.size();
+            }
+
+            ctxt->sax->characters(ctxt->userData, (const xmlChar*) s, (int) size);
+
+            return !stopped();
+        }
+
+        // markup kept raw: comments, CDATA, processing instructions, declarations, and empty element tags
+        bool raw(size_t begin, size_t end) {
+
+            const std::string& s = decoder.out;
+            size_t size = end - begin;
+            position(end);
+
+            if (size >= 7 && s.compare(begin, 4, "<!--") == 0 && s.compare(end - 3, 3, "-->") == 0) {
+
+                if (ctxt->sax->comment && !ctxt->disableSAX) {
+                    text.assign(s, begin + 4, size - 7);
+                    ctxt->sax->comment(ctxt->userData, BAD_CAST text.c_str());
+                }
+
+            } else if (size >= 12 && s.compare(begin, 9, "<![CDATA[") == 0 && s.compare(end - 3, 3, "]]>") == 0) {
+
+                if (elements.empty())
+                    return error("CDATA outside of the root element in binary srcML\n");
+
+                if (ctxt->sax->cdataBlock && !ctxt->disableSAX)
+                    ctxt->sax->cdataBlock(ctxt->userData, BAD_CAST srcml() + begin + 9, (int) (size - 12));
+
+            } else if (size >= 4 && s.compare(begin, 2, "<?") == 0 && s.compare(end - 2, 2, "?>") == 0) {
+
+                if (ctxt->sax->processingInstruction && !ctxt->disableSAX) {
+
+                    size_t target_end = begin + 2;
+                    while (target_end < end - 2 && !isspace(s[target_end]))
+                        ++target_end;
+                    size_t data_begin = target_end;
+                    while (data_begin < end - 2 && isspace(s[data_begin]))
+                        ++data_begin;
+
+                    std::string target(s, begin + 2, target_end - begin - 2);
+                    text.assign(s, data_begin, end - 2 - data_begin);
+                    ctxt->sax->processingInstruction(ctxt->userData, BAD_CAST target.c_str(), data_begin < end - 2 ? BAD_CAST text.c_str() : nullptr);
+                }
+
+            } else if (size >= 2 && s.compare(begin, 2, "<!") == 0 && elements.empty()) {
+
+                // document type declaration
+
+            } else if (size >= 4 && !is_name_end(s[begin + 1])) {
+
+                qname tagname;
+                bool empty = false;
+                if (!parse_tag(begin, end - 1, tagname, empty) || !empty)
+                    return error("Tag not valid in binary srcML\n");
+
+                return start_element(tagname, end - 1, true);
+
+            } else {
+
+                return error("Markup not valid in binary srcML\n");
+            }
+
+            return !stopped();
+        }
+
+        // events of the last operation decoded
+        bool dispatch() {
+
+            size_t begin = decoder.last_begin;
+            size_t end = decoder.out.size();
+
+            if (!started) {
+
+                if (decoder.last_op == OP_RAW && is_declaration(begin, end))
+                    return declaration(begin, end);
+
+                if (!start_document(begin))
+                    return false;
+            }
+
+            if (decoder.last_op == OP_TEXT) {
+                if (!pending_text) {
+                    pending_text = true;
+                    text_begin = begin;
+                }
+                return true;
+            }
+
+            if (pending_text) {
+                pending_text = false;
+                if (!characters(text_begin, begin))
+                    return false;
+            }
+
+            switch (decoder.last_op) {
+
+            case OP_START:
+            case OP_EMPTY:
+                attributes.clear();
+                for (const auto& attribute : decoder.last_attributes)
+                    attributes.push_back({ name(attribute.name), attribute.begin, attribute.end });
+
+                return start_element(name(decoder.last_name), end - 1, decoder.last_op == OP_EMPTY);
+
+            case OP_RAW_START: {
+
+                qname tagname;
+                bool empty = false;
+                if (!parse_tag(begin, end - 1, tagname, empty) || empty)
+                    return error("Tag not valid in binary srcML\n");
+
+                return start_element(tagname, end - 1, false);
+            }
+
+            case OP_END:
+                return end_element(end);
+
+            case OP_RAW_END: {
+
+                if (elements.empty())
+                    return error("Extra end tag in binary srcML\n");
+
+                // the end tag must be of the innermost element
+                const auto& tagname = elements.back().name;
+                size_t pos = begin + 2;
+                if (tagname.prefix) {
+                    size_t size = strlen((const char*) tagname.prefix);
+                    if (decoder.out.compare(pos, size, (const char*) tagname.prefix) != 0 || srcml()[pos + size] != ':')
+                        return error("Opening and ending tag mismatch in binary srcML\n");
+                    pos += size + 1;
+                }
+                size_t size = strlen((const char*) tagname.localname);
+                if (decoder.out.compare(pos, size, (const char*) tagname.localname) != 0 || !is_name_end(srcml()[pos + size]))
+                    return error("Opening and ending tag mismatch in binary srcML\n");
+
+                return end_element(end);
+            }
+
+            case OP_RAW:
+                return raw(begin, end);
+            };
+
+            return error("Binary srcML is not valid\n");
+        }
+
+        // discard the decoded srcML that is before both the parser position and the srcSAX handler
+        void shrink() {
+
+            auto input = ctxt->input;
+            size_t keep = input->cur - input->base;
+
+            auto state = (sax2_srcsax_handler*) ctxt->_private;
+            if (state && state->base && state->prevbase) {
+
+                auto offset = (state->base - state->prevbase) - (long) (input->consumed - state->prevconsumed);
+                if (offset >= 0 && (size_t) offset < keep)
+                    keep = (size_t) offset;
+            }
+
+            if (keep < KEEP_SIZE)
+                return;
+
+            decoder.out.erase(0, keep);
+            input->consumed += keep;
+            if (pending_text)
+                text_begin -= keep;
+            position(input->cur - input->base - keep);
+        }
+
+        int parse(xmlParserInputBuffer* input) {
+
+            xmlBufShrink(input->buffer, sizeof(SIGNATURE));
+
+            size_t consumed = 0;
+            while (true) {
+
+                const unsigned char* begin = xmlBufContent(input->buffer) + consumed;
+                const unsigned char* end = xmlBufContent(input->buffer) + xmlBufUse(input->buffer);
+
+                // decode only complete operations
+                size_t size = decoder.decode(begin, end, false);
+                if (size) {
+
+                    if (!decoder.decode(begin, end, true)) {
+                        error("Binary srcML is not valid\n");
+                        return status;
+                    }
+                    consumed += size;
+
+                    if (!dispatch())
+                        return status;
+
+                    shrink();
+                    continue;
+                }
+
+                if (decoder.error) {
+                    error("Binary srcML is not valid\n");
+                    return status;
+                }
+
+                xmlBufShrink(input->buffer, consumed);
+                consumed = 0;
+
+                int grow = xmlParserInputBufferGrow(input, 4096);
+                if (grow < 0) {
+                    error("Unable to read binary srcML\n");
+                    return status;
+                }
+
+                if (grow == 0) {
+
+                    if (xmlBufUse(input->buffer) != 0) {
+                        error("Binary srcML is incomplete\n");
+                        return status;
+                    }
+
+                    break;
+                }
+            }
+
+            if (!started && !start_document(0))
+                return status;
+
+            if (pending_text && !characters(text_begin, decoder.out.size()))
+                return status;
+
+            if (!root || !elements.empty()) {
+                error("Premature end of data in binary srcML\n");
+                return status;
+            }
+
+            position(decoder.out.size());
+            if (ctxt->sax->endDocument && !ctxt->disableSAX)
+                ctxt->sax->endDocument(ctxt->userData);
+
+            return status;
+        }
+    };
+}
+
+/**
+ * srcml_binary_detect
+ * @param input a parser input buffer
+ *
+ * Check for the signature of binary srcML at the start of the input.
+ * Input that is converted from another encoding is not binary srcML.
+ *
+ * @returns true if the input is binary srcML
+ */
+bool srcml_binary_detect(xmlParserInputBuffer* input) {
+
+    if (input == nullptr || input->encoder)
+        return false;
+
+    while (xmlBufUse(input->buffer) < sizeof(SIGNATURE)) {
+        if (xmlParserInputBufferGrow(input, 4096) <= 0)
+            break;
+    }
+
+    return xmlBufUse(input->buffer) >= sizeof(SIGNATURE) && memcmp(xmlBufContent(input->buffer), SIGNATURE, sizeof(SIGNATURE)) == 0;
+}
+
+/**
+ * srcml_binary_input_create
+ * @param input a parser input buffer of binary srcML, after srcml_binary_detect()
+ *
+ * Create an input buffer that decodes the binary srcML as it is read, so that
+ * the srcML is parsed as if it was read directly.
+ *
+ * @returns the input buffer of srcML, or 0 on error
+ */
+xmlParserInputBuffer* srcml_binary_input_create(xmlParserInputBuffer* input) {
+
+    if (input == nullptr)
+        return nullptr;
+
+    xmlBufShrink(input->buffer, sizeof(SIGNATURE));
+
+    auto decoder = new binary_decoder;
+    decoder->input = input;
+
+    xmlParserInputBuffer* binary = xmlParserInputBufferCreateIO(binary_read, binary_read_close, decoder, XML_CHAR_ENCODING_NONE);
+    if (binary == nullptr)
+        binary_read_close(decoder);
+
+    return binary;
+}
+
+/**
+ * srcml_binary_output_create
+ * @param output an output buffer
+ *
+ * Create an output buffer that encodes srcML written to it as binary srcML
+ * on the output. Any character encoding of the output is performed before
+ * the binary encoding.
+ *
+ * @returns the output buffer for srcML, or 0 on error
+ */
+xmlOutputBuffer* srcml_binary_output_create(xmlOutputBuffer* output) {
+
+    if (output == nullptr)
+        return nullptr;
+
+    auto encoder = new binary_encoder;
+    encoder->output = output;
+    encoder->out.assign((const char*) SIGNATURE, sizeof(SIGNATURE));
+
+    xmlOutputBuffer* binary = xmlOutputBufferCreateIO(binary_write, binary_write_close, encoder, output->encoder);
+    if (binary == nullptr) {
+        binary_write_close(encoder);
+        return nullptr;
+    }
+    output->encoder = nullptr;
+
+    return binary;
+}
+
+/**
+ * srcml_binary_is_utf8
+ * @param input a parser input buffer of binary srcML, after srcml_binary_detect()
+ *
+ * Check the encoding in the XML declaration of the binary srcML, if any.
+ * Only UTF-8 srcML can be parsed directly with srcml_binary_parse().
+ *
+ * @returns true if the srcML is UTF-8
+ */
+bool srcml_binary_is_utf8(xmlParserInputBuffer* input) {
+
+    if (input == nullptr)
+        return false;
+
+    // decode the first operation, without committing anything to the input
+    binary_decoder decoder;
+    while (true) {
+
+        const unsigned char* begin = xmlBufContent(input->buffer) + sizeof(SIGNATURE);
+        const unsigned char* end = xmlBufContent(input->buffer) + xmlBufUse(input->buffer);
+        if (decoder.decode(begin, end, false))
+            break;
+
+        if (decoder.error || xmlParserInputBufferGrow(input, 4096) <= 0)
+            return true;
+    }
+
+    const unsigned char* begin = xmlBufContent(input->buffer) + sizeof(SIGNATURE);
+    decoder.decode(begin, xmlBufContent(input->buffer) + xmlBufUse(input->buffer), true);
+    if (decoder.last_op != OP_RAW || decoder.out.compare(0, 5, "<?xml") != 0)
+        return true;
+
+    std::string encoding = declared_encoding(decoder.out);
+    std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::toupper);
+
+    return encoding.empty() || encoding == "UTF-8" || encoding == "UTF8";
+}
+
+/**
+ * srcml_binary_parse
+ * @param ctxt a parser context with an input of UTF-8 binary srcML, after srcml_binary_detect()
+ *
+ * Parse the binary srcML with the SAX2 callbacks of the parser context, instead of
+ * xmlParseDocument() on the decoded srcML. The binary records are decoded and
+ * directly called back, with the parser input positioned in the decoded srcML
+ * as libxml2 does.
+ *
+ * @returns 0 on success, -1 on error
+ */
+int srcml_binary_parse(xmlParserCtxtPtr ctxt) {
+
+    if (ctxt == nullptr || ctxt->input == nullptr || ctxt->input->buf == nullptr || ctxt->sax == nullptr)
+        return -1;
+
+    // the input is only read by the parser, and not grown by the callbacks
+    auto input = ctxt->input;
+    xmlParserInputBuffer* buf = input->buf;
+    input->buf = nullptr;
+
+    int status = 0;
+    {
+        binary_parser parser(ctxt);
+        status = parser.parse(buf);
+    }
+
+    // the decoded srcML is freed with the parser
+    input->buf = buf;
+    input->base = input->cur = input->end = BAD_CAST "";
+    ctxt->nameNr = 0;
+
+    return status;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file srcml_binary.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef INCLUDED_SRCML_BINARY_HPP
+#define INCLUDED_SRCML_BINARY_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/parser.h>
+
+// Check for the binary srcML signature at the start of the input
+bool srcml_binary_detect(xmlParserInputBuffer* input);
+
+// Input buffer of the srcML decoded from the binary srcML input, which it takes ownership of
+xmlParserInputBuffer* srcml_binary_input_create(xmlParserInputBuffer* input);
+
+// Check that the srcML of the binary srcML input is UTF-8, so that it can be parsed directly
+bool srcml_binary_is_utf8(xmlParserInputBuffer* input);
+
+// Parse the binary srcML input of the parser context directly with its SAX2 callbacks
+int srcml_binary_parse(xmlParserCtxtPtr ctxt);
+
+// Output buffer that encodes srcML into binary srcML on the output, which it takes ownership of
+xmlOutputBuffer* srcml_binary_output_create(xmlOutputBuffer* output);
+
+#endif
@@ -0,0 +1,324 @@
+/**
+ * @file srcml_cache.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+  Cache entry file, named by the key:
+
+    srcML cache 1
+    encoding
+    loc content-size namespace-count
+    flags<TAB>uri<TAB>prefix       (one line for each namespace)
+    tail
+
+  The key is the SHA-1 of the source hash, srcML version, language, the options
+  that change the parse, tabstop, encodings, namespaces, and user macros.
+*/
+
+#include <srcml_cache.hpp>
+#include <srcml_types.hpp>
+#include <sha1utilities.hpp>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _MSC_BUILD
+#include <io.h>
+#include <process.h>
+#include <direct.h>
+#include <sys/utime.h>
+#define getpid _getpid
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace {
+
+    // signature at the start of an entry, followed by the version of the format
+    const char SIGNATURE[] = "srcML cache 1";
+
+    // options that only change the archive or the unit start tag, not the parse
+    const OPTION_TYPE OUTPUT_OPTIONS = SRCML_OPTION_ARCHIVE | SRCML_OPTION_HASH | SRCML_OPTION_NAME_FILTER | SRCML_OPTION_BINARY |
+                                      SRCML_OPTION_STORE_LOC | SRCML_OPTION_NO_XML_DECL | SRCML_OPTION_DEDUP;
+
+    // temporary files of a stopped process are removed after this many seconds
+    const time_t TEMPORARY_AGE = 60 * 60;
+
+    bool next_line(const std::string& data, size_t& pos, std::string& line) {
+
+        auto end = data.find('\n', pos);
+        if (end == std::string::npos)
+            return false;
+
+        line.assign(data, pos, end - pos);
+        pos = end + 1;
+
+        return true;
+    }
+
+    // entry files are named by the hex digits of a SHA-1
+    bool is_entry_name(const std::string& name) {
+
+        return name.size() == 40 && name.find_first_not_of("0123456789abcdef") == std::string::npos;
+    }
+
+    // names of the files in the directory
+    std::vector<std::string> directory_files(const std::string& directory) {
+
+        std::vector<std::string> files;
+#ifdef _MSC_BUILD
+        _finddata_t data;
+        intptr_t handle = _findfirst((directory + "/*").c_str(), &data);
+        if (handle == -1)
+            return files;
+        do {
+            if (!(data.attrib & _A_SUBDIR))
+                files.push_back(data.name);
+        } while (_findnext(handle, &data) == 0);
+        _findclose(handle);
+#else
+        DIR* dir = opendir(directory.c_str());
+        if (!dir)
+            return files;
+        while (struct dirent* entry = readdir(dir))
+            files.push_back(entry->d_name);
+        closedir(dir);
+#endif
+        return files;
+    }
+}
+
+/**
+ * srcml_cache_key
+ * @param unit the unit the source is parsed into, with its language decided
+ * @param src_encoding the encoding of the source, or NULL to detect it
+ * @param source_hash hash of the source
+ *
+ * @returns the key of the parse, in hex digits
+ */
+std::string srcml_cache_key(const srcml_unit* unit, const char* src_encoding, const std::string& source_hash) {
+
+    const srcml_archive* archive = unit->archive;
+
+    std::string key(SIGNATURE);
+    key += '\n';
+    key += source_hash;
+    key += '\n';
+    key += srcml_version_string();
+    key += '\n';
+    key += Language(unit->derived_language).getLanguageString();
+    key += '\n';
+    key += std::to_string(archive->options & ~OUTPUT_OPTIONS);
+    key += '\n';
+    key += std::to_string(archive->tabstop);
+    key += '\n';
+    key += src_encoding ? src_encoding : "";
+    key += '\n';
+    key += optional_to_c_str(archive->encoding, "UTF-8");
+    key += '\n';
+
+    // the namespaces the translator starts with
+    for (const auto& ns : unit->namespaces ? *unit->namespaces : archive->namespaces) {
+        key += std::to_string(ns.flags);
+        key += '\t';
+        key += ns.uri;
+        key += '\t';
+        key += ns.prefix;
+        key += '\n';
+    }
+    key += '\n';
+
+    for (const auto& macro : archive->user_macro_list) {
+        key += macro;
+        key += '\n';
+    }
+
+    return sha1_hex(key.c_str(), key.size());
+}
+
+/**
+ * srcml_cache_load
+ * @param cache a cache
+ * @param key the key of the entry
+ * @param entry location to load the entry to
+ *
+ * Load an entry, and record the use of the entry for eviction.
+ *
+ * @returns if the entry was found
+ */
+bool srcml_cache_load(srcml_cache* cache, const std::string& key, srcml_cache_entry& entry) {
+
+    std::string path = cache->directory + "/" + key;
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // an entry that is missing, or partially written by an older version, is a miss
+    size_t pos = 0;
+    std::string line;
+    if (!in || !next_line(data, pos, line) || line != SIGNATURE || !next_line(data, pos, entry.encoding) || !next_line(data, pos, line)) {
+        ++cache->misses;
+        return false;
+    }
+
+    size_t namespace_count = 0;
+    if (sscanf(line.c_str(), "%d %d %zu", &entry.loc, &entry.content_size, &namespace_count) != 3) {
+        ++cache->misses;
+        return false;
+    }
+
+    entry.namespaces.clear();
+    for (size_t i = 0; i < namespace_count; ++i) {
+
+        auto first = std::string::npos;
+        auto second = std::string::npos;
+        if (!next_line(data, pos, line) || (first = line.find('\t')) == std::string::npos
+            || (second = line.find('\t', first + 1)) == std::string::npos) {
+            ++cache->misses;
+            return false;
+        }
+
+        entry.namespaces.push_back({ line.substr(second + 1), line.substr(first + 1, second - first - 1), atoi(line.c_str()) });
+    }
+
+    entry.tail.assign(data, pos, std::string::npos);
+
+    // the modification time is the time of last use, since access times may not be recorded
+    utime(path.c_str(), nullptr);
+
+    ++cache->hits;
+
+    return true;
+}
+
+/**
+ * srcml_cache_store
+ * @param cache a cache
+ * @param key the key of the entry
+ * @param entry the entry
+ *
+ * Store an entry. The entry is written to a temporary file that is renamed to the
+ * entry file, so that other threads and processes never read a partial entry.
+ */
+void srcml_cache_store(srcml_cache* cache, const std::string& key, const srcml_cache_entry& entry) {
+
+    std::string data(SIGNATURE);
+    data += '\n';
+    data += entry.encoding;
+    data += '\n';
+    data += std::to_string(entry.loc) + " " + std::to_string(entry.content_size) + " " + std::to_string(entry.namespaces.size());
+    data += '\n';
+    for (const auto& ns : entry.namespaces) {
+
+        // namespaces that cannot be on a line are not stored
+        if (ns.uri.find_first_of("\t\n") != std::string::npos || ns.prefix.find_first_of("\t\n") != std::string::npos)
+            return;
+
+        data += std::to_string(ns.flags) + "\t" + ns.uri + "\t" + ns.prefix;
+        data += '\n';
+    }
+    data += entry.tail;
+
+    std::string path = cache->directory + "/" + key;
+    std::string temporary = path + "." + std::to_string(getpid()) + "-" + std::to_string(cache->temporaries++) + ".tmp";
+
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (!out)
+        return;
+
+    bool written = fwrite(data.c_str(), 1, data.size(), out) == data.size();
+    written = fclose(out) == 0 && written;
+
+    // another process may have stored the same entry, which has the same contents
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return;
+    }
+
+    ++cache->stored;
+}
+
+/**
+ * srcml_cache_evict
+ * @param cache a cache
+ *
+ * Remove the least recently used entries until the total size of the entries is
+ * within the maximum size of the cache. Temporary files left by a stopped process
+ * are also removed.
+ */
+void srcml_cache_evict(srcml_cache* cache) {
+
+    cache->stored = 0;
+
+    if (cache->max_size == 0)
+        return;
+
+    struct file_info {
+        std::string path;
+        time_t mtime;
+        size_t size;
+    };
+    std::vector<file_info> entries;
+    size_t total = 0;
+
+    time_t now = time(nullptr);
+    for (const auto& name : directory_files(cache->directory)) {
+
+        std::string path = cache->directory + "/" + name;
+
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+            continue;
+
+        if (is_entry_name(name)) {
+            entries.push_back({ path, info.st_mtime, (size_t) info.st_size });
+            total += (size_t) info.st_size;
+
+        } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0 && is_entry_name(name.substr(0, 40))
+                   && now - info.st_mtime > TEMPORARY_AGE) {
+            remove(path.c_str());
+        }
+    }
+
+    if (total <= cache->max_size)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const file_info& a, const file_info& b) { return a.mtime < b.mtime; });
+
+    // another process may remove the same entry
+    for (const auto& entry : entries) {
+
+        if (total <= cache->max_size)
+            break;
+
+        remove(entry.path.c_str());
+        total -= entry.size;
+    }
+}
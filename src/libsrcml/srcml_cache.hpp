@@ -0,0 +1,96 @@
+/**
+ * @file srcml_cache.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef INCLUDED_SRCML_CACHE_HPP
+#define INCLUDED_SRCML_CACHE_HPP
+
+#include <srcmlns.hpp>
+#include <string>
+#include <atomic>
+#include <cstddef>
+
+struct srcml_unit;
+
+/**
+ * srcml_cache
+ *
+ * Directory of parsed units, shared by archives cloned from each other and by
+ * concurrent processes. Each file is the srcML of a unit parsed from a source,
+ * keyed by the hash of the source and everything else the parse depends on.
+ */
+struct srcml_cache {
+
+    srcml_cache(const std::string& directory, size_t max_size)
+        : directory(directory), max_size(max_size) {}
+
+    std::string directory;
+
+    /** maximum total size of the files in the directory, or 0 for no maximum */
+    size_t max_size;
+
+    /** statistics of lookups */
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+
+    /** number of entries stored since the last eviction */
+    std::atomic<size_t> stored{0};
+
+    /** for unique names of the temporary files of entries being stored */
+    std::atomic<size_t> temporaries{0};
+};
+
+/**
+ * srcml_cache_entry
+ *
+ * The parse of a unit, without the unit start tag, which is recreated from
+ * the attributes of the unit.
+ */
+struct srcml_cache_entry {
+
+    /** source encoding of the unit */
+    std::string encoding;
+
+    /** namespaces of the unit, with the namespaces used in the parse */
+    Namespaces namespaces;
+
+    /** the srcML after the start tag name and attributes, i.e., "/>" or ">" content end tag */
+    std::string tail;
+
+    /** size of the content, as content_end - content_begin of the unit */
+    int content_size = 0;
+
+    int loc = 0;
+};
+
+// key of the parse of the source into the unit, from the hash of the source and the options of the parse
+std::string srcml_cache_key(const srcml_unit* unit, const char* src_encoding, const std::string& source_hash);
+
+// load the entry with the key, recording a hit or miss
+bool srcml_cache_load(srcml_cache* cache, const std::string& key, srcml_cache_entry& entry);
+
+// store the entry with the key, replacing any existing entry atomically
+void srcml_cache_store(srcml_cache* cache, const std::string& key, const srcml_cache_entry& entry);
+
+// remove the least recently used entries until the cache is within its maximum size
+void srcml_cache_evict(srcml_cache* cache);
+
+#endif
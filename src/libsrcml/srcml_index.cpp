@@ -0,0 +1,646 @@
+/**
+ * @file srcml_index.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+  Index file:
+
+    signature
+    srcML file:  size and modification time, in nanoseconds, of the srcML file indexed
+    namespaces:  count, then for each the prefix and URI
+    units:       count, then for each the filename, language, and version
+    elements:    count, then for each the URI, name, number of units, total count,
+                 and the posting lists
+
+  A posting list has, for each unit with the element, the unit position as a delta
+  from the previous unit, the count, and the start-tag positions as deltas from the
+  previous position. Strings are a length and the characters, and all numbers are
+  unsigned LEB128.
+*/
+
+#include <srcml_index.hpp>
+#include <srcml_types.hpp>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <tuple>
+#include <sys/stat.h>
+
+namespace {
+
+    // signature at the start of an index, followed by the version of the format
+    const char SIGNATURE[] = { '\x89', 's', 'r', 'c', 'I', 'D', 'X', '\x02' };
+
+    // size and modification time of a file, in nanoseconds, or false if it does not exist
+    bool file_stamp(const char* filename, size_t& size, size_t& mtime) {
+
+        struct stat s;
+        if (stat(filename, &s) != 0)
+            return false;
+
+        size = (size_t) s.st_size;
+#if defined(__APPLE__)
+        mtime = (size_t) s.st_mtimespec.tv_sec * 1000000000 + (size_t) s.st_mtimespec.tv_nsec;
+#elif defined(WIN32) || defined(WIN64)
+        mtime = (size_t) s.st_mtime * 1000000000;
+#else
+        mtime = (size_t) s.st_mtim.tv_sec * 1000000000 + (size_t) s.st_mtim.tv_nsec;
+#endif
+
+        return true;
+    }
+
+    void append_number(std::string& out, size_t value) {
+
+        while (value >= 0x80) {
+            out += (char) ((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += (char) value;
+    }
+
+    void append_string(std::string& out, const std::string& s) {
+
+        append_number(out, s.size());
+        out += s;
+    }
+
+    bool read_number(const char*& p, const char* end, size_t& value) {
+
+        value = 0;
+        for (int shift = 0; p < end && shift <= 56; shift += 7) {
+
+            unsigned char c = (unsigned char) *p++;
+            value |= (size_t) (c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    bool read_string(const char*& p, const char* end, std::string& s) {
+
+        size_t size = 0;
+        if (!read_number(p, end, size) || (size_t) (end - p) < size)
+            return false;
+
+        s.assign(p, size);
+        p += size;
+
+        return true;
+    }
+
+    // key of an element in the index
+    std::string element_key(const std::string& uri, const std::string& name) {
+
+        return uri + ' ' + name;
+    }
+
+    // URI of a prefix in the namespaces, or in the standard srcML namespaces
+    const std::string* prefix_uri(const Namespaces& namespaces, const std::string& prefix) {
+
+        auto&& view = namespaces.get<nstags::prefix>();
+        auto it = view.find(prefix);
+        if (it != view.end())
+            return &it->uri;
+
+        auto&& default_view = default_namespaces.get<nstags::prefix>();
+        auto default_it = default_view.find(prefix);
+        if (default_it != default_view.end())
+            return &default_it->uri;
+
+        return nullptr;
+    }
+
+    /*
+      Element of a qualified name in a query. As in XPath on srcML, the prefix src is
+      for the srcML namespace. A name without a prefix is also in the srcML namespace.
+    */
+    srcml_index::element_entry* find_element(const srcml_index* index, const char* element) {
+
+        if (index == nullptr || element == nullptr)
+            return nullptr;
+
+        const char* colon = strchr(element, ':');
+        std::string prefix = colon ? std::string(element, colon) : "";
+        std::string name = colon ? colon + 1 : element;
+
+        std::string uri;
+        if (prefix == "src") {
+            uri = SRCML_SRC_NS_URI;
+        } else {
+            auto it = std::find_if(index->namespaces.begin(), index->namespaces.end(),
+                [&prefix](const std::pair<std::string, std::string>& ns) { return ns.first == prefix; });
+            if (it != index->namespaces.end()) {
+                uri = it->second;
+            } else {
+                const std::string* default_uri = prefix_uri(Namespaces(), prefix);
+                if (!default_uri)
+                    return nullptr;
+                uri = *default_uri;
+            }
+        }
+
+        auto it = index->elements.find(element_key(uri, name));
+        if (it == index->elements.end())
+            return nullptr;
+
+        // queries on the index do not change it, except for decoding the posting lists
+        auto& entry = const_cast<srcml_index::element_entry&>(it->second);
+        if (entry.decoded)
+            return &entry;
+
+        const char* p = entry.data.c_str();
+        const char* end = p + entry.data.size();
+        size_t unit = 0;
+        for (size_t i = 0; i < entry.units; ++i) {
+
+            size_t delta = 0;
+            size_t count = 0;
+            if (!read_number(p, end, delta) || !read_number(p, end, count))
+                break;
+            unit += delta;
+
+            // a truncated posting list only has its complete postings
+            std::vector<int> positions;
+            size_t position = 0;
+            for (size_t j = 0; j < count; ++j) {
+                size_t position_delta = 0;
+                if (!read_number(p, end, position_delta))
+                    break;
+                position += position_delta;
+                positions.push_back((int) position);
+            }
+            if (positions.size() != count)
+                break;
+
+            entry.postings.push_back({ unit, count, entry.positions.size() });
+            entry.positions.insert(entry.positions.end(), positions.begin(), positions.end());
+        }
+
+        entry.decoded = true;
+
+        return &entry;
+    }
+
+    // posting of the element for the unit
+    const srcml_index::posting* find_posting(const srcml_index::element_entry* entry, size_t pos) {
+
+        if (entry == nullptr)
+            return nullptr;
+
+        auto it = std::lower_bound(entry->postings.begin(), entry->postings.end(), pos,
+            [](const srcml_index::posting& posting, size_t unit) { return posting.unit < unit; });
+        if (it == entry->postings.end() || it->unit != pos)
+            return nullptr;
+
+        return &*it;
+    }
+}
+
+/**
+ * srcml_index_add_unit
+ * @param index an index
+ * @param unit a unit with srcML
+ *
+ * Add the elements of the unit to the index. The unit is the next unit of the archive.
+ * The position of an element is the offset of its start tag in the contents of the unit,
+ * i.e., in the srcML from srcml_unit_get_srcml_inner().
+ */
+void srcml_index_add_unit(srcml_index* index, const srcml_unit* unit) {
+
+    size_t unit_position = index->units.size();
+    index->units.push_back({ unit->filename ? *unit->filename : "",
+                             unit->language ? *unit->language : "",
+                             unit->version ? *unit->version : "" });
+
+    // positions of the start tags of each qualified name
+    std::unordered_map<std::string, std::vector<int>> tags;
+    const char* begin = unit->srcml.c_str() + unit->content_begin;
+    const char* end = begin + std::max(unit->content_end - unit->content_begin - 1, 0);
+    for (const char* p = begin; p < end;) {
+
+        p = (const char*) memchr(p, '<', end - p);
+        if (!p)
+            break;
+
+        // comments and processing instructions are not elements
+        if (p + 1 < end && (p[1] == '!' || p[1] == '?')) {
+            const char* close = p[1] == '!' && end - p > 3 && strncmp(p, "<!--", 4) == 0 ? strstr(p, "-->") : (const char*) memchr(p, '>', end - p);
+            p = close && close < end ? close + 1 : end;
+            continue;
+        }
+
+        const char* qname = p + 1;
+        const char* qnameend = qname;
+        while (qnameend < end && *qnameend != '>' && *qnameend != '/' && !isspace(*qnameend))
+            ++qnameend;
+
+        if (*qname != '/')
+            tags[std::string(qname, qnameend)].push_back((int) (p - begin));
+
+        p = qnameend;
+    }
+
+    const Namespaces& namespaces = unit->namespaces ? *unit->namespaces : unit->archive ? unit->archive->namespaces : default_namespaces;
+    for (const auto& tag : tags) {
+
+        size_t colon = tag.first.find(':');
+        std::string prefix = colon != std::string::npos ? tag.first.substr(0, colon) : "";
+        std::string name = colon != std::string::npos ? tag.first.substr(colon + 1) : tag.first;
+        const std::string* uri = prefix_uri(namespaces, prefix);
+
+        auto& entry = index->elements[element_key(uri ? *uri : "", name)];
+        if (entry.units == 0) {
+            entry.uri = uri ? *uri : "";
+            entry.name = name;
+        }
+
+        append_number(entry.data, unit_position - entry.last_unit);
+        append_number(entry.data, tag.second.size());
+        int last = 0;
+        for (int position : tag.second) {
+            append_number(entry.data, position - last);
+            last = position;
+        }
+
+        entry.last_unit = unit_position;
+        ++entry.units;
+        entry.total += tag.second.size();
+    }
+}
+
+/**
+ * srcml_index_set_namespaces
+ * @param index an index
+ * @param namespaces the namespaces of the archive
+ *
+ * Set the namespaces of the archive, so that the prefixes of the archive
+ * can be used in queries.
+ */
+void srcml_index_set_namespaces(srcml_index* index, const Namespaces& namespaces) {
+
+    index->namespaces.clear();
+    for (const auto& ns : namespaces)
+        index->namespaces.emplace_back(ns.prefix, ns.uri);
+}
+
+/**
+ * srcml_index_set_srcml_filename
+ * @param index an index
+ * @param srcml_filename name of the srcML file indexed
+ *
+ * Record the size and modification time of the srcML file, once it is completely written.
+ */
+void srcml_index_set_srcml_filename(srcml_index* index, const char* srcml_filename) {
+
+    if (!file_stamp(srcml_filename, index->srcml_size, index->srcml_mtime)) {
+        index->srcml_size = 0;
+        index->srcml_mtime = 0;
+    }
+}
+
+/**
+ * srcml_index_write_filename
+ * @param index an index
+ * @param index_filename name of the index file
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
+ */
+int srcml_index_write_filename(const srcml_index* index, const char* index_filename) {
+
+    std::string out(SIGNATURE, sizeof(SIGNATURE));
+
+    append_number(out, index->srcml_size);
+    append_number(out, index->srcml_mtime);
+
+    append_number(out, index->namespaces.size());
+    for (const auto& ns : index->namespaces) {
+        append_string(out, ns.first);
+        append_string(out, ns.second);
+    }
+
+    append_number(out, index->units.size());
+    for (const auto& unit : index->units) {
+        append_string(out, unit.filename);
+        append_string(out, unit.language);
+        append_string(out, unit.version);
+    }
+
+    // elements in a stable order, so that the same archive has the same index
+    std::vector<const srcml_index::element_entry*> elements;
+    for (const auto& element : index->elements)
+        elements.push_back(&element.second);
+    std::sort(elements.begin(), elements.end(), [](const srcml_index::element_entry* a, const srcml_index::element_entry* b) {
+        return std::tie(a->uri, a->name) < std::tie(b->uri, b->name);
+    });
+
+    append_number(out, elements.size());
+    for (const auto element : elements) {
+        append_string(out, element->uri);
+        append_string(out, element->name);
+        append_number(out, element->units);
+        append_number(out, element->total);
+        append_string(out, element->data);
+    }
+
+    std::ofstream index_file(index_filename, std::ios::binary);
+    index_file.write(out.c_str(), out.size());
+    index_file.close();
+
+    return index_file ? SRCML_STATUS_OK : SRCML_STATUS_IO_ERROR;
+}
+
+/******************************************************************************
+ *                                                                            *
+ *                           Index functions                                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/**
+ * srcml_index_build
+ * @param srcml_filename name of a srcML file
+ * @param index_filename name of the index file
+ *
+ * Build the index of an existing srcML archive.
+ *
+ * @returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_index_build(const char* srcml_filename, const char* index_filename) {
+
+    if (srcml_filename == nullptr || index_filename == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::unique_ptr<srcml_archive> archive(srcml_archive_create());
+    if (!archive)
+        return SRCML_STATUS_ERROR;
+
+    // the srcML is stamped before it is read, so that a change while reading makes the index stale
+    srcml_index index;
+    srcml_index_set_srcml_filename(&index, srcml_filename);
+
+    int status = srcml_archive_read_open_filename(archive.get(), srcml_filename);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    while (std::unique_ptr<srcml_unit> unit{ srcml_archive_read_unit(archive.get()) })
+        srcml_index_add_unit(&index, unit.get());
+
+    srcml_index_set_namespaces(&index, archive->namespaces);
+
+    return srcml_index_write_filename(&index, index_filename);
+}
+
+/**
+ * srcml_index_read_filename
+ * @param index_filename name of an index file
+ *
+ * Read an index. Must be freed with srcml_index_free().
+ *
+ * @returns the index, or 0 if the file is not a valid index
+ */
+struct srcml_index* srcml_index_read_filename(const char* index_filename) {
+
+    if (index_filename == nullptr)
+        return nullptr;
+
+    std::ifstream index_file(index_filename, std::ios::binary);
+    std::string in((std::istreambuf_iterator<char>(index_file)), std::istreambuf_iterator<char>());
+    if (in.size() < sizeof(SIGNATURE) || in.compare(0, sizeof(SIGNATURE), SIGNATURE, sizeof(SIGNATURE)) != 0)
+        return nullptr;
+
+    const char* p = in.c_str() + sizeof(SIGNATURE);
+    const char* end = in.c_str() + in.size();
+
+    std::unique_ptr<srcml_index> index(new srcml_index);
+
+    if (!read_number(p, end, index->srcml_size) || !read_number(p, end, index->srcml_mtime))
+        return nullptr;
+
+    size_t count = 0;
+    if (!read_number(p, end, count))
+        return nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        std::string prefix;
+        std::string uri;
+        if (!read_string(p, end, prefix) || !read_string(p, end, uri))
+            return nullptr;
+        index->namespaces.emplace_back(prefix, uri);
+    }
+
+    if (!read_number(p, end, count))
+        return nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        srcml_index::unit_entry unit;
+        if (!read_string(p, end, unit.filename) || !read_string(p, end, unit.language) || !read_string(p, end, unit.version))
+            return nullptr;
+        index->units.push_back(unit);
+    }
+
+    if (!read_number(p, end, count))
+        return nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        srcml_index::element_entry element;
+        if (!read_string(p, end, element.uri) || !read_string(p, end, element.name)
+            || !read_number(p, end, element.units) || !read_number(p, end, element.total) || !read_string(p, end, element.data))
+            return nullptr;
+        index->elements[element_key(element.uri, element.name)] = element;
+    }
+
+    return index.release();
+}
+
+/**
+ * srcml_index_free
+ * @param index an index
+ *
+ * Free an index read with srcml_index_read_filename().
+ */
+void srcml_index_free(struct srcml_index* index) {
+
+    delete index;
+}
+
+/**
+ * srcml_index_is_current
+ * @param index an index
+ * @param srcml_filename name of the srcML file of the index
+ *
+ * The index is of the current srcML file when the file has the same size and
+ * modification time as when it was indexed. Unlike comparing the modification
+ * time of the index, this detects a change made in the same second.
+ *
+ * @returns 1 if the index is of the current srcML file, 0 if not
+ */
+int srcml_index_is_current(const struct srcml_index* index, const char* srcml_filename) {
+
+    if (index == nullptr || srcml_filename == nullptr || index->srcml_mtime == 0)
+        return 0;
+
+    size_t size = 0;
+    size_t mtime = 0;
+    if (!file_stamp(srcml_filename, size, mtime))
+        return 0;
+
+    return size == index->srcml_size && mtime == index->srcml_mtime;
+}
+
+/**
+ * srcml_index_get_unit_size
+ * @param index an index
+ *
+ * @returns the number of units in the indexed archive
+ */
+size_t srcml_index_get_unit_size(const struct srcml_index* index) {
+
+    if (index == nullptr)
+        return 0;
+
+    return index->units.size();
+}
+
+/**
+ * srcml_index_get_unit_filename
+ * @param index an index
+ * @param pos position of the unit in the archive
+ *
+ * @returns the filename attribute of the unit, or 0 if none
+ */
+const char* srcml_index_get_unit_filename(const struct srcml_index* index, size_t pos) {
+
+    if (index == nullptr || pos >= index->units.size() || index->units[pos].filename.empty())
+        return 0;
+
+    return index->units[pos].filename.c_str();
+}
+
+/**
+ * srcml_index_get_unit_language
+ * @param index an index
+ * @param pos position of the unit in the archive
+ *
+ * @returns the language attribute of the unit, or 0 if none
+ */
+const char* srcml_index_get_unit_language(const struct srcml_index* index, size_t pos) {
+
+    if (index == nullptr || pos >= index->units.size() || index->units[pos].language.empty())
+        return 0;
+
+    return index->units[pos].language.c_str();
+}
+
+/**
+ * srcml_index_get_unit_version
+ * @param index an index
+ * @param pos position of the unit in the archive
+ *
+ * @returns the version attribute of the unit, or 0 if none
+ */
+const char* srcml_index_get_unit_version(const struct srcml_index* index, size_t pos) {
+
+    if (index == nullptr || pos >= index->units.size() || index->units[pos].version.empty())
+        return 0;
+
+    return index->units[pos].version.c_str();
+}
+
+/**
+ * srcml_index_get_element_total
+ * @param index an index
+ * @param element qualified name of an element, e.g., src:lambda or cpp:if
+ *
+ * @returns the number of occurrences of the element in all units
+ */
+size_t srcml_index_get_element_total(const struct srcml_index* index, const char* element) {
+
+    auto entry = find_element(index, element);
+
+    return entry ? entry->total : 0;
+}
+
+/**
+ * srcml_index_get_element_unit_size
+ * @param index an index
+ * @param element qualified name of an element
+ *
+ * @returns the number of units that contain the element
+ */
+size_t srcml_index_get_element_unit_size(const struct srcml_index* index, const char* element) {
+
+    auto entry = find_element(index, element);
+
+    return entry ? entry->postings.size() : 0;
+}
+
+/**
+ * srcml_index_get_element_unit
+ * @param index an index
+ * @param element qualified name of an element
+ * @param pos position in the units that contain the element
+ *
+ * @returns the position in the archive of the unit, or -1 if none
+ */
+int srcml_index_get_element_unit(const struct srcml_index* index, const char* element, size_t pos) {
+
+    auto entry = find_element(index, element);
+    if (entry == nullptr || pos >= entry->postings.size())
+        return -1;
+
+    return (int) entry->postings[pos].unit;
+}
+
+/**
+ * srcml_index_get_element_count
+ * @param index an index
+ * @param pos position of the unit in the archive
+ * @param element qualified name of an element
+ *
+ * @returns the number of occurrences of the element in the unit
+ */
+size_t srcml_index_get_element_count(const struct srcml_index* index, size_t pos, const char* element) {
+
+    auto posting = find_posting(find_element(index, element), pos);
+
+    return posting ? posting->count : 0;
+}
+
+/**
+ * srcml_index_get_element_position
+ * @param index an index
+ * @param pos position of the unit in the archive
+ * @param element qualified name of an element
+ * @param n which occurrence of the element in the unit
+ *
+ * @returns the offset of the start tag of the occurrence in the contents of the unit,
+ * as from srcml_unit_get_srcml_inner(), or -1 if none
+ */
+int srcml_index_get_element_position(const struct srcml_index* index, size_t pos, const char* element, size_t n) {
+
+    auto entry = find_element(index, element);
+    auto posting = find_posting(entry, pos);
+    if (posting == nullptr || n >= posting->count)
+        return -1;
+
+    return entry->positions[posting->positions + n];
+}
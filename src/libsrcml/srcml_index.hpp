@@ -0,0 +1,99 @@
+/**
+ * @file srcml_index.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcML Toolkit.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef INCLUDED_SRCML_INDEX_HPP
+#define INCLUDED_SRCML_INDEX_HPP
+
+#include <srcml.h>
+#include <srcmlns.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * srcml_index
+ *
+ * Posting lists of the elements in the units of a srcML archive: for each element,
+ * the units it occurs in, its count in each unit, and the position of each of its
+ * start tags in the contents of the unit.
+ */
+struct srcml_index {
+
+    /** unit attributes, with an empty string for none */
+    struct unit_entry {
+        std::string filename;
+        std::string language;
+        std::string version;
+    };
+
+    /** occurrences of an element in a unit, with the index of the first position */
+    struct posting {
+        size_t unit;
+        size_t count;
+        size_t positions;
+    };
+
+    struct element_entry {
+        std::string uri;
+        std::string name;
+
+        /** number of units with the element, and total count of the element */
+        size_t units = 0;
+        size_t total = 0;
+
+        /** posting lists, compressed as deltas in variable-length integers */
+        size_t last_unit = 0;
+        std::string data;
+
+        /** posting lists decoded when first queried */
+        bool decoded = false;
+        std::vector<posting> postings;
+        std::vector<int> positions;
+    };
+
+    /** size and modification time, in nanoseconds, of the srcML file indexed, or 0 if unknown */
+    size_t srcml_size = 0;
+    size_t srcml_mtime = 0;
+
+    /** prefix and URI of the namespaces of the archive */
+    std::vector<std::pair<std::string, std::string>> namespaces;
+
+    std::vector<unit_entry> units;
+
+    /** elements by URI and name, separated by a space */
+    std::unordered_map<std::string, element_entry> elements;
+};
+
+// add the elements of the unit to the index
+void srcml_index_add_unit(srcml_index* index, const srcml_unit* unit);
+
+// set the namespaces of the archive, for the prefixes used in queries
+void srcml_index_set_namespaces(srcml_index* index, const Namespaces& namespaces);
+
+// record the size and modification time of the srcML file indexed
+void srcml_index_set_srcml_filename(srcml_index* index, const char* srcml_filename);
+
+// write the index to a file
+int srcml_index_write_filename(const srcml_index* index, const char* index_filename);
+
+#endif
@@ -35,8 +35,10 @@
 #include <srcmlns.hpp>
 
 #include <string>
+#include <deque>
 #include <vector>
 #include <stack>
+#include <unordered_map>
 
 #include <cstring>
 
@@ -102,6 +104,10 @@ private :
     bool collect_unit_header = false;
     /** collect srcML as parse*/
     bool collect_unit_body = false;
+    /** collect the source of the unit body */
+    bool collect_src = true;
+    /** collect the srcML of the unit body */
+    bool collect_srcml = true;
 
     /** terminate */
     bool terminate = false;
@@ -112,6 +118,17 @@ private :
     /** skip internal unit elements */
     bool skip = false;
 
+    /** contents of the most recent units of a dedup archive by position, in the order read, and their total size,
+        for expanding references to them */
+    std::unordered_map<int, std::string> dedup_contents;
+    std::deque<int> dedup_order;
+    size_t dedup_size = 0;
+    /** collect the contents of the current unit for later references to it */
+    bool dedup_record = false;
+    /** position of the current unit, and the position of the unit it refers to */
+    int dedup_position = 0;
+    int dedup_ref = 0;
+
 public :
 
     /** Give access to members for srcml_sax2_reader class */
@@ -297,6 +314,8 @@ public :
                         archive->options |= SRCML_OPTION_CPP_MARKUP_IF0;
                     else if (option == "LINE")
                         archive->options |= SRCML_OPTION_LINE;
+                    else if (option == "DEDUP")
+                        archive->options |= SRCML_OPTION_DEDUP;
                 }
 
             } else if (attribute == "hash")
@@ -369,9 +388,23 @@ public :
         // collect attributes
         unit_update_attributes(unit, num_attributes, attributes);
 
+        // the name filter of a unit is not written to a clone of the archive, so it is only recorded as read
+        for (size_t i = 0; i + 1 < unit->attributes.size(); i += 2) {
+            if (unit->attributes[i] == UNIT_ATTRIBUTE_NAME_FILTER) {
+                archive->read_name_filter = true;
+                break;
+            }
+        }
+
         auto ctxt = (xmlParserCtxtPtr) get_controller().getContext()->libxml2_context;
         auto state = (sax2_srcsax_handler*) ctxt->_private;
 
+        // when references are expanded, a unit of a dedup archive with a hash may be referred to by a later unit,
+        // determined before the pause, since the unit may be replaced while paused
+        dedup_position = state->unit_count;
+        dedup_ref = unit->ref;
+        dedup_record = archive->dedup_expand > 0 && (archive->options & SRCML_OPTION_DEDUP) && unit->hash && !unit->ref;
+
         state->collect_unit_body = collect_unit_body;
 
         if (collect_unit_header) {
@@ -388,6 +421,20 @@ public :
         state->loc = 0;
 
         state->collect_unit_body = collect_unit_body;
+        state->collect_src = collect_src;
+        state->collect_srcml = collect_srcml;
+
+        // the srcml of a unit that may be referred to is collected, even when the unit is skipped
+        if (dedup_record) {
+            state->collect_src = collect_src && collect_unit_body;
+            state->collect_unit_body = true;
+            state->collect_srcml = true;
+        }
+
+        // filter the srcDiff revision as the unit is collected
+        state->revision = boost::none;
+        if (archive->revision_number && issrcdiff(archive->namespaces))
+            state->revision = (int) *archive->revision_number;
 
         if (terminate)
             stop_parser();
@@ -445,18 +492,90 @@ public :
         auto ctxt = (xmlParserCtxtPtr) get_controller().getContext()->libxml2_context;
         auto state = (sax2_srcsax_handler*) ctxt->_private;
 
-        if (collect_unit_body) {
+        // contents for the expansion of later references to this unit, removing the oldest beyond the maximum size
+        if (dedup_record) {
+
+            int size = state->content_end - state->content_begin - 1;
+            if (size < 0)
+                size = 0;
+
+            if ((size_t) size <= archive->dedup_expand) {
+
+                dedup_contents[dedup_position] = size > 0 ? state->unitsrcml.substr(state->content_begin, size) : std::string();
+                dedup_order.push_back(dedup_position);
+                dedup_size += size;
+
+                while (dedup_size > archive->dedup_expand) {
+                    auto oldest = dedup_contents.find(dedup_order.front());
+                    dedup_size -= oldest->second.size();
+                    dedup_contents.erase(oldest);
+                    dedup_order.pop_front();
+                }
+            }
+        }
+
+        // a reference is expanded to the start tag, without the ref attribute, and the contents of the unit it refers to
+        bool expanded = false;
+        if (collect_unit_body && dedup_ref > 0) {
 
-            if (!state->unitsrc.empty() && state->unitsrc.back() != '\n')
-                ++state->loc;
+            auto it = dedup_contents.find(dedup_ref);
+            if (it != dedup_contents.end()) {
+
+                std::string& s = state->unitsrcml;
+                s.resize(state->content_begin);
+
+                std::string refattr = std::string(" ") + UNIT_ATTRIBUTE_REF + "=\"" + std::to_string(dedup_ref) + "\"";
+                auto pos = s.find(refattr);
+                if (pos != std::string::npos)
+                    s.erase(pos, refattr.size());
+
+                if (s.size() >= 2 && s.compare(s.size() - 2, 2, "/>") == 0)
+                    s.replace(s.size() - 2, 2, ">");
+
+                state->content_begin = (int) s.size();
+                s += it->second;
+                state->content_end = (int) s.size() + 1;
+                s += "</";
+                if (prefix) {
+                    s += prefix;
+                    s += ':';
+                }
+                s += localname;
+                s += '>';
+
+                unit->ref = 0;
+                expanded = true;
+
+            } else if (archive->dedup_expand > 0) {
+
+                // the unit referred to was beyond the size of the expansion, or is not in the archive
+                unit->error_number = SRCML_STATUS_INVALID_INPUT;
+                unit->error_string = "Unable to expand the reference to unit " + std::to_string(dedup_ref);
+                archive->error_number = unit->error_number;
+                archive->error_string = unit->error_string;
+            }
+        }
+
+        if (collect_unit_body) {
 
             unit->content_begin = state->content_begin;
             unit->content_end = state->content_end;
             unit->insert_begin = state->insert_begin;
             unit->insert_end = state->insert_end;
             unit->srcml = std::move(state->unitsrcml);
-            unit->src = std::move(state->unitsrc);
-            unit->loc = state->loc;
+            unit->read_src_only = !collect_srcml && !expanded;
+            if (state->revision)
+                unit->currevision = *state->revision;
+
+            // without the source, it and the loc are extracted from the srcml on request
+            if (collect_src && !expanded) {
+
+                if (!state->unitsrc.empty() && state->unitsrc.back() != '\n')
+                    ++state->loc;
+
+                unit->src = std::move(state->unitsrc);
+                unit->loc = state->loc;
+            }
 
             // update provisional cpp prefix
             if (state->cpp_prefix) {
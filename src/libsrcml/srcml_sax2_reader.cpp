@@ -58,11 +58,12 @@ static void* start_routine(thread_args* args) {
 /**
  * srcml_sax2_reader
  * @param input parser input buffer
+ * @param binary the input is binary srcML to parse directly
  *
  * Construct a srcml_sax2_reader using a parser input buffer
  */
-srcml_sax2_reader::srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input)
-    : control(std::move(input)), handler() {
+srcml_sax2_reader::srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input, bool binary)
+    : control(std::move(input), binary), handler() {
 
     handler.archive = archive;
 
@@ -124,6 +125,8 @@ int srcml_sax2_reader::read_header(srcml_unit* unit) {
 
     unit->read_header = true;
 
+    header_unit = unit;
+
     return 1;
 }
 
@@ -148,6 +151,8 @@ int srcml_sax2_reader::read(srcml_unit* unit) {
     handler.skip = true;
     handler.collect_unit_header = true;
     handler.collect_unit_body = true;
+    handler.collect_src = unit->archive->read_content != SRCML_READ_CONTENT_SRCML;
+    handler.collect_srcml = unit->archive->read_content != SRCML_READ_CONTENT_SRC;
     handler.resume_and_wait();
     handler.collect_unit_body = false;
     handler.collect_unit_header = false;
@@ -161,6 +166,8 @@ int srcml_sax2_reader::read(srcml_unit* unit) {
     unit->read_header = true;
     unit->read_body = true;
 
+    header_unit = nullptr;
+
     return 1;
 }
 
@@ -168,8 +175,9 @@ int srcml_sax2_reader::read(srcml_unit* unit) {
  * read_body
  * @param output_buffer output buffer to write text
  *
- * Read the next unit from a srcML Archive
- * and return in the passed string parameter.
+ * Read the body of the unit whose header was just read.
+ * Once the header of another unit is read, the parser has
+ * moved past this body, and it can no longer be read.
  *
  * @returns 1 on success and 0 if done
  */
@@ -178,8 +186,13 @@ int srcml_sax2_reader::read_body(srcml_unit* unit) {
     if (handler.is_done)
         return 0;
 
+    if (unit != header_unit)
+        return 0;
+
     handler.unit = unit;
     handler.collect_unit_body = true;
+    handler.collect_src = unit->archive->read_content != SRCML_READ_CONTENT_SRCML;
+    handler.collect_srcml = unit->archive->read_content != SRCML_READ_CONTENT_SRC;
     handler.resume_and_wait();
     handler.collect_unit_body = false;
 
@@ -188,5 +201,7 @@ int srcml_sax2_reader::read_body(srcml_unit* unit) {
 
     unit->read_body = true;
 
+    header_unit = nullptr;
+
     return 1;
 }
@@ -75,10 +75,13 @@ private :
     std::thread thread;
     thread_args args = { &control, &handler };
 
+    /** unit whose header was last read, the only unit whose body can still be read */
+    srcml_unit* header_unit = nullptr;
+
 public :
 
     // constructors
-    srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input);
+    srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input, bool binary = false);
 
     // destructors
     ~srcml_sax2_reader();
@@ -467,30 +467,166 @@ int srcml_clear_transforms(srcml_archive* archive) {
     return SRCML_STATUS_OK;
 }
 
-static bool usesURI(xmlNode* cur_node, const std::string& URI);
-
-static bool usesURIChildren(xmlNode* a_node, const std::string& URI) {
+/**
+ * srcml_transform_prototype
+ * @param unit the unit the transformations are applied to
+ *
+ * Create the setup shared by all the result units of a unit, so that it
+ * is only cloned once for all results. The cpp and omp namespaces are marked
+ * unused until each result is examined, and the name filter of the unit is removed.
+ *
+ * @returns the prototype of the result units
+ */
+static srcml_unit* srcml_transform_prototype(const srcml_unit* unit) {
 
-    for (xmlNode* cur_node = a_node; cur_node; cur_node = cur_node->next) {
+    auto prototype = srcml_unit_clone(unit);
+    prototype->read_body = prototype->read_header = true;
 
-        if (cur_node->ns && cur_node->ns->prefix && URI == (const char*) cur_node->ns->href) {
-            return true;
+    // names of the results are not those of the unit
+    for (size_t i = 0; i + 1 < prototype->attributes.size(); i += 2) {
+        if (prototype->attributes[i] == UNIT_ATTRIBUTE_NAME_FILTER) {
+            prototype->attributes.erase(prototype->attributes.begin() + i, prototype->attributes.begin() + i + 2);
+            break;
         }
+    }
 
-        if (usesURIChildren(cur_node->children, URI))
-            return true;
+    // when no namespace, use the starting namespaces
+    if (!prototype->namespaces)
+        prototype->namespaces = starting_namespaces;
+
+    // mark unused cpp and omp until we examine the query result
+    auto& view = prototype->namespaces->get<nstags::uri>();
+    auto itcpp = view.find(SRCML_CPP_NS_URI);
+    if (itcpp != view.end()) {
+        view.modify(itcpp, [](Namespace& thisns){ thisns.flags &= ~NS_USED; });
+    }
+    auto itomp = view.find(SRCML_OPENMP_NS_URI);
+    if (itomp != view.end()) {
+        view.modify(itomp, [](Namespace& thisns){ thisns.flags &= ~NS_USED; });
     }
 
-    return false;
+    return prototype;
 }
 
-static bool usesURI(xmlNode* cur_node, const std::string& URI) {
+/**
+ * srcml_transform_create_unit
+ * @param prototype the setup shared by all result units
+ * @param position the position of the result
+ * @param unitWrapped whether the result is already a unit
+ *
+ * Create a unit to store a transformation result in.
+ *
+ * @returns the unit for the result
+ */
+static srcml_unit* srcml_transform_create_unit(const srcml_unit* prototype, int position, bool unitWrapped) {
 
-    if (cur_node->ns && cur_node->ns->prefix && URI == (const char*) cur_node->ns->href) {
-        return true;
+    auto nunit = new srcml_unit(*prototype);
+    if (!unitWrapped) {
+        nunit->attributes.push_back("item");
+        nunit->attributes.push_back(std::to_string(position + 1));
+        nunit->hash = boost::none;
     }
 
-    return usesURIChildren(cur_node->children, URI);
+    return nunit;
+}
+
+/**
+ * srcml_transform_use_namespace
+ * @param unit the unit of a transformation result
+ * @param uri the namespace uri
+ * @param prefix the default prefix of the namespace
+ *
+ * Mark the namespace as used in the result, adding it if not present.
+ */
+static void srcml_transform_use_namespace(srcml_unit* unit, const char* uri, const char* prefix) {
+
+    auto& view = unit->namespaces->get<nstags::uri>();
+    auto it = view.find(uri);
+    if (it != view.end()) {
+        view.modify(it, [](Namespace& thisns){ thisns.flags |= NS_USED; });
+    } else {
+        unit->namespaces->push_back({ prefix, uri, NS_USED | NS_STANDARD });
+    }
+}
+
+/**
+ * srcml_transform_update_namespaces
+ * @param unit the unit of a transformation result, with the serialized result
+ *
+ * Mark the cpp and openmp namespaces as used if any element of the serialized
+ * result uses them. Prefixed start tags are found directly in the srcML, instead
+ * of walking the result tree.
+ */
+static void srcml_transform_update_namespaces(srcml_unit* unit) {
+
+    auto& view = unit->namespaces->get<nstags::uri>();
+    for (const auto& ns : { std::make_pair(SRCML_CPP_NS_URI, SRCML_CPP_NS_DEFAULT_PREFIX),
+                            std::make_pair(SRCML_OPENMP_NS_URI, SRCML_OPENMP_NS_DEFAULT_PREFIX) }) {
+
+        auto it = view.find(ns.first);
+        std::string tag = "<";
+        tag += it != view.end() ? it->prefix : ns.second;
+        tag += ":";
+        if (unit->srcml.find(tag) != std::string::npos)
+            srcml_transform_use_namespace(unit, ns.first, ns.second);
+    }
+}
+
+/**
+ * srcml_transform_stream_results
+ * @param unit the unit the transformation is applied to
+ * @param matches the begin and end offsets of each result in the srcML of the unit
+ * @param result the transformation result to store the result units in
+ *
+ * Create the result units of a streaming transformation.
+ */
+static void srcml_transform_stream_results(srcml_unit* unit, const std::vector<std::pair<int, int>>& matches, srcml_transform_result* result) {
+
+    result->type = matches.empty() ? SRCML_RESULT_NONE : SRCML_RESULT_UNITS;
+    if (matches.empty())
+        return;
+
+    // setup shared by all result units
+    std::unique_ptr<srcml_unit> prototype(srcml_transform_prototype(unit));
+
+    for (int i = 0; i < (int) matches.size(); ++i) {
+
+        // create a new unit to store the results in
+        auto nunit = srcml_transform_create_unit(prototype.get(), i, false);
+        nunit->srcml.assign(unit->srcml, matches[i].first, matches[i].second - matches[i].first);
+
+        // update the cpp and openmp namespaces if any element of the result uses them
+        srcml_transform_update_namespaces(nunit);
+
+        // mark inside the units
+        nunit->content_begin = 0;
+        nunit->content_end = (int) nunit->srcml.size() + 1;
+        nunit->insert_begin = 0;
+        nunit->insert_end = 0;
+
+        // store in the returned results
+        result->units.push_back(nunit);
+    }
+}
+
+/**
+ * srcml_transform_filtered
+ * @param archive the archive with the transformations
+ * @param unit the unit the transformations are applied to
+ *
+ * Check the unit attributes against the unit predicates of the first transformation,
+ * so that a unit without results is found without a DOM or parse of the srcML.
+ *
+ * @returns true if the transformations have no results for the unit
+ */
+static bool srcml_transform_filtered(const srcml_archive* archive, const srcml_unit* unit) {
+
+    if (archive->transformations.empty())
+        return false;
+
+    auto filter = archive->transformations.front()->filter();
+
+    return filter && !unit_filter_match(unit, *filter);
 }
 
 /**
@@ -513,6 +649,10 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
     if (archive->transformations.empty())
         return SRCML_STATUS_OK;
 
+    // transformations need the srcml of the unit
+    if (unit->read_src_only)
+        return SRCML_STATUS_UNINITIALIZED_UNIT;
+
     srcml_transform_result* result = nullptr;
     if (presult) {
         *presult = new srcml_transform_result;
@@ -521,8 +661,49 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
         result->boolValue = false;
     }
 
-    // create a DOM of the unit
-    std::shared_ptr<xmlDoc> doc(xmlReadMemory(unit->srcml.c_str(), (int) unit->srcml.size(), 0, 0, 0), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+    // no results for a unit whose attributes fail the predicates of the first transformation
+    if (srcml_transform_filtered(archive, unit))
+        return SRCML_STATUS_OK;
+
+    // evaluate a streamable transformation directly on the srcML, without a DOM
+    if (!unit->doc && archive->transformations.size() == 1 && archive->transformations.front()->streamable()) {
+
+        std::vector<std::pair<int, int>> matches;
+        if (!archive->transformations.front()->apply_stream(unit->srcml, unit->namespaces ? *unit->namespaces : starting_namespaces, matches))
+            return SRCML_STATUS_ERROR;
+
+        if (result == nullptr)
+            return SRCML_STATUS_OK;
+
+        srcml_transform_stream_results(unit, matches, result);
+
+        return SRCML_STATUS_OK;
+    }
+
+    // use the DOM built directly by the parser, otherwise create a DOM of the unit
+    std::shared_ptr<xmlDoc> doc;
+    if (unit->doc) {
+
+        // when the DOM is changed, it is no longer that of the unit
+        if (archive->transformations.size() > 1 || archive->transformations.front()->modifies_document()) {
+
+            // DOM shared with the srcML of the unit is copied
+            if (!unit->srcml.empty()) {
+                doc.reset(xmlCopyDoc(unit->doc.get(), 1), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+            } else {
+                int status = srcml_unit_serialize_doc(unit);
+                if (status != SRCML_STATUS_OK)
+                    return status;
+
+                doc = std::move(unit->doc);
+            }
+        } else {
+            doc = unit->doc;
+        }
+
+    } else {
+        doc.reset(xmlReadMemory(unit->srcml.c_str(), (int) unit->srcml.size(), 0, 0, 0), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+    }
     if (doc == nullptr)
         return SRCML_STATUS_ERROR;
 
@@ -615,31 +796,23 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
     // create units out of the transformation results
     result->type = lastresult.nodeType;
 
-    for (int i = 0; i < fullresults->nodeNr; ++i) {
+    // setup shared by all result units
+    std::unique_ptr<srcml_unit> prototype(srcml_transform_prototype(unit));
 
-        // create a new unit to store the results in
-        auto nunit = srcml_unit_clone(unit);
-        nunit->read_body = nunit->read_header = true;
-        if (!lastresult.unitWrapped) {
-            nunit->attributes.push_back("item");
-            nunit->attributes.push_back(std::to_string(i + 1));
-            nunit->hash = boost::none;
-        }
+    // single output buffer for all results that writes to the srcml of the current result unit
+    std::string* output_srcml = nullptr;
+    xmlOutputBufferPtr output = xmlOutputBufferCreateIO([](void* context, const char* buffer, int len) {
 
-        // when no namespace, use the starting namespaces
-        if (!nunit->namespaces)
-            nunit->namespaces = starting_namespaces;
+        (*(std::string**) context)->append(buffer, len);
 
-        // mark unused cpp and omp until we examine the query result
-        auto& view = nunit->namespaces->get<nstags::uri>();
-        auto itcpp = view.find(SRCML_CPP_NS_URI);
-        if (itcpp != view.end()) {
-            view.modify(itcpp, [](Namespace& thisns){ thisns.flags &= ~NS_USED; });
-        }
-        auto itomp = view.find(SRCML_OPENMP_NS_URI);
-        if (itomp != view.end()) {
-            view.modify(itomp, [](Namespace& thisns){ thisns.flags &= ~NS_USED; });
-        }
+        return len;
+
+    }, 0, &output_srcml, 0);
+
+    for (int i = 0; i < fullresults->nodeNr; ++i) {
+
+        // create a new unit to store the results in
+        auto nunit = srcml_transform_create_unit(prototype.get(), i, lastresult.unitWrapped);
 
         // special cases where the nodes are not written to the tree
         switch (fullresults->nodeTab[i]->type) {
@@ -665,39 +838,15 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
 
         default:
 
-            // dump the result tree to the string using an output buffer that writes to a std::string
-            xmlOutputBufferPtr output = xmlOutputBufferCreateIO([](void* context, const char* buffer, int len) {
-
-                ((std::string*) context)->append(buffer, len);
-
-                return len;
-
-            }, 0, &(nunit->srcml), 0);
+            // dump the result tree to the string of the result unit
+            output_srcml = &(nunit->srcml);
             xmlNodeDumpOutput(output, curdoc.get(), fullresults->nodeTab[i], 0, 0, 0);
 
             // very important to flush to make sure the unit contents are all present
-            // also performs a free of resources
-            xmlOutputBufferClose(output);
-
-            // update the cpp namespace if actually used
-            if (usesURI(fullresults->nodeTab[i], SRCML_CPP_NS_URI)) {
-
-                if (itcpp != view.end()) {
-                    view.modify(itcpp, [](Namespace& thisns){ thisns.flags |= NS_USED; });
-                } else {
-                    nunit->namespaces->push_back({ SRCML_CPP_NS_DEFAULT_PREFIX, SRCML_CPP_NS_URI, NS_USED | NS_STANDARD });
-                }
-            }
-
-            // update the openmp namespace if actually used
-            if (usesURI(fullresults->nodeTab[i], SRCML_OPENMP_NS_URI)) {
+            xmlOutputBufferFlush(output);
 
-                if (itomp != view.end()) {
-                    view.modify(itomp, [](Namespace& thisns){ thisns.flags |= NS_USED; });
-                } else {
-                    nunit->namespaces->push_back({ SRCML_OPENMP_NS_DEFAULT_PREFIX, SRCML_OPENMP_NS_URI, NS_USED | NS_STANDARD });
-                }
-            }
+            // update the cpp and openmp namespaces if any element of the result uses them
+            srcml_transform_update_namespaces(nunit);
 
             break;
         }
@@ -708,52 +857,17 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
         nunit->insert_begin = 0;
         nunit->insert_end = 0;
 
-        // update the unit attributes with the transformed result based on the root tag
-        if (lastresult.unitWrapped) {
-            xmlSAXHandler roottagsax;
-            memset(&roottagsax, 0, sizeof(roottagsax));
-            roottagsax.initialized    = XML_SAX2_MAGIC;
-            roottagsax.startElementNs = [](void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
-                             int nb_namespaces, const xmlChar** namespaces,
-                             int nb_attributes, int /* nb_defaulted */, const xmlChar** attributes) {
-
-                auto ctxt = (xmlParserCtxtPtr) ctx;
-                if (ctxt == nullptr)
-                    return;
-                auto unit = (srcml_unit*) ctxt->_private;
-                if (unit == nullptr)
-                    return;
-
-                unit_update_attributes(unit, nb_attributes, attributes);
-            };
-
-            // extract the start tag, turning it into an empty tag
-            // note: it may be an empty tag already
-            std::string starttag = nunit->srcml.substr(0, nunit->content_begin - 1);
-            if (starttag.back() != '/')
-                starttag += "/";
-            starttag += ">";
-
-            // parse the start tag updating the unit
-            xmlParserCtxtPtr context = xmlCreateMemoryParserCtxt(starttag.c_str(), (int) starttag.size());
-            auto save_private = context->_private;
-            context->_private = nunit;
-            auto save_sax = context->sax;
-            context->sax = &roottagsax;
-
-            // parse our single-element unit
-            xmlParseDocument(context);
-
-            // restore state and free
-            context->_private = save_private;
-            context->sax = save_sax;
-            xmlFreeParserCtxt(context);
-        }
+        // update the unit attributes with the transformed result directly from the root element
+        if (lastresult.unitWrapped && fullresults->nodeTab[i]->type == XML_ELEMENT_NODE)
+            unit_update_attributes(nunit, fullresults->nodeTab[i]->properties);
 
         // store in the returned results
         result->units.push_back(nunit);
     }
 
+    // also performs a free of resources
+    xmlOutputBufferClose(output);
+
     // remove all nodes in the fullresults nodeset
     // valgrind shows free accessing these nodes after they have been freed
     // by the xmlDoc
@@ -762,6 +876,95 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_unit_apply_transforms_each
+ * @param size number of archives
+ * @param archives archives with the transformations
+ * @param unit the unit to apply the transformations to
+ * @param results the result of each archive
+ *
+ * Apply the transformations of each archive to the unit independently.
+ * Streamable XPath queries are evaluated in a single streaming parse of the unit,
+ * and the remaining transformations share a single DOM of the unit.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error codes on failure.
+ */
+int srcml_unit_apply_transforms_each(int size, struct srcml_archive** archives, struct srcml_unit* unit, struct srcml_transform_result** results) {
+
+    if (size < 0 || (size > 0 && (archives == nullptr || results == nullptr)) || unit == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    for (int i = 0; i < size; ++i) {
+        if (archives[i] == nullptr)
+            return SRCML_STATUS_INVALID_ARGUMENT;
+
+        results[i] = nullptr;
+    }
+
+    // transformations need the srcml of the unit
+    if (unit->read_src_only)
+        return SRCML_STATUS_UNINITIALIZED_UNIT;
+
+    // streamable queries, which are only xpath, in a single streaming parse
+    std::vector<int> streamed;
+    std::vector<const xpathTransformation*> queries;
+    if (!unit->doc) {
+        for (int i = 0; i < size; ++i) {
+
+            const auto& transformations = archives[i]->transformations;
+            if (transformations.size() == 1 && transformations.front()->streamable() && !srcml_transform_filtered(archives[i], unit)) {
+                streamed.push_back(i);
+                queries.push_back(static_cast<const xpathTransformation*>(transformations.front().get()));
+            }
+        }
+    }
+
+    if (!queries.empty()) {
+
+        std::vector<std::vector<std::pair<int, int>>> matches;
+        if (!xpathTransformation::apply_streams(queries, unit->srcml, unit->namespaces ? *unit->namespaces : starting_namespaces, matches))
+            return SRCML_STATUS_ERROR;
+
+        for (int i = 0; i < (int) streamed.size(); ++i) {
+
+            results[streamed[i]] = new srcml_transform_result;
+            results[streamed[i]]->boolValue = false;
+            srcml_transform_stream_results(unit, matches[i], results[streamed[i]]);
+        }
+    }
+
+    // remaining transformations share a DOM of the unit, except those filtered out by the unit attributes
+    int remaining = 0;
+    for (int i = 0; i < size; ++i) {
+        if (!archives[i]->transformations.empty() && !std::count(streamed.begin(), streamed.end(), i)
+            && !srcml_transform_filtered(archives[i], unit))
+            ++remaining;
+    }
+
+    bool shared = false;
+    if (remaining > 1 && !unit->doc) {
+        unit->doc.reset(xmlReadMemory(unit->srcml.c_str(), (int) unit->srcml.size(), 0, 0, 0), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+        if (!unit->doc)
+            return SRCML_STATUS_ERROR;
+
+        shared = true;
+    }
+
+    int status = SRCML_STATUS_OK;
+    for (int i = 0; i < size && status == SRCML_STATUS_OK; ++i) {
+
+        if (std::count(streamed.begin(), streamed.end(), i))
+            continue;
+
+        status = srcml_unit_apply_transforms(archives[i], unit, &results[i]);
+    }
+
+    if (shared)
+        unit->doc.reset();
+
+    return status;
+}
+
 /**
  * Free the resources in a tranformation result.
  * @param results Struct of result
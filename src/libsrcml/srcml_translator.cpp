@@ -32,6 +32,7 @@
 #include "srcmlns.hpp"
 #include <srcml_types.hpp>
 #include <unit_utilities.hpp>
+#include <name_filter.hpp>
 
 /**
  * srcml_translator
@@ -182,16 +183,18 @@ void srcml_translator::prepareOutput() {
 /**
  * add_unit
  * @param unit srcML to add to archive/non-archive with configuration options
- * @param xml the xml to output
+ * @param ref position of the earlier unit with the same source, or 0
+ * @param refnamespaces namespaces of the earlier unit with the same source
  *
  * Add a unit as string directly to the archive.  If not an archive
  * and supplied unit does not have src namespace add it.  Also, write out
  * a supplied hash as part of output unit if specified.
+ * A reference to an earlier unit is written with a ref attribute and no contents.
  * Can not be in by element mode.
  *
  * @returns if succesfully added.
  */
-bool srcml_translator::add_unit(const srcml_unit* unit) {
+bool srcml_translator::add_unit(const srcml_unit* unit, int ref, const boost::optional<Namespaces>& refnamespaces) {
 
     if (is_outputting_unit)
         return false;
@@ -210,6 +213,11 @@ bool srcml_translator::add_unit(const srcml_unit* unit) {
         mergedns += *unit->namespaces;
     }
 
+    // a reference declares the namespaces used in the contents of the earlier unit
+    if (refnamespaces) {
+        mergedns += *refnamespaces;
+    }
+
     // if a srcdiff revision, remove the srcdiff namespace
     if (unit->archive->revision_number) {
         auto&& view = mergedns.get<nstags::uri>();
@@ -221,6 +229,26 @@ bool srcml_translator::add_unit(const srcml_unit* unit) {
 
     std::string language = unit->language ? *unit->language : Language(unit->derived_language).getLanguageString();
 
+    // contents, excluding the start and end unit tags
+    int size = unit->content_end - unit->content_begin - 1;
+    bool extract = unit->archive->revision_number && issrcdiff(unit->archive->namespaces) && unit->currevision != (int) *unit->archive->revision_number;
+    std::string revisionsrcml;
+    if (extract)
+        revisionsrcml = extract_revision(unit->srcml.c_str() + unit->content_begin, size, (int) *unit->archive->revision_number);
+
+    // a name filter from the input is replaced, since it may be from other contents
+    const std::vector<std::string>* attributes = &unit->attributes;
+    std::vector<std::string> nofilter_attributes;
+    if (options & SRCML_OPTION_NAME_FILTER) {
+        for (size_t i = 0; i + 1 < unit->attributes.size(); i += 2) {
+            if (unit->attributes[i] == UNIT_ATTRIBUTE_NAME_FILTER)
+                continue;
+            nofilter_attributes.push_back(unit->attributes[i]);
+            nofilter_attributes.push_back(unit->attributes[i + 1]);
+        }
+        attributes = &nofilter_attributes;
+    }
+
     // create a new unit start tag with all new info (hash value, namespaces actually used, etc.)
     out.initNamespaces(mergedns);
     auto nrevision = unit->archive->revision_number;
@@ -232,17 +260,37 @@ bool srcml_translator::add_unit(const srcml_unit* unit) {
             !unit->timestamp ? 0 : (nrevision ? attribute_revision(*unit->timestamp, (int) *nrevision).c_str() : unit->timestamp->c_str()),
             !unit->hash      ? 0 : (nrevision ? attribute_revision(*unit->hash, (int) *nrevision).c_str() : unit->hash->c_str()),
             !unit->encoding  ? 0 : (nrevision ? attribute_revision(*unit->encoding, (int) *nrevision).c_str() : unit->encoding->c_str()),
-            unit->attributes,
+            *attributes,
             false);
 
-    // write out the contents, excluding the start and end unit tags
-    int size = unit->content_end - unit->content_begin - 1;
+    // lines of code, so that listing an archive does not need the unit body
+    if ((options & SRCML_OPTION_STORE_LOC) && unit->loc >= 0)
+        xmlTextWriterWriteAttribute(out.getWriter(), BAD_CAST UNIT_ATTRIBUTE_LOC, BAD_CAST std::to_string(unit->loc).c_str());
 
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
+    // position of the earlier unit with the same source, instead of the contents
+    if (ref > 0) {
+        xmlTextWriterWriteAttribute(out.getWriter(), BAD_CAST UNIT_ATTRIBUTE_REF, BAD_CAST std::to_string(ref).c_str());
+        xmlTextWriterEndElement(out.getWriter());
 
-        std::string s = extract_revision(unit->srcml.c_str() + unit->content_begin, size, (int) *unit->archive->revision_number);
+        return true;
+    }
 
-        xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST s.c_str(), (int) s.size());
+    // names in the unit, so that queries on a name can skip the unit body
+    if (options & SRCML_OPTION_NAME_FILTER) {
+
+        auto&& view = mergedns.get<nstags::uri>();
+        auto it = view.find(SRCML_SRC_NS_URI);
+        std::string prefix = it != view.end() ? it->prefix : SRCML_SRC_NS_DEFAULT_PREFIX;
+
+        std::string filter = extract ? name_filter_create(revisionsrcml.c_str(), revisionsrcml.size(), prefix)
+                                     : name_filter_create(unit->srcml.c_str() + unit->content_begin, size > 0 ? size : 0, prefix);
+        xmlTextWriterWriteAttribute(out.getWriter(), BAD_CAST UNIT_ATTRIBUTE_NAME_FILTER, BAD_CAST filter.c_str());
+    }
+
+    // write out the contents
+    if (extract) {
+
+        xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST revisionsrcml.c_str(), (int) revisionsrcml.size());
 
     } else if (size > 0) {
         xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST (unit->srcml.c_str() + unit->content_begin), size);
@@ -304,7 +352,7 @@ bool srcml_translator::add_end_unit() {
 
     is_outputting_unit = false;
 
-    return xmlTextWriterEndElement(out.getWriter()) != -1;
+    return out.endElement();
 }
 
 /**
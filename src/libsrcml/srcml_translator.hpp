@@ -78,7 +78,7 @@ public:
 
     void translate(UTF8CharBuffer* parser_input);
 
-    bool add_unit(const srcml_unit* unit);
+    bool add_unit(const srcml_unit* unit, int ref = 0, const boost::optional<Namespaces>& refnamespaces = boost::none);
     bool add_start_unit(const srcml_unit* unit);
     bool add_end_unit();
     bool add_start_element(const char* prefix, const char* name, const char* uri);
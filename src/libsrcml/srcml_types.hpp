@@ -52,6 +52,12 @@ const unsigned int SRCML_OPTION_CPP_DECLARED      = 1<<13;
 const unsigned int SRCML_OPTION_ARCHIVE           = 1<<14;
  /** Output hash attribute on each unit (default: on) */
 const unsigned int SRCML_OPTION_HASH              = 1<<15;
+ /** Output name filter attribute on each unit */
+const unsigned int SRCML_OPTION_NAME_FILTER       = 1<<16;
+ /** Output binary srcML */
+const unsigned int SRCML_OPTION_BINARY            = 1<<17;
+ /** Write units with the same source as an earlier unit as a reference to it */
+const unsigned int SRCML_OPTION_DEDUP             = 1<<18;
 
 /** All default enabled options */
 const unsigned int SRCML_OPTION_DEFAULT_INTERNAL  = (SRCML_OPTION_ARCHIVE | SRCML_OPTION_HASH | SRCML_OPTION_NAMESPACE_DECL);
@@ -65,6 +71,7 @@ const unsigned int SRCML_OPTION_DEFAULT_INTERNAL  = (SRCML_OPTION_ARCHIVE | SRCM
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #ifdef __GNUC__
 
@@ -92,6 +99,7 @@ typedef unsigned __int64 OPTION_TYPE;
 
 class srcml_sax2_reader;
 class srcml_translator;
+struct srcml_cache;
 
 /**
  * SRCML_ARCHIVE_TYPE
@@ -100,6 +108,23 @@ class srcml_translator;
  */
 enum SRCML_ARCHIVE_TYPE { SRCML_ARCHIVE_INVALID, SRCML_ARCHIVE_RW, SRCML_ARCHIVE_READ, SRCML_ARCHIVE_WRITE };
 
+/**
+ * srcml_dedup_unit
+ *
+ * Unit written in full to a dedup archive, for references to it.
+ */
+struct srcml_dedup_unit {
+
+    /** position of the unit in the archive, starting at 1 */
+    int position = 0;
+
+    /** lines of code of the unit */
+    int loc = -1;
+
+    /** namespaces of the unit, so that a reference declares the same ones */
+    boost::optional<Namespaces> namespaces;
+};
+
 /**
  * srcml_archive
  *
@@ -131,6 +156,9 @@ struct srcml_archive {
     /** size of tabstop */
     size_t tabstop = 8;
 
+    /** content collected for each unit read */
+    size_t read_content = SRCML_READ_CONTENT_ALL;
+
     /**  new namespace structure */
     Namespaces namespaces = starting_namespaces;
 
@@ -154,8 +182,31 @@ struct srcml_archive {
     /** srcDiff revision number */
     boost::optional<size_t> revision_number;
 
+    /** filter on the attributes of units read */
+    unit_filter unitfilter;
+
+    /** units read have the name-filter attribute */
+    bool read_name_filter = false;
+
+    /** element index of the units written, and the file it is written to on close */
+    boost::optional<std::string> index_filename;
+    srcml_index* index = nullptr;
+
+    /** cache of parsed units, shared with clones of the archive */
+    std::shared_ptr<srcml_cache> cache;
+
+    /** units written in full to a dedup archive by hash and language, and the number of units written */
+    std::unordered_map<std::string, srcml_dedup_unit> dedup_units;
+    int dedup_count = 0;
+
+    /** maximum size of the contents of units read from a dedup archive kept to expand references to them */
+    size_t dedup_expand = 0;
+
     /** output buffer for io, filename, FILE*, and fd */
     xmlOutputBuffer* output_buffer = nullptr;
+
+    /** name of the output file, for the index of the srcML written */
+    boost::optional<std::string> output_filename;
     xmlBuffer* xbuffer = nullptr;
 
     /** output for memory */
@@ -165,6 +216,15 @@ struct srcml_archive {
     /** raw writes were made */
     bool rawwrites = false;
 
+    /** output buffer is wrapped to encode binary srcML */
+    bool binary_wrapped = false;
+
+    /** units passed directly to or from another archive, instead of as srcML */
+    void* unit_context = nullptr;
+    int (*unit_write_callback)(void* context, srcml_unit* unit) = nullptr;
+    srcml_unit* (*unit_read_callback)(void* context) = nullptr;
+    int (*unit_close_callback)(void* context) = nullptr;
+
     /** error reporting */
     std::string error_string;
     int error_number = 0;
@@ -218,9 +278,19 @@ struct srcml_unit {
     // if body has been read
     bool read_body = false;
 
+    // if only the source of the body was read, so no srcml
+    bool read_src_only = false;
+
+    /** position of the unit with the same source in a dedup archive, for a reference unit read */
+    int ref = 0;
+
+    /** duplicate of a unit already written, so not parsed, and only written as a reference */
+    bool duplicate = false;
+
     /** srcml from read and after parsing */
     std::string srcml;
     boost::optional<std::string> srcml_revision;
+    /** srcDiff revision the srcml was filtered to when read */
     int currevision = -1;
     boost::optional<std::string> srcml_fragment;
     boost::optional<std::string> srcml_fragment_revision;
@@ -230,6 +300,9 @@ struct srcml_unit {
     /** src from read */
     boost::optional<std::string> src;
 
+    /** DOM built directly by the parser for transformations, with the srcml serialized from it when needed */
+    std::shared_ptr<xmlDoc> doc;
+
     /** record the begin and end of the actual content */
     // int instead of size_t since used with libxml2
     int content_begin = 0;
@@ -253,6 +326,14 @@ struct srcml_unit {
  */
 int srcml_unit_set_hash (struct srcml_unit* unit, const char* hash);
 
+/** Serialize the srcml of a unit parsed directly into a DOM
+ * Note: Not publicly available, so declared here instead of srcml.h
+ * @param unit A srcml_unit
+ * @retval SRCML_STATUS_OK on success, including when there is no DOM
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+int srcml_unit_serialize_doc(struct srcml_unit* unit);
+
 // helper conversions for boost::optional<std::string>
 inline const char* optional_to_c_str(const boost::optional<std::string>& s) {
     return s ? s->c_str() : 0;
@@ -22,6 +22,8 @@
 #include <srcml_types.hpp>
 #include <srcml_translator.hpp>
 #include <srcml_sax2_reader.hpp>
+#include <srcml_cache.hpp>
+#include <sha1utilities.hpp>
 #include <UTF8CharBuffer.hpp>
 #include <memory>
 #include <libxml2_utilities.hpp>
@@ -135,6 +137,29 @@ int srcml_unit_set_timestamp(struct srcml_unit* unit, const char* timestamp) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_unit_set_duplicate
+ * @param unit a srcml unit
+ * @param hash the hash of the source of the unit
+ *
+ * Mark the unit, instead of parsing it, as a duplicate of a unit with the same
+ * source already written to a dedup archive. Writing it to the archive
+ * writes a reference to that unit.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT
+ * on failure.
+ */
+int srcml_unit_set_duplicate(struct srcml_unit* unit, const char* hash) {
+
+    if (unit == nullptr || hash == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    unit->hash = std::string(hash);
+    unit->duplicate = true;
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_unit_set_hash
  * @param unit a srcml unit
@@ -295,17 +320,34 @@ const char* srcml_unit_get_hash(const struct srcml_unit* unit) {
 
 /**
  * srcml_unit_get_loc
- * @param unit a srcml unit
+ * @param const_unit a srcml unit
  *
  * Get the loc for the sourec code in the srcml unit.
+ * If the loc attribute was not in the header, the body is read.
  *
  * @returns loc on success and -1 on failure.
  */
-int srcml_unit_get_loc(const struct srcml_unit* unit) {
+int srcml_unit_get_loc(const struct srcml_unit* const_unit) {
 
-    if (unit == nullptr)
+    if (const_unit == nullptr)
         return -1;
 
+    // the loc, and the body needed for it, are computed lazily, and only cached in the unit
+    auto unit = const_cast<srcml_unit*>(const_unit);
+
+    if (unit->loc == -1 && !unit->read_body && unit->read_header && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
+        unit->archive->reader->read_body(unit);
+
+    // body read without the source
+    if (unit->loc == -1 && unit->read_body && !unit->src) {
+
+        unit->src = extract_src(unit->srcml);
+
+        unit->loc = (int) std::count(unit->src->begin(), unit->src->end(), '\n');
+        if (!unit->src->empty() && unit->src->back() != '\n')
+            ++unit->loc;
+    }
+
     return unit->loc;
 }
 
@@ -343,10 +385,27 @@ const char* srcml_unit_get_srcml(struct srcml_unit* unit) {
     if (unit == nullptr || (!unit->read_body && !unit->read_header))
         return 0;
 
-    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
+    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW)) {
         unit->archive->reader->read_body(unit);
 
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
+        // body is no longer available, e.g., a later unit was read
+        if (!unit->read_body)
+            return 0;
+    }
+
+    // only the source of the body was read
+    if (unit->read_src_only)
+        return 0;
+
+    // reference that was not expanded, so without the contents of the unit
+    if (unit->ref > 0)
+        return 0;
+
+    // srcml of a unit parsed directly into a DOM
+    if (srcml_unit_serialize_doc(unit) != SRCML_STATUS_OK)
+        return 0;
+
+    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces) && unit->currevision != (int) *unit->archive->revision_number) {
         if (!unit->srcml_revision || unit->currevision != (int) *unit->archive->revision_number)
             unit->srcml_revision = extract_revision(unit->srcml.c_str(), (int) unit->srcml.size(), (int) *unit->archive->revision_number);
         return unit->srcml_revision->c_str();
@@ -372,9 +431,26 @@ const char* srcml_unit_get_srcml_outer(struct srcml_unit* unit) {
     if (unit == nullptr || (!unit->read_body && !unit->read_header))
         return 0;
 
-    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
+    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW)) {
         unit->archive->reader->read_body(unit);
 
+        // body is no longer available, e.g., a later unit was read
+        if (!unit->read_body)
+            return 0;
+    }
+
+    // only the source of the body was read
+    if (unit->read_src_only)
+        return 0;
+
+    // reference that was not expanded, so without the contents of the unit
+    if (unit->ref > 0)
+        return 0;
+
+    // srcml of a unit parsed directly into a DOM
+    if (srcml_unit_serialize_doc(unit) != SRCML_STATUS_OK)
+        return 0;
+
     // size of resulting raw version (no unit tag)
     auto rawsize = unit->srcml.size() - (unit->insert_end - unit->insert_begin);
 
@@ -413,7 +489,7 @@ const char* srcml_unit_get_srcml_outer(struct srcml_unit* unit) {
     }
 
     // if srcdiff versioned, then use that
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
+    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces) && unit->currevision != (int) *unit->archive->revision_number) {
         if (!unit->srcml_fragment_revision || unit->currevision != (int) *unit->archive->revision_number)
             unit->srcml_fragment_revision = extract_revision(unit->srcml_fragment->c_str(), (int) unit->srcml_fragment->size(), (int) *unit->archive->revision_number);
         return unit->srcml_fragment_revision->c_str();
@@ -439,9 +515,26 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
     if (unit == nullptr || (!unit->read_body && !unit->read_header))
         return 0;
 
-    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
+    if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW)) {
         unit->archive->reader->read_body(unit);
 
+        // body is no longer available, e.g., a later unit was read
+        if (!unit->read_body)
+            return 0;
+    }
+
+    // only the source of the body was read
+    if (unit->read_src_only)
+        return 0;
+
+    // reference that was not expanded, so without the contents of the unit
+    if (unit->ref > 0)
+        return 0;
+
+    // srcml of a unit parsed directly into a DOM
+    if (srcml_unit_serialize_doc(unit) != SRCML_STATUS_OK)
+        return 0;
+
     auto start = unit->content_begin;
 
     // size of resulting raw version (no unit tag)
@@ -450,7 +543,7 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
         return "";
 
     // if srcdiff versioned, then use that
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
+    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces) && unit->currevision != (int) *unit->archive->revision_number) {
         if (!unit->srcml_raw_revision || unit->currevision != (int) *unit->archive->revision_number)
             unit->srcml_raw_revision = extract_revision(unit->srcml.c_str() + start, rawsize, (int) *unit->archive->revision_number);
         return unit->srcml_raw_revision->c_str();
@@ -471,6 +564,189 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
  *                                                                            *
  ******************************************************************************/
 
+/**
+ * srcml_unit_create_translator
+ * @param unit a srcml unit
+ * @param obuffer output buffer for the srcml, or 0 when building a DOM
+ *
+ * Create the translator (srcML parser + srcML output) for the unit,
+ * replacing any existing one.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
+ */
+static int srcml_unit_create_translator(struct srcml_unit* unit, xmlOutputBufferPtr obuffer) {
+
+    try {
+        // turn off option for archive so XML generated has full namespaces
+        auto options = unit->archive->options;
+        options &= ~(unsigned long long)(SRCML_OPTION_ARCHIVE);
+
+        if (!(unit->namespaces))
+            unit->namespaces = unit->archive->namespaces;
+
+        if (unit->unit_translator) {
+            unit->unit_translator->close();
+            delete unit->unit_translator;
+            unit->unit_translator = nullptr;
+            xmlBufferFree(unit->output_buffer);
+            unit->output_buffer = nullptr;
+        }
+        unit->unit_translator = new srcml_translator(
+            obuffer,
+            optional_to_c_str(unit->archive->encoding, "UTF-8"),
+            options,
+            *(unit->namespaces),
+            boost::none,
+            unit->archive->tabstop,
+            unit->derived_language,
+            optional_to_c_str(unit->revision),
+            optional_to_c_str(unit->url),
+            optional_to_c_str(unit->filename),
+            optional_to_c_str(unit->version),
+            unit->attributes,
+            optional_to_c_str(unit->timestamp),
+            optional_to_c_str(unit->hash, (unit->archive->options & SRCML_OPTION_HASH ? "" : 0)),
+            optional_to_c_str(unit->encoding));
+
+        unit->unit_translator->set_macro_list(unit->archive->user_macro_list);
+
+    } catch(...) {
+
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_unit_parse_doc
+ * @param unit a srcml unit
+ * @param input the source input to the translator
+ *
+ * Translate the input directly into a DOM for the transformations of the archive,
+ * instead of srcml that the transformations would have to parse. The srcml is
+ * only serialized from the DOM if needed.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_unit_parse_doc(struct srcml_unit* unit, UTF8CharBuffer* input) {
+
+    // the input is owned until the translator takes it
+    std::unique_ptr<UTF8CharBuffer> owned_input(input);
+
+    std::shared_ptr<xmlDoc> doc(srcMLOutput::createDocument(), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+    if (!doc)
+        return SRCML_STATUS_IO_ERROR;
+
+    int status = srcml_unit_create_translator(unit, 0);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    unit->unit_translator->out.setDocument(doc.get());
+
+    // build the unit element, and parse the input into it
+    if (!unit->unit_translator->add_start_unit(unit)) {
+
+        delete unit->unit_translator;
+        unit->unit_translator = nullptr;
+
+        return SRCML_STATUS_INVALID_INPUT;
+    }
+
+    unit->unit_translator->translate(owned_input.release());
+
+    // namespaces were updated during translation, may now include
+    // namespaces that were optional
+    unit->namespaces = unit->unit_translator->out.getNamespaces();
+
+    unit->unit_translator->add_end_unit();
+
+    delete unit->unit_translator;
+    unit->unit_translator = nullptr;
+
+    // the hash is only known after the input is translated
+    xmlNodePtr root = xmlDocGetRootElement(doc.get());
+    if (unit->hash)
+        xmlSetProp(root, BAD_CAST UNIT_ATTRIBUTE_HASH, BAD_CAST unit->hash->c_str());
+
+    // the loc from the text of the DOM
+    unit->loc = 0;
+    char last = '\n';
+    for (xmlNodePtr node = root; node; ) {
+
+        if (node->type == XML_TEXT_NODE && node->content && node->content[0] != '\0') {
+            const char* text = (const char*) node->content;
+            size_t size = strlen(text);
+            unit->loc += (int) std::count(text, text + size, '\n');
+            last = text[size - 1];
+
+        // escaped control characters are part of the source
+        } else if (node->type == XML_ELEMENT_NODE && !node->children && xmlStrEqual(node->name, BAD_CAST "escape")) {
+            last = 0;
+        }
+
+        // next node in document order, without the attributes
+        if (node->type == XML_ELEMENT_NODE && node->children) {
+            node = node->children;
+            continue;
+        }
+        while (node && !node->next)
+            node = node->parent != (xmlNodePtr) doc.get() ? node->parent : nullptr;
+        if (node)
+            node = node->next;
+    }
+    if (last != '\n')
+        ++unit->loc;
+
+    unit->doc = doc;
+    unit->srcml.clear();
+    unit->src = boost::none;
+    unit->read_body = true;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_unit_parse_cached
+ * @param unit a srcml unit
+ * @param entry the cache entry of an earlier parse of the same source
+ *
+ * Place the srcML of the cache entry into the unit, with a unit start tag created
+ * from the attributes of this unit, as srcml_write_end_unit() does after a parse.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_unit_parse_cached(struct srcml_unit* unit, const srcml_cache_entry& entry) {
+
+    unit->encoding = !entry.encoding.empty() ? boost::optional<std::string>(entry.encoding) : boost::none;
+    unit->url = unit->archive->url;
+    unit->namespaces = entry.namespaces;
+    unit->doc.reset();
+
+    int status = srcml_write_start_unit(unit);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    char* start_tag = (char*) xmlBufferDetach(unit->output_buffer);
+    unit->srcml.assign(start_tag);
+    unit->srcml.append(entry.tail);
+    free(start_tag);
+
+    unit->content_end = unit->content_begin + entry.content_size;
+    unit->loc = entry.loc;
+    unit->src = boost::none;
+
+    delete unit->unit_translator;
+    unit->unit_translator = nullptr;
+
+    xmlBufferFree(unit->output_buffer);
+    unit->output_buffer = nullptr;
+
+    unit->read_body = true;
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_unit_parse_internal
  * @param unit a srcml unit
@@ -485,7 +761,8 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
  * @returns Returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
  */
 static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filename,
-    std::function<UTF8CharBuffer*(const char* src_encoding, bool output_hash, boost::optional<std::string>& hash)> createUTF8CharBuffer) {
+    std::function<UTF8CharBuffer*(const char* src_encoding, bool output_hash, boost::optional<std::string>& hash)> createUTF8CharBuffer,
+    std::function<bool(std::string& source)> readSource) {
 
     // figure out the language based on unit, archive, registered languages
     int lang = unit->language ? srcml_check_language(unit->language->c_str())
@@ -515,6 +792,35 @@ static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filena
 
     bool output_hash = !unit->hash && unit->archive->options & SRCML_OPTION_HASH;
 
+    // a source parsed before with the same options is copied from the cache, except
+    // for transformations on a DOM, which is not cached
+    const auto& transformations = unit->archive->transformations;
+    std::string source;
+    std::string cache_key;
+    if (unit->archive->cache && (transformations.empty() || (transformations.size() == 1 && transformations.front()->streamable()))) {
+
+        // the key of the cache is from the entire source
+        if (!readSource(source))
+            return SRCML_STATUS_IO_ERROR;
+
+        std::string source_hash = sha1_hex(source.c_str(), source.size());
+        if (output_hash) {
+            unit->hash = source_hash;
+            output_hash = false;
+        }
+
+        cache_key = srcml_cache_key(unit, src_encoding, source_hash);
+
+        srcml_cache_entry entry;
+        if (srcml_cache_load(unit->archive->cache.get(), cache_key, entry))
+            return srcml_unit_parse_cached(unit, entry);
+
+        createUTF8CharBuffer = [&source](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
+
+            return new UTF8CharBuffer(source.c_str(), source.size(), encoding, output_hash, hash);
+        };
+    }
+
     UTF8CharBuffer* input = 0;
     try {
 
@@ -527,6 +833,15 @@ static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filena
     // unit url is just that of the archive
     unit->url = unit->archive->url;
 
+    // transformations use a DOM built directly from the parser,
+    // except a single streamable transformation that is applied to the srcML,
+    // and a unit whose attributes already rule out any results
+    bool filtered = !transformations.empty() && transformations.front()->filter()
+                    && !unit_filter_match(unit, *transformations.front()->filter());
+    if (!transformations.empty() && !(transformations.size() == 1 && transformations.front()->streamable()) && !filtered)
+        return srcml_unit_parse_doc(unit, input);
+    unit->doc.reset();
+
     // create the unit start tag (start_unit and end_unit must be called together)
     int status = srcml_write_start_unit(unit);
     if (status != SRCML_STATUS_OK)
@@ -540,7 +855,36 @@ static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filena
     unit->namespaces = unit->unit_translator->out.getNamespaces();
 
     // create the unit end tag
-    return srcml_write_end_unit(unit);
+    status = srcml_write_end_unit(unit);
+    if (status != SRCML_STATUS_OK || cache_key.empty())
+        return status;
+
+    srcml_cache_entry entry;
+    entry.encoding = optional_to_c_str(unit->encoding, "");
+    entry.namespaces = *unit->namespaces;
+    entry.tail = unit->srcml.substr(unit->content_begin - 1);
+    entry.content_size = unit->content_end - unit->content_begin;
+    entry.loc = unit->loc;
+    srcml_cache_store(unit->archive->cache.get(), cache_key, entry);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * read_source_fd
+ * @param src_fd a file descriptor open for reading
+ * @param source location to read the entire source to
+ *
+ * @returns if the source was read.
+ */
+static bool read_source_fd(int src_fd, std::string& source) {
+
+    char buffer[4096];
+    int size = 0;
+    while ((size = (int) READ(src_fd, buffer, sizeof(buffer))) > 0)
+        source.append(buffer, size);
+
+    return size == 0;
 }
 
 /**
@@ -564,10 +908,18 @@ int srcml_unit_parse_filename(struct srcml_unit* unit, const char* src_filename)
         return SRCML_STATUS_IO_ERROR;
     }
 
-    return srcml_unit_parse_internal(unit, src_filename, [src_fd](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
+    int status = srcml_unit_parse_internal(unit, src_filename, [src_fd](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
 
         return new UTF8CharBuffer(src_fd, encoding, output_hash, hash);
+    }, [src_fd](std::string& source) {
+
+        return read_source_fd(src_fd, source);
     });
+
+    // the file descriptor is not closed by the input, whether it was parsed, read for the cache, or failed
+    CLOSE(src_fd);
+
+    return status;
 }
 
 /**
@@ -589,6 +941,10 @@ int srcml_unit_parse_memory(struct srcml_unit* unit, const char* src_buffer, siz
     return srcml_unit_parse_internal(unit, 0, [src_buffer, buffer_size](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
 
         return new UTF8CharBuffer(src_buffer ? src_buffer : "", buffer_size, encoding, output_hash, hash);
+    }, [src_buffer, buffer_size](std::string& source) {
+
+        source.assign(src_buffer ? src_buffer : "", buffer_size);
+        return true;
     });
 }
 
@@ -610,6 +966,14 @@ int srcml_unit_parse_FILE(struct srcml_unit* unit, FILE* src_file) {
     return srcml_unit_parse_internal(unit, 0, [src_file](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
 
         return new UTF8CharBuffer(src_file, encoding, output_hash, hash);
+    }, [src_file](std::string& source) {
+
+        char buffer[4096];
+        size_t size = 0;
+        while ((size = fread(buffer, 1, sizeof(buffer), src_file)) > 0)
+            source.append(buffer, size);
+
+        return ferror(src_file) == 0;
     });
 }
 
@@ -631,6 +995,9 @@ int srcml_unit_parse_fd(struct srcml_unit* unit, int src_fd) {
     return srcml_unit_parse_internal(unit, 0, [src_fd](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
 
         return new UTF8CharBuffer(src_fd, encoding, output_hash, hash);
+    }, [src_fd](std::string& source) {
+
+        return read_source_fd(src_fd, source);
     });
 }
 
@@ -655,6 +1022,17 @@ int srcml_unit_parse_io(struct srcml_unit* unit, void * context, ssize_t (*read_
     return srcml_unit_parse_internal(unit, 0, [context, read_callback, close_callback](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
 
         return new UTF8CharBuffer(context, read_callback, close_callback, encoding, output_hash, hash);
+    }, [context, read_callback, close_callback](std::string& source) {
+
+        char buffer[4096];
+        ssize_t size = 0;
+        while ((size = read_callback(context, buffer, sizeof(buffer))) > 0)
+            source.append(buffer, size);
+
+        if (close_callback)
+            close_callback(context);
+
+        return size == 0;
     });
 }
 
@@ -677,11 +1055,6 @@ static int srcml_unit_unparse_internal(struct srcml_unit* unit, std::function<xm
 
     const char* encoding = optional_to_c_str(unit->encoding, optional_to_c_str(unit->archive->src_encoding, "ISO-8859-1"));
 
-    std::unique_ptr<xmlOutputBuffer> output_handler(createbuffer(encoding ? xmlFindCharEncodingHandler(encoding) : 0));
-    if (!output_handler) {
-        return SRCML_STATUS_IO_ERROR;
-    }
-
     try {
 
         if (!unit->read_body)
@@ -692,42 +1065,34 @@ static int srcml_unit_unparse_internal(struct srcml_unit* unit, std::function<xm
         return SRCML_STATUS_IO_ERROR;
     }
 
-    // if this unit was parsed from source, then the src does not exist
-    // generate this source from the srcml
-    if (!unit->src) {
-        unit->src = extract_src(unit->srcml);
-    }
+    if (!unit->read_body)
+        return SRCML_STATUS_UNINITIALIZED_UNIT;
 
-    // if EOL is not auto, then need to convert for
-    if (unit->eol == SOURCE_OUTPUT_EOL_AUTO) {
-        xmlOutputBufferWrite(output_handler.get(), (int) unit->src->size(), unit->src->c_str());
-    } else {
+    // reference that was not expanded, so without the source of the unit
+    if (unit->ref > 0)
+        return SRCML_STATUS_INVALID_INPUT;
 
-        // convert to the given eol
-        std::string neol(0, ' ');
-        neol.reserve(unit->src->size());
+    // if this unit was parsed from source, or read without it, then the src does not exist
+    // extract the source directly from the srcml content
+    bool markup = !unit->src;
+    const char* content = markup ? unit->srcml.c_str() + unit->content_begin : unit->src->c_str();
+    size_t size = markup ? (size_t) std::max(unit->content_end - unit->content_begin - 1, 0) : unit->src->size();
 
-        const std::string& src = *unit->src;
-        for (size_t i = 0; i < src.size(); ++i) {
-            if (src[i] != '\n') {
-                neol += src[i];
-            }
-            else if (unit->eol == SOURCE_OUTPUT_EOL_LF) {
-                neol += '\n';
-            }
-            else if (unit->eol == SOURCE_OUTPUT_EOL_CR) {
-                neol += '\r';
-            }
-            else if (unit->eol == SOURCE_OUTPUT_EOL_CRLF) {
-                neol += "\r\n";
-            } else {
-                neol += src[i];
-            }
-        }
+    // no encoding conversion when the output is the same as the UTF-8
+    xmlCharEncodingHandlerPtr handler = 0;
+    if (encoding && !unparse_passthrough(encoding, content, size, markup))
+        handler = xmlFindCharEncodingHandler(encoding);
 
-        xmlOutputBufferWrite(output_handler.get(), (int) neol.size(), neol.c_str());
+    std::unique_ptr<xmlOutputBuffer> output_handler(createbuffer(handler));
+    if (!output_handler) {
+        return SRCML_STATUS_IO_ERROR;
     }
 
+    if (markup)
+        unparse_srcml(output_handler.get(), content, size, unit->eol);
+    else
+        unparse_src(output_handler.get(), content, size, unit->eol);
+
     return SRCML_STATUS_OK;
 }
 
@@ -885,44 +1250,9 @@ int srcml_write_start_unit(struct srcml_unit* unit) {
         return SRCML_STATUS_IO_ERROR;
 
     // setup the translator (srcML parser + srcML output)
-    try {
-        // turn off option for archive so XML generated has full namespaces
-        auto options = unit->archive->options;
-        options &= ~(unsigned long long)(SRCML_OPTION_ARCHIVE);
-
-        if (!(unit->namespaces))
-            unit->namespaces = unit->archive->namespaces;
-
-        if (unit->unit_translator) {
-            unit->unit_translator->close();
-            delete unit->unit_translator;
-            unit->unit_translator = nullptr;
-            xmlBufferFree(unit->output_buffer);
-            unit->output_buffer = nullptr;
-        }
-        unit->unit_translator = new srcml_translator(
-            obuffer,
-            optional_to_c_str(unit->archive->encoding, "UTF-8"),
-            options,
-            *(unit->namespaces),
-            boost::none,
-            unit->archive->tabstop,
-            unit->derived_language,
-            optional_to_c_str(unit->revision),
-            optional_to_c_str(unit->url),
-            optional_to_c_str(unit->filename),
-            optional_to_c_str(unit->version),
-            unit->attributes,
-            optional_to_c_str(unit->timestamp),
-            optional_to_c_str(unit->hash, (unit->archive->options & SRCML_OPTION_HASH ? "" : 0)),
-            optional_to_c_str(unit->encoding));
-
-        unit->unit_translator->set_macro_list(unit->archive->user_macro_list);
-
-    } catch(...) {
-
-        return SRCML_STATUS_IO_ERROR;
-    }
+    int status = srcml_unit_create_translator(unit, obuffer);
+    if (status != SRCML_STATUS_OK)
+        return status;
 
     // create the unit start tag
     if (!unit->unit_translator->add_start_unit(unit))
@@ -1026,6 +1356,87 @@ int srcml_write_end_unit(struct srcml_unit* unit) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_unit_write_node
+ * @param writer the writer of the unit
+ * @param node the first of the sibling nodes to write
+ *
+ * Write the nodes of a DOM, and their descendants, the same as the
+ * srcml output of the parser.
+ */
+static void srcml_unit_write_node(xmlTextWriterPtr writer, xmlNodePtr node) {
+
+    for (; node; node = node->next) {
+
+        if (node->type == XML_TEXT_NODE) {
+
+            const char* text = (const char*) node->content;
+            while (*text) {
+
+                size_t size = strcspn(text, "<>&");
+                if (size)
+                    xmlTextWriterWriteRawLen(writer, BAD_CAST text, (int) size);
+                text += size;
+
+                if (*text == '<')
+                    xmlTextWriterWriteRaw(writer, BAD_CAST "&lt;");
+                else if (*text == '>')
+                    xmlTextWriterWriteRaw(writer, BAD_CAST "&gt;");
+                else if (*text == '&')
+                    xmlTextWriterWriteRaw(writer, BAD_CAST "&amp;");
+                else
+                    break;
+                ++text;
+            }
+
+            continue;
+        }
+
+        if (node->type != XML_ELEMENT_NODE)
+            continue;
+
+        xmlTextWriterStartElementNS(writer, node->ns ? node->ns->prefix : 0, node->name, 0);
+
+        for (xmlAttrPtr attr = node->properties; attr; attr = attr->next) {
+            xmlTextWriterWriteAttributeNS(writer, attr->ns ? attr->ns->prefix : 0, attr->name, 0,
+                                          attr->children ? attr->children->content : BAD_CAST "");
+        }
+
+        srcml_unit_write_node(writer, node->children);
+
+        xmlTextWriterEndElement(writer);
+    }
+}
+
+/**
+ * srcml_unit_serialize_doc
+ * @param unit a srcml unit
+ *
+ * Serialize the srcml of a unit that was parsed directly into a DOM.
+ * The DOM is kept for any transformations.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_unit_serialize_doc(struct srcml_unit* unit) {
+
+    if (unit == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    // not parsed into a DOM, or already serialized
+    if (!unit->doc || !unit->srcml.empty())
+        return SRCML_STATUS_OK;
+
+    int status = srcml_write_start_unit(unit);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    xmlNodePtr root = xmlDocGetRootElement(unit->doc.get());
+    if (root)
+        srcml_unit_write_node(unit->unit_translator->output_textwriter(), root->children);
+
+    return srcml_write_end_unit(unit);
+}
+
 /**
  * srcml_write_start_element
  * @param archive a srcml archive opened for writing
@@ -152,6 +152,15 @@ const char* const UNIT_ATTRIBUTE_TIMESTAMP = "timestamp";
 /** hash checksum attribute */
 const char* const UNIT_ATTRIBUTE_HASH = "hash";
 
+/** lines of code attribute */
+const char* const UNIT_ATTRIBUTE_LOC = "loc";
+
+/** name filter (Bloom filter of the name elements) attribute */
+const char* const UNIT_ATTRIBUTE_NAME_FILTER = "name-filter";
+
+/** reference (position of the unit with the same source in a dedup archive) attribute */
+const char* const UNIT_ATTRIBUTE_REF = "ref";
+
 /** hash checksum attribute */
 const char* const UNIT_ATTRIBUTE_SOURCE_ENCODING = "src-encoding";
 
@@ -52,12 +52,15 @@ public:
     /** xml parser input buffer */
     std::unique_ptr<xmlParserInputBuffer> input;
 
+    /** the input is binary srcML, parsed directly instead of by libxml2 */
+    bool binary = false;
+
     /** internally used libxml2 context */
     xmlParserCtxtPtr libxml2_context = nullptr;
 };
 
 /* srcSAX context creation/open functions */
-srcsax_context* srcsax_create_context_parser_input_buffer(std::unique_ptr<xmlParserInputBuffer> input);
+srcsax_context* srcsax_create_context_parser_input_buffer(std::unique_ptr<xmlParserInputBuffer> input, bool binary = false);
 
 /* srcSAX free function */
 void srcsax_free_context(srcsax_context * context);
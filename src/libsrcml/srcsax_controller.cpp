@@ -19,6 +19,7 @@
  */
 #include <srcsax.hpp>
 #include <sax2_srcsax_handler.hpp>
+#include <srcml_binary.hpp>
 
 #include <libxml/parserInternals.h>
 
@@ -47,12 +48,13 @@ static xmlParserCtxtPtr srcsax_create_parser_context(xmlParserInputBufferPtr buf
  * @param read_callback a read callback function
  * @close_callback a close callback function
  * @param encoding the files character encoding
+ * @param binary the input is binary srcML, parsed directly with srcml_binary_parse()
  *
  * Create a srcsSAX context from a general context and read/close callbacks with the specified encoding.
  *
  * @returns srcsax_context context to be used for srcML parsing.
  */
-srcsax_context* srcsax_create_context_parser_input_buffer(std::unique_ptr<xmlParserInputBuffer> input) {
+srcsax_context* srcsax_create_context_parser_input_buffer(std::unique_ptr<xmlParserInputBuffer> input, bool binary) {
 
     if (!input)
         return 0;
@@ -70,6 +72,7 @@ srcsax_context* srcsax_create_context_parser_input_buffer(std::unique_ptr<xmlPar
     }
 
     context->input = std::move(input);
+    context->binary = binary;
 
     xmlParserCtxtPtr libxml2_context = srcsax_create_parser_context(context->input.release(), encoding ? xmlParseCharEncoding(encoding) : XML_CHAR_ENCODING_NONE);
     if (libxml2_context == nullptr) {
@@ -123,7 +126,7 @@ int srcsax_parse(srcsax_context* context) {
     state.context = context;
     context->libxml2_context->_private = &state;
 
-    int status = xmlParseDocument(context->libxml2_context);
+    int status = context->binary ? srcml_binary_parse(context->libxml2_context) : xmlParseDocument(context->libxml2_context);
 
     context->libxml2_context->sax = save_sax;
 
@@ -0,0 +1,496 @@
+/**
+ * @file unit_filter.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <unit_filter.hpp>
+#include <srcml_types.hpp>
+#include <srcmlns.hpp>
+#include <name_filter.hpp>
+#include <cstring>
+#include <cctype>
+
+// trim whitespace from both ends
+static std::string trim(const std::string& s) {
+
+    auto begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return "";
+
+    return s.substr(begin, s.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// position of the end of the bracketed expression starting at pos, respecting quotes
+static size_t matching_bracket(const std::string& s, size_t pos) {
+
+    int depth = 0;
+    char quote = 0;
+    for (auto i = pos; i < s.size(); ++i) {
+
+        char c = s[i];
+        if (quote) {
+            if (c == quote)
+                quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == '(' || c == '[') {
+            ++depth;
+        } else if (c == ')' || c == ']') {
+            if (--depth == 0)
+                return i;
+        }
+    }
+
+    return std::string::npos;
+}
+
+// split the top-level terms of an expression on the operator, respecting quotes and brackets
+static std::vector<std::string> split_terms(const std::string& s, const char* op) {
+
+    std::vector<std::string> terms;
+    auto oplen = strlen(op);
+    size_t start = 0;
+    int depth = 0;
+    char quote = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+
+        char c = s[i];
+        if (quote) {
+            if (c == quote)
+                quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == '(' || c == '[') {
+            ++depth;
+        } else if (c == ')' || c == ']') {
+            --depth;
+        } else if (depth == 0 && s.compare(i, oplen, op) == 0
+                   && i > 0 && (isspace(s[i - 1]) || s[i - 1] == ')' || s[i - 1] == '\'' || s[i - 1] == '"')
+                   && i + oplen < s.size() && (isspace(s[i + oplen]) || s[i + oplen] == '(')) {
+
+            terms.push_back(s.substr(start, i - start));
+            start = i + oplen;
+            i += oplen - 1;
+        }
+    }
+    terms.push_back(s.substr(start));
+
+    return terms;
+}
+
+// parse an attribute reference, @NAME, of an attribute kept in the unit header
+static bool parse_attribute(const std::string& s, std::string& name) {
+
+    auto term = trim(s);
+    if (term.size() < 2 || term[0] != '@' || !(isalpha(term[1]) || term[1] == '_'))
+        return false;
+
+    for (size_t i = 2; i < term.size(); ++i) {
+        if (!(isalnum(term[i]) || term[i] == '_' || term[i] == '-' || term[i] == '.'))
+            return false;
+    }
+
+    name = term.substr(1);
+
+    // the reader drops these attributes, so the header cannot decide them
+    return name != "tabs" && name != "options" && name != UNIT_ATTRIBUTE_REF;
+}
+
+// parse a string literal, 'VALUE' or "VALUE"
+static bool parse_literal(const std::string& s, std::string& value) {
+
+    auto term = trim(s);
+    if (term.size() < 2 || (term[0] != '\'' && term[0] != '"') || term.back() != term[0])
+        return false;
+
+    value = term.substr(1, term.size() - 2);
+
+    return value.find(term[0]) == std::string::npos;
+}
+
+// check if the last step of a location path selects src:name elements,
+// or when contextname, if the path is the context node and it is a name element
+static bool is_name_path(const std::string& s, bool contextname) {
+
+    auto path = trim(s);
+    if (path == ".")
+        return contextname;
+
+    if (path.empty() || path.back() == '/')
+        return false;
+
+    for (auto c : path) {
+        if (!(isalnum(c) || strchr("/:*._-", c)))
+            return false;
+    }
+
+    // any axis of the last step selects name elements in the same unit
+    auto step = path.substr(path.rfind('/') + 1);
+    auto axis = step.find("::");
+    if (axis != std::string::npos)
+        step = step.substr(axis + 2);
+
+    return step == "src:name";
+}
+
+// parse an equality test on the string value of name elements, PATH='VALUE'
+static bool parse_name_predicate(const std::string& s, bool contextname, unit_predicate& predicate) {
+
+    auto term = trim(s);
+    auto equal = term.find('=');
+    if (equal == std::string::npos || equal == 0 || term[equal - 1] == '!'
+        || !is_name_path(term.substr(0, equal), contextname))
+        return false;
+
+    predicate.op = unit_predicate::NAME;
+    predicate.attribute = UNIT_ATTRIBUTE_NAME_FILTER;
+
+    return parse_literal(term.substr(equal + 1), predicate.value);
+}
+
+// parse a single unit attribute predicate
+static bool parse_predicate(const std::string& s, unit_predicate& predicate) {
+
+    auto term = trim(s);
+
+    // .//src:name='VALUE'
+    if (parse_name_predicate(term, false, predicate))
+        return true;
+
+    // @NAME
+    if (parse_attribute(term, predicate.attribute)) {
+        predicate.op = unit_predicate::EXISTS;
+        return true;
+    }
+
+    // starts-with(@NAME, 'VALUE') and contains(@NAME, 'VALUE')
+    for (const auto& function : { std::make_pair("starts-with", (int) unit_predicate::STARTS_WITH),
+                                  std::make_pair("contains", (int) unit_predicate::CONTAINS) }) {
+
+        auto len = strlen(function.first);
+        if (term.compare(0, len, function.first) != 0)
+            continue;
+
+        auto open = term.find_first_not_of(" \t\r\n", len);
+        if (open == std::string::npos || term[open] != '(' || matching_bracket(term, open) != term.size() - 1)
+            return false;
+
+        auto comma = term.find(',', open);
+        if (comma == std::string::npos)
+            return false;
+
+        predicate.op = function.second;
+        return parse_attribute(term.substr(open + 1, comma - open - 1), predicate.attribute)
+            && parse_literal(term.substr(comma + 1, term.size() - comma - 2), predicate.value);
+    }
+
+    // @NAME = 'VALUE' and @NAME != 'VALUE'
+    auto equal = term.find('=');
+    if (equal == std::string::npos || equal == 0)
+        return false;
+
+    predicate.op = unit_predicate::EQUAL;
+    auto attrend = equal;
+    if (term[equal - 1] == '!') {
+        predicate.op = unit_predicate::NOT_EQUAL;
+        --attrend;
+    }
+
+    return parse_attribute(term.substr(0, attrend), predicate.attribute)
+        && parse_literal(term.substr(equal + 1), predicate.value);
+}
+
+// parse a conjunction of unit attribute predicates, ignoring other terms when partial
+static bool parse_conjunction(const std::string& predicate, std::vector<unit_predicate>& predicates, bool partial) {
+
+    // a disjunction does not require any of its terms
+    if (split_terms(predicate, "or").size() > 1)
+        return false;
+
+    for (const auto& s : split_terms(predicate, "and")) {
+
+        auto term = trim(s);
+
+        // parenthesized conjunction
+        if (!term.empty() && term[0] == '(' && matching_bracket(term, 0) == term.size() - 1) {
+            if (!parse_conjunction(term.substr(1, term.size() - 2), predicates, partial) && !partial)
+                return false;
+            continue;
+        }
+
+        unit_predicate unitpredicate;
+        if (parse_predicate(term, unitpredicate))
+            predicates.push_back(unitpredicate);
+        else if (!partial)
+            return false;
+    }
+
+    return true;
+}
+
+// parse the name predicates of a conjunction in the predicate of a step, ignoring other terms
+static void parse_name_conjunction(const std::string& predicate, bool contextname, std::vector<unit_predicate>& predicates) {
+
+    if (split_terms(predicate, "or").size() > 1)
+        return;
+
+    for (const auto& s : split_terms(predicate, "and")) {
+
+        auto term = trim(s);
+
+        if (!term.empty() && term[0] == '(' && matching_bracket(term, 0) == term.size() - 1) {
+            parse_name_conjunction(term.substr(1, term.size() - 2), contextname, predicates);
+            continue;
+        }
+
+        unit_predicate unitpredicate;
+        if (parse_name_predicate(term, contextname, unitpredicate))
+            predicates.push_back(unitpredicate);
+    }
+}
+
+// predicate expression of the predicates
+static std::string expression(const std::vector<unit_predicate>& predicates) {
+
+    std::string s;
+    for (const auto& predicate : predicates) {
+
+        if (!s.empty())
+            s += " and ";
+
+        // values cannot contain the quote they were parsed with
+        char quote = predicate.value.find('\'') == std::string::npos ? '\'' : '"';
+        std::string value = quote + predicate.value + quote;
+
+        switch (predicate.op) {
+        case unit_predicate::EXISTS:
+            s += "@" + predicate.attribute;
+            break;
+
+        case unit_predicate::EQUAL:
+            s += "@" + predicate.attribute + "=" + value;
+            break;
+
+        case unit_predicate::NOT_EQUAL:
+            s += "@" + predicate.attribute + "!=" + value;
+            break;
+
+        case unit_predicate::STARTS_WITH:
+            s += "starts-with(@" + predicate.attribute + ", " + value + ")";
+            break;
+
+        case unit_predicate::CONTAINS:
+            s += "contains(@" + predicate.attribute + ", " + value + ")";
+            break;
+
+        case unit_predicate::NAME:
+            s += ".//src:name=" + value;
+            break;
+        };
+    }
+
+    return s;
+}
+
+/**
+ * unit_filter_parse
+ * @param predicate the predicate expression
+ * @param filter the filter to append the predicates to
+ * @param partial ignore terms of the conjunction that are not unit attribute predicates
+ *
+ * Parse a conjunction of predicates on the unit attributes.
+ *
+ * @returns true if the predicate expression is a conjunction of supported predicates,
+ * or with partial, if it is a conjunction.
+ */
+bool unit_filter_parse(const std::string& predicate, unit_filter& filter, bool partial) {
+
+    std::vector<unit_predicate> predicates;
+    if (!parse_conjunction(predicate, predicates, partial))
+        return false;
+
+    filter.predicates.insert(filter.predicates.end(), predicates.begin(), predicates.end());
+    filter.expression = expression(filter.predicates);
+
+    return true;
+}
+
+/**
+ * unit_filter_from_xpath
+ * @param xpath the xpath expression
+ * @param filter the filter to append the predicates to
+ *
+ * Extract the predicates that a location path requires of a unit: the unit attribute
+ * predicates of a first step on the unit, e.g., /src:unit[@language='C++']//src:function,
+ * and the equality tests on names in the predicates of any step, e.g., //src:call[src:name='foo'].
+ * Any result of the xpath is in a unit that satisfies the filter.
+ *
+ * @returns true if there is a filter on the unit, false otherwise
+ */
+bool unit_filter_from_xpath(const std::string& xpath, unit_filter& filter) {
+
+    auto path = trim(xpath);
+
+    // the path must be only location steps, so that the predicates apply to the entire xpath
+    std::vector<unit_predicate> predicates;
+    size_t stepstart = 0;
+    int step = 0;
+    std::string stepname;
+    for (size_t i = 0; i < path.size(); ++i) {
+
+        if (path[i] == '/') {
+            if (i > 0 && path[i - 1] != '/')
+                ++step;
+            stepstart = i + 1;
+            stepname.clear();
+            continue;
+        }
+
+        if (path[i] == '[') {
+
+            auto end = matching_bracket(path, i);
+            if (end == std::string::npos)
+                return false;
+
+            if (stepname.empty()) {
+                stepname = path.substr(stepstart, i - stepstart);
+                auto axis = stepname.find("::");
+                if (axis != std::string::npos)
+                    stepname = stepname.substr(axis + 2);
+            }
+
+            auto predicate = path.substr(i + 1, end - i - 1);
+            if (step == 0 && path[0] == '/' && stepname == "src:unit") {
+                if (!parse_conjunction(predicate, predicates, true))
+                    predicates.clear();
+            } else {
+                parse_name_conjunction(predicate, stepname == "src:name", predicates);
+            }
+
+            i = end;
+            continue;
+        }
+
+        if (!(isalnum(path[i]) || strchr(":*@._-", path[i])))
+            return false;
+    }
+
+    if (predicates.empty())
+        return false;
+
+    filter.predicates.insert(filter.predicates.end(), predicates.begin(), predicates.end());
+    filter.expression = expression(filter.predicates);
+
+    return true;
+}
+
+// value of the attribute in the unit start tag, nullptr if not present
+// The value of a numeric attribute is formatted into buffer
+static const std::string* unit_attribute(const srcml_unit* unit, const std::string& attribute, std::string& buffer) {
+
+    const boost::optional<std::string>* value = nullptr;
+    if (attribute == "language")
+        value = &unit->language;
+    else if (attribute == "filename")
+        value = &unit->filename;
+    else if (attribute == "version")
+        value = &unit->version;
+    else if (attribute == "timestamp")
+        value = &unit->timestamp;
+    else if (attribute == "hash")
+        value = &unit->hash;
+    else if (attribute == "revision")
+        value = &unit->revision;
+    else if (attribute == "url")
+        value = &unit->url;
+
+    if (value)
+        return *value ? &**value : nullptr;
+
+    if (attribute == UNIT_ATTRIBUTE_LOC) {
+        if (unit->loc < 0)
+            return nullptr;
+
+        buffer = std::to_string(unit->loc);
+        return &buffer;
+    }
+
+    for (size_t i = 0; i + 1 < unit->attributes.size(); i += 2) {
+        if (unit->attributes[i] == attribute)
+            return &unit->attributes[i + 1];
+    }
+
+    return nullptr;
+}
+
+/**
+ * unit_filter_match
+ * @param unit a unit with at least the header read
+ * @param filter the unit filter
+ *
+ * Check the attributes of the unit against the filter, using XPath
+ * semantics for attributes that are not present.
+ *
+ * @returns true if the unit satisfies all predicates of the filter
+ */
+bool unit_filter_match(const srcml_unit* unit, const unit_filter& filter) {
+
+    static const std::string empty;
+
+    std::string buffer;
+    for (const auto& predicate : filter.predicates) {
+
+        auto value = unit_attribute(unit, predicate.attribute, buffer);
+        switch (predicate.op) {
+        case unit_predicate::EXISTS:
+            if (!value)
+                return false;
+            break;
+
+        case unit_predicate::EQUAL:
+            if (!value || *value != predicate.value)
+                return false;
+            break;
+
+        case unit_predicate::NOT_EQUAL:
+            if (!value || *value == predicate.value)
+                return false;
+            break;
+
+        case unit_predicate::STARTS_WITH:
+            if ((value ? *value : empty).compare(0, predicate.value.size(), predicate.value) != 0)
+                return false;
+            break;
+
+        case unit_predicate::CONTAINS:
+            if ((value ? *value : empty).find(predicate.value) == std::string::npos)
+                return false;
+            break;
+
+        // without a name filter, the unit may contain the name
+        case unit_predicate::NAME:
+            if (value && !name_filter_may_contain(*value, predicate.value))
+                return false;
+            break;
+        };
+    }
+
+    return true;
+}
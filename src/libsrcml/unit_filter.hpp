@@ -0,0 +1,62 @@
+/**
+ * @file unit_filter.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef INCLUDED_UNIT_FILTER_HPP
+#define INCLUDED_UNIT_FILTER_HPP
+
+#include <string>
+#include <vector>
+
+struct srcml_unit;
+
+// Predicate on an attribute of the unit start tag
+// A NAME predicate tests the name filter attribute for a name element with the value
+struct unit_predicate {
+    enum { EXISTS, EQUAL, NOT_EQUAL, STARTS_WITH, CONTAINS, NAME };
+
+    int op = EXISTS;
+    std::string attribute;
+    std::string value;
+};
+
+// Conjunction of predicates on the unit attributes
+struct unit_filter {
+    std::vector<unit_predicate> predicates;
+
+    // predicate expression of the filter
+    std::string expression;
+
+    bool empty() const { return predicates.empty(); }
+};
+
+// Parse a conjunction of unit attribute predicates, e.g., @language='C++' and starts-with(@filename, 'src/')
+// When partial, other terms of the conjunction are ignored instead of failing
+bool unit_filter_parse(const std::string& predicate, unit_filter& filter, bool partial = false);
+
+// Extract the unit attribute predicates that an xpath requires of a unit, e.g., /src:unit[@language='C++']//src:function,
+// and the names it requires, e.g., //src:call[src:name='foo']
+bool unit_filter_from_xpath(const std::string& xpath, unit_filter& filter);
+
+// Check the header of a unit against the filter
+bool unit_filter_match(const srcml_unit* unit, const unit_filter& filter);
+
+#endif
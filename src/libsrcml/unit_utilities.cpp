@@ -22,7 +22,53 @@
 
 #include <unit_utilities.hpp>
 #include <libxml/parserInternals.h>
+#include <libxml/encoding.h>
 #include <stack>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+
+// Update a unit attribute with its value
+static void unit_update_attribute(srcml_unit* unit, const std::string& attribute, const std::string& value) {
+
+    if (attribute == "timestamp")
+        srcml_unit_set_timestamp(unit, value.c_str());
+    else if (attribute == "hash")
+        srcml_unit_set_hash(unit, value.c_str());
+    else if (attribute == "language")
+        srcml_unit_set_language(unit, value.c_str());
+    else if (attribute == "revision")
+        unit->revision = value;
+    else if (attribute == "filename")
+        srcml_unit_set_filename(unit, value.c_str());
+    else if (attribute == "url")
+        unit->url = value;
+    else if (attribute == "version")
+        srcml_unit_set_version(unit, value.c_str());
+    else if (attribute == UNIT_ATTRIBUTE_LOC)
+        unit->loc = atoi(value.c_str());
+    else if (attribute == UNIT_ATTRIBUTE_REF)
+        unit->ref = atoi(value.c_str());
+    else if (attribute == "tabs" || attribute == "options" || attribute == "hash")
+        ;
+    else {
+        // if we already have the attribute, then just update the value
+        // otherwise create a new one
+        bool found = false;
+        for (size_t i = 0; i < unit->attributes.size(); i += 2) {
+            if (unit->attributes[i] == attribute) {
+                found = true;
+                unit->attributes[i + 1] = value;
+                break;
+            }
+        }
+        if (!found) {
+            unit->attributes.push_back(attribute);
+            unit->attributes.push_back(value);
+        }
+    }
+}
 
 // Update unit attributes with xml parsed attributes
 void unit_update_attributes(srcml_unit* unit, int num_attributes, const xmlChar** attributes) {
@@ -33,38 +79,27 @@ void unit_update_attributes(srcml_unit* unit, int num_attributes, const xmlChar*
         std::string attribute = (const char*) attributes[pos * 5];
         std::string value((const char *)attributes[pos * 5 + 3], attributes[pos * 5 + 4] - attributes[pos * 5 + 3]);
 
-        if (attribute == "timestamp")
-            srcml_unit_set_timestamp(unit, value.c_str());
-        else if (attribute == "hash")
-            srcml_unit_set_hash(unit, value.c_str());
-        else if (attribute == "language")
-            srcml_unit_set_language(unit, value.c_str());
-        else if (attribute == "revision")
-            unit->revision = value;
-        else if (attribute == "filename")
-            srcml_unit_set_filename(unit, value.c_str());
-        else if (attribute == "url")
-            unit->url = value;
-        else if (attribute == "version")
-            srcml_unit_set_version(unit, value.c_str());
-        else if (attribute == "tabs" || attribute == "options" || attribute == "hash")
-            ;
-        else {
-            // if we already have the attribute, then just update the value
-            // otherwise create a new one
-            bool found = false;
-            for (size_t i = 0; i < unit->attributes.size(); i += 2) {
-                if (unit->attributes[i] == attribute) {
-                    found = true;
-                    unit->attributes[i + 1] = value;
-                    break;
-                }
-            }
-            if (!found) {
-                unit->attributes.push_back(attribute);
-                unit->attributes.push_back(value);
-            }
+        unit_update_attribute(unit, attribute, value);
+    }
+}
+
+// Update unit attributes with the attributes of a DOM element
+void unit_update_attributes(srcml_unit* unit, const xmlAttr* attributes) {
+
+    for (const xmlAttr* attr = attributes; attr; attr = attr->next) {
+
+        // attribute values are usually a single text node
+        std::string value;
+        if (attr->children && !attr->children->next && attr->children->type == XML_TEXT_NODE) {
+            value = (const char*) attr->children->content;
+        } else {
+            xmlChar* content = xmlNodeListGetString(attr->doc, attr->children, 1);
+            if (content)
+                value = (const char*) content;
+            xmlFree(content);
         }
+
+        unit_update_attribute(unit, (const char*) attr->name, value);
     }
 }
 
@@ -206,3 +241,251 @@ std::string attribute_revision(const std::string& attribute, int revision) {
 
     return attribute.substr(pos + 1);
 }
+
+// Write a run of source text, converting each newline to the eol
+static void write_eol(xmlOutputBufferPtr output, const char* text, const char* end, size_t eol) {
+
+    if (text >= end)
+        return;
+
+    // only CR and CRLF change the newline
+    if (eol != SOURCE_OUTPUT_EOL_CR && eol != SOURCE_OUTPUT_EOL_CRLF) {
+        xmlOutputBufferWrite(output, (int) (end - text), text);
+        return;
+    }
+
+    int eolsize = eol == SOURCE_OUTPUT_EOL_CR ? 1 : 2;
+    const char* p = text;
+    while ((p = (const char*) memchr(p, '\n', end - p))) {
+
+        xmlOutputBufferWrite(output, (int) (p - text), text);
+        xmlOutputBufferWrite(output, eolsize, "\r\n");
+
+        text = ++p;
+    }
+    xmlOutputBufferWrite(output, (int) (end - text), text);
+}
+
+// Decode the entity reference between '&' and ';' into UTF-8
+// Returns the number of bytes, or 0 for an unknown entity
+static int decode_entity(const char* name, const char* end, char* value) {
+
+    auto len = end - name;
+    if (len == 2 && memcmp(name, "lt", 2) == 0) {
+        value[0] = '<';
+        return 1;
+    }
+    if (len == 2 && memcmp(name, "gt", 2) == 0) {
+        value[0] = '>';
+        return 1;
+    }
+    if (len == 3 && memcmp(name, "amp", 3) == 0) {
+        value[0] = '&';
+        return 1;
+    }
+    if (len == 4 && memcmp(name, "quot", 4) == 0) {
+        value[0] = '"';
+        return 1;
+    }
+    if (len == 4 && memcmp(name, "apos", 4) == 0) {
+        value[0] = '\'';
+        return 1;
+    }
+
+    // character reference, decimal or hex
+    if (len < 2 || name[0] != '#' || (name[1] == 'x' && len < 3))
+        return 0;
+
+    char* numend = nullptr;
+    unsigned long c = name[1] == 'x' ? strtoul(name + 2, &numend, 16) : strtoul(name + 1, &numend, 10);
+    if (numend != end)
+        return 0;
+
+    if (c < 0x80) {
+        value[0] = (char) c;
+        return 1;
+    }
+    if (c < 0x800) {
+        value[0] = (char) (0xC0 | (c >> 6));
+        value[1] = (char) (0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        value[0] = (char) (0xE0 | (c >> 12));
+        value[1] = (char) (0x80 | ((c >> 6) & 0x3F));
+        value[2] = (char) (0x80 | (c & 0x3F));
+        return 3;
+    }
+    if (c < 0x110000) {
+        value[0] = (char) (0xF0 | (c >> 18));
+        value[1] = (char) (0x80 | ((c >> 12) & 0x3F));
+        value[2] = (char) (0x80 | ((c >> 6) & 0x3F));
+        value[3] = (char) (0x80 | (c & 0x3F));
+        return 4;
+    }
+
+    return 0;
+}
+
+// Find the end of the tag, skipping over quoted attribute values
+static const char* tag_end(const char* p, const char* end) {
+
+    for (; p < end; ++p) {
+
+        if (*p == '>')
+            return p;
+
+        if (*p == '"' || *p == '\'') {
+            p = (const char*) memchr(p + 1, *p, end - p - 1);
+            if (!p)
+                return nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+// Write any source in the markup starting at p, i.e., escaped characters and CDATA
+// Returns the position after the markup
+static const char* unparse_markup(xmlOutputBufferPtr output, const char* p, const char* end, size_t eol) {
+
+    auto starts = [p, end](const char* s) { return (size_t) (end - p) >= strlen(s) && memcmp(p, s, strlen(s)) == 0; };
+    auto find = [end](const char* from, const char* s) { return std::search(from, end, s, s + strlen(s)); };
+
+    // comments and processing instructions have no source
+    if (starts("<!--")) {
+        auto close = find(p + 4, "-->");
+        return close == end ? end : close + 3;
+    }
+    if (starts("<?")) {
+        auto close = find(p + 2, "?>");
+        return close == end ? end : close + 2;
+    }
+
+    // CDATA is character data, without entities
+    if (starts("<![CDATA[")) {
+        auto close = find(p + 9, "]]>");
+        write_eol(output, p + 9, close, eol);
+        return close == end ? end : close + 3;
+    }
+
+    auto gt = tag_end(p + 1, end);
+    if (!gt)
+        return end;
+
+    // special element <escape char="0x0c"/> used to embed non-XML characters
+    auto name = p + 1;
+    auto nameend = name;
+    while (nameend < gt && *nameend != '/' && !isspace((unsigned char) *nameend))
+        ++nameend;
+    auto colon = (const char*) memchr(name, ':', nameend - name);
+    auto localname = colon ? colon + 1 : name;
+    if (nameend - localname == 6 && memcmp(localname, "escape", 6) == 0) {
+
+        const char* CHAR_ATTRIBUTE = "char=";
+        auto attribute = std::search(nameend, gt, CHAR_ATTRIBUTE, CHAR_ATTRIBUTE + strlen(CHAR_ATTRIBUTE));
+        if (attribute != gt) {
+            char value = (char) strtol(attribute + strlen(CHAR_ATTRIBUTE) + 1, NULL, 0);
+            xmlOutputBufferWrite(output, 1, &value);
+        }
+    }
+
+    return gt + 1;
+}
+
+// Write source code to the output, converting eol
+void unparse_src(xmlOutputBufferPtr output, const char* src, size_t size, size_t eol) {
+
+    write_eol(output, src, src + size, eol);
+}
+
+// Write source code of the srcml content to the output in a single pass, converting eol
+// Tags are stripped and entities decoded, without parsing or an intermediate string
+void unparse_srcml(xmlOutputBufferPtr output, const char* srcml, size_t size, size_t eol) {
+
+    const char* end = srcml + size;
+    const char* p = srcml;
+
+    // next start of markup and of an entity reference
+    auto lt = (const char*) memchr(p, '<', size);
+    auto amp = (const char*) memchr(p, '&', size);
+
+    while (lt || amp) {
+
+        if (amp && (!lt || amp < lt)) {
+
+            write_eol(output, p, amp, eol);
+
+            // decoded value may be a newline, e.g., &#10;
+            char value[4];
+            auto semicolon = (const char*) memchr(amp, ';', end - amp);
+            int len = semicolon ? decode_entity(amp + 1, semicolon, value) : 0;
+            if (len) {
+                write_eol(output, value, value + len, eol);
+                p = semicolon + 1;
+            } else {
+                xmlOutputBufferWrite(output, 1, "&");
+                p = amp + 1;
+            }
+
+            amp = (const char*) memchr(p, '&', end - p);
+            continue;
+        }
+
+        write_eol(output, p, lt, eol);
+
+        p = unparse_markup(output, lt, end, eol);
+
+        lt = (const char*) memchr(p, '<', end - p);
+        if (amp && amp < p)
+            amp = (const char*) memchr(p, '&', end - p);
+    }
+
+    write_eol(output, p, end, eol);
+}
+
+// Check if the UTF-8 content is unchanged when converted to the encoding
+// so that the output can skip the encoding conversion
+bool unparse_passthrough(const char* encoding, const char* content, size_t size, bool markup) {
+
+    auto charencoding = xmlParseCharEncoding(encoding);
+    if (charencoding == XML_CHAR_ENCODING_UTF8)
+        return true;
+
+    // encodings where ASCII is unchanged
+    if (charencoding != XML_CHAR_ENCODING_ASCII
+        && (charencoding < XML_CHAR_ENCODING_8859_1 || charencoding > XML_CHAR_ENCODING_8859_9))
+        return false;
+
+    // check a word at a time for any non-ASCII byte
+    const char* end = content + size;
+    const char* p = content;
+    for (; end - p >= (long) sizeof(uint64_t); p += sizeof(uint64_t)) {
+
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        if (word & 0x8080808080808080ULL)
+            return false;
+    }
+    for (; p < end; ++p) {
+        if (*p & 0x80)
+            return false;
+    }
+
+    // character references are decoded, so may not be ASCII
+    if (markup) {
+
+        p = content;
+        while ((p = (const char*) memchr(p, '&', end - p))) {
+
+            ++p;
+            if (p < end && *p == '#') {
+                unsigned long c = (p + 1 < end && p[1] == 'x') ? strtoul(p + 2, NULL, 16) : strtoul(p + 1, NULL, 10);
+                if (c >= 0x80)
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
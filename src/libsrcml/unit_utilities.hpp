@@ -26,13 +26,27 @@
 #include <srcml_types.hpp>
 #include <srcml.h>
 #include <libxml/parser.h>
+#include <libxml/xmlIO.h>
+#include <libxml/tree.h>
 
 // Update unit attributes with xml parsed attributes
 void unit_update_attributes(srcml_unit* unit, int num_attributes, const xmlChar** attributes);
 
+// Update unit attributes with the attributes of a DOM element
+void unit_update_attributes(srcml_unit* unit, const xmlAttr* attributes);
+
 // Extract source code from srcml
 std::string extract_src(const std::string& srcml, boost::optional<int> revision = boost::none);
 std::string extract_revision(const char* srcml, int size, int revision, bool text_only = false);
 std::string attribute_revision(const std::string& attribute, int revision);
 
+// Write source code to the output, converting eol
+void unparse_src(xmlOutputBufferPtr output, const char* src, size_t size, size_t eol);
+
+// Write source code of the srcml content to the output in a single pass, converting eol
+void unparse_srcml(xmlOutputBufferPtr output, const char* srcml, size_t size, size_t eol);
+
+// Check if the UTF-8 content is unchanged when converted to the encoding
+bool unparse_passthrough(const char* encoding, const char* content, size_t size, bool markup);
+
 #endif
@@ -23,6 +23,7 @@
 #include <libxml/parser.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/parserInternals.h>
 
 #ifdef WITH_LIBXSLT
 #include <libexslt/exslt.h>
@@ -40,9 +41,19 @@
 #include <srcml_sax2_utilities.hpp>
 #include <libxml2_utilities.hpp>
 #include <memory>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <atomic>
 
 const char* const xpathTransformation::simple_xpath_attribute_name = "location";
 
+namespace {
+
+    // identifier of the next transformation, for the contexts of the threads
+    std::atomic<unsigned long long> next_transformation_id(1);
+}
+
 #define stringOrNull(m) (m ? m : "")
 
 /**
@@ -63,7 +74,7 @@ const char* const xpathTransformation::simple_xpath_attribute_name = "location";
 xpathTransformation::xpathTransformation(srcml_archive* oarchive, const char* xpath,
                         const char* element_prefix, const char* element_uri, const char* element,
                         const char* attr_prefix, const char* attr_uri, const char* attr_name, const char* attr_value)
-    : xpath(xpath), prefix(stringOrNull(element_prefix)), uri(stringOrNull(element_uri)), element(stringOrNull(element)), attr_prefix(stringOrNull(attr_prefix)), attr_uri(stringOrNull(attr_uri)), attr_name(stringOrNull(attr_name)), attr_value(stringOrNull(attr_value)) {
+    : id(next_transformation_id++), xpath(xpath), prefix(stringOrNull(element_prefix)), uri(stringOrNull(element_uri)), element(stringOrNull(element)), attr_prefix(stringOrNull(attr_prefix)), attr_uri(stringOrNull(attr_uri)), attr_name(stringOrNull(attr_name)), attr_value(stringOrNull(attr_value)) {
 
     // compile the xpath expression
     // errors will show up when it is first used
@@ -79,6 +90,14 @@ xpathTransformation::xpathTransformation(srcml_archive* oarchive, const char* xp
         element_ns = xmlNewNs(NULL, (const xmlChar*) uri.c_str(), (const xmlChar*) prefix.c_str());
     }
 
+    // compile a pattern for streaming when the xpath allows it
+    compilePattern(oarchive);
+
+    // plan the unit attribute predicates so units can be filtered on their header
+    // marking results outputs every unit, even without results
+    if (!modifies_document())
+        unit_filter_from_xpath(this->xpath, unitfilter);
+
     // load DLL exslt functions
 #if LIBEXSLT_VERSION > 813
 #ifdef DLLOAD
@@ -93,6 +112,10 @@ xpathTransformation::~xpathTransformation() {
     // free the compiled xpath
     xmlXPathFreeCompExpr(compiled_xpath);
 
+    // free the streaming pattern
+    if (pattern)
+        xmlFreePattern(pattern);
+
     // free the namespace for any added attributes
     if (attr_ns)
         xmlFreeNs(attr_ns);
@@ -248,21 +271,14 @@ xmlXPathContextPtr xpathTransformation::createContext(xmlDocPtr doc) const {
 #pragma GCC diagnostic push
 
 /**
- * apply
- *
- * Apply XPath expression, writing results.
+ * register_standard_namespaces
+ * @param context an xpath context
  *
- * @returns true on success false on failure.
+ * Register the standard prefixes for the standard namespaces, with src for
+ * the srcML namespace.
  */
-TransformationResult xpathTransformation::apply(xmlDocPtr doc, int position) const {
-
-    std::unique_ptr<xmlXPathContext> context(createContext(doc));
-    if (!context) {
-        fprintf(stderr, "%s: Error in executing xpath\n", "libsrcml");
-        return TransformationResult();
-    }
+static void register_standard_namespaces(xmlXPathContextPtr context) {
 
-    // register standard prefixes for standard namespaces
     for (const auto& ns : default_namespaces) {
 
         const char* uri = ns.uri.c_str();
@@ -270,19 +286,343 @@ TransformationResult xpathTransformation::apply(xmlDocPtr doc, int position) con
         if (ns.uri == SRCML_SRC_NS_URI)
             prefix = "src";
 
-        if (xmlXPathRegisterNs(context.get(), BAD_CAST prefix, BAD_CAST uri) == -1) {
+        if (xmlXPathRegisterNs(context, BAD_CAST prefix, BAD_CAST uri) == -1) {
             fprintf(stderr, "%s: Unable to register prefix '%s' for namespace %s\n", "libsrcml", prefix, uri);
         }
     }
+}
+
+/**
+ * threadContext
+ * @param doc the doc to evaluate on
+ * @param namespaces the prefixes and uris of the doc
+ *
+ * The xpath context of the calling thread, created and registered with
+ * the standard namespaces on first use. Only the doc, and the namespaces of
+ * the doc when they differ from the previous doc, are updated on each call.
+ * The contexts are thread local, so they are freed when the thread ends.
+ *
+ * @returns the xpath context on success, NULL on failure.
+ */
+xmlXPathContextPtr xpathTransformation::threadContext(xmlDocPtr doc, const std::vector<std::pair<const xmlChar*, const xmlChar*>>& namespaces) const {
+
+    static thread_local std::unordered_map<const xpathTransformation*, ThreadContext> thread_contexts;
+
+    // a context of an earlier transformation at the same address is replaced
+    ThreadContext* cached = &thread_contexts[this];
+    if (cached->owner != id) {
+        *cached = ThreadContext();
+        cached->owner = id;
+    }
+
+    if (!cached->context) {
+
+        cached->context.reset(createContext(doc));
+        if (!cached->context)
+            return nullptr;
+
+        register_standard_namespaces(cached->context.get());
+    }
+    auto context = cached->context.get();
+
+    // register prefixes of the doc only when they change
+    if (namespaces.size() != cached->namespaces.size() || !std::equal(namespaces.begin(), namespaces.end(), cached->namespaces.begin(),
+        [](const std::pair<const xmlChar*, const xmlChar*>& ns, const std::pair<std::string, std::string>& cachedns) {
+            return cachedns.first == (const char*) ns.first && cachedns.second == (const char*) ns.second;
+        })) {
+
+        // prefixes of the previous doc go back to the standard namespaces
+        if (!cached->namespaces.empty()) {
+            for (const auto& ns : cached->namespaces)
+                xmlXPathRegisterNs(context, BAD_CAST ns.first.c_str(), nullptr);
+
+            register_standard_namespaces(context);
+        }
+
+        cached->namespaces.clear();
+        for (const auto& ns : namespaces) {
+
+            xmlXPathRegisterNs(context, ns.first, ns.second);
+            cached->namespaces.emplace_back((const char*) ns.first, (const char*) ns.second);
+        }
+    }
+
+    // rebind to the doc
+    context->doc = doc;
+    context->node = nullptr;
+    context->contextSize = -1;
+    context->proximityPosition = -1;
+
+    return context;
+}
+
+/**
+ * compilePattern
+ * @param oarchive the archive the transformation is applied to
+ *
+ * Compile a pattern of the xpath for streaming evaluation. The pattern is
+ * only created for a single absolute path of elements, without predicates,
+ * that cannot match a unit. Any other xpath, including a union, uses the doc.
+ */
+void xpathTransformation::compilePattern(srcml_archive* oarchive) {
+
+    // marking results requires the doc
+    if (modifies_document())
+        return;
+
+    // trim the xpath
+    auto begin = xpath.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return;
+    auto end = xpath.find_last_not_of(" \t\r\n");
+    std::string path = xpath.substr(begin, end - begin + 1);
+
+    // path of elements only, since an alternative of a union may be relative or match a unit,
+    // and a predicate is evaluated on the element in the doc
+    if (path.empty() || path.find_first_of("@()[]$|") != std::string::npos)
+        return;
+
+    // unit results are unit-wrapped, which requires the doc
+    auto step = path.substr(path.find_last_of('/') + 1);
+    auto local = step.substr(step.find(':') + 1);
+    if (local == "unit" || local == "*")
+        return;
+
+    // namespaces of the archive are used before the standard prefixes
+    std::vector<const xmlChar*> namespaces;
+    if (oarchive) {
+        for (const auto& ns : oarchive->namespaces) {
+            if (ns.prefix.empty())
+                continue;
+
+            namespaces.push_back(BAD_CAST ns.uri.c_str());
+            namespaces.push_back(BAD_CAST ns.prefix.c_str());
+        }
+    }
+    for (const auto& ns : default_namespaces) {
+
+        namespaces.push_back(BAD_CAST ns.uri.c_str());
+        namespaces.push_back(BAD_CAST (ns.uri == SRCML_SRC_NS_URI ? "src" : ns.prefix.c_str()));
+    }
+    namespaces.push_back(nullptr);
+    namespaces.push_back(nullptr);
+
+    // unknown prefixes, and non-element steps, do not compile
+    pattern = xmlPatterncompile(BAD_CAST path.c_str(), nullptr, 0, namespaces.data());
+    if (pattern == nullptr)
+        return;
+
+    if (xmlPatternStreamable(pattern) != 1 || xmlPatternFromRoot(pattern) != 1) {
+        xmlFreePattern(pattern);
+        pattern = nullptr;
+    }
+}
+
+/**
+ * modifies_document
+ *
+ * The results are marked in the doc with an element or attribute.
+ *
+ * @returns true if the doc is changed, false otherwise.
+ */
+bool xpathTransformation::modifies_document() const {
+
+    return !element.empty() || !attr_name.empty();
+}
+
+/**
+ * streamable
+ *
+ * The XPath is a single absolute path of elements, without predicates.
+ *
+ * @returns true if apply_stream() can be used, false otherwise.
+ */
+bool xpathTransformation::streamable() const {
+
+    return pattern != nullptr;
+}
+
+/**
+ * filter
+ *
+ * Predicates on the unit attributes from a leading predicate on the unit,
+ * e.g., /src:unit[@language='C++']//src:function
+ *
+ * @returns the unit filter, or nullptr if there is none.
+ */
+const unit_filter* xpathTransformation::filter() const {
+
+    return unitfilter.empty() ? nullptr : &unitfilter;
+}
+
+/**
+ * apply_stream
+ * @param srcml the srcML of the unit
+ * @param namespaces the namespaces of the unit
+ * @param results the begin and end offsets of each result in the srcML
+ *
+ * Apply XPath expression to the srcML of a unit using a streaming parse.
+ *
+ * @returns true on success, false on failure.
+ */
+bool xpathTransformation::apply_stream(const std::string& srcml, const Namespaces& namespaces,
+                                       std::vector<std::pair<int, int>>& results) const {
+
+    std::vector<std::vector<std::pair<int, int>>> allresults(1);
+    if (!apply_streams({ this }, srcml, namespaces, allresults))
+        return false;
+
+    results = std::move(allresults.front());
+
+    return true;
+}
+
+/**
+ * apply_streams
+ * @param transformations the streamable xpath transformations
+ * @param srcml the srcML of the unit
+ * @param namespaces the namespaces of the unit
+ * @param results the begin and end offsets of each result in the srcML, for each transformation
+ *
+ * Apply the XPath expressions to the srcML of a unit in a single streaming parse.
+ * Elements are matched by the patterns as their start tags are parsed, and
+ * recorded when their end tags are parsed.
+ *
+ * @returns true on success, false on failure.
+ */
+bool xpathTransformation::apply_streams(const std::vector<const xpathTransformation*>& transformations, const std::string& srcml,
+                                        const Namespaces& /* namespaces */, std::vector<std::vector<std::pair<int, int>>>& results) {
+
+    // state of the streaming parse, with the starts of each open element for each pattern
+    struct StreamState {
+        std::vector<xmlStreamCtxtPtr> streams;
+        const char* srcml;
+        std::vector<int> starts;
+        std::vector<std::vector<std::pair<int, int>>>* results;
+    } state = { {}, srcml.c_str(), {}, &results };
+
+    results.assign(transformations.size(), {});
+
+    auto free_streams = [&state]() {
+        for (auto stream : state.streams)
+            xmlFreeStreamCtxt(stream);
+    };
+
+    for (const auto transformation : transformations) {
+
+        auto stream = xmlPatternGetStreamCtxt(transformation->pattern);
+        if (stream == nullptr) {
+            free_streams();
+            return false;
+        }
+        state.streams.push_back(stream);
+
+        // the document node, so that absolute paths match from it
+        xmlStreamPush(stream, nullptr, nullptr);
+    }
+
+    xmlSAXHandler streamsax;
+    memset(&streamsax, 0, sizeof(streamsax));
+    streamsax.initialized    = XML_SAX2_MAGIC;
+    streamsax.startElementNs = [](void* ctx, const xmlChar* localname, const xmlChar* /* prefix */, const xmlChar* URI,
+                     int /* nb_namespaces */, const xmlChar** /* namespaces */,
+                     int /* nb_attributes */, int /* nb_defaulted */, const xmlChar** /* attributes */) {
+
+        auto ctxt = (xmlParserCtxtPtr) ctx;
+        auto state = (StreamState*) ctxt->_private;
+
+        // start of a matched element is the start of its tag
+        int tagstart = -1;
+        for (auto stream : state->streams) {
+
+            int start = -1;
+            if (xmlStreamPush(stream, localname, URI) == 1) {
+                if (tagstart == -1) {
+                    const char* tag = state->srcml + xmlByteConsumed(ctxt);
+                    while (*tag != '<')
+                        --tag;
+                    tagstart = (int) (tag - state->srcml);
+                }
+                start = tagstart;
+            }
+            state->starts.push_back(start);
+        }
+    };
+    streamsax.endElementNs = [](void* ctx, const xmlChar* /* localname */, const xmlChar* /* prefix */, const xmlChar* /* URI */) {
+
+        auto ctxt = (xmlParserCtxtPtr) ctx;
+        auto state = (StreamState*) ctxt->_private;
+
+        // end of a matched element is the end of its end tag
+        auto starts = state->starts.end() - state->streams.size();
+        for (std::size_t i = 0; i < state->streams.size(); ++i) {
+
+            xmlStreamPop(state->streams[i]);
+            if (starts[i] != -1)
+                (*state->results)[i].emplace_back(starts[i], (int) xmlByteConsumed(ctxt));
+        }
+        state->starts.erase(starts, state->starts.end());
+    };
+
+    xmlParserCtxtPtr context = xmlCreateMemoryParserCtxt(srcml.c_str(), (int) srcml.size());
+    if (context == nullptr) {
+        free_streams();
+        return false;
+    }
+    auto save_private = context->_private;
+    context->_private = &state;
+    auto save_sax = context->sax;
+    context->sax = &streamsax;
+
+    xmlParseDocument(context);
+    bool wellformed = context->wellFormed;
+
+    // restore state and free
+    context->_private = save_private;
+    context->sax = save_sax;
+    xmlFreeParserCtxt(context);
+    free_streams();
+
+    if (!wellformed)
+        return false;
+
+    // results are recorded in the order of their end tags
+    for (auto& transformation_results : results)
+        std::stable_sort(transformation_results.begin(), transformation_results.end());
+
+    return true;
+}
 
-    // register prefixes from the doc
+/**
+ * apply
+ *
+ * Apply XPath expression, writing results.
+ *
+ * @returns true on success false on failure.
+ */
+TransformationResult xpathTransformation::apply(xmlDocPtr doc, int position) const {
+
+    // prefixes from the doc
+    std::vector<std::pair<const xmlChar*, const xmlChar*>> namespaces;
     for (auto p = doc->children->nsDef; p; p = p->next) {
 
-        xmlXPathRegisterNs(context.get(), p->prefix, p->href);
+        if (p->prefix)
+            namespaces.emplace_back(p->prefix, p->href);
+    }
+
+    auto context = threadContext(doc, namespaces);
+    if (!context) {
+        fprintf(stderr, "%s: Error in executing xpath\n", "libsrcml");
+        return TransformationResult();
     }
 
     // evaluate the xpath
-    std::unique_ptr<xmlXPathObject> result_nodes(xmlXPathCompiledEval(compiled_xpath, context.get()));
+    std::unique_ptr<xmlXPathObject> result_nodes(xmlXPathCompiledEval(compiled_xpath, context));
+
+    // the context is reused for later docs, so it does not keep this one
+    context->doc = nullptr;
+    context->node = nullptr;
+
     if (!result_nodes) {
         fprintf(stderr, "%s: Error in executing xpath\n", "libsrcml");
         return TransformationResult();
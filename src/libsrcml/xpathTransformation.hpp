@@ -30,6 +30,7 @@
 #endif
 
 #include <libxml/parser.h>
+#include <libxml/pattern.h>
 
 #include <srcmlns.hpp>
 
@@ -40,6 +41,8 @@
 #include <Transformation.hpp>
 #include <srcml_translator.hpp>
 
+#include <unordered_map>
+
 /**
  * srcml_xpath
  * @param input_buffer a parser input buffer
@@ -137,6 +140,61 @@ public :
      */
     virtual TransformationResult apply(xmlDocPtr doc, int position) const;
 
+    /**
+     * modifies_document
+     *
+     * The results are marked in the doc with an element or attribute.
+     *
+     * @returns true if the doc is changed, false otherwise.
+     */
+    virtual bool modifies_document() const;
+
+    /**
+     * streamable
+     *
+     * The XPath is a single absolute path of elements, without predicates.
+     *
+     * @returns true if apply_stream() can be used, false otherwise.
+     */
+    virtual bool streamable() const;
+
+    /**
+     * apply_stream
+     * @param srcml the srcML of the unit
+     * @param namespaces the namespaces of the unit
+     * @param results the begin and end offsets of each result in the srcML
+     *
+     * Apply XPath expression to the srcML of a unit using a streaming parse.
+     *
+     * @returns true on success, false on failure.
+     */
+    virtual bool apply_stream(const std::string& srcml, const Namespaces& namespaces,
+                              std::vector<std::pair<int, int>>& results) const;
+
+    /**
+     * apply_streams
+     * @param transformations the streamable xpath transformations
+     * @param srcml the srcML of the unit
+     * @param namespaces the namespaces of the unit
+     * @param results the begin and end offsets of each result in the srcML, for each transformation
+     *
+     * Apply the XPath expressions to the srcML of a unit in a single streaming parse.
+     *
+     * @returns true on success, false on failure.
+     */
+    static bool apply_streams(const std::vector<const xpathTransformation*>& transformations, const std::string& srcml,
+                              const Namespaces& namespaces, std::vector<std::vector<std::pair<int, int>>>& results);
+
+    /**
+     * filter
+     *
+     * Predicates on the unit attributes from a leading predicate on the unit,
+     * e.g., /src:unit[@language='C++']//src:function
+     *
+     * @returns the unit filter, or nullptr if there is none.
+     */
+    virtual const unit_filter* filter() const;
+
     void addElementXPathResults(xmlDocPtr doc, xmlXPathObjectPtr result_nodes) const;
 
     // element namespace
@@ -146,6 +204,9 @@ public :
     xmlNsPtr attr_ns = nullptr;
 
 public:
+    // identifier of the transformation, since a later one may have the same address
+    const unsigned long long id;
+
     std::string xpath;
     std::string prefix;
     std::string uri;
@@ -156,14 +217,28 @@ public:
     std::string attr_value;
     xmlXPathCompExprPtr compiled_xpath = nullptr;
 
+    // pattern of the xpath for streaming, if streamable
+    xmlPatternPtr pattern = nullptr;
+
+    // predicates on the unit attributes required by the xpath
+    unit_filter unitfilter;
+
     static const char* const simple_xpath_attribute_name;
 
 private:
     xmlXPathContextPtr createContext(xmlDocPtr doc) const;
+    xmlXPathContextPtr threadContext(xmlDocPtr doc, const std::vector<std::pair<const xmlChar*, const xmlChar*>>& namespaces) const;
+    void compilePattern(srcml_archive* oarchive);
 #ifdef DLLOAD
     void* handle = nullptr;
 #endif
 
+    // context of a thread for a transformation, with the namespaces registered for the last doc
+    struct ThreadContext {
+        unsigned long long owner = 0;
+        std::unique_ptr<xmlXPathContext> context;
+        std::vector<std::pair<std::string, std::string>> namespaces;
+    };
 };
 
 #endif
@@ -24,6 +24,8 @@
 #define SHA1_UTILITIES_HPP
 
 #include <type_traits>
+#include <string>
+#include <cstddef>
 
 #ifdef _MSC_BUILD
 #include <windows.h>
@@ -70,4 +72,78 @@ static constexpr char hexchar[] = { '0','1','2','3','4','5','6','7','8','9','a',
             hexchar[md[19] >> 4], hexchar[md[19] & 0x0F]
 static_assert(sizeof(hexchar) == 16, "Wrong size for hex conversion");
 
+/**
+ * sha1_hash
+ *
+ * SHA-1 of data added in parts, in hex, the same as the hash attribute of a unit
+ */
+class sha1_hash {
+public:
+    sha1_hash() {
+#ifdef _MSC_BUILD
+        BOOL success = CryptAcquireContext(&crypt_provider, NULL, NULL, PROV_RSA_FULL, 0);
+        if (!success && GetLastError() == NTE_BAD_KEYSET)
+            success = CryptAcquireContext(&crypt_provider, NULL, NULL, PROV_RSA_FULL, CRYPT_NEWKEYSET);
+        CryptCreateHash(crypt_provider, CALG_SHA1, 0, 0, &crypt_hash);
+#else
+        SHA1_Init(&ctx);
+#endif
+    }
+
+    sha1_hash(const sha1_hash&) = delete;
+    sha1_hash& operator=(const sha1_hash&) = delete;
+
+    ~sha1_hash() {
+#ifdef _MSC_BUILD
+        CryptDestroyHash(crypt_hash);
+        CryptReleaseContext(crypt_provider, 0);
+#endif
+    }
+
+    void update(const char* data, size_t size) {
+#ifdef _MSC_BUILD
+        CryptHashData(crypt_hash, (BYTE*) data, (DWORD) size, 0);
+#else
+        SHA1_Update(&ctx, data, (SHA_LONG) size);
+#endif
+    }
+
+    std::string hex() {
+
+        unsigned char md[20];
+#ifdef _MSC_BUILD
+        DWORD SHA_DIGEST_LENGTH = sizeof(md);
+        CryptGetHashParam(crypt_hash, HP_HASHVAL, (BYTE*) md, &SHA_DIGEST_LENGTH, 0);
+#else
+        SHA1_Final(md, &ctx);
+#endif
+        const char outmd[] = { HEXCHARASCII(md), '\0' };
+
+        return outmd;
+    }
+
+private:
+#ifdef _MSC_BUILD
+    HCRYPTPROV crypt_provider;
+    HCRYPTHASH crypt_hash;
+#else
+    SHA_CTX ctx;
+#endif
+};
+
+/**
+ * sha1_hex
+ * @param data the data
+ * @param size the size of the data
+ *
+ * @returns the SHA-1 of the data in hex, the same as the hash attribute of a unit
+ */
+inline std::string sha1_hex(const char* data, size_t size) {
+
+    sha1_hash hash;
+    hash.update(data, size);
+
+    return hash.hex();
+}
+
 #endif
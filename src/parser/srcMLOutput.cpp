@@ -89,7 +89,63 @@ srcMLOutput::srcMLOutput(TokenStream* ints,
       tabsize(ts)
 {
     // open the output text writer stream
-    xout = xmlNewTextWriter(output_buffer);
+    if (output_buffer)
+        xout = xmlNewTextWriter(output_buffer);
+}
+
+/**
+ * createDocument
+ *
+ * Create a document for building srcml as a DOM. Element and attribute names
+ * are interned in a dictionary shared by all documents. The shared dictionary is
+ * never changed after it is created, so documents can be built and freed on any thread.
+ *
+ * @returns the new document
+ */
+xmlDocPtr srcMLOutput::createDocument() {
+
+    // all element and attribute names of srcml
+    static xmlDictPtr names = []() {
+
+        xmlDictPtr dict = xmlDictCreate();
+
+        for (const auto& entry : process) {
+            for (const char* name : { entry.second.name, entry.second.attr_name, entry.second.attr2_name }) {
+                if (name && name[0] != '\0')
+                    xmlDictLookup(dict, BAD_CAST name, -1);
+            }
+        }
+
+        for (const char* name : { "unit", "macro-list", "token", "type", "start", "end", "tabs",
+                                  UNIT_ATTRIBUTE_REVISION, UNIT_ATTRIBUTE_LANGUAGE, UNIT_ATTRIBUTE_URL,
+                                  UNIT_ATTRIBUTE_FILENAME, UNIT_ATTRIBUTE_VERSION, UNIT_ATTRIBUTE_TIMESTAMP,
+                                  UNIT_ATTRIBUTE_HASH, UNIT_ATTRIBUTE_SOURCE_ENCODING, UNIT_ATTRIBUTE_OPTIONS }) {
+            xmlDictLookup(dict, BAD_CAST name, -1);
+        }
+
+        return dict;
+    }();
+
+    xmlDocPtr doc = xmlNewDoc(BAD_CAST XML_VERSION);
+    if (!doc)
+        return nullptr;
+
+    // any other names are interned in a dictionary for just this document
+    doc->dict = xmlDictCreateSub(names);
+
+    return doc;
+}
+
+/**
+ * setDocument
+ * @param doc document to build the srcml in
+ *
+ * Build the srcml as a DOM in the document instead of writing it.
+ */
+void srcMLOutput::setDocument(xmlDocPtr doc) {
+
+    this->doc = doc;
+    node = nullptr;
 }
 
 /**
@@ -245,6 +301,17 @@ void srcMLOutput::outputProcessingInstruction() {
  */
 void srcMLOutput::outputNamespaces(xmlTextWriterPtr xout, const OPTION_TYPE& options, int depth) {
 
+    // in a DOM, namespaces are declared on the element
+    auto writeNamespace = [this, xout](const Namespace& ns) {
+
+        if (!doc) {
+            srcMLTextWriterWriteNamespace(xout, ns);
+            return;
+        }
+
+        xmlNewNs(node, BAD_CAST ns.uri.c_str(), ns.prefix.empty() ? 0 : BAD_CAST ns.prefix.c_str());
+    };
+
     // based on options, turn on specific namespaces (i.e., mark as used)
     auto& view = namespaces.get<nstags::uri>();
 
@@ -265,13 +332,13 @@ void srcMLOutput::outputNamespaces(xmlTextWriterPtr xout, const OPTION_TYPE& opt
 
             // must be required, or on the root and used
             if ((ns.flags & NS_STANDARD) && ((ns.flags & NS_REQUIRED) || ((ns.flags & NS_ROOT) && (ns.flags & NS_USED)))) {
-                srcMLTextWriterWriteNamespace(xout, ns);
+                writeNamespace(ns);
                 continue;
             }
 
             // must be user registered
             if (ns.flags & NS_REGISTERED && !(ns.flags & NS_STANDARD)) {
-                srcMLTextWriterWriteNamespace(xout, ns);
+                writeNamespace(ns);
                 continue;
             }
         }
@@ -281,7 +348,7 @@ void srcMLOutput::outputNamespaces(xmlTextWriterPtr xout, const OPTION_TYPE& opt
 
             // must be required, must not be on the root, and must be used
             if ((ns.flags & NS_STANDARD) && !(ns.flags & NS_ROOT) && !(ns.flags & NS_REQUIRED) && (ns.flags & NS_USED)) {
-                srcMLTextWriterWriteNamespace(xout, ns);
+                writeNamespace(ns);
                 continue;
             }
         }
@@ -319,7 +386,7 @@ void srcMLOutput::startUnit(const char* language, const char* revision,
 
     // start of main tag
     std::string unitprefix = namespaces[SRC].getPrefix();
-    xmlTextWriterStartElementNS(xout, BAD_CAST (!unitprefix.empty() ? unitprefix.c_str() : 0), BAD_CAST "unit", 0);
+    startElement(!unitprefix.empty() ? unitprefix.c_str() : 0, "unit");
     ++openelementcount;
 
     // output namespaces for root and nested units
@@ -327,6 +394,10 @@ void srcMLOutput::startUnit(const char* language, const char* revision,
         outputNamespaces(xout, options, depth);
     }
 
+    // the unit element of a DOM needs its namespace declared
+    if (doc && !node->ns)
+        xmlSetNs(node, findNamespace(!unitprefix.empty() ? unitprefix.c_str() : 0));
+
     // setup for tabs if used
     std::string tabattribute;
     if (isoption(options, SRCML_OPTION_POSITION)) {
@@ -341,9 +412,15 @@ void srcMLOutput::startUnit(const char* language, const char* revision,
         { SRCML_OPTION_CPP_TEXT_ELSE,  "CPP_TEXT_ELSE" },
         { SRCML_OPTION_CPP_MARKUP_IF0, "CPP_MARKUP_IF0" },
         { SRCML_OPTION_LINE,           "LINE" },
+        { SRCML_OPTION_DEDUP,          "DEDUP" },
     }};
     std::string soptions;
     for (const auto& pair : sep) {
+
+        // references to other units are only in an archive
+        if (pair.first == SRCML_OPTION_DEDUP && !isoption(options, SRCML_OPTION_ARCHIVE))
+            continue;
+
         if (isoption(options, pair.first)) {
             if (!soptions.empty())
                 soptions += ",";
@@ -389,11 +466,11 @@ void srcMLOutput::startUnit(const char* language, const char* revision,
         if (!attrs[i][1])
             continue;
 
-        xmlTextWriterWriteAttribute(xout, BAD_CAST attrs[i][0], BAD_CAST attrs[i][1]);
+        writeAttribute(attrs[i][0], attrs[i][1]);
     }
 
     for(std::vector<std::string>::size_type pos = 0; pos < attributes.size(); pos += 2) {
-        xmlTextWriterWriteAttribute(xout, BAD_CAST attributes[pos].c_str(), BAD_CAST attributes[pos + 1].c_str());
+        writeAttribute(attributes[pos].c_str(), attributes[pos + 1].c_str());
     }
 
     if (output_macrolist)
@@ -423,13 +500,108 @@ void srcMLOutput::outputMacroList() {
 
     for(std::vector<std::string>::size_type i = 0; i < user_macro_list.size(); i += 2) {
 
-        xmlTextWriterStartElement(xout, BAD_CAST "macro-list");
-        xmlTextWriterWriteAttribute(xout, BAD_CAST "token", BAD_CAST user_macro_list[i].c_str());
-        xmlTextWriterWriteAttribute(xout, BAD_CAST "type", BAD_CAST user_macro_list[i + 1].c_str());
-        xmlTextWriterEndElement(xout);
+        startElement(0, "macro-list");
+        writeAttribute("token", user_macro_list[i].c_str());
+        writeAttribute("type", user_macro_list[i + 1].c_str());
+        endElement();
     }
 }
 
+/**
+ * startElement
+ * @param prefix namespace prefix of the element, or 0 for none
+ * @param name the element name
+ *
+ * Start an element with the writer, or as the current element of the DOM.
+ */
+void srcMLOutput::startElement(const char* prefix, const char* name) {
+
+    if (!doc) {
+        xmlTextWriterStartElementNS(xout, BAD_CAST prefix, BAD_CAST name, 0);
+        return;
+    }
+
+    xmlNodePtr element = xmlNewDocNode(doc, 0, BAD_CAST name, 0);
+    if (node)
+        xmlAddChild(node, element);
+    else
+        xmlDocSetRootElement(doc, element);
+    node = element;
+
+    // the namespaces of the root are not declared yet
+    if (node->parent != (xmlNodePtr) doc)
+        xmlSetNs(node, findNamespace(prefix));
+}
+
+/**
+ * writeAttribute
+ * @param name the attribute name, with any prefix
+ * @param value the attribute value
+ *
+ * Write an attribute of the current element.
+ */
+void srcMLOutput::writeAttribute(const char* name, const char* value) {
+
+    if (!doc) {
+        xmlTextWriterWriteAttribute(xout, BAD_CAST name, BAD_CAST value);
+        return;
+    }
+
+    const char* local = strchr(name, ':');
+    if (!local) {
+        xmlNewProp(node, BAD_CAST name, BAD_CAST value);
+        return;
+    }
+
+    std::string prefix(name, local - name);
+    xmlNewNsProp(node, findNamespace(prefix.c_str()), BAD_CAST (local + 1), BAD_CAST value);
+}
+
+/**
+ * endElement
+ *
+ * End the current element.
+ *
+ * @returns if successfully ended.
+ */
+bool srcMLOutput::endElement() {
+
+    if (!doc)
+        return xmlTextWriterEndElement(xout) != -1;
+
+    if (!node)
+        return false;
+
+    node = node->parent != (xmlNodePtr) doc ? node->parent : nullptr;
+
+    return true;
+}
+
+/**
+ * findNamespace
+ * @param prefix the namespace prefix, or 0 for the default namespace
+ *
+ * Find the namespace of the prefix in the DOM. Namespaces are declared on the root
+ * element, and any not declared there yet are declared when first used.
+ *
+ * @returns the namespace, or 0 if the prefix is unknown
+ */
+xmlNsPtr srcMLOutput::findNamespace(const char* prefix) {
+
+    xmlNodePtr root = xmlDocGetRootElement(doc);
+    for (xmlNsPtr ns = root->nsDef; ns; ns = ns->next) {
+        if (xmlStrEqual(ns->prefix, BAD_CAST prefix))
+            return ns;
+    }
+
+    auto& view = namespaces.get<nstags::prefix>();
+    auto it = view.find(prefix ? prefix : "");
+    if (it == view.end())
+        return 0;
+
+    return xmlNewNs(root, BAD_CAST it->uri.c_str(), BAD_CAST prefix);
+}
+
 /**
  * processText
  * @param str text to output
@@ -438,9 +610,10 @@ void srcMLOutput::outputMacroList() {
  */
 inline void srcMLOutput::processText(const std::string& str) {
 
-    if (strpbrk(str.c_str(), "<>&") == nullptr) {
+    // text in a DOM is not escaped
+    if (doc || strpbrk(str.c_str(), "<>&") == nullptr) {
 
-        xmlTextWriterWriteRawLen(xout, BAD_CAST (unsigned char*) str.data(), (int)str.size());
+        processText(str.data(), (int) str.size());
 
     } else {
 
@@ -473,7 +646,16 @@ inline void srcMLOutput::processText(const std::string& str) {
  */
 inline void srcMLOutput::processText(const char* s, int size) {
 
-    xmlTextWriterWriteRawLen(xout, BAD_CAST (unsigned char*) s, size);
+    if (!doc) {
+        xmlTextWriterWriteRawLen(xout, BAD_CAST (unsigned char*) s, size);
+        return;
+    }
+
+    // adjacent text is a single text node, as when the srcml is parsed
+    if (node->last && node->last->type == XML_TEXT_NODE)
+        xmlNodeAddContentLen(node->last, BAD_CAST s, size);
+    else
+        xmlAddChild(node, xmlNewDocTextLen(doc, BAD_CAST s, size));
 }
 
 /**
@@ -501,6 +683,28 @@ void srcMLOutput::addPosition(const antlr::RefToken& token) {
     if (stoken->endline < stoken->getLine() || (stoken->endline == stoken->getLine() && stoken->endcolumn < stoken->getColumn()))
             return;
 
+    // position attributes of a DOM
+    if (doc) {
+
+        const std::string& prefix = namespaces[POS].prefix;
+        xmlNsPtr ns = findNamespace(!prefix.empty() ? prefix.c_str() : 0);
+
+        std::string start = positoa(token->getLine());
+        start += ':';
+        start += positoa(token->getColumn());
+        xmlNewNsProp(node, ns, BAD_CAST "start", BAD_CAST start.c_str());
+
+        std::string end = token->getLine() > stoken->endline ? "INVALID_POS(" : "";
+        end += positoa(stoken->endline);
+        if (token->getLine() > stoken->endline)
+            end += ')';
+        end += ':';
+        end += positoa(stoken->endcolumn);
+        xmlNewNsProp(node, ns, BAD_CAST "end", BAD_CAST end.c_str());
+
+        return;
+    }
+
     thread_local const std::string& prefix = namespaces[POS].prefix;
     thread_local const std::string startAttribute = " " + prefix + (!prefix.empty() ? ":" : "") + "start=\"";
     thread_local const std::string endAttribute   = " " + prefix + (!prefix.empty() ? ":" : "") + "end=\"";
@@ -543,14 +747,14 @@ void srcMLOutput::processToken(const antlr::RefToken& token, const char* name, c
         if (prefix[0] == '\0')
             prefix = 0;
 
-        xmlTextWriterStartElementNS(xout, BAD_CAST prefix, BAD_CAST name, 0);
+        startElement(prefix, name);
         ++openelementcount;
 
         if (attr_name1)
-            xmlTextWriterWriteAttribute(xout, BAD_CAST attr_name1, BAD_CAST attr_value1);
+            writeAttribute(attr_name1, attr_value1);
 
         if (attr_name2)
-            xmlTextWriterWriteAttribute(xout, BAD_CAST attr_name2, BAD_CAST attr_value2);
+            writeAttribute(attr_name2, attr_value2);
 
         // if position attributes for non-empty start elements
         if (isposition && !isempty(token))
@@ -560,7 +764,7 @@ void srcMLOutput::processToken(const antlr::RefToken& token, const char* name, c
     if (!isstart(token) || isempty(token)) {
 
         --openelementcount;
-        xmlTextWriterEndElement(xout);
+        endElement();
     }
 }
 
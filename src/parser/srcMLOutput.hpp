@@ -37,6 +37,7 @@
 #include <unordered_map>
 #include "srcmlns.hpp"
 #include <libxml/xmlwriter.h>
+#include <libxml/tree.h>
 
 /**
  * anonymous enum for prefix positions
@@ -91,6 +92,15 @@ public:
     // same srcml file can be generated from multiple input token streams
     void setTokenStream(TokenStream& ints);
 
+    // create a document with names interned in the shared element dictionary
+    static xmlDocPtr createDocument();
+
+    // build the srcml as a DOM in the document instead of writing it
+    void setDocument(xmlDocPtr doc);
+
+    // end the current element
+    bool endElement();
+
     void outputXMLDecl();
 
     void outputProcessingInstruction();
@@ -127,6 +137,11 @@ private:
     // adds the position attributes to a token
     void addPosition(const antlr::RefToken& token);
 
+    // output of elements, attributes, and text to either the writer or the DOM
+    void startElement(const char* prefix, const char* name);
+    void writeAttribute(const char* name, const char* value);
+    xmlNsPtr findNamespace(const char* prefix);
+
 public:
     /** token stream input */
     TokenStream* input = nullptr;
@@ -137,6 +152,12 @@ public:
     /** output buffer */
     xmlOutputBuffer* output_buffer = nullptr;
 
+    /** document the srcml is built in, instead of written with the writer */
+    xmlDocPtr doc = nullptr;
+
+    /** current element of the document */
+    xmlNodePtr node = nullptr;
+
     /** unit attribute language */
     const char* unit_language = nullptr;
 
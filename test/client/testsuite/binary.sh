@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test binary srcML output and input
+define srcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+	</unit>
+	STDOUT
+
+define src <<- 'STDOUT'
+	a;
+	STDOUT
+
+xmlcheck "$srcml"
+
+createfile a.cpp "a;
+"
+
+# the extension .srcmlb is binary srcML
+srcml a.cpp -o a.srcmlb
+
+srcml a.srcmlb --output-srcml
+check "$srcml"
+
+srcml a.srcmlb
+check "$src"
+
+srcml a.srcmlb -o a.cpp.xml
+check a.cpp.xml "$srcml"
+
+# binary srcML on standard input
+srcml a.cpp --output-binary -o a.cpp.bin
+
+srcml --output-srcml < a.cpp.bin
+check "$srcml"
+
+# srcML to binary srcML and back
+createfile a.cpp.xml "$srcml"
+
+srcml a.cpp.xml -o b.srcmlb
+
+srcml b.srcmlb --output-srcml
+check "$srcml"
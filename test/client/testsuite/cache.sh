@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test the cache of parsed units
+createfile sub/a.cpp "#define A 1
+a;
+"
+createfile sub/b.cpp "b;
+"
+
+srcml sub -o nocache.xml
+check_exit 0
+
+# units parsed into an empty cache
+srcml sub --cache cache -o archive.xml
+check_exit 0
+
+if [ ! -d cache ] || [ -z "$(ls cache)" ]; then
+    echo "missing units in cache"
+    exit 1
+fi
+
+srcml archive.xml
+check nocache.xml
+
+# units copied from the cache
+srcml sub --cache cache -o archive.xml
+check_exit 0
+
+srcml archive.xml
+check nocache.xml
+
+# same source in another file
+createfile other/b.cpp "b;
+"
+
+srcml other/b.cpp --cache cache -o nocache.xml
+check_exit 0
+
+srcml other/b.cpp
+check nocache.xml
+
+# cache without a size limit, and with a size limit
+srcml sub --cache unlimited --cache-size 0 -o archive.xml
+check_exit 0
+
+srcml sub --cache limited --cache-size 1 -o archive.xml
+check_exit 0
+
+srcml sub --cache limited --cache-size 1 -o archive.xml
+check_exit 0
+
+srcml sub
+check archive.xml
+
+# cache size requires a cache
+srcml sub --cache-size 1
+check_exit 1
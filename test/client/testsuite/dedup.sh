@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test dedup archives, with units of the same source written as a reference
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "a;
+"
+createfile sub/c.cpp "c;
+"
+
+srcml sub -o full.xml
+check_exit 0
+
+srcml sub --dedup -o dedup.xml
+check_exit 0
+
+# only the duplicate is a reference, to the first unit
+if [ "$(grep -o ' ref="[0-9]*"' dedup.xml)" != ' ref="1"' ]; then
+    echo "duplicate unit not written as a reference to the first unit"
+    exit 1
+fi
+
+# references are expanded when read
+srcml dedup.xml
+check full.xml
+
+srcml dedup.xml --dedup
+check dedup.xml
+
+srcml full.xml --dedup
+check dedup.xml
+
+# source of a reference
+srcml dedup.xml --unit=2
+check "a;
+"
+
+# the index needs the elements of each unit
+srcml sub --dedup --index -o index.xml
+check_exit 1
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test directory input of plain source files, which are read directly, along with a compressed
+# file, which is read through libarchive
+createfile direct/a.cpp "a;
+"
+createfile direct/empty.cpp ""
+createfile compressed.cpp "c;
+"
+gzip -c compressed.cpp > direct/b.cpp.gz
+
+srcml direct -o direct.xml
+check_exit 0
+
+if [ "$(grep -o 'filename="[^"]*"' direct.xml | tr '\n' ' ')" != 'filename="direct/a.cpp" filename="direct/b.cpp" filename="direct/empty.cpp" ' ]; then
+    echo "units of the directory not in sorted order"
+    exit 1
+fi
+
+srcml direct.xml --unit=1
+check "a;
+"
+
+srcml direct.xml --unit=2
+check "c;
+"
+
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test directory input of a tree, which is listed and read in parallel, and written in sorted order
+createfile tree/b.cpp "b;
+"
+createfile tree/a.cpp "a;
+"
+createfile tree/a/y.cpp "y;
+"
+createfile tree/a/x.cpp "x;
+"
+createfile tree/a/b/z.cpp "z;
+"
+createfile tree/c/w.cpp "w;
+"
+createfile tree/.hidden/h.cpp "h;
+"
+createfile tree/c/.h.cpp "h;
+"
+
+srcml tree -j 1 -o single.xml
+check_exit 0
+
+if [ "$(grep -o 'filename="[^"]*"' single.xml | tr '\n' ' ')" != 'filename="tree/a.cpp" filename="tree/a/b/z.cpp" filename="tree/a/x.cpp" filename="tree/a/y.cpp" filename="tree/b.cpp" filename="tree/c/w.cpp" ' ]; then
+    echo "units of the tree not in sorted order"
+    exit 1
+fi
+
+srcml tree -j 8
+check single.xml
@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test filtering the units of srcML input on their attributes
+define archive <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+	</unit>
+
+	<unit revision="REVISION" language="C" filename="b.c"><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+	</unit>
+
+	<unit revision="REVISION" language="C++" filename="sub/c.cpp"><expr_stmt><expr><name>c</name></expr>;</expr_stmt>
+	</unit>
+
+	</unit>
+	STDOUT
+
+define cppnames <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="a.cpp" item="1"><name>a</name></unit>
+
+	<unit revision="REVISION" language="C++" filename="sub/c.cpp" item="1"><name>c</name></unit>
+
+	</unit>
+	STDOUT
+
+define subnames <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="sub/c.cpp" item="1"><name>c</name></unit>
+
+	</unit>
+	STDOUT
+
+xmlcheck "$archive"
+xmlcheck "$cppnames"
+xmlcheck "$subnames"
+
+createfile archive.xml "$archive"
+
+# explicit filter
+srcml archive.xml --filter-unit="@language='C++'" --xpath="//src:name"
+check "$cppnames"
+
+srcml archive.xml --filter-unit="@language='C' and @filename='b.c'" --xpath="count(//src:name)"
+check "1
+"
+
+srcml archive.xml --filter-unit="@language!='C'" --xpath="count(//src:name)" --aggregate=sum
+check "2
+"
+
+# filter of the query on the unit attributes
+srcml archive.xml --xpath="/src:unit[@language='C++']//src:name"
+check "$cppnames"
+
+srcml archive.xml --xpath="/src:unit[@language='C++' and starts-with(@filename, 'sub/')]//src:name"
+check "$subnames"
+
+# explicit filter along with the filter of the query
+srcml archive.xml --filter-unit="contains(@filename, 'sub')" --xpath="/src:unit[@language='C++']//src:name"
+check "$subnames"
+
+# position of the unit is among the matching units
+srcml archive.xml --filter-unit="@language='C++'" --unit=2
+check "c;
+"
+
+# invalid filter
+srcml archive.xml --filter-unit="position()=1" --xpath="//src:name"
+check_exit 1
@@ -0,0 +1,86 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test the element index of srcML
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b + c;
+"
+createfile c.c "d;
+"
+
+# index of the srcML output
+srcml sub/a.cpp sub/b.cpp c.c --index -o archive.xml
+check_exit 0
+
+if [ ! -f archive.xml.idx ]; then
+    echo "missing index archive.xml.idx"
+    exit 1
+fi
+
+# queries answered from the index
+srcml archive.xml --xpath="count(//src:name)"
+check "1
+2
+1
+"
+
+srcml archive.xml --xpath="boolean(//src:operator)"
+check "false
+true
+false
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=sum
+check "4
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=max --group-by=directory
+check ".	1
+sub	2
+"
+
+# index of existing srcML
+srcml sub/a.cpp sub/b.cpp c.c -o noindex.xml
+
+srcml noindex.xml --index
+check_exit 0
+
+if [ ! -f noindex.xml.idx ]; then
+    echo "missing index noindex.xml.idx"
+    exit 1
+fi
+
+srcml noindex.xml --xpath="count(//src:name)" --aggregate=sum
+check "4
+"
+
+# an index of an earlier srcML file is not used, even when changed in the same second
+sed -i.bak 's|<name>d</name>|<name/><name/>|' noindex.xml
+
+srcml noindex.xml --xpath="count(//src:name)"
+check "1
+2
+2
+"
+
+createfile c.c "d + e;
+"
+srcml c.c -o noindex.xml
+
+srcml noindex.xml --xpath="count(//src:name)"
+check "2
+"
+
+# queries that need the srcML
+srcml archive.xml --xpath="count(//src:name[.='b'])"
+check "0
+1
+0
+"
+
+# index of standard output
+srcml sub/a.cpp --index
+check_exit 2
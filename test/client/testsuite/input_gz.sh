@@ -92,6 +92,16 @@ check archive/empty.xml "$empty_output"
 srcml --files-from empty.txt.gz -o archive/compressed_empty.xml
 check archive/compressed_empty.xml "$empty_output"
 
+# truncated compressed data is an error, not the end of the source
+seq 1 10000 | sed 's/.*/a&;/' > archive/long.cpp
+gzip -c archive/long.cpp | head -c 1000 > archive/truncated.cpp.gz
+
+srcml archive/truncated.cpp.gz -o archive/truncated.xml 2> archive/truncated.txt
+check_exit 1
+
+rmfile archive/long.cpp
+rmfile archive/truncated.cpp.gz
+
 rmfile list.txt
 rmfile list.txt.gz
 rmfile empty.txt
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test compressed archive input larger than the read ahead, where the decompression is a separate stage
+for f in a b c d; do
+    createfile archive/$f.cpp "$(for i in $(seq 30000); do echo "int $f$i = $i;"; done)
+"
+done
+tar -cf archive.tar archive/a.cpp archive/b.cpp archive/c.cpp archive/d.cpp
+gzip -c archive.tar > archive.tar.gz
+cp archive.tar.gz archive.tgz
+gzip -c archive/d.cpp > d.cpp.gz
+
+srcml archive.tar -o tar.xml
+check_exit 0
+
+srcml archive.tar.gz -o tar.gz.xml
+check_exit 0
+
+if [ "$(grep -v '^<unit xmlns' tar.xml)" != "$(grep -v '^<unit xmlns' tar.gz.xml)" ]; then
+    echo "compressed archive input differs from the archive input"
+    exit 1
+fi
+
+srcml tar.gz.xml --unit=4
+check archive/d.cpp
+
+# compressed single file
+srcml d.cpp.gz -o d.xml
+check_exit 0
+
+srcml d.xml
+check archive/d.cpp
+
+# archive and compression in a single extension
+srcml archive.tgz -o tgz.xml
+check_exit 0
+
+if [ "$(grep -c '<unit revision' tgz.xml)" != "4" ]; then
+    echo "units of the compressed archive missing"
+    exit 1
+fi
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test that units are written in input order, however they are scheduled for parsing
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b;
+"
+createfile sub/c.cpp "c;
+"
+
+# the largest file is last in input order, and is parsed first when scheduled by size
+createfile sub/d.cpp "$(for i in $(seq 2000); do echo "int d$i = $i;"; done)
+"
+
+srcml sub -j 1 -o single.xml
+check_exit 0
+
+srcml sub -j 8
+check single.xml
+
+srcml sub -j 8 --schedule-by-size
+check single.xml
+
+srcml sub/d.cpp sub/a.cpp sub/c.cpp sub/b.cpp -j 1 -o files.xml
+check_exit 0
+
+srcml sub/d.cpp sub/a.cpp sub/c.cpp sub/b.cpp -j 8
+check files.xml
+
+srcml sub/d.cpp sub/a.cpp sub/c.cpp sub/b.cpp -j 8 --schedule-by-size
+check files.xml
+
+# filenames of the units, in the order of the command line
+srcml sub/d.cpp sub/a.cpp -j 8 --schedule-by-size -o list.xml
+check_exit 0
+
+if [ "$(grep -o 'filename="[^"]*"' list.xml | tr '\n' ' ')" != 'filename="sub/d.cpp" filename="sub/a.cpp" ' ]; then
+    echo "units not written in input order"
+    exit 1
+fi
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+define srcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="sub/a.cpp" hash="a301d91aac4aa1ab4e69cbc59cde4b4fff32f2b8" loc="1"><expr_stmt><expr><name>a</name></expr>;</expr_stmt></unit>
+
+	<unit revision="REVISION" language="C++" filename="sub/b.cpp" hash="9a1e1d3d0e27715d29bcfbf72b891b3ece985b36" loc="1"><expr_stmt><expr><name>b</name></expr>;</expr_stmt></unit>
+
+	</unit>
+	STDOUT
+xmlcheck "$srcml"
+
+define output <<- 'STDOUT'
+	XML encoding: UTF-8
+	    1  C++     1 a301d91aac4aa1ab4e69cbc59cde4b4fff32f2b8 sub/a.cpp
+	    2  C++     1 9a1e1d3d0e27715d29bcfbf72b891b3ece985b36 sub/b.cpp
+	units: 2
+	LOC: 2
+	STDOUT
+
+createfile sub/a.cpp "a;"
+createfile sub/b.cpp "b;"
+
+# test --loc stores the loc attribute
+srcml --loc sub/a.cpp sub/b.cpp
+check "$srcml"
+
+srcml --loc sub/a.cpp sub/b.cpp -o sub/ab.cpp.xml
+check sub/ab.cpp.xml "$srcml"
+
+# test --list uses the stored loc attribute
+srcml --list sub/ab.cpp.xml
+check "$output"
+
+srcml --list < sub/ab.cpp.xml
+check "$output"
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test name filter attribute and queries on names
+define srcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION" language="C++" filename="a.cpp" name-filter="0201000040201804"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+	</unit>
+	STDOUT
+
+define archive <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="a.cpp" name-filter="0201000040201804"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+	</unit>
+
+	<unit revision="REVISION" language="C++" filename="b.cpp" name-filter="8000000002480124"><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+	</unit>
+
+	</unit>
+	STDOUT
+
+define bnames <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="b.cpp" item="1"><expr><name>b</name></expr></unit>
+
+	</unit>
+	STDOUT
+
+xmlcheck "$srcml"
+xmlcheck "$archive"
+xmlcheck "$bnames"
+
+createfile a.cpp "a;
+"
+
+srcml --name-filter a.cpp
+check "$srcml"
+
+srcml a.cpp --name-filter -o a.cpp.xml
+check a.cpp.xml "$srcml"
+
+# a name filter from the input is replaced
+srcml a.cpp.xml --name-filter
+check "$srcml"
+
+createfile archive.xml "$archive"
+
+# units without the name are skipped, and the results do not have the name filter
+srcml archive.xml --xpath="//src:expr[src:name='b']"
+check "$bnames"
+
+srcml archive.xml --xpath="/src:unit//src:expr[(src:name='b')]"
+check "$bnames"
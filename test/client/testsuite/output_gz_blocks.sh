@@ -0,0 +1,32 @@
+#!/bin/bash
+
+libversion=$(srcml --version | tail -1)
+libversion=${libversion:10}
+numversion=$(printf "%d%03d%03d" ${libversion:1:1} ${libversion:3:1} ${libversion:5:1})
+if [[ $numversion -lt 3002000 ]]; then
+	echo "Test Skipped: Output as gz not available on this platform"
+	exit 0
+fi
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test gzip output of more than one block, which is compressed in parallel as a multi-member gzip
+createfile sub/a.cpp "$(for i in $(seq 40000); do echo "int a$i = $i;"; done)
+"
+
+srcml sub/a.cpp -o a.xml
+check_exit 0
+
+srcml sub/a.cpp -j 4 -o a.xml.gz
+check_exit 0
+
+gunzip -c a.xml.gz > a.gunzip.xml
+if ! cmp -s a.xml a.gunzip.xml; then
+    echo "gzip output differs from the uncompressed output"
+    exit 1
+fi
+
+# all of the members are read as input
+srcml a.xml.gz
+check sub/a.cpp
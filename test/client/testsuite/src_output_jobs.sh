@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test that source from an archive is the same whether unparsed serially or in parallel
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b;
+"
+createfile sub/dir/c.cpp "c;
+"
+createfile sub/dir/d.cpp "$(for i in $(seq 2000); do echo "int d$i = $i;"; done)
+"
+
+srcml sub -o archive.xml
+check_exit 0
+
+# units to stdout, in order and separated by a null
+srcml archive.xml -j 1 -o single.txt
+check_exit 0
+
+srcml archive.xml -j 8 --parallel-unparse
+check single.txt
+
+# entries of a tar file, in the order of the units
+srcml archive.xml -j 1 -o single.tar
+check_exit 0
+
+srcml archive.xml -j 8 --parallel-unparse -o parallel.tar
+check_exit 0
+
+if [ "$(tar -tf single.tar)" != "$(tar -tf parallel.tar)" ]; then
+    echo "tar entries not in unit order"
+    exit 1
+fi
+
+# files of a directory, in any order
+rmfile sub/a.cpp
+rmfile sub/b.cpp
+rmfile sub/dir/c.cpp
+rmfile sub/dir/d.cpp
+
+srcml archive.xml -j 8 --parallel-unparse --to-dir=.
+
+check sub/a.cpp "a;"
+check sub/b.cpp "b;"
+check sub/dir/c.cpp "c;"
+check sub/dir/d.cpp "$(for i in $(seq 2000); do echo "int d$i = $i;"; done)"
+
+# a file that cannot be written is an error
+mkdir -p out/sub/a.cpp
+
+srcml archive.xml --to-dir=out 2> error.txt
+check_exit 1
+
+srcml archive.xml -j 8 --parallel-unparse --to-dir=out 2> error.txt
+check_exit 1
+
+rm -rf out
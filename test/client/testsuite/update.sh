@@ -0,0 +1,90 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test update of an existing srcML archive
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b;
+"
+createfile sub/c.cpp "c;
+"
+
+srcml sub -o archive.xml
+check_exit 0
+
+# changed, new, and deleted files
+createfile sub/b.cpp "b + 1;
+"
+createfile sub/d.cpp "d;
+"
+rm sub/c.cpp
+
+srcml sub --update --dev -o archive.xml 2> debug.txt
+check_exit 0
+
+# only the unchanged file is reused
+if [ "$(grep '^Reused units:' debug.txt)" != "Reused units: 1" ]; then
+    echo "unchanged unit not reused"
+    exit 1
+fi
+
+if [ -e archive.xml.update ]; then
+    echo "temporary archive archive.xml.update not removed"
+    exit 1
+fi
+
+# same as creating the archive again
+srcml sub
+check archive.xml
+
+# no changes
+srcml sub --update --dev -o archive.xml 2> debug.txt
+check_exit 0
+
+if [ "$(grep '^Reused units:' debug.txt)" != "Reused units: 3" ]; then
+    echo "unchanged units not reused"
+    exit 1
+fi
+
+srcml sub
+check archive.xml
+
+# different options than the previous archive
+srcml sub --update --position -o archive.xml
+check_exit 0
+
+srcml sub --position
+check archive.xml
+
+# an input that fails keeps the previous archive
+cp archive.xml previous.xml
+seq 1 10000 | sed 's/.*/a&;/' > long.cpp
+gzip -c long.cpp | head -c 1000 > truncated.cpp.gz
+
+srcml sub truncated.cpp.gz --update -o archive.xml 2> error.txt
+check_exit 1
+
+if ! cmp -s archive.xml previous.xml; then
+    echo "previous archive not kept after an error"
+    exit 1
+fi
+
+if [ -e archive.xml.update ]; then
+    echo "incomplete archive archive.xml.update not removed"
+    exit 1
+fi
+
+rmfile long.cpp
+rmfile truncated.cpp.gz
+rmfile previous.xml
+
+# no previous archive
+rm archive.xml
+
+srcml sub --update -o archive.xml
+check_exit 0
+
+srcml sub
+check archive.xml
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test the reorder window of units parsed but not yet written, which must not change the output
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b;
+"
+createfile sub/c.cpp "c;
+"
+createfile sub/d.cpp "d;
+"
+
+srcml sub -o full.xml
+check_exit 0
+
+# a window of a single unit writes each unit before the next is parsed
+srcml sub --window=1
+check full.xml
+
+# more threads than units in the window
+srcml sub --window-size=0 --window=2 -j 8
+check full.xml
+
+# no limits
+srcml sub --window=0 --window-size=0
+check full.xml
+
+srcml sub --window=-1
+check_exit 1
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test aggregate of xpath results over all units
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b + c;
+"
+createfile c.c "d;
+"
+
+srcml sub/a.cpp sub/b.cpp c.c -o archive.xml
+
+# scalar results
+srcml archive.xml --xpath="count(//src:name)" --aggregate=sum
+check "4
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=count
+check "3
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=min
+check "1
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=max
+check "2
+"
+
+srcml archive.xml --xpath="count(//src:name) > 1" --aggregate=sum
+check "1
+"
+
+# element results contribute the number of results
+srcml archive.xml --xpath="//src:name" --aggregate=sum
+check "4
+"
+
+srcml --xpath="//src:name" --aggregate=sum archive.xml -o result.txt
+check result.txt "4
+"
+
+# grouped by unit attribute
+srcml archive.xml --xpath="count(//src:name)" --aggregate=sum --group-by=language
+check "C	1
+C++	3
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=max --group-by=directory
+check ".	1
+sub	2
+"
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=count --group-by=filename
+check "c.c	1
+sub/a.cpp	1
+sub/b.cpp	1
+"
+
+# invalid aggregate
+srcml archive.xml --xpath="count(//src:name)" --aggregate=average
+check_exit 1
+
+srcml archive.xml --xpath="count(//src:name)" --aggregate=sum --group-by=hash
+check_exit 1
+
+srcml archive.xml --aggregate=sum
+check_exit 1
@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test independent xpath queries with their own output
+define srcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+	</unit>
+	STDOUT
+
+define names <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="a.cpp" item="1"><name>a</name></unit>
+
+	</unit>
+	STDOUT
+
+define exprs <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="a.cpp" item="1"><expr><name>a</name></expr></unit>
+
+	</unit>
+	STDOUT
+
+xmlcheck "$srcml"
+xmlcheck "$names"
+xmlcheck "$exprs"
+
+createfile sub/a.cpp.xml "$srcml"
+
+# only independent queries, so the unit is output unchanged
+srcml sub/a.cpp.xml --xpath="//src:name" --xpath-output=sub/names.xml --xpath="count(//src:name)" --xpath-output=sub/count.txt
+check "$srcml"
+check sub/names.xml "$names"
+check sub/count.txt "1
+"
+
+# independent queries along with the output query
+srcml sub/a.cpp.xml --xpath="//src:expr" --xpath="//src:name" --xpath-output=sub/names.xml --xpath="count(//src:name)" --xpath-output=sub/count.txt
+check "$exprs"
+check sub/names.xml "$names"
+check sub/count.txt "1
+"
+
+srcml sub/a.cpp.xml --xpath="//src:name" --xpath-output=sub/names.xml --xpath="//src:expr" -o sub/exprs.xml
+check sub/exprs.xml "$exprs"
+check sub/names.xml "$names"
+
+# independent query after the output query
+srcml sub/a.cpp.xml --xpath="//src:expr" --xpath="//src:name" --xpath-output=sub/names.xml
+check "$exprs"
+check sub/names.xml "$names"
+
+# an output must follow its query
+srcml sub/a.cpp.xml --xpath-output=sub/names.xml --xpath="//src:name"
+check_exit 1
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test source output of query results of source, with the units passed directly from parsing
+createfile sub/a.cpp "a;
+"
+createfile sub/b.cpp "b;
+"
+
+srcml sub/a.cpp --xpath="//src:name" --output-src
+check "a"
+
+srcml sub/a.cpp sub/b.cpp --xpath="//src:expr_stmt" --output-src
+check "a;\0b;"
+
+srcml sub/a.cpp sub/b.cpp --xpath="//src:expr_stmt" --output-src -j 8
+check "a;\0b;"
+
+# same as through srcML
+srcml sub/a.cpp sub/b.cpp -o sub/ab.xml
+check_exit 0
+
+srcml sub/ab.xml --xpath="//src:expr_stmt" --output-src
+check "a;\0b;"
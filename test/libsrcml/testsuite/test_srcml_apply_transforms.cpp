@@ -248,6 +248,34 @@ int main(int, char* argv[]) {
         srcml_archive_free(iarchive);
     }
 
+    //  xpath number result for units with different namespace prefixes
+    {
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_a.c_str(), srcml_a.size());
+        srcml_archive* barchive = srcml_archive_create();
+        srcml_archive_read_open_memory(barchive, srcml_b.c_str(), srcml_b.size());
+        srcml_append_transform_xpath(iarchive, "count(//src:name)");
+
+        srcml_unit* aunit = srcml_archive_read_unit(iarchive);
+        srcml_unit* bunit = srcml_archive_read_unit(barchive);
+        for (auto unit : { aunit, bunit, aunit, bunit }) {
+            srcml_transform_result* result = nullptr;
+            srcml_unit_apply_transforms(iarchive, unit, &result);
+
+            dassert(srcml_transform_get_type(result), SRCML_RESULT_NUMBER);
+            dassert(srcml_transform_get_number(result), 1.0);
+            srcml_transform_free(result);
+        }
+        srcml_clear_transforms(iarchive);
+        srcml_unit_free(aunit);
+        srcml_unit_free(bunit);
+
+        srcml_archive_close(barchive);
+        srcml_archive_free(barchive);
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+    }
+
     //  xpath boolean result
     {
         srcml_archive* iarchive = srcml_archive_create();
@@ -1705,6 +1733,201 @@ int main(int, char* argv[]) {
         free(s);
     }
 
+    /*
+      streamable xpath
+    */
+
+    {
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_a.c_str(), srcml_a.size());
+        srcml_append_transform_xpath(iarchive, "/src:unit/src:expr_stmt//src:name");
+
+        srcml_unit* unit = srcml_archive_read_unit(iarchive);
+        srcml_transform_result* result = nullptr;
+        srcml_unit_apply_transforms(iarchive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_UNITS);
+        dassert(srcml_transform_get_unit_size(result), 1);
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(result, 0))), "<name>a</name>");
+        srcml_transform_free(result);
+        srcml_clear_transforms(iarchive);
+
+        srcml_append_transform_xpath(iarchive, "//src:expr[src:name='a']");
+        srcml_unit_apply_transforms(iarchive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_UNITS);
+        dassert(srcml_transform_get_unit_size(result), 1);
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(result, 0))), "<expr><name>a</name></expr>");
+        srcml_transform_free(result);
+        srcml_clear_transforms(iarchive);
+
+        srcml_append_transform_xpath(iarchive, "//src:expr[src:name='b']");
+        srcml_unit_apply_transforms(iarchive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_NONE);
+        dassert(srcml_transform_get_unit_size(result), 0);
+        srcml_transform_free(result);
+        srcml_clear_transforms(iarchive);
+
+        // unit results are the unit itself, not nested in a new unit
+        for (auto xpath : { "//src:unit", "/src:unit", "/*" }) {
+            srcml_append_transform_xpath(iarchive, xpath);
+            srcml_unit_apply_transforms(iarchive, unit, &result);
+
+            dassert(srcml_transform_get_type(result), SRCML_RESULT_UNITS);
+            dassert(srcml_transform_get_unit_size(result), 1);
+            dassert(srcml_unit_get_filename(srcml_transform_get_unit(result, 0)), std::string("a.cpp"));
+            dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(result, 0))), "<expr_stmt><expr><name>a</name></expr>;</expr_stmt>\n");
+            srcml_transform_free(result);
+            srcml_clear_transforms(iarchive);
+        }
+
+        // a relative alternative of a union is relative to the document, not to each element
+        srcml_append_transform_xpath(iarchive, "//src:expr | src:name");
+        srcml_unit_apply_transforms(iarchive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_UNITS);
+        dassert(srcml_transform_get_unit_size(result), 1);
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(result, 0))), "<expr><name>a</name></expr>");
+        srcml_transform_free(result);
+        srcml_clear_transforms(iarchive);
+
+        // a unit in any alternative of a union is the unit itself
+        srcml_append_transform_xpath(iarchive, "//src:unit | //src:expr");
+        srcml_unit_apply_transforms(iarchive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_UNITS);
+        dassert(srcml_unit_get_filename(srcml_transform_get_unit(result, 0)), std::string("a.cpp"));
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(result, 0))), "<expr_stmt><expr><name>a</name></expr>;</expr_stmt>\n");
+        srcml_transform_free(result);
+        srcml_clear_transforms(iarchive);
+        srcml_unit_free(unit);
+
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+    }
+
+    /*
+      unit results with attributes of the result
+    */
+
+    {
+        const std::string srcml_amp = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a&amp;b.cpp" version="1"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+)";
+
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_amp.c_str(), srcml_amp.size());
+        srcml_append_transform_xpath_attribute(iarchive, "//src:name", "pre", "foo.com", "attr", "value");
+
+        srcml_unit* unit = srcml_archive_read_unit(iarchive);
+        srcml_transform_result* result = nullptr;
+        srcml_unit_apply_transforms(iarchive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_UNITS);
+        dassert(srcml_transform_get_unit_size(result), 1);
+        dassert(srcml_unit_get_filename(srcml_transform_get_unit(result, 0)), std::string("a&b.cpp"));
+        dassert(srcml_unit_get_version(srcml_transform_get_unit(result, 0)), std::string("1"));
+        dassert(srcml_unit_get_language(srcml_transform_get_unit(result, 0)), std::string("C++"));
+        srcml_transform_free(result);
+        srcml_unit_free(unit);
+
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+    }
+
+    /*
+      srcml_unit_apply_transforms_each
+    */
+
+    {
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_a.c_str(), srcml_a.size());
+
+        srcml_archive* names = srcml_archive_clone(iarchive);
+        srcml_append_transform_xpath(names, "//src:name");
+        srcml_archive* count = srcml_archive_clone(iarchive);
+        srcml_append_transform_xpath(count, "count(//src:name)");
+        srcml_archive* exprs = srcml_archive_clone(iarchive);
+        srcml_append_transform_xpath(exprs, "//src:expr");
+        srcml_append_transform_xpath(exprs, "//src:name");
+
+        srcml_archive* archives[] = { names, count, exprs, iarchive };
+        srcml_transform_result* results[4];
+
+        srcml_unit* unit = srcml_archive_read_unit(iarchive);
+        dassert(srcml_unit_apply_transforms_each(4, archives, unit, results), SRCML_STATUS_OK);
+
+        dassert(srcml_transform_get_type(results[0]), SRCML_RESULT_UNITS);
+        dassert(srcml_transform_get_unit_size(results[0]), 1);
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(results[0], 0))), "<name>a</name>");
+
+        dassert(srcml_transform_get_type(results[1]), SRCML_RESULT_NUMBER);
+        dassert(srcml_transform_get_number(results[1]), 1.0);
+
+        dassert(srcml_transform_get_type(results[2]), SRCML_RESULT_UNITS);
+        dassert(srcml_transform_get_unit_size(results[2]), 1);
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(results[2], 0))), "<name>a</name>");
+
+        dassert(results[3], 0);
+
+        srcml_transform_free(results[0]);
+        srcml_transform_free(results[1]);
+        srcml_transform_free(results[2]);
+
+        dassert(srcml_unit_apply_transforms_each(4, nullptr, unit, results), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_unit_apply_transforms_each(4, archives, nullptr, results), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_unit_apply_transforms_each(4, archives, unit, nullptr), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+
+        srcml_archive_free(names);
+        srcml_archive_free(count);
+        srcml_archive_free(exprs);
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+    }
+
+    /*
+      unit parsed from source with transformations
+    */
+
+    {
+        const std::string src = "a < b && c;\n\f";
+
+        char* s;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        srcml_unit* expected = srcml_unit_create(archive);
+        srcml_unit_set_language(expected, "C++");
+        srcml_unit_parse_memory(expected, src.c_str(), src.size());
+
+        srcml_append_transform_xpath(archive, "count(//src:name)");
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_parse_memory(unit, src.c_str(), src.size());
+
+        srcml_transform_result* result = nullptr;
+        srcml_unit_apply_transforms(archive, unit, &result);
+
+        dassert(srcml_transform_get_type(result), SRCML_RESULT_NUMBER);
+        dassert(srcml_transform_get_number(result), 3.0);
+        dassert(srcml_unit_get_loc(unit), srcml_unit_get_loc(expected));
+        dassert(std::string(srcml_unit_get_srcml(unit)), srcml_unit_get_srcml(expected));
+
+        srcml_transform_free(result);
+        srcml_unit_free(unit);
+        srcml_unit_free(expected);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        free(s);
+    }
+
     srcml_cleanup_globals();
 
     return 0;
@@ -238,6 +238,85 @@ int main(int, char* argv[]) {
         dassert(srcml_archive_set_tabstop(0, 4), SRCML_STATUS_INVALID_ARGUMENT);
     }
 
+    /*
+      srcml_archive_set_read_content
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_archive_get_read_content(archive), SRCML_READ_CONTENT_ALL);
+        dassert(srcml_archive_set_read_content(archive, SRCML_READ_CONTENT_SRC), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_read_content(archive), SRCML_READ_CONTENT_SRC);
+        dassert(srcml_archive_set_read_content(archive, 3), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_read_content(archive), SRCML_READ_CONTENT_SRC);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_read_content(0, SRCML_READ_CONTENT_SRCML), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      srcml_archive_set_unit_filter
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_archive_get_unit_filter(archive), 0);
+        dassert(srcml_archive_set_unit_filter(archive, "@language='C++' and starts-with(@filename, \"src/\")"), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), std::string("@language='C++' and starts-with(@filename, 'src/')"));
+        dassert(srcml_archive_set_unit_filter(archive, "@language='C++' or @language='C'"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_unit_filter(archive), std::string("@language='C++' and starts-with(@filename, 'src/')"));
+        dassert(srcml_archive_set_unit_filter(archive, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_append_transform_xpath(archive, "/src:unit[@language='C++']//src:name"), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), std::string("@language='C++'"));
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_append_transform_xpath(archive, "//src:name"), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    // attributes the reader drops are not in the unit header
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_archive_set_unit_filter(archive, "@tabs='4'"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_set_unit_filter(archive, "contains(@options, 'CPP')"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_unit_filter(archive), 0);
+        dassert(srcml_archive_set_unit_filter(archive, "@revision='1.0.0' and @url='project' and @loc='2'"), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), std::string("@revision='1.0.0' and @url='project' and @loc='2'"));
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_append_transform_xpath(archive, "/src:unit[@tabs='4']//src:name"), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), 0);
+        srcml_clear_transforms(archive);
+        dassert(srcml_append_transform_xpath(archive, "/src:unit[@options='CPP' and @loc='2']//src:name"), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_unit_filter(archive), std::string("@loc='2'"));
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_unit_filter(0, "@language='C'"), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
     /*
       srcml_archive_register_file_extension
     */
@@ -0,0 +1,175 @@
+/**
+ * @file test_srcml_archive_units.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for passing units directly between archives
+*/
+
+#include <srcml.h>
+
+#include <string>
+#include <deque>
+
+#include <dassert.hpp>
+
+namespace {
+
+    // units written and not yet read, and the number of closes
+    struct units_context {
+        std::deque<srcml_unit*> units;
+        int closed = 0;
+    };
+
+    int write_unit(void* context, srcml_unit* unit) {
+
+        static_cast<units_context*>(context)->units.push_back(unit);
+
+        return 0;
+    }
+
+    srcml_unit* read_unit(void* context) {
+
+        auto& units = static_cast<units_context*>(context)->units;
+        if (units.empty())
+            return 0;
+
+        srcml_unit* unit = units.front();
+        units.pop_front();
+
+        return unit;
+    }
+
+    int close_units(void* context) {
+
+        ++static_cast<units_context*>(context)->closed;
+
+        return 0;
+    }
+
+    // parse the source into a new unit of the archive and write it
+    void write(srcml_archive* archive, const char* filename, const std::string& source) {
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_set_filename(unit, filename);
+        srcml_unit_parse_memory(unit, source.c_str(), source.size());
+        srcml_archive_write_unit(archive, unit);
+        srcml_unit_free(unit);
+    }
+
+    // source of the unit
+    std::string unparse(srcml_unit* unit) {
+
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_unit_unparse_memory(unit, &buffer, &size);
+        std::string src(buffer, size);
+        srcml_memory_free(buffer);
+
+        return src;
+    }
+}
+
+int main(int, char* argv[]) {
+
+    /*
+      srcml_archive_write_open_units
+    */
+
+    {
+        units_context context;
+
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_write_open_units(archive, &context, write_unit, close_units), SRCML_STATUS_OK);
+
+        write(archive, "a.cpp", "a;\n");
+        write(archive, "b.cpp", "b;\n");
+
+        dassert(srcml_archive_write_string(archive, "a", 1), SRCML_STATUS_INVALID_IO_OPERATION);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert((int) context.units.size(), 2);
+        dassert(context.closed, 1);
+        dassert(srcml_unit_get_filename(context.units[0]), std::string("a.cpp"));
+        dassert(srcml_unit_get_filename(context.units[1]), std::string("b.cpp"));
+
+        for (auto unit : context.units)
+            srcml_unit_free(unit);
+    }
+
+    {
+        units_context context;
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_write_open_units(0, &context, write_unit, close_units), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_open_units(archive, 0, write_unit, close_units), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_open_units(archive, &context, 0, close_units), SRCML_STATUS_INVALID_ARGUMENT);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcml_archive_read_open_units
+    */
+
+    {
+        units_context context;
+
+        srcml_archive* output = srcml_archive_create();
+        srcml_archive_write_open_units(output, &context, write_unit, 0);
+        write(output, "a.cpp", "a;\n");
+        write(output, "src/b.cpp", "b;\n");
+        write(output, "src/c.cpp", "c;\n");
+        srcml_archive_close(output);
+        srcml_archive_free(output);
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_unit_filter(archive, "starts-with(@filename, 'src/')");
+        dassert(srcml_archive_read_open_units(archive, &context, read_unit, close_units), SRCML_STATUS_OK);
+
+        dassert(srcml_archive_skip_unit(archive), 1);
+
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("src/c.cpp"));
+        dassert(unparse(unit), "c;\n");
+        srcml_unit_free(unit);
+
+        dassert(srcml_archive_read_unit(archive), 0);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(context.closed, 1);
+    }
+
+    {
+        units_context context;
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_read_open_units(0, &context, read_unit, close_units), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_read_open_units(archive, 0, read_unit, close_units), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_read_open_units(archive, &context, 0, close_units), SRCML_STATUS_INVALID_ARGUMENT);
+        srcml_archive_free(archive);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -95,6 +95,18 @@ int main(int, char* argv[]) {
 <unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
 </unit>
 
+</unit>
+)";
+
+    const std::string srcml_ab_name_filter = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" name-filter="0201000040201804"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp" name-filter="8000000002480124"><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+</unit>
+
 </unit>
 )";
 
@@ -196,6 +208,255 @@ int main(int, char* argv[]) {
         free(s);
     }
 
+    /*
+      name filter
+    */
+
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_enable_name_filter(archive);
+        dassert(srcml_archive_has_name_filter(archive), 1);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        for (const char* name : { "a", "b" }) {
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_filename(unit, (std::string(name) + ".cpp").c_str());
+            srcml_unit_set_language(unit, "C++");
+            srcml_unit_parse_memory(unit, (std::string(name) + ";\n").c_str(), 3);
+
+            dassert(srcml_archive_write_unit(archive, unit), SRCML_STATUS_OK);
+
+            srcml_unit_free(unit);
+        }
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_ab_name_filter);
+
+        // queries on a name skip the units without it
+        archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, s, size);
+        srcml_append_transform_xpath(archive, "//src:expr[src:name='b']");
+        dassert(srcml_archive_get_unit_filter(archive), std::string(".//src:name='b'"));
+        srcml_archive_set_unit_filter(archive, srcml_archive_get_unit_filter(archive));
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("b.cpp"));
+        dassert(srcml_archive_has_name_filter(archive), 1);
+        srcml_transform_result* result = 0;
+        srcml_unit_apply_transforms(archive, unit, &result);
+        dassert(srcml_transform_get_unit_size(result), 1);
+
+        // the name filter of the unit is not for the result
+        char* t = 0;
+        size_t tsize;
+        srcml_archive* oarchive = srcml_archive_clone(archive);
+        srcml_archive_write_open_memory(oarchive, &t, &tsize);
+        srcml_archive_write_unit(oarchive, srcml_transform_get_unit(result, 0));
+        srcml_archive_close(oarchive);
+        srcml_archive_free(oarchive);
+        dassert(std::string(t, tsize).find("name-filter"), std::string::npos);
+        free(t);
+
+        srcml_transform_free(result);
+        srcml_unit_free(unit);
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        free(s);
+    }
+
+    // names with character references are in the filter as UTF-8
+    {
+        const std::string srcml_references = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" language="C++" filename="a.cpp"><expr_stmt><expr><name>caf&#233;</name> <operator>+</operator> <name>&#x43A;&#x1F600;</name></expr>;</expr_stmt>
+</unit>
+)";
+
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_references.c_str(), srcml_references.size());
+        srcml_unit* unit = srcml_archive_read_unit(iarchive);
+
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_enable_name_filter(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_archive_write_unit(archive, unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_unit_free(unit);
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+
+        for (const char* name : { "caf\xC3\xA9", "\xD0\xBA\xF0\x9F\x98\x80" }) {
+            archive = srcml_archive_create();
+            srcml_archive_read_open_memory(archive, s, size);
+            srcml_append_transform_xpath(archive, (std::string("//src:expr[src:name='") + name + "']").c_str());
+            srcml_archive_set_unit_filter(archive, srcml_archive_get_unit_filter(archive));
+            unit = srcml_archive_read_unit(archive);
+            dassert(srcml_unit_get_filename(unit), std::string("a.cpp"));
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+        }
+
+        free(s);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_has_name_filter(archive), 0);
+        srcml_archive_enable_name_filter(archive);
+        srcml_archive_disable_name_filter(archive);
+        dassert(srcml_archive_has_name_filter(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_enable_name_filter(0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_disable_name_filter(0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      binary
+    */
+
+    {
+        std::string output[2];
+        for (int binary = 0; binary < 2; ++binary) {
+            char* s = 0;
+            size_t size;
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_disable_hash(archive);
+            if (binary)
+                srcml_archive_enable_binary(archive);
+            dassert(srcml_archive_is_binary(archive), binary);
+            srcml_archive_write_open_memory(archive, &s, &size);
+            for (const char* name : { "a", "b" }) {
+                srcml_unit* unit = srcml_unit_create(archive);
+                srcml_unit_set_filename(unit, (std::string(name) + ".cpp").c_str());
+                srcml_unit_set_language(unit, "C++");
+                srcml_unit_parse_memory(unit, (std::string(name) + ";\n").c_str(), 3);
+
+                dassert(srcml_archive_write_unit(archive, unit), SRCML_STATUS_OK);
+
+                srcml_unit_free(unit);
+            }
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+
+            output[binary].assign(s, size);
+            free(s);
+        }
+
+        dassert(output[1].substr(0, 6), std::string("\x89srcML"));
+        dassert((output[1].size() < output[0].size()), true);
+
+        // binary srcML is read as the srcML it was encoded from
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_read_open_memory(archive, output[1].c_str(), output[1].size()), SRCML_STATUS_OK);
+        dassert(srcml_archive_is_binary(archive), 1);
+        srcml_archive* xml_archive = srcml_archive_create();
+        dassert(srcml_archive_read_open_memory(xml_archive, output[0].c_str(), output[0].size()), SRCML_STATUS_OK);
+        dassert(srcml_archive_is_binary(xml_archive), 0);
+        for (const char* filename : { "a.cpp", "b.cpp" }) {
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            srcml_unit* xml_unit = srcml_archive_read_unit(xml_archive);
+            dassert(srcml_unit_get_filename(unit), std::string(filename));
+            dassert(std::string(srcml_unit_get_srcml(unit)), srcml_unit_get_srcml(xml_unit));
+            srcml_unit_free(unit);
+            srcml_unit_free(xml_unit);
+        }
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_archive_close(xml_archive);
+        srcml_archive_free(xml_archive);
+    }
+
+    // the output is encoded once, for both units and strings
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_enable_binary(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_filename(unit, "a.cpp");
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_parse_memory(unit, "a;\n", 3);
+        dassert(srcml_archive_write_unit(archive, unit), SRCML_STATUS_OK);
+        srcml_unit_free(unit);
+        dassert(srcml_archive_write_string(archive, "\n", 1), SRCML_STATUS_OK);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size).find("\x89srcML", 1), std::string::npos);
+
+        archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, s, size);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a.cpp"));
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        free(s);
+    }
+
+    // binary srcML in another encoding is read the same as UTF-8
+    for (const char* encoding : { "UTF-8", "ISO-8859-1" }) {
+
+        std::string output[2];
+        for (int binary = 0; binary < 2; ++binary) {
+            char* s = 0;
+            size_t size;
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_set_xml_encoding(archive, encoding);
+            if (binary)
+                srcml_archive_enable_binary(archive);
+            srcml_archive_write_open_memory(archive, &s, &size);
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_filename(unit, "a.cpp");
+            srcml_unit_set_language(unit, "C++");
+            srcml_unit_parse_memory(unit, "caf\xc3\xa9 < b; /* c */\r\n", 20);
+            srcml_archive_write_unit(archive, unit);
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+
+            archive = srcml_archive_create();
+            srcml_archive_read_open_memory(archive, s, size);
+            unit = srcml_archive_read_unit(archive);
+            output[binary] = srcml_unit_get_srcml(unit);
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+            free(s);
+        }
+
+        dassert(output[1], output[0]);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_is_binary(archive), 0);
+        srcml_archive_enable_binary(archive);
+        srcml_archive_disable_binary(archive);
+        dassert(srcml_archive_is_binary(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_enable_binary(0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_disable_binary(0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
     {
         char* s = 0;
         size_t size;
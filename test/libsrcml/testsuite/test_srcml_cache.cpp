@@ -0,0 +1,218 @@
+/**
+ * @file test_srcml_cache.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for the cache of parsed units
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#include <fcntl.h>
+
+#include <dassert.hpp>
+
+namespace {
+
+    // parse the source into a unit of a new archive with the cache, and return the srcML of the unit
+    std::string parse(const char* cache, size_t max_size, const char* language, const char* filename, const std::string& source,
+                      size_t& hits, size_t& misses) {
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_cache(archive, cache, max_size);
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_archive_write_open_memory(archive, &buffer, &size);
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, language);
+        srcml_unit_set_filename(unit, filename);
+        srcml_unit_parse_memory(unit, source.c_str(), source.size());
+        std::string srcml = srcml_unit_get_srcml(unit);
+
+        hits = srcml_archive_get_cache_hits(archive);
+        misses = srcml_archive_get_cache_misses(archive);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(buffer);
+
+        return srcml;
+    }
+}
+
+int main(int, char* argv[]) {
+
+    const std::string source = "#define A 1\nint f() { return A; }\n";
+
+    /*
+      srcml_archive_set_cache
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_get_cache_directory(archive), 0);
+        dassert(srcml_archive_set_cache(archive, "cache_set", 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_cache_directory(archive), std::string("cache_set"));
+        dassert(srcml_archive_get_cache_hits(archive), 0);
+        dassert(srcml_archive_get_cache_misses(archive), 0);
+        dassert(srcml_archive_set_cache(archive, 0, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_cache_directory(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        std::ofstream file("cache_file");
+        file << "not a directory";
+        file.close();
+
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_set_cache(archive, "cache_file", 0), SRCML_STATUS_INVALID_ARGUMENT);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_cache(0, "cache_set", 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_cache_directory(0), 0);
+        dassert(srcml_archive_get_cache_hits(0), 0);
+        dassert(srcml_archive_get_cache_misses(0), 0);
+    }
+
+    /*
+      srcml_unit_parse_* with a cache
+    */
+
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        std::string nocache = parse(0, 0, "C++", "a.cpp", source, hits, misses);
+        dassert(hits, 0);
+        dassert(misses, 0);
+
+        std::string first = parse("cache_parse", 0, "C++", "a.cpp", source, hits, misses);
+        dassert(hits, 0);
+        dassert(misses, 1);
+        dassert(first, nocache);
+
+        std::string second = parse("cache_parse", 0, "C++", "a.cpp", source, hits, misses);
+        dassert(hits, 1);
+        dassert(misses, 0);
+        dassert(second, nocache);
+
+        // the unit attributes are not part of the cache
+        std::string renamed = parse("cache_parse", 0, "C++", "b.cpp", source, hits, misses);
+        dassert(hits, 1);
+        dassert(misses, 0);
+        dassert(renamed, parse(0, 0, "C++", "b.cpp", source, hits, misses));
+
+        // the language is
+        std::string c = parse("cache_parse", 0, "C", "a.cpp", source, hits, misses);
+        dassert(hits, 0);
+        dassert(misses, 1);
+        dassert(c, parse(0, 0, "C", "a.cpp", source, hits, misses));
+    }
+
+    {
+        std::ofstream file("cache_a.cpp");
+        file << source;
+        file.close();
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_cache(archive, "cache_parse", 0);
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_archive_write_open_memory(archive, &buffer, &size);
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        dassert(srcml_unit_parse_filename(unit, "cache_a.cpp"), SRCML_STATUS_OK);
+        dassert(srcml_unit_get_language(unit), std::string("C++"));
+        dassert(srcml_unit_get_loc(unit), 2);
+        srcml_unit_free(unit);
+
+        dassert(srcml_archive_get_cache_hits(archive), 1);
+        dassert(srcml_archive_get_cache_misses(archive), 0);
+
+        // the file is closed after a cache hit, a miss, and a failed read
+        int fd = OPEN("cache_a.cpp", O_RDONLY, 0);
+        CLOSE(fd);
+
+        unit = srcml_unit_create(archive);
+        srcml_unit_parse_filename(unit, "cache_a.cpp");
+        srcml_unit_free(unit);
+        dassert(OPEN("cache_a.cpp", O_RDONLY, 0), fd);
+        CLOSE(fd);
+
+        unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C");
+        srcml_unit_parse_filename(unit, "cache_a.cpp");
+        srcml_unit_free(unit);
+        dassert(OPEN("cache_a.cpp", O_RDONLY, 0), fd);
+        CLOSE(fd);
+
+        unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        dassert(srcml_unit_parse_filename(unit, "."), SRCML_STATUS_IO_ERROR);
+        srcml_unit_free(unit);
+        dassert(OPEN("cache_a.cpp", O_RDONLY, 0), fd);
+        CLOSE(fd);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(buffer);
+    }
+
+    /*
+      eviction of the least recently used units
+    */
+
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        parse("cache_evict", 1, "C++", "a.cpp", source, hits, misses);
+        dassert(misses, 1);
+
+        parse("cache_evict", 1, "C++", "a.cpp", source, hits, misses);
+        dassert(hits, 0);
+        dassert(misses, 1);
+
+        parse("cache_evict", 0, "C++", "a.cpp", source, hits, misses);
+        parse("cache_evict", 0, "C++", "a.cpp", source, hits, misses);
+        dassert(hits, 1);
+    }
+
+    remove("cache_file");
+    remove("cache_a.cpp");
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
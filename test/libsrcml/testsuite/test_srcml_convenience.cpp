@@ -167,6 +167,30 @@ int main(int, char* argv[]) {
         dassert(srcml("foo.c", "foo.xml"), SRCML_STATUS_IO_ERROR);
     }
 
+    /*
+      srcml_convert_to_binary, srcml_convert_from_binary
+    */
+
+    {
+        dassert(srcml_convert_to_binary("project.xml", "project.srcmlb"), SRCML_STATUS_OK);
+        dassert(srcml_convert_from_binary("project.srcmlb", "project_binary.xml"), SRCML_STATUS_OK);
+        std::ifstream project("project_binary.xml");
+        std::string res_srcml((std::istreambuf_iterator<char>(project)), std::istreambuf_iterator<char>());
+
+        dassert(res_srcml, asrcml);
+    }
+
+    {
+        dassert(srcml_convert_to_binary("project.srcmlb", "project_twice.srcmlb"), SRCML_STATUS_INVALID_INPUT);
+        dassert(srcml_convert_from_binary("project.xml", "project_binary.xml"), SRCML_STATUS_INVALID_INPUT);
+    }
+
+    {
+        dassert(srcml_convert_to_binary("foo.xml", "foo.srcmlb"), SRCML_STATUS_IO_ERROR);
+        dassert(srcml_convert_to_binary(0, "foo.srcmlb"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_convert_from_binary("project.srcmlb", 0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
     srcml_cleanup_globals();
 
     UNLINK("a.cpp");
@@ -179,6 +203,8 @@ int main(int, char* argv[]) {
     UNLINK("project.c.xml");
     UNLINK("inta.cpp");
     UNLINK("project_full.cpp.xml");
+    UNLINK("project.srcmlb");
+    UNLINK("project_binary.xml");
 
     return 0;
 }
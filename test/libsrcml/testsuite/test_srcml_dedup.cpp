@@ -0,0 +1,299 @@
+/**
+ * @file test_srcml_dedup.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for dedup archives
+*/
+
+#include <srcml.h>
+
+#include <string>
+
+#include <dassert.hpp>
+
+namespace {
+
+    // number of occurrences of the text in the string
+    int count(const std::string& s, const std::string& text) {
+
+        int n = 0;
+        for (auto pos = s.find(text); pos != std::string::npos; pos = s.find(text, pos + 1))
+            ++n;
+
+        return n;
+    }
+
+    // parse the source into a new unit of the archive and write it
+    void write(srcml_archive* archive, const char* filename, const std::string& source) {
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_set_filename(unit, filename);
+        srcml_unit_parse_memory(unit, source.c_str(), source.size());
+        srcml_archive_write_unit(archive, unit);
+        srcml_unit_free(unit);
+    }
+
+    // archive of the sources a.cpp, b.cpp (same as a.cpp), and c.cpp
+    std::string create(bool dedup) {
+
+        srcml_archive* archive = srcml_archive_create();
+        if (dedup)
+            srcml_archive_enable_dedup(archive);
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_archive_write_open_memory(archive, &buffer, &size);
+
+        write(archive, "a.cpp", "a;\n");
+        write(archive, "b.cpp", "a;\n");
+        write(archive, "c.cpp", "c;\n");
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        std::string srcml(buffer, size);
+        srcml_memory_free(buffer);
+
+        return srcml;
+    }
+}
+
+int main(int, char* argv[]) {
+
+    const std::string full = create(false);
+    const std::string dedup = create(true);
+
+    /*
+      srcml_archive_is_dedup
+      srcml_archive_enable_dedup
+      srcml_archive_disable_dedup
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_is_dedup(archive), 0);
+        dassert(srcml_archive_enable_dedup(archive), SRCML_STATUS_OK);
+        dassert(srcml_archive_is_dedup(archive), 1);
+        dassert(srcml_archive_disable_dedup(archive), SRCML_STATUS_OK);
+        dassert(srcml_archive_is_dedup(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_enable_dedup(0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_disable_dedup(0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      srcml_archive_write_unit with dedup
+    */
+
+    {
+        dassert(count(full, "ref=\""), 0);
+        dassert(count(full, "<name>a</name>"), 2);
+
+        dassert(count(dedup, "options=\"DEDUP\""), 1);
+        dassert(count(dedup, "filename=\"b.cpp\""), 1);
+        dassert(count(dedup, "ref=\"1\""), 1);
+        dassert(count(dedup, "<name>a</name>"), 1);
+        dassert(count(dedup, "<name>c</name>"), 1);
+    }
+
+    /*
+      srcml_archive_read_unit of a dedup archive
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_get_dedup_expand(archive), 0);
+        dassert(srcml_archive_set_dedup_expand(archive, 1024), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_dedup_expand(archive), 1024);
+        srcml_archive_read_open_memory(archive, dedup.c_str(), dedup.size());
+        dassert(srcml_archive_is_dedup(archive), 1);
+
+        srcml_unit* a = srcml_archive_read_unit(archive);
+        srcml_unit* b = srcml_archive_read_unit(archive);
+        srcml_unit* c = srcml_archive_read_unit(archive);
+
+        dassert(srcml_unit_get_filename(b), std::string("b.cpp"));
+        dassert(srcml_unit_get_hash(b), std::string(srcml_unit_get_hash(a)));
+        dassert(srcml_unit_get_srcml_inner(b), std::string(srcml_unit_get_srcml_inner(a)));
+        dassert(srcml_unit_get_loc(b), 1);
+        dassert(count(srcml_unit_get_srcml(b), "ref=\""), 0);
+
+        char* src = 0;
+        size_t size = 0;
+        srcml_unit_unparse_memory(b, &src, &size);
+        dassert(std::string(src, size), "a;\n");
+        srcml_memory_free(src);
+
+        dassert(srcml_unit_get_srcml_inner(c), std::string("<expr_stmt><expr><name>c</name></expr>;</expr_stmt>\n"));
+
+        srcml_unit_free(a);
+        srcml_unit_free(b);
+        srcml_unit_free(c);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    // the unit referred to is skipped
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_dedup_expand(archive, 1024);
+        srcml_archive_read_open_memory(archive, dedup.c_str(), dedup.size());
+
+        dassert(srcml_archive_skip_unit(archive), 1);
+        srcml_unit* b = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_srcml_inner(b), std::string("<expr_stmt><expr><name>a</name></expr>;</expr_stmt>\n"));
+
+        srcml_unit_free(b);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    // expanded when written without dedup
+    {
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_set_dedup_expand(iarchive, 1024);
+        srcml_archive_read_open_memory(iarchive, dedup.c_str(), dedup.size());
+
+        srcml_archive* oarchive = srcml_archive_create();
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_archive_write_open_memory(oarchive, &buffer, &size);
+
+        while (srcml_unit* unit = srcml_archive_read_unit_header(iarchive)) {
+            srcml_archive_write_unit(oarchive, unit);
+            srcml_unit_free(unit);
+        }
+
+        srcml_archive_close(oarchive);
+        srcml_archive_free(oarchive);
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+
+        std::string srcml(buffer, size);
+        srcml_memory_free(buffer);
+
+        dassert(count(srcml, "ref=\""), 0);
+        dassert(count(srcml, "<name>a</name>"), 2);
+    }
+
+    // not expanded by default, or when the contents are larger than the maximum size,
+    // so only written as a reference, and without srcML or source of its own
+    for (size_t max_size : { 0, 1 }) {
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_set_dedup_expand(iarchive, max_size);
+        srcml_archive_read_open_memory(iarchive, dedup.c_str(), dedup.size());
+
+        srcml_archive* oarchive = srcml_archive_create();
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_archive_write_open_memory(oarchive, &buffer, &size);
+
+        srcml_unit* a = srcml_archive_read_unit(iarchive);
+        srcml_unit* b = srcml_archive_read_unit(iarchive);
+        dassert(srcml_unit_get_srcml(b), 0);
+        dassert(srcml_unit_get_srcml_outer(b), 0);
+        dassert(srcml_unit_get_srcml_inner(b), 0);
+
+        char* src = 0;
+        size_t src_size = 0;
+        dassert(srcml_unit_unparse_memory(b, &src, &src_size), SRCML_STATUS_INVALID_INPUT);
+
+        // only a reference that could have been expanded is an error of the read
+        dassert(srcml_unit_error_number(b), (max_size ? SRCML_STATUS_INVALID_INPUT : 0));
+        dassert(srcml_archive_error_number(iarchive), (max_size ? SRCML_STATUS_INVALID_INPUT : 0));
+
+        dassert(srcml_archive_write_unit(oarchive, a), SRCML_STATUS_OK);
+        dassert(srcml_archive_write_unit(oarchive, b), SRCML_STATUS_INVALID_INPUT);
+
+        srcml_unit_free(a);
+        srcml_unit_free(b);
+        srcml_archive_close(oarchive);
+        srcml_archive_free(oarchive);
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+        srcml_memory_free(buffer);
+    }
+
+    {
+        dassert(srcml_archive_set_dedup_expand(0, 1024), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_dedup_expand(0), 0);
+    }
+
+    /*
+      srcml_unit_set_duplicate
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_enable_dedup(archive);
+        char* buffer = 0;
+        size_t size = 0;
+        srcml_archive_write_open_memory(archive, &buffer, &size);
+
+        srcml_unit* a = srcml_unit_create(archive);
+        srcml_unit_set_language(a, "C++");
+        srcml_unit_set_filename(a, "a.cpp");
+        srcml_unit_parse_memory(a, "a;\n", 3);
+        srcml_archive_write_unit(archive, a);
+
+        srcml_unit* b = srcml_unit_create(archive);
+        srcml_unit_set_language(b, "C++");
+        srcml_unit_set_filename(b, "b.cpp");
+        dassert(srcml_unit_set_duplicate(b, srcml_unit_get_hash(a)), SRCML_STATUS_OK);
+        dassert(srcml_archive_write_unit(archive, b), SRCML_STATUS_OK);
+
+        // not the same as a unit written before
+        srcml_unit* c = srcml_unit_create(archive);
+        srcml_unit_set_language(c, "C++");
+        srcml_unit_set_filename(c, "c.cpp");
+        dassert(srcml_unit_set_duplicate(c, "0000000000000000000000000000000000000000"), SRCML_STATUS_OK);
+        dassert(srcml_archive_write_unit(archive, c), SRCML_STATUS_INVALID_INPUT);
+
+        srcml_unit_free(a);
+        srcml_unit_free(b);
+        srcml_unit_free(c);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        std::string srcml(buffer, size);
+        srcml_memory_free(buffer);
+
+        dassert(count(srcml, "filename=\"b.cpp\""), 1);
+        dassert(count(srcml, "ref=\"1\""), 1);
+        dassert(count(srcml, "filename=\"c.cpp\""), 0);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        dassert(srcml_unit_set_duplicate(0, "0000000000000000000000000000000000000000"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_unit_set_duplicate(unit, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
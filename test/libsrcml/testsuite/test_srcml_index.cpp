@@ -0,0 +1,189 @@
+/**
+ * @file test_srcml_index.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for the element index
+*/
+
+#include <srcml.h>
+
+#include <string>
+#include <fstream>
+
+#include <dassert.hpp>
+
+int main(int, char* argv[]) {
+
+    const std::string srcml = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit language="C" filename="a.c"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit language="C" filename="b.c"><cpp:define>#<cpp:directive>define</cpp:directive> <cpp:macro><name>B</name></cpp:macro></cpp:define>
+<function><type><name>int</name></type> <name>f</name><parameter_list>()</parameter_list> <block>{<block_content> <return>return <expr><literal type="number">0</literal></expr>;</return> </block_content>}</block></function>
+</unit>
+
+</unit>
+)";
+
+    std::ofstream srcml_file("project.xml");
+    srcml_file << srcml;
+    srcml_file.close();
+
+    /*
+      srcml_archive_set_index_filename
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_set_index_filename(archive, "write.xml.idx"), SRCML_STATUS_OK);
+        srcml_archive_write_open_filename(archive, "write.xml");
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_set_filename(unit, "a.cpp");
+        srcml_unit_parse_memory(unit, "a; b;\n", 6);
+        srcml_archive_write_unit(archive, unit);
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        srcml_index* index = srcml_index_read_filename("write.xml.idx");
+        dassert(!index, false);
+        dassert(srcml_index_get_unit_size(index), 1);
+        dassert(srcml_index_get_unit_filename(index, 0), std::string("a.cpp"));
+        dassert(srcml_index_get_unit_language(index, 0), std::string("C++"));
+        dassert(srcml_index_get_element_total(index, "src:expr_stmt"), 2);
+        dassert(srcml_index_get_element_count(index, 0, "src:name"), 2);
+        dassert(srcml_index_is_current(index, "write.xml"), 1);
+        srcml_index_free(index);
+    }
+
+    {
+        dassert(srcml_archive_set_index_filename(0, "write.xml.idx"), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      srcml_index_build
+    */
+
+    {
+        dassert(srcml_index_build("project.xml", "project.xml.idx"), SRCML_STATUS_OK);
+    }
+
+    {
+        dassert(srcml_index_build(0, "project.xml.idx"), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    {
+        dassert(srcml_index_build("project.xml", 0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      srcml_index_read_filename
+    */
+
+    {
+        srcml_index* index = srcml_index_read_filename("project.xml.idx");
+        dassert(!index, false);
+        dassert(srcml_index_get_unit_size(index), 2);
+        dassert(srcml_index_get_unit_filename(index, 1), std::string("b.c"));
+        dassert(srcml_index_get_unit_language(index, 1), std::string("C"));
+        dassert(srcml_index_get_unit_version(index, 1), 0);
+        dassert(srcml_index_get_unit_filename(index, 2), 0);
+        srcml_index_free(index);
+    }
+
+    {
+        dassert(srcml_index_read_filename("project.xml"), 0);
+    }
+
+    {
+        dassert(srcml_index_read_filename(0), 0);
+    }
+
+    /*
+      srcml_index_get_element_*
+    */
+
+    {
+        srcml_index* index = srcml_index_read_filename("project.xml.idx");
+
+        dassert(srcml_index_get_element_total(index, "src:name"), 4);
+        dassert(srcml_index_get_element_total(index, "name"), 4);
+        dassert(srcml_index_get_element_total(index, "cpp:define"), 1);
+        dassert(srcml_index_get_element_total(index, "define"), 0);
+        dassert(srcml_index_get_element_total(index, "src:unit"), 0);
+        dassert(srcml_index_get_element_total(index, "x:name"), 0);
+
+        dassert(srcml_index_get_element_unit_size(index, "src:name"), 2);
+        dassert(srcml_index_get_element_unit_size(index, "src:function"), 1);
+        dassert(srcml_index_get_element_unit(index, "src:function", 0), 1);
+        dassert(srcml_index_get_element_unit(index, "src:function", 1), -1);
+
+        dassert(srcml_index_get_element_count(index, 0, "src:name"), 1);
+        dassert(srcml_index_get_element_count(index, 1, "src:name"), 3);
+        dassert(srcml_index_get_element_count(index, 0, "src:function"), 0);
+        dassert(srcml_index_get_element_count(index, 2, "src:name"), 0);
+
+        dassert(srcml_index_get_element_position(index, 0, "src:expr_stmt", 0), 0);
+        dassert(srcml_index_get_element_position(index, 0, "src:name", 0), 16);
+        dassert(srcml_index_get_element_position(index, 0, "src:name", 1), -1);
+        dassert(srcml_index_get_element_position(index, 1, "cpp:define", 0), 0);
+
+        srcml_index_free(index);
+    }
+
+    /*
+      srcml_index_is_current
+    */
+
+    {
+        srcml_index* index = srcml_index_read_filename("project.xml.idx");
+        dassert(srcml_index_is_current(index, "project.xml"), 1);
+
+        // a change made right after indexing, in the same second
+        std::ofstream changed("project.xml", std::ios::app);
+        changed << '\n';
+        changed.close();
+        dassert(srcml_index_is_current(index, "project.xml"), 0);
+
+        dassert(srcml_index_is_current(index, "write.xml"), 0);
+        dassert(srcml_index_is_current(index, "missing.xml"), 0);
+        srcml_index_free(index);
+    }
+
+    {
+        dassert(srcml_index_is_current(0, "project.xml"), 0);
+    }
+
+    {
+        dassert(srcml_index_get_unit_size(0), 0);
+        dassert(srcml_index_get_unit_filename(0, 0), 0);
+        dassert(srcml_index_get_element_total(0, "src:name"), 0);
+        dassert(srcml_index_get_element_count(0, 0, "src:name"), 0);
+        dassert(srcml_index_get_element_position(0, 0, "src:name", 0), -1);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -317,6 +317,231 @@ int main(int, char* argv[]) {
         dassert(srcml_archive_read_unit(0), 0);
     }
 
+    /*
+      srcml_archive_read_unit_header
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_two.c_str(), srcml_two.size());
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_language(unit), std::string("C"));
+        dassert(srcml_unit_get_filename(unit), std::string("project.c"));
+        dassert(srcml_unit_get_srcml_outer(unit), srcml_a);
+        dassert(srcml_unit_get_loc(unit), 1);
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_language(unit), std::string("C"));
+        dassert(srcml_unit_get_filename(unit), std::string("project.c"));
+        dassert(srcml_unit_get_srcml_inner(unit), std::string("<expr_stmt><expr><name>b</name></expr>;</expr_stmt>\n"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit_header(archive);
+        dassert(unit, 0);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_two.c_str(), srcml_two.size());
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        srcml_unit* unit2 = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_srcml_outer(unit), 0);
+        dassert(srcml_unit_get_srcml_outer(unit2), srcml_b_two);
+        srcml_unit_free(unit);
+        srcml_unit_free(unit2);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        const std::string srcml_loc = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" language="C" filename="project.c" loc="2"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+<expr_stmt><expr><name>a</name></expr>;</expr_stmt></unit>
+
+</unit>
+)";
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_loc.c_str(), srcml_loc.size());
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_loc(unit), 2);
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcml_archive_set_read_content
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_read_content(archive, SRCML_READ_CONTENT_SRCML);
+        srcml_archive_read_open_memory(archive, srcml_two.c_str(), srcml_two.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_srcml_outer(unit), srcml_a);
+        dassert(srcml_unit_get_loc(unit), 1);
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_read_content(archive, SRCML_READ_CONTENT_SRC);
+        srcml_archive_read_open_memory(archive, srcml_two.c_str(), srcml_two.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("project.c"));
+        dassert(srcml_unit_get_srcml_outer(unit), 0);
+        dassert(srcml_unit_get_loc(unit), 1);
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcml_archive_set_unit_filter
+    */
+
+    {
+        const std::string srcml_languages = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" language="C" filename="a.c"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" language="C++" filename="b.cpp"><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+</unit>
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" language="C" filename="c.c"><expr_stmt><expr><name>c</name></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_unit_filter(archive, "@language='C'");
+        srcml_archive_read_open_memory(archive, srcml_languages.c_str(), srcml_languages.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a.c"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("c.c"));
+        dassert(srcml_unit_get_srcml_inner(unit), std::string("<expr_stmt><expr><name>c</name></expr>;</expr_stmt>\n"));
+        srcml_unit_free(unit);
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_unit_filter(archive, "starts-with(@filename, 'b')");
+        srcml_archive_read_open_memory(archive, srcml_languages.c_str(), srcml_languages.size());
+        unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_language(unit), std::string("C++"));
+        srcml_unit_free(unit);
+        dassert(srcml_archive_read_unit_header(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_unit_filter(archive, "@language='Java'");
+        srcml_archive_read_open_memory(archive, srcml_languages.c_str(), srcml_languages.size());
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        const std::string srcml_attributes = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src">
+
+<unit revision="0.9.5" language="C" filename="a.c" loc="1"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit language="C" url="project" filename="b.c" loc="2"><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+<expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+</unit>
+
+<unit language="C" filename="c.c"><expr_stmt><expr><name>c</name></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+        for (const auto& test : { std::make_pair("@revision='0.9.5'", "a.c"),
+                                  std::make_pair("@url='project'", "b.c"),
+                                  std::make_pair("@loc='2'", "b.c") }) {
+
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_set_unit_filter(archive, test.first);
+            srcml_archive_read_open_memory(archive, srcml_attributes.c_str(), srcml_attributes.size());
+            srcml_unit* unit = srcml_archive_read_unit_header(archive);
+            dassert(srcml_unit_get_filename(unit), std::string(test.second));
+            srcml_unit_free(unit);
+            dassert(srcml_archive_read_unit_header(archive), 0);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+        }
+
+        // without the attribute, the unit does not satisfy the filter
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_unit_filter(archive, "@loc");
+        srcml_archive_read_open_memory(archive, srcml_attributes.c_str(), srcml_attributes.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a.c"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("b.c"));
+        srcml_unit_free(unit);
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcDiff revision
+    */
+
+    {
+        const std::string srcml_diff = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:diff="http://www.srcML.org/srcDiff">
+
+<unit language="C" filename="project.c"><expr_stmt><expr><diff:delete type="replace"><name>a</name></diff:delete><diff:insert type="replace"><name>b</name></diff:insert></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+        for (size_t revision : { SRCDIFF_REVISION_ORIGINAL, SRCDIFF_REVISION_MODIFIED }) {
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_set_srcdiff_revision(archive, revision);
+            srcml_archive_read_open_memory(archive, srcml_diff.c_str(), srcml_diff.size());
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            dassert(srcml_unit_get_srcml_inner(unit), std::string("<expr_stmt><expr><name>") + (revision == SRCDIFF_REVISION_ORIGINAL ? "a" : "b") + "</name></expr>;</expr_stmt>\n");
+            char* s = 0;
+            size_t size = 0;
+            srcml_unit_unparse_memory(unit, &s, &size);
+            dassert(s, std::string(revision == SRCDIFF_REVISION_ORIGINAL ? "a;\n" : "b;\n"));
+            srcml_memory_free(s);
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+        }
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_read_unit_header(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_read_unit_header(0), 0);
+    }
+
     srcml_cleanup_globals();
 
     return 0;
@@ -418,6 +418,33 @@ int main(int, char* argv[]) {
         srcml_archive_free(archive);
     }
 
+    {
+        const std::string srcml_markup = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src">
+
+<unit language="C" filename="project.c"><expr_stmt><expr><name>a</name> <operator>&lt;</operator> <name>b</name> <operator>&amp;&amp;</operator> <literal type="char">'<escape char="0x0c"/>'</literal></expr>;</expr_stmt><comment type="line">// x</comment>
+</unit>
+
+</unit>
+)";
+
+        char* s;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_read_content(archive, SRCML_READ_CONTENT_SRCML);
+        srcml_archive_read_open_memory(archive, srcml_markup.c_str(), srcml_markup.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        srcml_unit_set_eol(unit, SOURCE_OUTPUT_EOL_CRLF);
+
+        dassert(srcml_unit_unparse_memory(unit, &s, &size), SRCML_STATUS_OK);
+        dassert(s, std::string("a < b && '\f';// x\r\n"));
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+    }
+
     /*
       srcml_unit_unparse_FILE
     */